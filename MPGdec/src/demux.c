@@ -0,0 +1,373 @@
+/*
+ * 
+ * This file is part of the ALPBench Benchmark Suite Version 1.0
+ * 
+ * Copyright (c) 2005 The Board of Trustees of the University of Illinois
+ * 
+ * All rights reserved.
+ * 
+ * ALPBench is a derivative of several codes, and restricted by licenses
+ * for those codes, as indicated in the source files and the ALPBench
+ * license at http://www.cs.uiuc.edu/alp/alpbench/alpbench-license.html
+ * 
+ * The multithreading and SSE2 modifications for SpeechRec, FaceRec,
+ * MPEGenc, and MPEGdec were done by Man-Lap (Alex) Li and Ruchira
+ * Sasanka as part of the ALP research project at the University of
+ * Illinois at Urbana-Champaign (http://www.cs.uiuc.edu/alp/), directed
+ * by Prof. Sarita V. Adve, Dr. Yen-Kuang Chen, and Dr. Eric Debes.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal with the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimers.
+ * 
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimers in the documentation and/or other materials provided
+ *       with the distribution.
+ * 
+ *     * Neither the names of Professor Sarita Adve's research group, the
+ *       University of Illinois at Urbana-Champaign, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this Software without specific prior written permission.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE
+ * SOFTWARE.
+ * 
+ */
+
+
+
+/* demux.c, program and transport stream demultiplexer                   */
+
+/*
+ * With ZERO_COPY the whole input is in memory (Map_Buffer()).  When it
+ * is a program stream (ISO/IEC 13818-1, or an ISO/IEC 11172-1 system
+ * stream) or a transport stream, Demux_Input() collects the payload of
+ * every video elementary stream into a buffer of its own before any
+ * decoding.  Decode_Streams() in mpeg2dec.c then decodes the streams,
+ * with FRAME_THRD all at once: every stream has a parser thread of its
+ * own, and the parsers share the slice workers.  In a transport stream
+ * the video PIDs are the ones of stream_type 1 or 2 in the PMTs the PAT
+ * lists; without a PAT, every PID that carries video PES packets is
+ * taken.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "global.h"
+
+#ifdef ZERO_COPY
+
+#define DEMUX_STREAMS 16
+#define TS_PACKET 188
+
+typedef struct {
+  int id;               /* stream_id, or PID in a transport stream */
+  int program;          /* program_number, transport streams only */
+  int started;          /* a PES packet start has been seen */
+  int cc;               /* last continuity_counter */
+  unsigned char *data;  /* the elementary stream */
+  long size, alloc;
+} Demux_Stream;
+
+static Demux_Stream demux[DEMUX_STREAMS];
+static int demux_count;
+
+static Demux_Stream *Demux_Find _ANSI_ARGS_((int id, int program, int add));
+static void Demux_Append _ANSI_ARGS_((Demux_Stream *s, unsigned char *p,
+  long n));
+static int PES_Header _ANSI_ARGS_((unsigned char *p, int n));
+static void Demux_PS _ANSI_ARGS_((unsigned char *p, unsigned char *end));
+static int TS_Payload _ANSI_ARGS_((unsigned char *p));
+static void TS_PSI _ANSI_ARGS_((unsigned char *p, unsigned char *end));
+static void Demux_TS _ANSI_ARGS_((unsigned char *p, unsigned char *end));
+
+/* the stream with the given id, added if add is set and there is room */
+static Demux_Stream *Demux_Find(id, program, add)
+int id, program, add;
+{
+  int k;
+
+  for (k=0; k<demux_count; k++)
+    if (demux[k].id==id)
+      return &demux[k];
+
+  if (!add || demux_count==DEMUX_STREAMS)
+    return NULL;
+
+  demux[demux_count].id = id;
+  demux[demux_count].program = program;
+  demux[demux_count].cc = -1;
+  return &demux[demux_count++];
+}
+
+static void Demux_Append(s, p, n)
+Demux_Stream *s;
+unsigned char *p;
+long n;
+{
+  if (n<=0)
+    return;
+  if (s->size+n > s->alloc)
+  {
+    s->alloc = s->alloc ? s->alloc<<1 : 1<<20;
+    while (s->size+n > s->alloc)
+      s->alloc <<= 1;
+    if (!(s->data = (unsigned char *) realloc(s->data, s->alloc)))
+      Error("realloc failed\n");
+  }
+  memcpy(s->data+s->size, p, n);
+  s->size += n;
+}
+
+/* length of the header of the PES packet at p (n bytes available) */
+static int PES_Header(p, n)
+unsigned char *p;
+int n;
+{
+  int i;
+
+  if (n<9)
+    return n;
+
+  if ((p[6]>>6)==2)
+    /* ISO/IEC 13818-1 PES header */
+    i = 9 + p[8];
+  else
+  {
+    /* ISO/IEC 11172-1 packet header: stuffing, STD buffer, time stamps */
+    for (i=6; i<n && p[i]==0xff; i++)
+      ;
+    if (i<n && (p[i]>>6)==1)
+      i += 2;
+    if (i<n)
+      i += ((p[i]>>4)==2) ? 5 : ((p[i]>>4)==3) ? 10 : 1;
+  }
+
+  return i<n ? i : n;
+}
+
+/* program stream: packs, system headers and PES packets */
+static void Demux_PS(p, end)
+unsigned char *p, *end;
+{
+  Demux_Stream *s;
+  unsigned char *q;
+  long len;
+
+  while ((p = find_start_code(p, end))+6 <= end)
+  {
+    if (p[3]==(PACK_START_CODE&255))
+    {
+      /* MPEG-2 pack headers are 14 bytes plus stuffing, MPEG-1 ones 12 */
+      if ((p[4]>>6)==1)
+        p += (p+14 <= end) ? 14 + (p[13]&7) : 14;
+      else
+        p += 12;
+    }
+    else if (p[3]>=(SYSTEM_START_CODE&255))
+    {
+      /* system header or PES packet */
+      len = (p[4]<<8) | p[5];
+      q = (p+6+len <= end) ? p+6+len : end;
+      if ((p[3]&0xf0)==0xe0 && (s = Demux_Find(p[3], 0, 1)))
+        Demux_Append(s, p+PES_Header(p, q-p), q-p-PES_Header(p, q-p));
+      p = q;
+    }
+    else
+      p += 4;   /* program end code, or garbage */
+  }
+}
+
+/* offset of the payload of the transport packet at p, 0 if none */
+static int TS_Payload(p)
+unsigned char *p;
+{
+  int i;
+
+  if (p[1]&0x80)                /* transport_error_indicator */
+    return 0;
+  if (!(p[3]&0x10))             /* no payload */
+    return 0;
+  i = (p[3]&0x20) ? 5 + p[4] : 4;
+  return i<TS_PACKET ? i : 0;
+}
+
+/* find the video PIDs: PAT, then PMTs (sections within one packet) */
+static void TS_PSI(p, end)
+unsigned char *p, *end;
+{
+  int pid, i, n, k, program, pmt[DEMUX_STREAMS], pmts;
+  unsigned char *sec;
+
+  pmts = 0;
+  for (; p+TS_PACKET <= end; p += TS_PACKET)
+  {
+    if (p[0]!=0x47 || !(p[1]&0x40) || !(i = TS_Payload(p)))
+      continue;
+    pid = ((p[1]&0x1f)<<8) | p[2];
+    sec = p + i + 1 + p[i];     /* skip pointer_field */
+    if (sec+12 > p+TS_PACKET)
+      continue;
+    n = ((sec[1]&0x0f)<<8) | sec[2];    /* section_length */
+    if (sec+3+n > p+TS_PACKET)
+      n = p+TS_PACKET-sec-3;
+
+    if (pid==0 && sec[0]==0)
+    {
+      /* program association: program_number, program_map_PID */
+      for (i=8; i+4 <= 3+n-4; i+=4)
+      {
+        program = (sec[i]<<8) | sec[i+1];
+        pid = ((sec[i+2]&0x1f)<<8) | sec[i+3];
+        for (k=0; k<pmts && pmt[k]!=pid; k++)
+          ;
+        if (program && k==pmts && pmts<DEMUX_STREAMS)
+          pmt[pmts++] = pid;
+      }
+    }
+    else if (sec[0]==2)
+    {
+      for (k=0; k<pmts && pmt[k]!=pid; k++)
+        ;
+      if (k==pmts)
+        continue;
+
+      /* program map: stream_type, elementary_PID, ES_info_length */
+      program = (sec[3]<<8) | sec[4];
+      for (i=12+(((sec[10]&0x0f)<<8) | sec[11]); i+5 <= 3+n-4;
+           i+=5+(((sec[i+3]&0x0f)<<8) | sec[i+4]))
+        if (sec[i]==1 || sec[i]==2)
+          Demux_Find(((sec[i+1]&0x1f)<<8) | sec[i+2], program, 1);
+    }
+  }
+}
+
+/* transport stream: the payload of the video PIDs, PES headers removed */
+static void Demux_TS(p, end)
+unsigned char *p, *end;
+{
+  Demux_Stream *s;
+  unsigned char *q;
+  int pid, i, cc, psi;
+
+  TS_PSI(p, end);
+  psi = demux_count>0;
+
+  for (; p+TS_PACKET <= end; p += TS_PACKET)
+  {
+    if (p[0]!=0x47)
+    {
+      /* lost sync: find two packets in a row again */
+      while (p+TS_PACKET < end && !(p[0]==0x47 && p[TS_PACKET]==0x47))
+        p++;
+      if (p+TS_PACKET > end || p[0]!=0x47)
+        break;
+    }
+    if (!(i = TS_Payload(p)))
+      continue;
+
+    pid = ((p[1]&0x1f)<<8) | p[2];
+    q = p + i;
+    if (!psi && (p[1]&0x40) && q+4 <= p+TS_PACKET
+        && !q[0] && !q[1] && q[2]==1 && (q[3]&0xf0)==0xe0)
+      s = Demux_Find(pid, 0, 1);
+    else
+      s = Demux_Find(pid, 0, 0);
+    if (!s)
+      continue;
+
+    /* repeated packets carry the same continuity_counter */
+    cc = p[3]&0x0f;
+    if (cc==s->cc)
+      continue;
+    s->cc = cc;
+
+    if (p[1]&0x40)
+    {
+      /* payload_unit_start_indicator: a PES packet begins here */
+      q += PES_Header(q, p+TS_PACKET-q);
+      s->started = 1;
+    }
+    if (s->started)
+      Demux_Append(s, q, p+TS_PACKET-q);
+  }
+}
+
+/* split the input if it is a program or transport stream; returns the
+   number of video streams found, 0 for an elementary stream */
+int Demux_Input()
+{
+  unsigned char *p, *end;
+  int k, n, ts;
+
+  p = ld->Map;
+  end = ld->Map + ld->Mapsize;
+
+  ts = ld->Mapsize>=TS_PACKET && p[0]==0x47
+       && (ld->Mapsize<2*TS_PACKET || p[TS_PACKET]==0x47);
+  if (!ts && !(ld->Mapsize>=4 && !p[0] && !p[1] && p[2]==1
+               && p[3]==(PACK_START_CODE&255)))
+    return 0;
+
+  if (ts)
+    Demux_TS(p, end);
+  else
+    Demux_PS(p, end);
+
+  /* drop empty streams, pad the others for the bit readers */
+  for (k=n=0; k<demux_count; k++)
+    if (demux[k].size)
+    {
+      demux[n] = demux[k];
+      Map_Memory(demux[n].data, demux[n].size);
+      demux[n].data = ld->Map;
+      if (!Quiet_Flag)
+        fprintf(stderr, "video stream %d: %s 0x%x", n,
+                ts ? "PID" : "stream_id", demux[n].id);
+      if (!Quiet_Flag && demux[n].program)
+        fprintf(stderr, " (program %d)", demux[n].program);
+      if (!Quiet_Flag)
+        fprintf(stderr, ", %ld bytes\n", demux[n].size);
+      n++;
+    }
+    else
+      free(demux[k].data);
+  demux_count = n;
+
+  if (!n)
+  {
+    sprintf(Error_Text,"No video stream in %s\n",Main_Bitstream_Filename);
+    Error(Error_Text);
+  }
+
+  Demux_Select(0);
+  return n;
+}
+
+/* make video stream k the input of the decoder */
+void Demux_Select(k)
+int k;
+{
+  ld = &base;
+  ld->Map = demux[k].data;
+  ld->Mapsize = demux[k].size;
+}
+
+#endif /* ZERO_COPY */
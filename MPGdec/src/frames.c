@@ -0,0 +1,241 @@
+/*
+ * 
+ * This file is part of the ALPBench Benchmark Suite Version 1.0
+ * 
+ * Copyright (c) 2005 The Board of Trustees of the University of Illinois
+ * 
+ * All rights reserved.
+ * 
+ * ALPBench is a derivative of several codes, and restricted by licenses
+ * for those codes, as indicated in the source files and the ALPBench
+ * license at http://www.cs.uiuc.edu/alp/alpbench/alpbench-license.html
+ * 
+ * The multithreading and SSE2 modifications for SpeechRec, FaceRec,
+ * MPEGenc, and MPEGdec were done by Man-Lap (Alex) Li and Ruchira
+ * Sasanka as part of the ALP research project at the University of
+ * Illinois at Urbana-Champaign (http://www.cs.uiuc.edu/alp/), directed
+ * by Prof. Sarita V. Adve, Dr. Yen-Kuang Chen, and Dr. Eric Debes.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal with the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimers.
+ * 
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimers in the documentation and/or other materials provided
+ *       with the distribution.
+ * 
+ *     * Neither the names of Professor Sarita Adve's research group, the
+ *       University of Illinois at Urbana-Champaign, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this Software without specific prior written permission.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE
+ * SOFTWARE.
+ * 
+ */
+
+
+
+/* frames.c, frame buffer pool                                           */
+
+/*
+ * Every picture buffer (reference, auxiliary, substitute and lower layer
+ * frames) comes from here.  A frame is one allocation holding its three
+ * planes; each plane starts on a FRAME_ALIGN boundary and has FRAME_EDGE
+ * rows of padding above and below it, so wide loads past the last pel
+ * and predictions reaching outside the picture stay inside the buffer.
+ * The stride is unchanged (Coded_Picture_Width, Chroma_Width).
+ *
+ * Frames are reference counted.  Whoever wants to keep a frame past the
+ * point where the decoder may reuse it (the stream writer thread) takes
+ * a reference with Frame_Hold(); before decoding into a frame the
+ * decoder calls Frame_Own(), which swaps in another buffer from the pool
+ * if the frame is still held.  Released frames stay in the pool, so a
+ * new sequence of the same size allocates nothing.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef THRD
+#include <pthread.h>
+#endif
+
+#include "config.h"
+#include "global.h"
+
+#define FRAME_ALIGN 64
+#define FRAME_EDGE 32
+
+typedef struct frame_buffer {
+  unsigned char *mem;
+  unsigned char *frame[3];
+  int width, height, chroma_width, chroma_height;
+  int refs;
+  struct frame_buffer *next;
+} Frame_Buffer;
+
+static Frame_Buffer *pool;
+
+#ifdef THRD
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+#define POOL_LOCK() pthread_mutex_lock(&pool_lock)
+#define POOL_UNLOCK() pthread_mutex_unlock(&pool_lock)
+#else
+#define POOL_LOCK()
+#define POOL_UNLOCK()
+#endif
+
+#define ALIGN_UP(n) (((n) + FRAME_ALIGN-1) & ~(long)(FRAME_ALIGN-1))
+
+static Frame_Buffer *Frame_Alloc _ANSI_ARGS_((int width, int height,
+  int chroma_width, int chroma_height));
+static Frame_Buffer *Frame_Find _ANSI_ARGS_((unsigned char *p));
+
+/* a new frame: padding, then the plane, then padding, for each plane */
+static Frame_Buffer *Frame_Alloc(width, height, chroma_width, chroma_height)
+int width, height, chroma_width, chroma_height;
+{
+  Frame_Buffer *f;
+  long size, edge[3], plane[3];
+  int cc, w;
+  unsigned char *p;
+
+  size = 0;
+  for (cc=0; cc<3; cc++)
+  {
+    w = cc ? chroma_width : width;
+    edge[cc] = ALIGN_UP((long)FRAME_EDGE*w);
+    plane[cc] = ALIGN_UP((long)w*(cc ? chroma_height : height));
+    size += 2*edge[cc] + plane[cc];
+  }
+
+  if (!(f = (Frame_Buffer *) malloc(sizeof(Frame_Buffer))) ||
+      posix_memalign((void **)&f->mem, FRAME_ALIGN, size))
+    Error("frame buffer malloc failed\n");
+
+  /* grey, so stray predictions are at least deterministic */
+  memset(f->mem, 128, size);
+
+  p = f->mem;
+  for (cc=0; cc<3; cc++)
+  {
+    f->frame[cc] = p + edge[cc];
+    p += 2*edge[cc] + plane[cc];
+  }
+  f->width = width;
+  f->height = height;
+  f->chroma_width = chroma_width;
+  f->chroma_height = chroma_height;
+  return f;
+}
+
+/* the pool frame whose luminance plane is at p, or NULL */
+static Frame_Buffer *Frame_Find(p)
+unsigned char *p;
+{
+  Frame_Buffer *f;
+
+  for (f=pool; f && f->frame[0]!=p; f=f->next)
+    ;
+  return f;
+}
+
+/* a frame of the given size with one reference; idle frames of another
+   size are freed on the way */
+void Frame_New(frame, width, height, chroma_width, chroma_height)
+unsigned char *frame[3];
+int width, height, chroma_width, chroma_height;
+{
+  Frame_Buffer *f, **pp;
+  int cc;
+
+  POOL_LOCK();
+  for (pp=&pool; (f = *pp); )
+  {
+    if (!f->refs && f->width==width && f->height==height
+        && f->chroma_width==chroma_width && f->chroma_height==chroma_height)
+      break;
+    if (!f->refs)
+    {
+      *pp = f->next;
+      free(f->mem);
+      free(f);
+    }
+    else
+      pp = &f->next;
+  }
+  if (!f)
+  {
+    f = Frame_Alloc(width, height, chroma_width, chroma_height);
+    f->next = pool;
+    pool = f;
+  }
+  f->refs = 1;
+  POOL_UNLOCK();
+
+  for (cc=0; cc<3; cc++)
+    frame[cc] = f->frame[cc];
+}
+
+/* take another reference; 0 if frame is not from the pool */
+int Frame_Hold(frame)
+unsigned char *frame[3];
+{
+  Frame_Buffer *f;
+
+  POOL_LOCK();
+  if ((f = Frame_Find(frame[0])))
+    f->refs++;
+  POOL_UNLOCK();
+  return f!=NULL;
+}
+
+/* drop a reference; the frame goes back to the pool with the last one */
+void Frame_Release(frame)
+unsigned char *frame[3];
+{
+  Frame_Buffer *f;
+  int cc;
+
+  POOL_LOCK();
+  if ((f = Frame_Find(frame[0])) && f->refs>0)
+    f->refs--;
+  POOL_UNLOCK();
+
+  for (cc=0; cc<3; cc++)
+    frame[cc] = NULL;
+}
+
+/* about to decode into frame: if anyone else still holds it, leave it
+   to them and continue with a fresh frame of the same size */
+void Frame_Own(frame)
+unsigned char *frame[3];
+{
+  Frame_Buffer *f;
+
+  POOL_LOCK();
+  f = Frame_Find(frame[0]);
+  if (f && f->refs>1)
+    f->refs--;
+  else
+    f = NULL;
+  POOL_UNLOCK();
+
+  if (f)
+    Frame_New(frame, f->width, f->height, f->chroma_width, f->chroma_height);
+}
@@ -87,16 +87,51 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <assert.h>
+#ifdef ZERO_COPY
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
 
 #include "config.h"
 #include "global.h"
 
+/* the input is read RDBFR_SIZE bytes at a time; INPUT_PAD bytes of
+   sequence end codes are kept behind the data at the end of the input,
+   so the readers may look ahead past the last start code */
+#define RDBFR_SIZE (1<<21)
+#define INPUT_PAD 4096
+#ifdef ZERO_COPY
+#define READ_CHUNK (1<<20)
+#endif
+
+static long Read_Input _ANSI_ARGS_((unsigned char *p, long n));
+static void Pad_Buffer _ANSI_ARGS_((unsigned char *p, long n));
+static void Refill_Buffer _ANSI_ARGS_((void));
+#ifdef ZERO_COPY
+static void Map_Pad _ANSI_ARGS_((unsigned char *p, long size));
+#endif
+
 /* initialize buffer, call once before first getbits or showbits */
 
 void Initialize_Buffer()
 {
+#ifdef ZERO_COPY
+  if (ld->Map)
+  {
+    ld->Rdbfr = ld->Map;
+    ld->Rdend = ld->Map + ((ld->Mapsize+3)&~3) + INPUT_PAD;
+  }
+  else
+#endif
+  {
+    if (!ld->Rdbfr &&
+        !(ld->Rdbfr = (unsigned char *) malloc(RDBFR_SIZE+INPUT_PAD)))
+      Error("malloc failed\n");
+    ld->Rdend = ld->Rdbfr;
+  }
   ld->Incnt = 0;
-  ld->Rdptr = ld->Rdbfr + 2048;
+  ld->Rdptr = ld->Rdbfr;
   ld->Rdmax = ld->Rdptr;
 
 #ifdef VERIFY
@@ -112,50 +147,74 @@ void Initialize_Buffer()
   Flush_Buffer(0); /* fills valid data into bfr */
 }
 
+/* called when Rdptr has run past Rdend; Rdptr and Rdmax keep their
+   position relative to the stream */
 void Fill_Buffer()
 {
-  int Buffer_Level;
+  long Buffer_Level;
 
-  Buffer_Level = read(ld->Infile,ld->Rdbfr,2048);
-  ld->Rdptr = ld->Rdbfr;
+#ifdef ZERO_COPY
+  if (ld->Map)
+  {
+    /* past the padding: keep returning sequence end codes */
+    ld->Rdptr = ld->Map + ((ld->Mapsize+3)&~3);
+    return;
+  }
+#endif
 
+  ld->Rdptr = ld->Rdbfr + (ld->Rdptr - ld->Rdend);
   if (System_Stream_Flag)
-    ld->Rdmax -= 2048;
+    ld->Rdmax = ld->Rdbfr + (ld->Rdmax - ld->Rdend);
+
+  Buffer_Level = Read_Input(ld->Rdbfr, RDBFR_SIZE);
 
-  
   /* end of the bitstream file */
-  if (Buffer_Level < 2048)
+  if (Buffer_Level < RDBFR_SIZE)
   {
-    /* just to be safe */
-    if (Buffer_Level < 0)
-      Buffer_Level = 0;
-
     /* pad until the next to the next 32-bit word boundary */
     while (Buffer_Level & 3)
       ld->Rdbfr[Buffer_Level++] = 0;
 
-	/* pad the buffer with sequence end codes */
-    while (Buffer_Level < 2048)
-    {
-      ld->Rdbfr[Buffer_Level++] = SEQUENCE_END_CODE>>24;
-      ld->Rdbfr[Buffer_Level++] = SEQUENCE_END_CODE>>16;
-      ld->Rdbfr[Buffer_Level++] = SEQUENCE_END_CODE>>8;
-      ld->Rdbfr[Buffer_Level++] = SEQUENCE_END_CODE&0xff;
-    }
+    /* pad the buffer with sequence end codes */
+    Pad_Buffer(ld->Rdbfr+Buffer_Level, INPUT_PAD);
+    Buffer_Level += INPUT_PAD;
   }
+  ld->Rdend = ld->Rdbfr + Buffer_Level;
 }
 
+/* read() until n bytes or end of file, pipes return short counts */
+static long Read_Input(p, n)
+unsigned char *p;
+long n;
+{
+  long Level, k;
 
-/* MPEG-1 system layer demultiplexer */
+  for (Level = 0; Level < n; Level += k)
+    if ((k = read(ld->Infile, p+Level, n-Level)) <= 0)
+      break;
+  return Level;
+}
 
-int Get_Byte()
+static void Pad_Buffer(p, n)
+unsigned char *p;
+long n;
 {
-  while(ld->Rdptr >= ld->Rdbfr+2048)
+  for (; n>=4; n-=4)
   {
-    read(ld->Infile,ld->Rdbfr,2048);
-    ld->Rdptr -= 2048;
-    ld->Rdmax -= 2048;
+    *p++ = SEQUENCE_END_CODE>>24;
+    *p++ = SEQUENCE_END_CODE>>16;
+    *p++ = SEQUENCE_END_CODE>>8;
+    *p++ = SEQUENCE_END_CODE&0xff;
   }
+}
+
+
+/* MPEG-1 system layer demultiplexer */
+
+int Get_Byte()
+{
+  while(ld->Rdptr >= ld->Rdend)
+    Fill_Buffer();
   return *ld->Rdptr++;
 }
 
@@ -174,7 +233,7 @@ int Get_Word()
 unsigned int Show_Bits(N)
 int N;
 {
-  return ld->Bfr >> (32-N);
+  return BITS_SHOW(ld->Bfr,N);
 }
 
 
@@ -191,46 +250,19 @@ unsigned int Get_Bits1()
 void Flush_Buffer(N)
 int N;
 {
-  int Incnt;
-
   ld->Bfr <<= N;
 
-  Incnt = ld->Incnt -= N;
-
-  if (Incnt <= 24)
+  if ((ld->Incnt -= N) < 32)
   {
-    if (System_Stream_Flag && (ld->Rdptr >= ld->Rdmax-4))
+    if (ld->Rdptr+4 <= ld->Rdend &&
+        (!System_Stream_Flag || ld->Rdptr+4 <= ld->Rdmax))
     {
-      do
-      {
-        if (ld->Rdptr >= ld->Rdmax)
-          Next_Packet();
-        ld->Bfr |= Get_Byte() << (24 - Incnt);
-        Incnt += 8;
-      }
-      while (Incnt <= 24);
-    }
-    else if (ld->Rdptr < ld->Rdbfr+2044)
-    {
-      do
-      {
-        ld->Bfr |= *ld->Rdptr++ << (24 - Incnt);
-        Incnt += 8;
-      }
-      while (Incnt <= 24);
+      ld->Bfr |= (BITBUF)BITS_WORD(ld->Rdptr) << (32-ld->Incnt);
+      ld->Rdptr += 4;
+      ld->Incnt += 32;
     }
     else
-    {
-      do
-      {
-        if (ld->Rdptr >= ld->Rdbfr+2048)
-          Fill_Buffer();
-        ld->Bfr |= *ld->Rdptr++ << (24 - Incnt);
-        Incnt += 8;
-      }
-      while (Incnt <= 24);
-    }
-    ld->Incnt = Incnt;
+      Refill_Buffer();
   }
 
 #ifdef VERIFY 
@@ -239,6 +271,18 @@ int N;
 
 }
 
+/* byte-wise refill across buffer and packet boundaries */
+static void Refill_Buffer()
+{
+  while (ld->Incnt < 32)
+  {
+    if (System_Stream_Flag && ld->Rdptr >= ld->Rdmax)
+      Next_Packet();
+    ld->Bfr |= (BITBUF)Get_Byte() << (56 - ld->Incnt);
+    ld->Incnt += 8;
+  }
+}
+
 
 /* return next n bits (right adjusted) */
 
@@ -254,6 +298,105 @@ int N;
 }
 
 
+#ifdef ZERO_COPY
+/* Keep the whole input in memory: regular files are mapped, anything
+   else (pipes, stdin) is read in large chunks.  The header parser reads
+   the mapping directly and slice data is decoded in place by the threads
+   (see new_slice() in getpic.c) */
+
+void Map_Buffer()
+{
+  struct stat st;
+  unsigned char *p;
+  long size, len, page, n;
+
+  ld->Map = NULL;
+  ld->Mapsize = 0;
+
+  if (fstat(ld->Infile,&st)==0 && S_ISREG(st.st_mode) && st.st_size>0)
+  {
+    size = st.st_size;
+    page = sysconf(_SC_PAGESIZE);
+    len = (size + page - 1) / page * page;
+
+    /* reserve the padding first, then map the file over its head */
+    p = (unsigned char *) mmap(NULL, len+INPUT_PAD, PROT_READ|PROT_WRITE,
+                               MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (p!=(unsigned char *)MAP_FAILED)
+    {
+      if (mmap(p, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED,
+               ld->Infile, 0)!=(void *)p)
+        munmap(p, len+INPUT_PAD);
+      else
+      {
+        Map_Pad(p, size);
+        return;
+      }
+    }
+  }
+
+  /* not mappable: slurp it */
+  len = READ_CHUNK;
+  size = 0;
+  if (!(p = (unsigned char *) malloc(len+INPUT_PAD)))
+    Error("malloc failed\n");
+  while ((n = read(ld->Infile, p+size, len-size)) > 0)
+  {
+    size += n;
+    if (size==len)
+    {
+      len <<= 1;
+      if (!(p = (unsigned char *) realloc(p, len+INPUT_PAD)))
+        Error("realloc failed\n");
+    }
+  }
+  Map_Pad(p, size);
+}
+
+/* take over a malloc'ed buffer of size bytes as the input (used for the
+   demultiplexed video streams, see demux.c) */
+void Map_Memory(p, size)
+unsigned char *p;
+long size;
+{
+  if (!(p = (unsigned char *) realloc(p, size+4+INPUT_PAD)))
+    Error("realloc failed\n");
+  Map_Pad(p, size);
+}
+
+/* end codes right behind the data, as Fill_Buffer() does */
+static void Map_Pad(p, size)
+unsigned char *p;
+long size;
+{
+  long n;
+
+  for (n = size; n & 3; n++)
+    p[n] = 0;
+  Pad_Buffer(p+n, INPUT_PAD);
+  ld->Map = p;
+  ld->Mapsize = size;
+}
+
+/* input offset of the next unread byte; the bit reader must be
+   byte aligned */
+long Buffer_Offset()
+{
+  return (ld->Rdptr - ld->Map) - (ld->Incnt>>3);
+}
+
+/* restart the bit reader at the given input offset */
+void Seek_Buffer(offset)
+long offset;
+{
+  ld->Rdptr = ld->Map + offset;
+  ld->Incnt = 0;
+  ld->Bfr = 0;
+  Flush_Buffer(0);
+}
+#endif
+
+
 #ifdef THRD 
 /* These are thread-specific functions. They are duplicated so they can operate
    on different buffers */
@@ -262,6 +405,7 @@ void Thrd_Initialize_Buffer(t)
 int t;
 {
   thrd_buf[t] = 0;
+  thrd_Incnt[t] = 0;
   Thrd_Flush_Buffer(t, 0); /* fills valid data into bfr */
 }
 
@@ -289,7 +433,7 @@ unsigned int Thrd_Show_Bits(t, N)
 int t;
 int N;
 {
-  return thrd_buf[t] >> (32-N);
+  return BITS_SHOW(thrd_buf[t],N);
 }
 
 
@@ -307,30 +451,9 @@ void Thrd_Flush_Buffer(t, N)
 int t;
 int N;
 {
-  int Incnt;
-
-  thrd_buf[t] <<= N;
-
-  Incnt = thrd_Incnt[t] -= N;
-  
-  if (Incnt <= 24) {
-    if (System_Stream_Flag && (ld->Rdptr >= ld->Rdmax-4)) {
-      assert(0&&"System_Strem_Flag is 1\n");
-      do {
-        if (ld->Rdptr >= ld->Rdmax)
-          Next_Packet();
-        ld->Bfr |= Get_Byte() << (24 - Incnt);
-        Incnt += 8;
-      } while (Incnt <= 24);
-    }  else {
-      do {
-        thrd_buf[t] |= *thrd_ptr[t]++ << (24 - Incnt);
-        Incnt += 8;
-      }  while (Incnt <= 24);
-    }
-    thrd_Incnt[t] = Incnt;
-  }
-  
+  /* slice data sits in memory with BITS_SLACK (or INPUT_PAD) readable
+     bytes behind it, so there is no end of buffer to check for */
+  BITS_FLUSH(thrd_buf[t], thrd_Incnt[t], thrd_ptr[t], N);
 }
 
 
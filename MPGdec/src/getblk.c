@@ -623,13 +623,21 @@ int comp;
 }
 
 #ifdef THRD
+/* the coefficient loops keep the thread's bit reader in registers */
+#define THRD_DCT_LOAD(t) \
+  (bfr = thrd_buf[t], incnt = thrd_Incnt[t], ptr = thrd_ptr[t])
+#define THRD_DCT_STORE(t) \
+  (thrd_buf[t] = bfr, thrd_Incnt[t] = incnt, thrd_ptr[t] = ptr)
+
 void Thrd_Decode_MPEG2_Intra_Block(t, comp,dc_dct_pred)
      int t;
 int comp;
 int dc_dct_pred[];
 {
-  int val, i, j, sign, nc, cc, run;
+  int val, i, j, sign, nc, cc, run, incnt, pos;
   unsigned int code;
+  BITBUF bfr;
+  unsigned char *ptr;
   DCTtab *tab;
   short *bp;
   int *qmat;
@@ -658,11 +666,14 @@ int dc_dct_pred[];
   bp[0] = val << (3-intra_dc_precision);
 
   nc=0;
+  pos=0;
+
+  THRD_DCT_LOAD(t);
 
   /* decode AC coefficients */
   for (i=1; ; i++)
   {
-    code = Thrd_Show_Bits(t,16);
+    code = BITS_SHOW(bfr,16);
     if (code>=16384 && !intra_vlc_format)
       tab = &DCTtabnext[(code>>12)-4];
     else if (code>=1024)
@@ -694,27 +705,30 @@ int dc_dct_pred[];
       if (!Quiet_Flag)
         printf("invalid Huffman code in Decode_MPEG2_Intra_Block()\n");
       Fault_Flag = 1;
-      return;
+      break;
     }
 
-    Thrd_Flush_Buffer(t,tab->len);
-
     if (tab->run==64) /* end_of_block */
     {
-      return;
+      BITS_FLUSH(bfr,incnt,ptr,tab->len);
+      break;
     }
 
+    /* code and sign, or escape code, run and level, are taken from
+       the cache in one go */
     if (tab->run==65) /* escape */
     {
-      i+= run = Thrd_Get_Bits(t,6);
+      code = BITS_SHOW(bfr,24);
+      BITS_FLUSH(bfr,incnt,ptr,24);
+      i+= run = (code>>12)&63;
 
-      val = Thrd_Get_Bits(t,12);
+      val = code&4095;
       if ((val&2047)==0)
       {
         if (!Quiet_Flag)
           printf("invalid escape in Decode_MPEG2_Intra_Block()\n");
         Fault_Flag = 1;
-        return;
+        break;
       }
       if((sign = (val>=2048)))
         val = 4096 - val;
@@ -723,8 +737,8 @@ int dc_dct_pred[];
     {
       i+= run = tab->run;
       val = tab->level;
-      sign = Thrd_Get_Bits(t,1);
-
+      sign = BITS_SHOW(bfr,tab->len+1)&1;
+      BITS_FLUSH(bfr,incnt,ptr,tab->len+1);
     }
 
     if (i>=64)
@@ -732,17 +746,21 @@ int dc_dct_pred[];
       if (!Quiet_Flag)
         fprintf(stderr,"DCT coeff index (i) out of bounds (intra2)\n");
       Fault_Flag = 1;
-      return;
+      break;
     }
 
     j = scan[ld1->alternate_scan][i];
     val = (val * thrd_ld[t].quantizer_scale * qmat[j]) >> 4;
     bp[j] = sign ? -val : val;
+    pos|= j;
     nc++;
 
     if (base.scalable_mode==SC_DP && nc==base.priority_breakpoint-63)
       ld = &enhan;
   }
+
+  THRD_DCT_STORE(t);
+  thrd_ld[t].pos[comp] = pos;
 }
 
 
@@ -752,8 +770,10 @@ void Thrd_Decode_MPEG2_Non_Intra_Block(t,comp)
      int t;
 int comp;
 {
-  int val, i, j, sign, nc, run;
+  int val, i, j, sign, nc, run, incnt, pos;
   unsigned int code;
+  BITBUF bfr;
+  unsigned char *ptr;
   DCTtab *tab;
   short *bp;
   int *qmat;
@@ -774,11 +794,14 @@ int comp;
          : ld1->chroma_non_intra_quantizer_matrix;
 
   nc = 0;
+  pos = 0;
+
+  THRD_DCT_LOAD(t);
 
   /* decode AC coefficients */
   for (i=0; ; i++)
   {
-    code = Thrd_Show_Bits(t,16);
+    code = BITS_SHOW(bfr,16);
     if (code>=16384)
     {
       if (i==0)
@@ -805,27 +828,30 @@ int comp;
       if (!Quiet_Flag)
         printf("invalid Huffman code in Decode_MPEG2_Non_Intra_Block()\n");
       Fault_Flag = 1;
-      return;
+      break;
     }
 
-    Thrd_Flush_Buffer(t,tab->len);
-
     if (tab->run==64) /* end_of_block */
     {
-      return;
+      BITS_FLUSH(bfr,incnt,ptr,tab->len);
+      break;
     }
 
+    /* code and sign, or escape code, run and level, are taken from
+       the cache in one go */
     if (tab->run==65) /* escape */
     {
-      i+= run = Thrd_Get_Bits(t,6);
+      code = BITS_SHOW(bfr,24);
+      BITS_FLUSH(bfr,incnt,ptr,24);
+      i+= run = (code>>12)&63;
 
-      val = Thrd_Get_Bits(t,12);
+      val = code&4095;
       if ((val&2047)==0)
       {
         if (!Quiet_Flag)
           printf("invalid escape in Decode_MPEG2_Intra_Block()\n");
         Fault_Flag = 1;
-        return;
+        break;
       }
       if((sign = (val>=2048)))
         val = 4096 - val;
@@ -834,8 +860,8 @@ int comp;
     {
       i+= run = tab->run;
       val = tab->level;
-      sign = Thrd_Get_Bits(t,1);
-
+      sign = BITS_SHOW(bfr,tab->len+1)&1;
+      BITS_FLUSH(bfr,incnt,ptr,tab->len+1);
     }
 
     if (i>=64)
@@ -843,17 +869,21 @@ int comp;
       if (!Quiet_Flag)
         fprintf(stderr,"DCT coeff index (i) out of bounds (inter2)\n");
       Fault_Flag = 1;
-      return;
+      break;
     }
 
     j = scan[ld1->alternate_scan][i];
     val = (((val<<1)+1) * thrd_ld[t].quantizer_scale * qmat[j]) >> 5;
     bp[j] = sign ? -val : val;
+    pos|= j;
     nc++;
 
     if (base.scalable_mode==SC_DP && nc==base.priority_breakpoint-63)
       ld = &enhan;
   }
+
+  THRD_DCT_STORE(t);
+  thrd_ld[t].pos[comp] = pos;
 }
 
 #endif
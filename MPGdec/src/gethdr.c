@@ -111,9 +111,9 @@ static int  Thrd_extra_bit_information _ANSI_ARGS_((int t));
 /* introduced in September 1995 to assist spatial scalable decoding */
 static void Update_Temporal_Reference_Tacking_Data _ANSI_ARGS_((void));
 /* private variables */
-static int Temporal_Reference_Base = 0;
-static int True_Framenum_max  = -1;
-static int Temporal_Reference_GOP_Reset = 0;
+static SEQ_LOCAL int Temporal_Reference_Base = 0;
+static SEQ_LOCAL int True_Framenum_max  = -1;
+static SEQ_LOCAL int Temporal_Reference_GOP_Reset = 0;
 
 #define RESERVED    -1 
 static double frame_rate_Table[16] =
@@ -1159,8 +1159,8 @@ static void copyright_extension()
 /* introduced in September 1995 to assist Spatial Scalability */
 static void Update_Temporal_Reference_Tacking_Data()
 {
-  static int temporal_reference_wrap  = 0;
-  static int temporal_reference_old   = 0;
+  static SEQ_LOCAL int temporal_reference_wrap  = 0;
+  static SEQ_LOCAL int temporal_reference_old   = 0;
 
   if (ld == &base)			/* *CH* */
   {
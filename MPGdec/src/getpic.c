@@ -84,6 +84,13 @@
 #if defined(THRD) && (NUM_THREADS>1)
 #include <pthread.h>
 #endif
+#if defined(ZERO_COPY) || defined(THRD)
+#include <string.h>
+#endif
+#ifdef THRD
+#include <sys/time.h>
+#include <time.h>
+#endif
 
 #include "config.h"
 #include "global.h"
@@ -99,9 +106,14 @@ static void macroblock_modes _ANSI_ARGS_((int *pmacroblock_type, int *pstwtype,
 static void Clear_Block _ANSI_ARGS_((int comp));
 static void Sum_Block _ANSI_ARGS_((int comp));
 static void Saturate _ANSI_ARGS_((short *bp));
+#ifdef THRD
+static void Saturate_4x4 _ANSI_ARGS_((short *bp));
+#endif
 static void Add_Block _ANSI_ARGS_((int comp, int bx, int by,
   int dct_type, int addflag));
+#ifndef FRAME_THRD
 static void Update_Picture_Buffers _ANSI_ARGS_((void));
+#endif
 static void frame_reorder _ANSI_ARGS_((int bitstream_framenum, 
   int sequence_framenum));
 static void Decode_SNR_Macroblock _ANSI_ARGS_((int *SNRMBA, int *SNRMBAinc, 
@@ -148,6 +160,13 @@ static void Thrd_macroblock_modes _ANSI_ARGS_((int t, int *pmacroblock_type, int
 static void Thrd_Clear_Block _ANSI_ARGS_((int t,int comp));
 static void Thrd_Add_Block _ANSI_ARGS_((int t, int comp, int bx, int by,
   int dct_type, int addflag));
+static unsigned char *Thrd_Block_Dest _ANSI_ARGS_((int comp, int bx, int by,
+  int dct_type, int *lx));
+#endif
+#ifdef FRAME_THRD
+static void Thrd_Update_Picture_Buffers _ANSI_ARGS_((void));
+static void Thrd_Output_Picture _ANSI_ARGS_((int framenum,
+  int *oldref_progressive_frame));
 #endif
 
 
@@ -163,8 +182,18 @@ int bitstream_framenum, sequence_framenum;
     Second_Field = 0;
   }
 
+#ifdef THRD
+  Bench_Picture(picture_coding_type);
+#endif
+
   /* IMPLEMENTATION: update picture buffer pointers */
+#ifdef FRAME_THRD
+  Thrd_Update_Picture_Buffers();
+  if (Ersatz_Flag || base.pict_scal)
+    Thrd_Drain();
+#else
   Update_Picture_Buffers();
+#endif
 
 #ifdef VERIFY 
   Check_Headers(bitstream_framenum, sequence_framenum);
@@ -891,7 +920,38 @@ short *Block_Ptr;
 
 }
 
+#ifdef THRD
+/* Saturate for a block whose coded coefficients all lie in the top-left
+   4x4, the rest of it being zero */
+static void Saturate_4x4(Block_Ptr)
+short *Block_Ptr;
+{
+  int i, j, sum, val;
+
+  sum = 0;
+
+  for (i=0; i<32; i+=8)
+  {
+    for (j=i; j<i+4; j++)
+    {
+      val = Block_Ptr[j];
+      if (val>2047)
+        val = 2047;
+      else if (val<-2048)
+        val = -2048;
+      Block_Ptr[j] = val;
+      sum+= val;
+    }
+  }
+
+  /* ISO/IEC 13818-2 section 7.4.4: Mismatch control */
+  if ((sum&1)==0)
+    Block_Ptr[63]^= 1;
+}
+#endif
+
 
+#ifndef FRAME_THRD
 /* reuse old picture buffers as soon as they are no longer needed 
    based on life-time axioms of MPEG */
 static void Update_Picture_Buffers()
@@ -899,6 +959,11 @@ static void Update_Picture_Buffers()
   int cc;              /* color component index */
   unsigned char *tmp;  /* temporary swap pointer */
 
+  /* the buffer about to be decoded into may still be held by the
+     stream writer, see Frame_Own() */
+  if (!Second_Field)
+    Frame_Own(picture_coding_type==B_TYPE ? auxframe : forward_reference_frame);
+
   for (cc=0; cc<3; cc++)
   {
     /* B pictures do not need to be save for future reference */
@@ -937,6 +1002,7 @@ static void Update_Picture_Buffers()
       current_frame[cc]+= (cc==0) ? Coded_Picture_Width : Chroma_Width;
   }
 }
+#endif
 
 
 /* store last frame */
@@ -944,6 +1010,9 @@ static void Update_Picture_Buffers()
 void Output_Last_Frame_of_Sequence(Framenum)
 int Framenum;
 {
+#ifdef FRAME_THRD
+  Thrd_Drain();
+#endif
   if (Second_Field)
     printf("last frame incomplete, not stored\n");
   else
@@ -956,12 +1025,18 @@ static void frame_reorder(Bitstream_Framenum, Sequence_Framenum)
 int Bitstream_Framenum, Sequence_Framenum;
 {
   /* tracking variables to insure proper output in spatial scalability */
-  static int Oldref_progressive_frame, Newref_progressive_frame;
+  static SEQ_LOCAL int Oldref_progressive_frame;
+#ifndef FRAME_THRD
+  static int Newref_progressive_frame;
+#endif
 
   if (Sequence_Framenum!=0)
   {
     if (picture_structure==FRAME_PICTURE || Second_Field)
     {
+#ifdef FRAME_THRD
+      Thrd_Output_Picture(Bitstream_Framenum-1, &Oldref_progressive_frame);
+#else
       if (picture_coding_type==B_TYPE)
         Write_Frame(auxframe,Bitstream_Framenum-1);
       else
@@ -973,6 +1048,7 @@ int Bitstream_Framenum, Sequence_Framenum;
 
         Oldref_progressive_frame = progressive_frame = Newref_progressive_frame;
       }
+#endif
     }
 #ifdef DISPLAY
     else if (Output_Type==T_X11)
@@ -1439,7 +1515,7 @@ void write_frame_buf8(int t, unsigned char data) {
     tb[t].frame_buf_size <<= 1;
     tb[t].frame_buf = 
       (unsigned char *) realloc(tb[t].frame_buf,
-				sizeof(unsigned char)*tb[t].frame_buf_size);
+				sizeof(unsigned char)*(tb[t].frame_buf_size+BITS_SLACK));
   };
   tb[t].frame_buf[tb[t].frame_buf_offset++] = data;
 #endif
@@ -1454,6 +1530,108 @@ void write_frame_buf32(int t, unsigned int data) {
 
 
 
+/* wall clock in seconds, for the per-thread busy/idle report */
+double Thrd_Time()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+void Thrd_Report()
+{
+  int t;
+  double busy = 0.0;
+
+  printf("thread  slices   busy(s)   idle(s)\n");
+  for (t=0; t<Num_Threads; t++)
+  {
+    printf("%6d %7d %9.3f %9.3f\n", t, thrd_stat[t].slices,
+           thrd_stat[t].busy, thrd_stat[t].idle);
+    busy += thrd_stat[t].busy;
+  }
+  printf("total busy %.3f s\n", busy);
+}
+
+/* BENCH_CLOCK() where there is no cycle counter: nanoseconds */
+BENCH_TICKS Bench_Clock()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (BENCH_TICKS)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+/* -bench counts; the parsers of several streams may update them at once */
+static pthread_mutex_t bench_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* a picture of picture_coding_type type was parsed */
+void Bench_Picture(type)
+int type;
+{
+  pthread_mutex_lock(&bench_lock);
+  Bench_Pictures[BENCH_TYPE(type)]++;
+  pthread_mutex_unlock(&bench_lock);
+}
+
+/* a frame was passed to Write_Frame(), which took seconds */
+void Bench_Frame(seconds)
+double seconds;
+{
+  pthread_mutex_lock(&bench_lock);
+  Bench_Frames++;
+  Bench_Output += seconds;
+  pthread_mutex_unlock(&bench_lock);
+}
+
+/* -bench: forget the warm-up runs */
+void Bench_Reset()
+{
+  memset(thrd_stat, 0, sizeof(thrd_stat));
+  memset(Bench_Pictures, 0, sizeof(Bench_Pictures));
+  Bench_Frames = 0;
+  Bench_Output = 0.0;
+}
+
+/* -bench: CSV report of the measured runs, which took wall seconds or
+   ticks of BENCH_CLOCK(). Three tables: throughput, decoding time by
+   picture type (summed over the threads) and the per-thread stages;
+   writing frames is done by the main thread. */
+void Bench_Report(runs, wall, ticks)
+int runs;
+double wall;
+BENCH_TICKS ticks;
+{
+  int t, k;
+  double tick, busy;
+
+  tick = ticks ? wall/ticks : 0.0;
+
+  printf("runs,threads,frames,seconds,fps\n");
+  printf("%d,%d,%d,%.6f,%.2f\n", runs, Num_Threads, Bench_Frames, wall,
+         wall>0.0 ? Bench_Frames/wall : 0.0);
+
+  printf("\ntype,pictures,thread_seconds,ms_per_picture\n");
+  for (k=1; k<5; k++)
+  {
+    busy = 0.0;
+    for (t=0; t<Num_Threads; t++)
+      busy += thrd_stat[t].type[k];
+    if (Bench_Pictures[k])
+      printf("%c,%d,%.6f,%.3f\n", "?IPBD"[k], Bench_Pictures[k], busy,
+             1e3*busy/Bench_Pictures[k]);
+  }
+
+  printf("\nthread,slices,busy,idle,vlc,mc,idct,output\n");
+  for (t=0; t<Num_Threads; t++)
+    printf("%d,%d,%.6f,%.6f,%.6f,%.6f,%.6f,0\n", t, thrd_stat[t].slices,
+           thrd_stat[t].busy, thrd_stat[t].idle, tick*thrd_stat[t].vlc,
+           tick*thrd_stat[t].mc, tick*thrd_stat[t].idct);
+  printf("main,0,0,0,0,0,0,%.6f\n", Bench_Output);
+}
+
+
 extern short ic[8][8];
 
 void *Thrd_Work(void* thrd_args) {
@@ -1474,6 +1652,7 @@ void *Thrd_Work(void* thrd_args) {
   int SNRMBA, SNRMBAinc;
   int localMBA, localMBAmax;
   int ret;
+  BENCH_TICKS c = 0;
 
   MBA = 0; /* macroblock address */
   MBAinc = 0;
@@ -1558,6 +1737,9 @@ void *Thrd_Work(void* thrd_args) {
       return NULL;
     }
 
+    if (Bench_Runs)
+      BENCH_CLOCK(c);
+
     if (MBAinc==1) /* not skipped */
     {
       ret = Thrd_decode_macroblock(id, &macroblock_type, &stwtype, &stwclass,
@@ -1582,6 +1764,9 @@ void *Thrd_Work(void* thrd_args) {
         motion_vertical_field_select, &stwtype, &macroblock_type);
     }
 
+    if (Bench_Runs)
+      BENCH_LAP(id,vlc,c);
+
     /* SCALABILITY: SNR */
     /* ISO/IEC 13818-2 section 7.8 */
     /* NOTE: we currently ignore faults encountered in this routine */
@@ -1619,6 +1804,851 @@ void *Thrd_Work(void* thrd_args) {
 
 Thrd_Args thread_data_array[NUM_THREADS];
 
+#ifdef ZERO_COPY
+/* return the next 00 00 01 prefix in [p,end), or end */
+unsigned char *find_start_code(p, end)
+unsigned char *p, *end;
+{
+  while (p+3 <= end && (p = (unsigned char *) memchr(p, 0, end-p-2)) != NULL)
+  {
+    if (p[1]==0 && p[2]==1)
+      return p;
+    p += (p[1]!=0) ? 2 : 1;
+  }
+  return end;
+}
+
+/* decode the single slice thrd_ptr[id] points at, up to the next
+   start code */
+static void Thrd_slice(id, MBAmax)
+int id, MBAmax;
+{
+  int MBA;
+  int MBAinc, macroblock_type, motion_type, dct_type;
+  int dc_dct_pred[3];
+  int PMV[2][2][2], motion_vertical_field_select[2][2];
+  int dmvector[2];
+  int stwtype, stwclass;
+  BENCH_TICKS c = 0;
+
+  MBA = 0;
+  MBAinc = 0;
+
+  if (Thrd_start_of_slice(id, MBAmax, &MBA, &MBAinc, dc_dct_pred, PMV)!=1)
+    return;
+
+  for (;;)
+  {
+    if (MBA>=MBAmax)
+      return;
+
+    ld = &base;
+
+    if (MBAinc==0)
+    {
+      if (!Thrd_Show_Bits(id,23) || Fault_Flag) /* next_start_code or fault */
+      {
+        Fault_Flag = 0;
+        return;
+      }
+      MBAinc = Thrd_Get_macroblock_address_increment(id);
+      if (Fault_Flag)
+      {
+        Fault_Flag = 0;
+        return;
+      }
+    }
+
+    if (MBA>=MBAmax)
+    {
+      /* MBAinc points beyond picture dimensions */
+      if (!Quiet_Flag)
+        printf("Too many macroblocks in picture\n");
+      return;
+    }
+
+    if (Bench_Runs)
+      BENCH_CLOCK(c);
+
+    if (MBAinc==1) /* not skipped */
+    {
+      if (Thrd_decode_macroblock(id, &macroblock_type, &stwtype, &stwclass,
+                                 &motion_type, &dct_type, PMV, dc_dct_pred,
+                                 motion_vertical_field_select, dmvector)!=1)
+        return;
+    }
+    else /* MBAinc!=1: skipped macroblock */
+      Thrd_skipped_macroblock(id, dc_dct_pred, PMV, &motion_type,
+        motion_vertical_field_select, &stwtype, &macroblock_type);
+
+    if (Bench_Runs)
+      BENCH_LAP(id,vlc,c);
+
+    /* ISO/IEC 13818-2 section 7.6 */
+    Thrd_motion_compensation(id, MBA, macroblock_type, motion_type, PMV,
+                             motion_vertical_field_select, dmvector, stwtype, dct_type);
+
+    MBA++;
+    MBAinc--;
+  }
+}
+
+#ifdef FRAME_THRD
+/* Frame level scheduler.  The main thread parses ahead: every picture is
+   indexed and queued as a job without waiting for the ones before it,
+   and the workers take slices from the queue in decoding order.  Anchors
+   rotate through three frame buffers and B pictures through FRAME_BSLOTS
+   buffers, so consecutive B pictures and the next anchor are decoded
+   together.  Every buffer counts its leading reconstructed macroblock
+   rows; a worker starts a slice only once the rows its motion vectors
+   can reach are done in the reference frames.  Slices are handed out in
+   decoding order, so whatever a worker waits for is already being
+   decoded.  Field pictures and the scalable/substitution modes still go
+   one picture at a time.
+
+   The streams of a demultiplexed input are parsed by threads of their
+   own (Decode_Streams() in mpeg2dec.c).  Each parser keeps its jobs,
+   buffers and output queue in a Thrd_Stream of its own, and they all
+   queue their jobs to the same workers.  A worker only ever waits for
+   earlier pictures of the stream it is decoding, which were queued,
+   and so handed out, before its own. */
+
+#define FRAME_BSLOTS 3
+#define FRAME_SLOTS (3+FRAME_BSLOTS)
+#define FRAME_JOBS 8
+#define FRAME_OUTPUTS 8
+
+typedef struct {
+  unsigned char *frame[3];
+  int rows_done;        /* leading macroblock rows reconstructed */
+  int readers;          /* queued pictures predicting from it */
+  int outputs;          /* queued Write_Frame()s */
+} Thrd_Frame;
+
+typedef struct thrd_job {
+  int serial;
+  /* sequence level state the workers read, see SEQ_LOCAL in global.h */
+  int Coded_Picture_Width, Chroma_Width, chroma_format, block_count;
+  int mb_width, vertical_size, spatial_temporal_weight_code_table_index;
+  /* picture level state, see PICT_LOCAL in global.h */
+  int picture_coding_type, picture_structure, top_field_first, Second_Field;
+  int frame_pred_frame_dct, concealment_motion_vectors, intra_vlc_format;
+  int intra_dc_precision, progressive_frame;
+  int full_pel_forward_vector, forward_f_code;
+  int full_pel_backward_vector, backward_f_code;
+  int f_code[2][2];
+  unsigned char *current_frame[3];
+  unsigned char *forward_reference_frame[3];
+  unsigned char *backward_reference_frame[3];
+  struct layer_data base;
+  /* scheduling */
+  int MBAmax, rows;
+  int frame_rows;       /* mb_height of the stream */
+  Thrd_Frame *dst;      /* NULL: decoded one picture at a time */
+  Thrd_Frame *ref[2];   /* forward, backward */
+  int margin[2];        /* rows below the slice a prediction may reach */
+  unsigned char **slice;
+  int *slice_row;
+  int *row_left;        /* undecoded slices per row */
+  int slice_size, row_size;
+  int num_slices, next, left;
+  struct thrd_job *queued;  /* next job with slices to hand out */
+} Thrd_Job;
+
+/* the workers, shared by all streams */
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t work;          /* a job was queued */
+  pthread_cond_t progress;      /* rows or a job completed */
+  int workers;
+  int serial;
+  Thrd_Job *head, *tail;        /* jobs with slices left to hand out */
+} pool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+          PTHREAD_COND_INITIALIZER};
+
+/* the scheduling state of one stream, pool.lock guards what the workers
+   touch */
+typedef struct {
+  int rows;                     /* mb_height */
+  Thrd_Job job[FRAME_JOBS];
+  int tail;                     /* jobs queued, the next goes in job[tail] */
+  Thrd_Frame frames[FRAME_SLOTS];
+  Thrd_Frame *fwd, *bwd, *cur;
+  struct {
+    Thrd_Frame *f;
+    int framenum, progressive_frame;
+  } out[FRAME_OUTPUTS];
+  int out_head, out_tail;
+} Thrd_Stream;
+
+/* the stream this thread parses, from Thrd_Init_Frames() */
+static SEQ_LOCAL Thrd_Stream *fs;
+
+/* main thread: snapshot the state parsed for the current picture */
+static void Thrd_Save_Picture(j)
+Thrd_Job *j;
+{
+  int cc;
+
+  j->Coded_Picture_Width = Coded_Picture_Width;
+  j->Chroma_Width = Chroma_Width;
+  j->chroma_format = chroma_format;
+  j->block_count = block_count;
+  j->mb_width = mb_width;
+  j->vertical_size = vertical_size;
+  j->spatial_temporal_weight_code_table_index =
+    spatial_temporal_weight_code_table_index;
+  j->picture_coding_type = picture_coding_type;
+  j->picture_structure = picture_structure;
+  j->top_field_first = top_field_first;
+  j->Second_Field = Second_Field;
+  j->frame_pred_frame_dct = frame_pred_frame_dct;
+  j->concealment_motion_vectors = concealment_motion_vectors;
+  j->intra_vlc_format = intra_vlc_format;
+  j->intra_dc_precision = intra_dc_precision;
+  j->progressive_frame = progressive_frame;
+  j->full_pel_forward_vector = full_pel_forward_vector;
+  j->forward_f_code = forward_f_code;
+  j->full_pel_backward_vector = full_pel_backward_vector;
+  j->backward_f_code = backward_f_code;
+  memcpy(j->f_code, f_code, sizeof(f_code));
+  for (cc=0; cc<3; cc++)
+  {
+    j->current_frame[cc] = current_frame[cc];
+    j->forward_reference_frame[cc] = forward_reference_frame[cc];
+    j->backward_reference_frame[cc] = backward_reference_frame[cc];
+  }
+  j->base = base;
+}
+
+/* worker: take over the state of the picture a slice belongs to */
+static void Thrd_Load_Picture(j)
+Thrd_Job *j;
+{
+  int cc;
+
+  Coded_Picture_Width = j->Coded_Picture_Width;
+  Chroma_Width = j->Chroma_Width;
+  chroma_format = j->chroma_format;
+  block_count = j->block_count;
+  mb_width = j->mb_width;
+  vertical_size = j->vertical_size;
+  spatial_temporal_weight_code_table_index =
+    j->spatial_temporal_weight_code_table_index;
+  picture_coding_type = j->picture_coding_type;
+  picture_structure = j->picture_structure;
+  top_field_first = j->top_field_first;
+  Second_Field = j->Second_Field;
+  frame_pred_frame_dct = j->frame_pred_frame_dct;
+  concealment_motion_vectors = j->concealment_motion_vectors;
+  intra_vlc_format = j->intra_vlc_format;
+  intra_dc_precision = j->intra_dc_precision;
+  progressive_frame = j->progressive_frame;
+  full_pel_forward_vector = j->full_pel_forward_vector;
+  forward_f_code = j->forward_f_code;
+  full_pel_backward_vector = j->full_pel_backward_vector;
+  backward_f_code = j->backward_f_code;
+  memcpy(f_code, j->f_code, sizeof(f_code));
+  for (cc=0; cc<3; cc++)
+  {
+    current_frame[cc] = j->current_frame[cc];
+    forward_reference_frame[cc] = j->forward_reference_frame[cc];
+    backward_reference_frame[cc] = j->backward_reference_frame[cc];
+  }
+  base = j->base;
+  ld = &base;
+  Fault_Flag = 0;
+}
+
+/* macroblock rows below its own that a prediction with vertical f_code
+   f can reach: field and dual prime vectors scale the range by up to
+   3/2 in frame lines, plus one line for half-pel interpolation */
+static int Thrd_margin(f)
+int f;
+{
+  if (f<1 || f>9)
+    return fs->rows;
+  return ((24<<(f-1)) + 4 + 15)/16 + 1;
+}
+
+/* pool.lock held: extend the reconstructed rows of a job's frame */
+static void Thrd_advance_rows(j)
+Thrd_Job *j;
+{
+  while (j->dst->rows_done < j->rows && !j->row_left[j->dst->rows_done])
+    j->dst->rows_done++;
+}
+
+static void *Thrd_Frame_Work(arg)
+void *arg;
+{
+  int id = (int)(long)arg;
+  int serial = 0;
+  int i, k, row, need;
+  Thrd_Job *j;
+  Thrd_Frame *r;
+  double t0;
+
+  pthread_mutex_lock(&pool.lock);
+  for (;;)
+  {
+    t0 = Thrd_Time();
+    while (!pool.head)
+      pthread_cond_wait(&pool.work, &pool.lock);
+    j = pool.head;
+    i = j->next++;
+    if (j->next==j->num_slices && !(pool.head = j->queued))
+      pool.tail = NULL;
+
+    /* wait for the reference rows this slice can reach */
+    row = j->slice_row[i];
+    for (k=0; k<2; k++)
+      if ((r = j->ref[k]))
+      {
+        need = row + j->margin[k];
+        if (need > j->frame_rows-1)
+          need = j->frame_rows-1;
+        while (r->rows_done <= need)
+          pthread_cond_wait(&pool.progress, &pool.lock);
+      }
+    pthread_mutex_unlock(&pool.lock);
+    thrd_stat[id].idle += Thrd_Time() - t0;
+
+    if (j->serial!=serial)
+    {
+      Thrd_Load_Picture(j);
+      serial = j->serial;
+    }
+
+    t0 = Thrd_Time();
+    thrd_ptr[id] = j->slice[i];
+    Thrd_Initialize_Buffer(id);
+    Thrd_slice(id, j->MBAmax);
+    t0 = Thrd_Time() - t0;
+    thrd_stat[id].busy += t0;
+    thrd_stat[id].type[BENCH_TYPE(picture_coding_type)] += t0;
+    thrd_stat[id].slices++;
+
+    pthread_mutex_lock(&pool.lock);
+    if (j->dst && --j->row_left[row]==0)
+    {
+      Thrd_advance_rows(j);
+      pthread_cond_broadcast(&pool.progress);
+    }
+    if (--j->left==0)
+    {
+      for (k=0; k<2; k++)
+        if (j->ref[k])
+          j->ref[k]->readers--;
+      pthread_cond_broadcast(&pool.progress);
+    }
+  }
+  return NULL;
+}
+
+/* main thread: write queued frames whose decoding has completed, in
+   order; with block set, wait for the first one */
+static void Thrd_Write_Outputs(block)
+int block;
+{
+  Thrd_Frame *f;
+  int framenum, prog, done;
+
+  while (fs->out_head!=fs->out_tail)
+  {
+    f = fs->out[fs->out_head%FRAME_OUTPUTS].f;
+    pthread_mutex_lock(&pool.lock);
+    while (block && f->rows_done < fs->rows)
+      pthread_cond_wait(&pool.progress, &pool.lock);
+    done = f->rows_done==fs->rows;
+    pthread_mutex_unlock(&pool.lock);
+    if (!done)
+      return;
+
+    framenum = fs->out[fs->out_head%FRAME_OUTPUTS].framenum;
+    prog = progressive_frame;
+    progressive_frame = fs->out[fs->out_head%FRAME_OUTPUTS].progressive_frame;
+    Write_Frame(f->frame, framenum);
+    progressive_frame = prog;
+
+    f->outputs--;
+    fs->out_head++;
+    block = 0;
+  }
+}
+
+static void Thrd_Queue_Output(f, framenum, prog)
+Thrd_Frame *f;
+int framenum, prog;
+{
+  if (fs->out_tail - fs->out_head == FRAME_OUTPUTS)
+    Thrd_Write_Outputs(1);
+  fs->out[fs->out_tail%FRAME_OUTPUTS].f = f;
+  fs->out[fs->out_tail%FRAME_OUTPUTS].framenum = framenum;
+  fs->out[fs->out_tail%FRAME_OUTPUTS].progressive_frame = prog;
+  fs->out_tail++;
+  f->outputs++;
+}
+
+/* frame_reorder(): queue the frame due for output, written once it
+   is decoded */
+static void Thrd_Output_Picture(framenum, oldref_progressive_frame)
+int framenum;
+int *oldref_progressive_frame;
+{
+  if (picture_coding_type==B_TYPE)
+    Thrd_Queue_Output(fs->cur, framenum, progressive_frame);
+  else
+  {
+    Thrd_Queue_Output(fs->fwd, framenum, *oldref_progressive_frame);
+    *oldref_progressive_frame = progressive_frame;
+  }
+  Thrd_Write_Outputs(0);
+}
+
+/* main thread: wait for all queued pictures */
+static void Thrd_Wait_Jobs()
+{
+  int i;
+
+  pthread_mutex_lock(&pool.lock);
+  for (i=0; i<FRAME_JOBS; i++)
+    while (fs->job[i].left)
+      pthread_cond_wait(&pool.progress, &pool.lock);
+  pthread_mutex_unlock(&pool.lock);
+}
+
+/* finish everything queued, output included */
+void Thrd_Drain()
+{
+  Thrd_Wait_Jobs();
+  Thrd_Write_Outputs(0);
+}
+
+/* a free buffer among fs->frames[first..last), other than the backward
+   reference */
+static Thrd_Frame *Thrd_Get_Frame(first, last)
+int first, last;
+{
+  int k;
+  Thrd_Frame *f;
+
+  for (;;)
+  {
+    Thrd_Write_Outputs(0);
+
+    pthread_mutex_lock(&pool.lock);
+    for (k=first; k<last; k++)
+    {
+      f = &fs->frames[k];
+      if (f!=fs->bwd && !f->readers && !f->outputs && f->rows_done==fs->rows)
+      {
+        pthread_mutex_unlock(&pool.lock);
+        Frame_Own(f->frame);
+        return f;
+      }
+    }
+    /* a completed frame may only be waiting to be written */
+    if (fs->out_head==fs->out_tail
+        || fs->out[fs->out_head%FRAME_OUTPUTS].f->rows_done < fs->rows)
+      pthread_cond_wait(&pool.progress, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+  }
+}
+
+/* Update_Picture_Buffers() over the rotating buffers */
+static void Thrd_Update_Picture_Buffers()
+{
+  int cc;
+
+  if (!Second_Field)
+  {
+    if (picture_coding_type==B_TYPE)
+      fs->cur = Thrd_Get_Frame(3, FRAME_SLOTS);
+    else
+    {
+      fs->cur = Thrd_Get_Frame(0, 3);
+      fs->fwd = fs->bwd;
+      fs->bwd = fs->cur;
+    }
+  }
+
+  for (cc=0; cc<3; cc++)
+  {
+    forward_reference_frame[cc] = fs->fwd->frame[cc];
+    backward_reference_frame[cc] = fs->bwd->frame[cc];
+    current_frame[cc] = fs->cur->frame[cc];
+
+    if (picture_structure==BOTTOM_FIELD)
+      current_frame[cc]+= (cc==0) ? Coded_Picture_Width : Chroma_Width;
+  }
+}
+
+/* the buffers of a sequence: the three allocated by Initialize_Sequence()
+   plus a spare anchor and FRAME_BSLOTS-1 more B buffers */
+void Thrd_Init_Frames()
+{
+  int k, cc;
+
+  if (!(fs = (Thrd_Stream *) calloc(1, sizeof(Thrd_Stream))))
+    Error("malloc failed\n");
+
+  fs->rows = mb_height;
+  for (k=0; k<FRAME_SLOTS; k++)
+  {
+    if (k!=0 && k!=1 && k!=3)
+      Frame_New(fs->frames[k].frame, Coded_Picture_Width,
+                Coded_Picture_Height, Chroma_Width, Chroma_Height);
+    for (cc=0; cc<3; cc++)
+      if (k==0)
+        fs->frames[k].frame[cc] = forward_reference_frame[cc];
+      else if (k==1)
+        fs->frames[k].frame[cc] = backward_reference_frame[cc];
+      else if (k==3)
+        fs->frames[k].frame[cc] = auxframe[cc];
+  }
+  for (k=0; k<FRAME_SLOTS; k++)
+    fs->frames[k].rows_done = fs->rows;
+  fs->fwd = &fs->frames[0];
+  fs->bwd = fs->cur = &fs->frames[1];
+}
+
+void Thrd_Free_Frames()
+{
+  int k;
+
+  Thrd_Drain();
+  for (k=0; k<FRAME_SLOTS; k++)
+    Frame_Release(fs->frames[k].frame);
+  for (k=0; k<FRAME_JOBS; k++)
+  {
+    free(fs->job[k].slice);
+    free(fs->job[k].slice_row);
+    free(fs->job[k].row_left);
+  }
+  free(fs);
+  fs = NULL;
+}
+
+/* Queue the picture: index its slices in the in-memory input, record
+   which reference rows they depend on and resume the header parser
+   behind the last slice.  Pictures that cannot overlap are waited for. */
+static int new_slice(framenum, MBAmax)
+int framenum, MBAmax;
+{
+  Thrd_Job *j;
+  unsigned char *p, *end;
+  unsigned int code;
+  int sync, row, k, t, rc;
+  pthread_t thread;
+
+  assert(ld->Map && "new_slice: input not mapped\n");
+
+  pthread_mutex_lock(&pool.lock);
+  for (t=pool.workers; t<Num_Threads; t++)
+  {
+    rc = pthread_create(&thread, NULL, Thrd_Frame_Work, (void*)(long)t);
+    if (rc) {
+      printf("ERROR; return code from pthread_create() is %d\n", rc);
+      exit(-1);
+    }
+    pthread_detach(thread);
+    pool.workers++;
+  }
+  pthread_mutex_unlock(&pool.lock);
+
+  sync = picture_structure!=FRAME_PICTURE || Ersatz_Flag || base.pict_scal;
+  if (sync)
+    Thrd_Wait_Jobs();
+
+  next_start_code(); /*this should be pointing to the first slice of the picture*/
+  code = Show_Bits(32);
+  assert(!(code<SLICE_START_CODE_MIN || code>SLICE_START_CODE_MAX)&&"Bad slice start code\n");
+
+  /* next job slot */
+  pthread_mutex_lock(&pool.lock);
+  j = &fs->job[fs->tail%FRAME_JOBS];
+  while (j->left)
+    pthread_cond_wait(&pool.progress, &pool.lock);
+  j->serial = ++pool.serial;
+  pthread_mutex_unlock(&pool.lock);
+
+  Thrd_Save_Picture(j);
+  j->MBAmax = MBAmax;
+  j->rows = MBAmax / mb_width;
+  j->frame_rows = fs->rows;
+  if (j->row_size < j->rows)
+  {
+    j->row_size = j->rows;
+    if (!(j->row_left = (int *) realloc(j->row_left, sizeof(int)*j->row_size)))
+      Error("realloc failed\n");
+  }
+  for (row=0; row<j->rows; row++)
+    j->row_left[row] = 0;
+
+  /* slice index */
+  j->num_slices = 0;
+  end = ld->Map + ld->Mapsize;
+  p = ld->Map + Buffer_Offset();
+  while (p < end && p[3]>=(SLICE_START_CODE_MIN&255) && p[3]<=(SLICE_START_CODE_MAX&255))
+  {
+    if (j->num_slices==j->slice_size)
+    {
+      j->slice_size = j->slice_size ? j->slice_size<<1 : 2*mb_height;
+      j->slice = (unsigned char **) realloc(j->slice,
+                                            sizeof(unsigned char *)*j->slice_size);
+      j->slice_row = (int *) realloc(j->slice_row, sizeof(int)*j->slice_size);
+      if (!j->slice || !j->slice_row)
+        Error("realloc failed\n");
+    }
+    row = p[3] - 1;
+    if (vertical_size>2800)
+      row += (p[4]>>5)<<7;
+    if (row >= j->rows)
+      row = j->rows-1;
+    j->row_left[row]++;
+    j->slice_row[j->num_slices] = row;
+    j->slice[j->num_slices++] = p;
+    p = find_start_code(p+4, end);
+  }
+  /* p is the start code following the picture */
+
+  j->dst = sync ? NULL : fs->cur;
+  j->ref[0] = j->ref[1] = NULL;
+  if (!sync && (picture_coding_type==P_TYPE || picture_coding_type==B_TYPE))
+  {
+    j->ref[0] = fs->fwd;
+    j->margin[0] = Thrd_margin(base.MPEG2_Flag ? f_code[0][1] : forward_f_code);
+  }
+  if (!sync && picture_coding_type==B_TYPE)
+  {
+    j->ref[1] = fs->bwd;
+    j->margin[1] = Thrd_margin(base.MPEG2_Flag ? f_code[1][1] : backward_f_code);
+  }
+
+  pthread_mutex_lock(&pool.lock);
+  j->next = 0;
+  j->left = j->num_slices;
+  if (j->dst)
+  {
+    j->dst->rows_done = 0;
+    Thrd_advance_rows(j);
+  }
+  if (j->num_slices)
+  {
+    for (k=0; k<2; k++)
+      if (j->ref[k])
+        j->ref[k]->readers++;
+    j->queued = NULL;
+    if (pool.tail)
+      pool.tail->queued = j;
+    else
+      pool.head = j;
+    pool.tail = j;
+    fs->tail++;
+    pthread_cond_broadcast(&pool.work);
+  }
+  else if (j->dst)
+    j->dst->rows_done = fs->rows;
+
+  if (sync)
+  {
+    while (j->left)
+      pthread_cond_wait(&pool.progress, &pool.lock);
+    fs->cur->rows_done = fs->rows;
+  }
+  pthread_mutex_unlock(&pool.lock);
+
+  Seek_Buffer(p - ld->Map);
+  return -1;
+}
+
+#else /* FRAME_THRD */
+
+/* Worker pool.  The threads are created once; for every picture the
+   main thread publishes the slice list and all threads (the main thread
+   being thread 0) take the next undecoded slice until the list is empty,
+   so a thread that drew cheap slices simply decodes more of them. */
+static struct {
+  unsigned char **slice;
+  int slice_size;
+  int num_slices;
+  int next;             /* next slice to hand out */
+  int MBAmax;
+#if (NUM_THREADS>1)
+  pthread_mutex_t lock;
+  pthread_cond_t start, done;
+  int gen;              /* bumped for every picture */
+  int busy;             /* workers still on the current picture */
+  int workers;          /* workers created */
+#endif
+} pool;
+
+static void Thrd_pull_slices(id)
+int id;
+{
+  int i;
+  double t0;
+
+  for (;;)
+  {
+#if (NUM_THREADS>1)
+    pthread_mutex_lock(&pool.lock);
+#endif
+    i = pool.next++;
+#if (NUM_THREADS>1)
+    pthread_mutex_unlock(&pool.lock);
+#endif
+    if (i>=pool.num_slices)
+      return;
+
+    t0 = Thrd_Time();
+    thrd_ptr[id] = pool.slice[i];
+    Thrd_Initialize_Buffer(id);
+    Thrd_slice(id, pool.MBAmax);
+    t0 = Thrd_Time() - t0;
+    thrd_stat[id].busy += t0;
+    thrd_stat[id].type[BENCH_TYPE(picture_coding_type)] += t0;
+    thrd_stat[id].slices++;
+  }
+}
+
+#if (NUM_THREADS>1)
+static void *Thrd_Pool_Work(arg)
+void *arg;
+{
+  int id = (int)(long)arg;
+  int gen = 0;
+  double t0;
+
+  for (;;)
+  {
+    t0 = Thrd_Time();
+    pthread_mutex_lock(&pool.lock);
+    while (pool.gen==gen)
+      pthread_cond_wait(&pool.start, &pool.lock);
+    gen = pool.gen;
+    pthread_mutex_unlock(&pool.lock);
+    thrd_stat[id].idle += Thrd_Time() - t0;
+
+    Thrd_pull_slices(id);
+
+    pthread_mutex_lock(&pool.lock);
+    if (--pool.busy==0)
+      pthread_cond_signal(&pool.done);
+    pthread_mutex_unlock(&pool.lock);
+  }
+  return NULL;
+}
+#endif
+
+/* Decode the picture in place: index the slices of the picture in the
+   in-memory input, let the pool decode them and resume the header
+   parser behind the last slice.  Unlike the copying version below, any
+   number of slices per row is accepted. */
+static int new_slice(framenum, MBAmax)
+int framenum, MBAmax;
+{
+  unsigned char *p, *end;
+  unsigned int code;
+  double t0;
+#if (NUM_THREADS>1)
+  int t, rc;
+  pthread_t thread;
+#endif
+
+  assert(ld->Map && "new_slice: input not mapped\n");
+
+#if (NUM_THREADS>1)
+  if (pool.workers < Num_Threads-1)
+  {
+    if (pool.workers==0)
+    {
+      pthread_mutex_init(&pool.lock, NULL);
+      pthread_cond_init(&pool.start, NULL);
+      pthread_cond_init(&pool.done, NULL);
+    }
+    for (t=pool.workers+1; t<Num_Threads; t++)
+    {
+      rc = pthread_create(&thread, NULL, Thrd_Pool_Work, (void*)(long)t);
+      if (rc) {
+        printf("ERROR; return code from pthread_create() is %d\n", rc);
+        exit(-1);
+      }
+      pthread_detach(thread);
+    }
+    pool.workers = Num_Threads-1;
+  }
+#endif
+
+  next_start_code(); /*this should be pointing to the first slice of the picture*/
+  code = Show_Bits(32);
+  assert(!(code<SLICE_START_CODE_MIN || code>SLICE_START_CODE_MAX)&&"Bad slice start code\n");
+
+  /* slice index */
+  pool.num_slices = 0;
+  end = ld->Map + ld->Mapsize;
+  p = ld->Map + Buffer_Offset();
+  while (p < end && p[3]>=(SLICE_START_CODE_MIN&255) && p[3]<=(SLICE_START_CODE_MAX&255))
+  {
+    if (pool.num_slices==pool.slice_size)
+    {
+      pool.slice_size = pool.slice_size ? pool.slice_size<<1 : 2*mb_height;
+      pool.slice = (unsigned char **) realloc(pool.slice,
+                                              sizeof(unsigned char *)*pool.slice_size);
+      if (!pool.slice)
+        Error("realloc failed\n");
+    }
+    pool.slice[pool.num_slices++] = p;
+    p = find_start_code(p+4, end);
+  }
+  /* p is the start code following the picture */
+
+  pool.next = 0;
+  pool.MBAmax = MBAmax;
+
+#if (NUM_THREADS>1)
+  pthread_mutex_lock(&pool.lock);
+  pool.busy = pool.workers;
+  pool.gen++;
+  pthread_cond_broadcast(&pool.start);
+  pthread_mutex_unlock(&pool.lock);
+#endif
+
+  Thrd_pull_slices(0);
+
+  t0 = Thrd_Time();
+#if (NUM_THREADS>1)
+  pthread_mutex_lock(&pool.lock);
+  while (pool.busy)
+    pthread_cond_wait(&pool.done, &pool.lock);
+  pthread_mutex_unlock(&pool.lock);
+#endif
+  thrd_stat[0].idle += Thrd_Time() - t0;
+
+  Seek_Buffer(p - ld->Map);
+  return -1;
+}
+
+#endif /* FRAME_THRD */
+
+#else /* ZERO_COPY */
+
+static void *Thrd_Timed_Work(thrd_args)
+void *thrd_args;
+{
+  Thrd_Args *mydata = (Thrd_Args*) thrd_args;
+  double t0 = Thrd_Time();
+
+  Thrd_Work(thrd_args);
+  thrd_stat[mydata->id].last = Thrd_Time() - t0;
+  thrd_stat[mydata->id].busy += thrd_stat[mydata->id].last;
+  thrd_stat[mydata->id].type[BENCH_TYPE(picture_coding_type)] +=
+    thrd_stat[mydata->id].last;
+  thrd_stat[mydata->id].slices += mydata->num_slices;
+  return NULL;
+}
+
 static int new_slice(framenum, MBAmax)
 int framenum, MBAmax;
 {
@@ -1636,7 +2666,8 @@ int framenum, MBAmax;
   pthread_attr_t attr;
   int rc, status;
 #endif
-  int num_thrds = (mb_height > NUM_THREADS) ? NUM_THREADS : mb_height;
+  int num_thrds = (mb_height > Num_Threads) ? Num_Threads : mb_height;
+  double t0 = Thrd_Time();
   
   /*assert((mb_height >= NUM_THREADS) && "more threads than slices\n");    */
 
@@ -1695,7 +2726,7 @@ int framenum, MBAmax;
 
 #if (NUM_THREADS>1)	
 	if (t!=num_thrds-1) {
-	  rc = pthread_create(&thread[t], &attr, Thrd_Work, 
+	  rc = pthread_create(&thread[t], &attr, Thrd_Timed_Work, 
 			      (void*) &thread_data_array[t]); 
 	  if (rc) {
 	    printf("ERROR; return code from pthread_create() is %d\n", rc);
@@ -1747,7 +2778,7 @@ int framenum, MBAmax;
   }
 #endif
 
-  Thrd_Work((void*) &thread_data_array[t]);
+  Thrd_Timed_Work((void*) &thread_data_array[t]);
 #if (NUM_THREADS>1)
 /*Thread JOIN */
   for(t=0;t < num_thrds-1;t++)
@@ -1760,8 +2791,13 @@ int framenum, MBAmax;
 	}
     }
 #endif
+  /* a thread is idle for whatever part of the picture it did not decode */
+  t0 = Thrd_Time() - t0;
+  for (t=0; t<Num_Threads; t++)
+    thrd_stat[t].idle += (t<num_thrds) ? t0 - thrd_stat[t].last : t0;
   return -1;
 }
+#endif /* ZERO_COPY */
 
 /* return==-1 means go to next picture */
 /* the expression "start of slice" is used throughout the normative
@@ -2112,9 +3148,13 @@ int dmvector[2];
 int stwtype;
 int dct_type;
 {
-  int bx, by;
+  int bx, by, lx;
   int comp;
+  unsigned char *rfp;
+  BENCH_TICKS c = 0;
 
+  if (Bench_Runs)
+    BENCH_CLOCK(c);
 
   /* derive current macroblock position within picture */
   /* ISO/IEC 13818-2 section 6.3.1.6 and 6.3.1.7 */
@@ -2125,6 +3165,9 @@ int dct_type;
   if (!(macroblock_type & MACROBLOCK_INTRA))
     form_predictions(bx,by,macroblock_type,motion_type,PMV,
       motion_vertical_field_select,dmvector,stwtype);
+
+  if (Bench_Runs)
+    BENCH_LAP(t,mc,c);
   
   /* SCALABILITY: Data Partitioning */
   if (base.scalable_mode==SC_DP)
@@ -2145,18 +3188,33 @@ int dct_type;
     /* base layer could be MPEG-1 stream, enhancement MPEG-2 SNR */
     /* ISO/IEC 13818-2 section 7.4.3 and 7.4.4: Saturation and Mismatch control */
     if ((Two_Streams && enhan.scalable_mode==SC_SNR) || ld->MPEG2_Flag)
-      Saturate(thrd_ld[t].block[comp]);
+    {
+      if ((thrd_ld[t].pos[comp]&0x24)==0)
+        Saturate_4x4(thrd_ld[t].block[comp]);
+      else
+        Saturate(thrd_ld[t].block[comp]);
+    }
 
     /* ISO/IEC 13818-2 section Annex A: inverse DCT */
+    /* ISO/IEC 13818-2 section 7.6.8: Adding prediction and coefficient data */
     if (Reference_IDCT_Flag)
+    {
       Reference_IDCT(thrd_ld[t].block[comp]);
+      Thrd_Add_Block(t,comp,bx,by,dct_type,
+        (macroblock_type & MACROBLOCK_INTRA)==0);
+    }
     else
-      Fast_IDCT(thrd_ld[t].block[comp]);
-    
-    /* ISO/IEC 13818-2 section 7.6.8: Adding prediction and coefficient data */
-    Thrd_Add_Block(t,comp,bx,by,dct_type,(macroblock_type & MACROBLOCK_INTRA)==0);
+    {
+      /* DC only, 4x4 or full iDCT, added straight into the frame */
+      rfp = Thrd_Block_Dest(comp,bx,by,dct_type,&lx);
+      Fast_IDCT_Add(thrd_ld[t].block[comp],thrd_ld[t].pos[comp],rfp,lx,
+        (macroblock_type & MACROBLOCK_INTRA)==0);
+    }
   }
 
+  if (Bench_Runs)
+    BENCH_LAP(t,idct,c);
+
 }
 
 static void Thrd_macroblock_modes(t, pmacroblock_type,pstwtype,pstwclass,
@@ -2268,6 +3326,7 @@ int comp;
   int i, j;
   
   Block_Ptr = thrd_ld[t].block[comp];
+  thrd_ld[t].pos[comp] = 0;
 
 #ifdef SSE2
   __asm{
@@ -2299,12 +3358,14 @@ int comp;
     
 }
 
-static void Thrd_Add_Block(t,comp,bx,by,dct_type,addflag)
-int t, comp,bx,by,dct_type,addflag;
+/* position of block comp of the macroblock at bx,by in the current
+   frame, and the line stride within the block */
+static unsigned char *Thrd_Block_Dest(comp,bx,by,dct_type,lx)
+int comp,bx,by,dct_type;
+int *lx;
 {
-  int cc,i, j, iincr;
+  int cc;
   unsigned char *rfp;
-  short *bptr, tmp;
 
   /* derive color component index */
   /* equivalent to ISO/IEC 13818-2 Table 7-1 */
@@ -2320,21 +3381,21 @@ int t, comp,bx,by,dct_type,addflag;
         /* field DCT coding */
         rfp = current_frame[0]
               + Coded_Picture_Width*(by+((comp&2)>>1)) + bx + ((comp&1)<<3);
-        iincr = (Coded_Picture_Width<<1) - 8;
+        *lx = Coded_Picture_Width<<1;
       }
       else
       {
         /* frame DCT coding */
         rfp = current_frame[0]
               + Coded_Picture_Width*(by+((comp&2)<<2)) + bx + ((comp&1)<<3);
-        iincr = Coded_Picture_Width - 8;
+        *lx = Coded_Picture_Width;
       }
     else
     {
       /* field picture */
       rfp = current_frame[0]
             + (Coded_Picture_Width<<1)*(by+((comp&2)<<2)) + bx + ((comp&1)<<3);
-      iincr = (Coded_Picture_Width<<1) - 8;
+      *lx = Coded_Picture_Width<<1;
     }
   }
   else
@@ -2353,14 +3414,14 @@ int t, comp,bx,by,dct_type,addflag;
         /* field DCT coding */
         rfp = current_frame[cc]
               + Chroma_Width*(by+((comp&2)>>1)) + bx + (comp&8);
-        iincr = (Chroma_Width<<1) - 8;
+        *lx = Chroma_Width<<1;
       }
       else
       {
         /* frame DCT coding */
         rfp = current_frame[cc]
               + Chroma_Width*(by+((comp&2)<<2)) + bx + (comp&8);
-        iincr = Chroma_Width - 8;
+        *lx = Chroma_Width;
       }
     }
     else
@@ -2368,10 +3429,23 @@ int t, comp,bx,by,dct_type,addflag;
       /* field picture */
       rfp = current_frame[cc]
             + (Chroma_Width<<1)*(by+((comp&2)<<2)) + bx + (comp&8);
-      iincr = (Chroma_Width<<1) - 8;
+      *lx = Chroma_Width<<1;
     }
   }
 
+  return rfp;
+}
+
+static void Thrd_Add_Block(t,comp,bx,by,dct_type,addflag)
+int t, comp,bx,by,dct_type,addflag;
+{
+  int i, j, iincr;
+  unsigned char *rfp;
+  short *bptr, tmp;
+
+  rfp = Thrd_Block_Dest(comp,bx,by,dct_type,&iincr);
+  iincr -= 8;
+
   bptr = thrd_ld[t].block[comp];
 
   if (addflag)
@@ -91,6 +91,54 @@
 #define EXTERN
 #endif
 
+/* bit reader: all readers (main, systems layer, per-thread) keep a 64-bit
+ * cache with the next bit in the msb.  A flush that leaves fewer than 32
+ * bits refills a whole 32-bit word, so up to 32 bits can always be shown.
+ * The caller of BITS_FLUSH guarantees 4 readable bytes at ptr.
+ */
+typedef unsigned long long BITBUF;
+
+#define BITS_WORD(p) \
+  (((unsigned int)(p)[0]<<24)|((p)[1]<<16)|((p)[2]<<8)|(p)[3])
+#define BITS_SHOW(bfr,n) ((unsigned int)((bfr) >> (64-(n))))
+#define BITS_FLUSH(bfr,incnt,ptr,n) \
+  do { \
+    (bfr) <<= (n); \
+    if (((incnt) -= (n)) < 32) \
+    { \
+      (bfr) |= (BITBUF)BITS_WORD(ptr) << (32-(incnt)); \
+      (ptr) += 4; \
+      (incnt) += 32; \
+    } \
+  } while (0)
+
+/*
+ * -bench counts the decoding stages in ticks of the cheapest clock at
+ * hand (the time stamp counter, rdtime on RISC-V, else nanoseconds);
+ * the report scales them to seconds against the wall clock.
+ */
+typedef unsigned long long BENCH_TICKS;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BENCH_CLOCK(c) ((c) = __builtin_ia32_rdtsc())
+#elif defined(__GNUC__) && defined(__riscv) && (__riscv_xlen==64)
+#define BENCH_CLOCK(c) __asm__ __volatile__ ("rdtime %0" : "=r" (c))
+#else
+#define BENCH_CLOCK(c) ((c) = Bench_Clock())
+#endif
+
+/* index of picture_coding_type x into the per-type counts, 0 if invalid */
+#define BENCH_TYPE(x) ((unsigned int)(x)<5 ? (x) : 0)
+
+/* add the ticks since c to stage of thread t and restart c */
+#define BENCH_LAP(t,stage,c) \
+  do { \
+    BENCH_TICKS c_; \
+    BENCH_CLOCK(c_); \
+    thrd_stat[t].stage += c_ - (c); \
+    (c) = c_; \
+  } while (0)
+
 /* prototypes of global functions */
 /* readpic.c */
 void Substitute_Frame_Buffer _ANSI_ARGS_ ((int bitstream_framenum, 
@@ -105,6 +153,12 @@ void Flush_Buffer _ANSI_ARGS_((int n));
 unsigned int Get_Bits _ANSI_ARGS_((int n));
 int Get_Byte _ANSI_ARGS_((void));
 int Get_Word _ANSI_ARGS_((void));
+#ifdef ZERO_COPY
+void Map_Buffer _ANSI_ARGS_((void));
+void Seek_Buffer _ANSI_ARGS_((long offset));
+long Buffer_Offset _ANSI_ARGS_((void));
+void Map_Memory _ANSI_ARGS_((unsigned char *p, long size));
+#endif
 #ifdef THRD
 void Thrd_Initialize_Buffer _ANSI_ARGS_((int t));
 unsigned int Thrd_Show_Bits _ANSI_ARGS_((int t, int n));
@@ -144,6 +198,24 @@ void marker_bit _ANSI_ARGS_((char *text));
 void Decode_Picture _ANSI_ARGS_((int bitstream_framenum, 
   int sequence_framenum));
 void Output_Last_Frame_of_Sequence _ANSI_ARGS_((int framenum));
+#ifdef THRD
+double Thrd_Time _ANSI_ARGS_((void));
+void Thrd_Report _ANSI_ARGS_((void));
+BENCH_TICKS Bench_Clock _ANSI_ARGS_((void));
+void Bench_Picture _ANSI_ARGS_((int type));
+void Bench_Frame _ANSI_ARGS_((double seconds));
+void Bench_Reset _ANSI_ARGS_((void));
+void Bench_Report _ANSI_ARGS_((int runs, double wall, BENCH_TICKS ticks));
+#endif
+#ifdef FRAME_THRD
+void Thrd_Init_Frames _ANSI_ARGS_((void));
+void Thrd_Free_Frames _ANSI_ARGS_((void));
+void Thrd_Drain _ANSI_ARGS_((void));
+#endif
+#ifdef ZERO_COPY
+unsigned char *find_start_code _ANSI_ARGS_((unsigned char *p,
+  unsigned char *end));
+#endif
 
 /* getvlc.c */
 int Get_macroblock_type _ANSI_ARGS_((void));
@@ -156,6 +228,8 @@ int Get_Chroma_DC_dct_diff _ANSI_ARGS_((void));
 
 /* idct.c */
 void Fast_IDCT _ANSI_ARGS_((short *block));
+void Fast_IDCT_Add _ANSI_ARGS_((short *block, int pos, unsigned char *dst,
+  int lx, int addflag));
 void Initialize_Fast_IDCT _ANSI_ARGS_((void));
 
 /* Reference_IDCT.c */
@@ -187,11 +261,34 @@ void form_predictions _ANSI_ARGS_((int bx, int by, int macroblock_type,
   int motion_type, int PMV[2][2][2], int motion_vertical_field_select[2][2], 
   int dmvector[2], int stwtype));
 
+/* mcpred.c */
+typedef void (*Pred_Kernel) _ANSI_ARGS_((unsigned char *d, unsigned char *s,
+  int lx, int lx2, int h));
+EXTERN Pred_Kernel Pred_Table[2][2][2][2]; /* [average][xh][yh][w==16] */
+EXTERN char *Pred_Name;
+void Initialize_Predict _ANSI_ARGS_((void));
+int Check_Predict _ANSI_ARGS_((void));
+
+/* demux.c */
+#ifdef ZERO_COPY
+int Demux_Input _ANSI_ARGS_((void));
+void Demux_Select _ANSI_ARGS_((int k));
+#endif
+
+/* frames.c */
+void Frame_New _ANSI_ARGS_((unsigned char *frame[3], int width, int height,
+  int chroma_width, int chroma_height));
+int Frame_Hold _ANSI_ARGS_((unsigned char *frame[3]));
+void Frame_Release _ANSI_ARGS_((unsigned char *frame[3]));
+void Frame_Own _ANSI_ARGS_((unsigned char *frame[3]));
+
 /* spatscal.c */
 void Spatial_Prediction _ANSI_ARGS_((void));
 
 /* store.c */
 void Write_Frame _ANSI_ARGS_((unsigned char *src[], int frame));
+void Open_Stream _ANSI_ARGS_((void));
+void Close_Stream _ANSI_ARGS_((void));
 
 #ifdef DISPLAY
 /* display.c */
@@ -225,6 +322,30 @@ void Thrd_Decode_MPEG2_Intra_Block _ANSI_ARGS_((int t, int comp, int dc_dct_pred
 
 /* global variables */
 
+/* With FRAME_THRD several pictures are decoded at once, so the picture
+   level state below is kept per thread: the main thread parses headers
+   into its own copy and the slice workers load the copy of the picture
+   they work on (see Thrd_Load_Picture() in getpic.c) */
+#ifdef FRAME_THRD
+#if !defined(ZERO_COPY) || (NUM_THREADS<2)
+#error FRAME_THRD needs ZERO_COPY and NUM_THREADS>1
+#endif
+#define PICT_LOCAL __thread
+#else
+#define PICT_LOCAL
+#endif
+
+/* The streams of a demultiplexed input are parsed concurrently, each by
+   a thread of its own (Decode_Streams() in mpeg2dec.c), so with
+   FRAME_THRD the sequence level state the parser writes is per thread
+   as well.  The slice workers get the few fields they read through
+   Thrd_Load_Picture(). */
+#ifdef FRAME_THRD
+#define SEQ_LOCAL __thread
+#else
+#define SEQ_LOCAL
+#endif
+
 EXTERN char Version[]
 #ifdef GLOBAL
   ="mpeg2decode V1.2a, 96/07/19"
@@ -331,6 +452,8 @@ EXTERN int Inverse_Table_6_9[8][4]
 #define T_PPM   3
 #define T_X11   4
 #define T_X11HIQ 5
+#define T_YUVS  6 /* single planar YUV stream */
+#define T_Y4M   7 /* single YUV4MPEG2 stream */
 
 /* decoder operation control variables */
 EXTERN int Output_Type;
@@ -339,7 +462,7 @@ EXTERN int hiQdither;
 /* decoder operation control flags */
 EXTERN int Quiet_Flag;
 EXTERN int Trace_Flag;
-EXTERN int Fault_Flag;
+EXTERN PICT_LOCAL int Fault_Flag;
 EXTERN int Verbose_Flag;
 EXTERN int Two_Streams;
 EXTERN int Spatial_Flag;
@@ -353,139 +476,145 @@ EXTERN int Verify_Flag;
 EXTERN int Stats_Flag;
 EXTERN int User_Data_Flag;
 EXTERN int Main_Bitstream_Flag;
+EXTERN int Direct_Flag;
+EXTERN int Bench_Runs;      /* -bench n: measured decodes, 0 normally */
+EXTERN int Bench_Warmup;    /* -warmup n: unmeasured decodes before them */
+EXTERN int Bench_Pictures[5]; /* pictures parsed by picture_coding_type */
+EXTERN int Bench_Frames;    /* frames passed to Write_Frame() */
+EXTERN double Bench_Output; /* seconds spent in Write_Frame() */
 
 
 /* filenames */
-EXTERN char *Output_Picture_Filename;
+EXTERN SEQ_LOCAL char *Output_Picture_Filename;
 EXTERN char *Substitute_Picture_Filename;
 EXTERN char *Main_Bitstream_Filename; 
 EXTERN char *Enhancement_Layer_Bitstream_Filename; 
 
 
 /* buffers for multiuse purposes */
-EXTERN char Error_Text[256];
+EXTERN SEQ_LOCAL char Error_Text[256];
 EXTERN unsigned char *Clip;
 
 /* pointers to generic picture buffers */
-EXTERN unsigned char *backward_reference_frame[3];
-EXTERN unsigned char *forward_reference_frame[3];
+EXTERN PICT_LOCAL unsigned char *backward_reference_frame[3];
+EXTERN PICT_LOCAL unsigned char *forward_reference_frame[3];
 
-EXTERN unsigned char *auxframe[3];
-EXTERN unsigned char *current_frame[3];
-EXTERN unsigned char *substitute_frame[3];
+EXTERN SEQ_LOCAL unsigned char *auxframe[3];
+EXTERN PICT_LOCAL unsigned char *current_frame[3];
+EXTERN SEQ_LOCAL unsigned char *substitute_frame[3];
 
 
 /* pointers to scalability picture buffers */
-EXTERN unsigned char *llframe0[3];
-EXTERN unsigned char *llframe1[3];
+EXTERN SEQ_LOCAL unsigned char *llframe0[3];
+EXTERN SEQ_LOCAL unsigned char *llframe1[3];
 
-EXTERN short *lltmp;
+EXTERN SEQ_LOCAL short *lltmp;
 EXTERN char *Lower_Layer_Picture_Filename;
 
 
 
 
 /* non-normative variables derived from normative elements */
-EXTERN int Coded_Picture_Width;
-EXTERN int Coded_Picture_Height;
-EXTERN int Chroma_Width;
-EXTERN int Chroma_Height;
-EXTERN int block_count;
-EXTERN int Second_Field;
-EXTERN int profile, level;
+EXTERN SEQ_LOCAL int Coded_Picture_Width;
+EXTERN SEQ_LOCAL int Coded_Picture_Height;
+EXTERN SEQ_LOCAL int Chroma_Width;
+EXTERN SEQ_LOCAL int Chroma_Height;
+EXTERN SEQ_LOCAL int block_count;
+EXTERN PICT_LOCAL int Second_Field;
+EXTERN SEQ_LOCAL int profile, level;
 
 /* normative derived variables (as per ISO/IEC 13818-2) */
-EXTERN int horizontal_size;
-EXTERN int vertical_size;
-EXTERN int mb_width;
-EXTERN int mb_height;
-EXTERN double bit_rate;
-EXTERN double frame_rate; 
+EXTERN SEQ_LOCAL int horizontal_size;
+EXTERN SEQ_LOCAL int vertical_size;
+EXTERN SEQ_LOCAL int mb_width;
+EXTERN SEQ_LOCAL int mb_height;
+EXTERN SEQ_LOCAL double bit_rate;
+EXTERN SEQ_LOCAL double frame_rate; 
 
 
 
 /* headers */
 
 /* ISO/IEC 13818-2 section 6.2.2.1:  sequence_header() */
-EXTERN int aspect_ratio_information;
-EXTERN int frame_rate_code; 
-EXTERN int bit_rate_value; 
-EXTERN int vbv_buffer_size;
-EXTERN int constrained_parameters_flag;
+EXTERN SEQ_LOCAL int aspect_ratio_information;
+EXTERN SEQ_LOCAL int frame_rate_code; 
+EXTERN SEQ_LOCAL int bit_rate_value; 
+EXTERN SEQ_LOCAL int vbv_buffer_size;
+EXTERN SEQ_LOCAL int constrained_parameters_flag;
 
 /* ISO/IEC 13818-2 section 6.2.2.3:  sequence_extension() */
-EXTERN int profile_and_level_indication;
-EXTERN int progressive_sequence;
-EXTERN int chroma_format;
-EXTERN int low_delay;
-EXTERN int frame_rate_extension_n;
-EXTERN int frame_rate_extension_d;
+EXTERN SEQ_LOCAL int profile_and_level_indication;
+EXTERN SEQ_LOCAL int progressive_sequence;
+EXTERN SEQ_LOCAL int chroma_format;
+EXTERN SEQ_LOCAL int low_delay;
+EXTERN SEQ_LOCAL int frame_rate_extension_n;
+EXTERN SEQ_LOCAL int frame_rate_extension_d;
 
 /* ISO/IEC 13818-2 section 6.2.2.4:  sequence_display_extension() */
-EXTERN int video_format;  
-EXTERN int color_description;
-EXTERN int color_primaries;
-EXTERN int transfer_characteristics;
-EXTERN int matrix_coefficients;
-EXTERN int display_horizontal_size;
-EXTERN int display_vertical_size;
+EXTERN SEQ_LOCAL int video_format;  
+EXTERN SEQ_LOCAL int color_description;
+EXTERN SEQ_LOCAL int color_primaries;
+EXTERN SEQ_LOCAL int transfer_characteristics;
+EXTERN SEQ_LOCAL int matrix_coefficients;
+EXTERN SEQ_LOCAL int display_horizontal_size;
+EXTERN SEQ_LOCAL int display_vertical_size;
 
 /* ISO/IEC 13818-2 section 6.2.3: picture_header() */
-EXTERN int temporal_reference;
-EXTERN int picture_coding_type;
-EXTERN int vbv_delay;
-EXTERN int full_pel_forward_vector;
-EXTERN int forward_f_code;
-EXTERN int full_pel_backward_vector;
-EXTERN int backward_f_code;
+EXTERN SEQ_LOCAL int temporal_reference;
+EXTERN PICT_LOCAL int picture_coding_type;
+EXTERN SEQ_LOCAL int vbv_delay;
+EXTERN PICT_LOCAL int full_pel_forward_vector;
+EXTERN PICT_LOCAL int forward_f_code;
+EXTERN PICT_LOCAL int full_pel_backward_vector;
+EXTERN PICT_LOCAL int backward_f_code;
 
 
 /* ISO/IEC 13818-2 section 6.2.3.1: picture_coding_extension() header */
-EXTERN int f_code[2][2];
-EXTERN int intra_dc_precision;
-EXTERN int picture_structure;
-EXTERN int top_field_first;
-EXTERN int frame_pred_frame_dct;
-EXTERN int concealment_motion_vectors;
+EXTERN PICT_LOCAL int f_code[2][2];
+EXTERN PICT_LOCAL int intra_dc_precision;
+EXTERN PICT_LOCAL int picture_structure;
+EXTERN PICT_LOCAL int top_field_first;
+EXTERN PICT_LOCAL int frame_pred_frame_dct;
+EXTERN PICT_LOCAL int concealment_motion_vectors;
 
-EXTERN int intra_vlc_format;
+EXTERN PICT_LOCAL int intra_vlc_format;
 
-EXTERN int repeat_first_field;
+EXTERN SEQ_LOCAL int repeat_first_field;
 
-EXTERN int chroma_420_type;
-EXTERN int progressive_frame;
-EXTERN int composite_display_flag;
-EXTERN int v_axis;
-EXTERN int field_sequence;
-EXTERN int sub_carrier;
-EXTERN int burst_amplitude;
-EXTERN int sub_carrier_phase;
+EXTERN SEQ_LOCAL int chroma_420_type;
+EXTERN PICT_LOCAL int progressive_frame;
+EXTERN SEQ_LOCAL int composite_display_flag;
+EXTERN SEQ_LOCAL int v_axis;
+EXTERN SEQ_LOCAL int field_sequence;
+EXTERN SEQ_LOCAL int sub_carrier;
+EXTERN SEQ_LOCAL int burst_amplitude;
+EXTERN SEQ_LOCAL int sub_carrier_phase;
 
 
 
 /* ISO/IEC 13818-2 section 6.2.3.3: picture_display_extension() header */
-EXTERN int frame_center_horizontal_offset[3];
-EXTERN int frame_center_vertical_offset[3];
+EXTERN SEQ_LOCAL int frame_center_horizontal_offset[3];
+EXTERN SEQ_LOCAL int frame_center_vertical_offset[3];
 
 
 
 /* ISO/IEC 13818-2 section 6.2.2.5: sequence_scalable_extension() header */
-EXTERN int layer_id;
-EXTERN int lower_layer_prediction_horizontal_size;
-EXTERN int lower_layer_prediction_vertical_size;
-EXTERN int horizontal_subsampling_factor_m;
-EXTERN int horizontal_subsampling_factor_n;
-EXTERN int vertical_subsampling_factor_m;
-EXTERN int vertical_subsampling_factor_n;
+EXTERN SEQ_LOCAL int layer_id;
+EXTERN SEQ_LOCAL int lower_layer_prediction_horizontal_size;
+EXTERN SEQ_LOCAL int lower_layer_prediction_vertical_size;
+EXTERN SEQ_LOCAL int horizontal_subsampling_factor_m;
+EXTERN SEQ_LOCAL int horizontal_subsampling_factor_n;
+EXTERN SEQ_LOCAL int vertical_subsampling_factor_m;
+EXTERN SEQ_LOCAL int vertical_subsampling_factor_n;
 
 
 /* ISO/IEC 13818-2 section 6.2.3.5: picture_spatial_scalable_extension() header */
-EXTERN int lower_layer_temporal_reference;
-EXTERN int lower_layer_horizontal_offset;
-EXTERN int lower_layer_vertical_offset;
-EXTERN int spatial_temporal_weight_code_table_index;
-EXTERN int lower_layer_progressive_frame;
-EXTERN int lower_layer_deinterlaced_field_select;
+EXTERN SEQ_LOCAL int lower_layer_temporal_reference;
+EXTERN SEQ_LOCAL int lower_layer_horizontal_offset;
+EXTERN SEQ_LOCAL int lower_layer_vertical_offset;
+EXTERN SEQ_LOCAL int spatial_temporal_weight_code_table_index;
+EXTERN SEQ_LOCAL int lower_layer_progressive_frame;
+EXTERN SEQ_LOCAL int lower_layer_deinterlaced_field_select;
 
 
 
@@ -493,36 +622,42 @@ EXTERN int lower_layer_deinterlaced_field_select;
 
 
 /* ISO/IEC 13818-2 section 6.2.3.6: copyright_extension() header */
-EXTERN int copyright_flag;
-EXTERN int copyright_identifier;
-EXTERN int original_or_copy;
-EXTERN int copyright_number_1;
-EXTERN int copyright_number_2;
-EXTERN int copyright_number_3;
+EXTERN SEQ_LOCAL int copyright_flag;
+EXTERN SEQ_LOCAL int copyright_identifier;
+EXTERN SEQ_LOCAL int original_or_copy;
+EXTERN SEQ_LOCAL int copyright_number_1;
+EXTERN SEQ_LOCAL int copyright_number_2;
+EXTERN SEQ_LOCAL int copyright_number_3;
 
 /* ISO/IEC 13818-2 section 6.2.2.6: group_of_pictures_header()  */
-EXTERN int drop_flag;
-EXTERN int hour;
-EXTERN int minute;
-EXTERN int sec;
-EXTERN int frame;
-EXTERN int closed_gop;
-EXTERN int broken_link;
+EXTERN SEQ_LOCAL int drop_flag;
+EXTERN SEQ_LOCAL int hour;
+EXTERN SEQ_LOCAL int minute;
+EXTERN SEQ_LOCAL int sec;
+EXTERN SEQ_LOCAL int frame;
+EXTERN SEQ_LOCAL int closed_gop;
+EXTERN SEQ_LOCAL int broken_link;
 
 
 
 /* layer specific variables (needed for SNR and DP scalability) */
-EXTERN struct layer_data {
+struct layer_data {
   /* bit input */
   int Infile;
-  unsigned char Rdbfr[2048];
+  unsigned char *Rdbfr; /* input buffer, or the mapped input */
   unsigned char *Rdptr;
+  unsigned char *Rdend; /* end of valid data in Rdbfr */
   unsigned char Inbfr[16];
   /* from mpeg2play */
-  unsigned int Bfr;
+  BITBUF Bfr;
   unsigned char *Rdmax;
   int Incnt;
   int Bitcnt;
+#ifdef ZERO_COPY
+  /* whole input held in memory, see Map_Buffer() */
+  unsigned char *Map;
+  long Mapsize;
+#endif
   /* sequence header and quant_matrix_extension() */
   int intra_quantizer_matrix[64];
   int non_intra_quantizer_matrix[64];
@@ -547,24 +682,27 @@ EXTERN struct layer_data {
   int quantizer_scale;
   int intra_slice;
   short block[12][64];
-} base, enhan, *ld;
+};
+
+EXTERN PICT_LOCAL struct layer_data base, *ld;
+EXTERN struct layer_data enhan;
 
 
 
 #ifdef VERIFY
-EXTERN int verify_sequence_header;
-EXTERN int verify_group_of_pictures_header;
-EXTERN int verify_picture_header;
-EXTERN int verify_slice_header;
-EXTERN int verify_sequence_extension;
-EXTERN int verify_sequence_display_extension;
-EXTERN int verify_quant_matrix_extension;
-EXTERN int verify_sequence_scalable_extension;
-EXTERN int verify_picture_display_extension;
-EXTERN int verify_picture_coding_extension;
-EXTERN int verify_picture_spatial_scalable_extension;
-EXTERN int verify_picture_temporal_scalable_extension;
-EXTERN int verify_copyright_extension;
+EXTERN SEQ_LOCAL int verify_sequence_header;
+EXTERN SEQ_LOCAL int verify_group_of_pictures_header;
+EXTERN SEQ_LOCAL int verify_picture_header;
+EXTERN SEQ_LOCAL int verify_slice_header;
+EXTERN SEQ_LOCAL int verify_sequence_extension;
+EXTERN SEQ_LOCAL int verify_sequence_display_extension;
+EXTERN SEQ_LOCAL int verify_quant_matrix_extension;
+EXTERN SEQ_LOCAL int verify_sequence_scalable_extension;
+EXTERN SEQ_LOCAL int verify_picture_display_extension;
+EXTERN SEQ_LOCAL int verify_picture_coding_extension;
+EXTERN SEQ_LOCAL int verify_picture_spatial_scalable_extension;
+EXTERN SEQ_LOCAL int verify_picture_temporal_scalable_extension;
+EXTERN SEQ_LOCAL int verify_copyright_extension;
 #endif /* VERIFY */
 
 
@@ -579,7 +717,7 @@ void Clear_Verify_Headers _ANSI_ARGS_((void));
 
 EXTERN int global_MBA;
 EXTERN int global_pic;
-EXTERN int True_Framenum;
+EXTERN SEQ_LOCAL int True_Framenum;
 
 #ifdef THRD
 unsigned char *frame_buffer;
@@ -588,10 +726,12 @@ unsigned int frame_buf_size;
 unsigned int frame_buf_offset;
 
 unsigned char *thrd_ptr[NUM_THREADS];
-unsigned int thrd_buf[NUM_THREADS];
+BITBUF thrd_buf[NUM_THREADS];
 int thrd_Incnt[NUM_THREADS];
 
 #define INIT_BUF_SIZE 2048
+/* bytes the slice readers may look ahead past the copied data */
+#define BITS_SLACK 8
 #if 0
 unsigned char *thrd_frame_buf[NUM_THREADS];
 unsigned int thrd_frame_buf_size[NUM_THREADS];
@@ -614,6 +754,24 @@ typedef struct{
   int MBAmax;
 } Thrd_Args;
 
+/* decoding threads at run time (-threads), at most NUM_THREADS */
+int Num_Threads;
+
+/* per-thread accounting, see Thrd_Report() */
+typedef struct {
+  double busy;          /* seconds spent decoding slices */
+  double idle;          /* seconds spent waiting for work */
+  double last;          /* busy time of the current picture */
+  double type[5];       /* busy time by picture_coding_type */
+  BENCH_TICKS vlc;      /* -bench: macroblock parsing and coefficients */
+  BENCH_TICKS mc;       /* -bench: motion compensated prediction */
+  BENCH_TICKS idct;     /* -bench: saturation, iDCT and add */
+  int slices;
+  unsigned char padding[36];
+} thrd_stat_info;
+
+thrd_stat_info thrd_stat[NUM_THREADS];
+
 #ifndef USE_ICC
 #define __declspec(x)
 #define align(x)
@@ -629,6 +787,7 @@ __declspec(align(16)) struct thrd_layer_data {
   int quantizer_scale;
   int intra_slice;
   short block[12][64];
+  int pos[12]; /* OR of the raster positions of the coded coefficients */
 } thrd_ld[NUM_THREADS];
 
 
@@ -135,6 +135,8 @@
 /* global declarations */
 void Initialize_Fast_IDCT _ANSI_ARGS_((void));
 void Fast_IDCT _ANSI_ARGS_((short *block));
+void Fast_IDCT_Add _ANSI_ARGS_((short *block, int pos, unsigned char *dst,
+  int lx, int addflag));
 
 /* private data */
 #if 0
@@ -703,8 +705,7 @@ __declspec(align(16)) short tab_i_35[] =
 #define tg_3_16  -21746
 #define cos_4_16 -19195
 
-#define DCT_8_INV_COL(x, y)				\
-  {							\
+#define DCT_8_INV_COL_TERMS(x)				\
     int t0, t1, t2, t3, t4, t5, t6, t7;			\
     int tp03, tm03, tp12, tm12, tp65, tm65;		\
     int tp465, tm465, tp765, tm765;			\
@@ -733,7 +734,11 @@ __declspec(align(16)) short tab_i_35[] =
     t0 = tp03 + tm03+RND_INV_COL;			\
     t3 = tp03 - tm03+RND_INV_CORR;			\
     t1 = tp12 + tm12+RND_INV_COL;			\
-    t2 = tp12 - tm12+RND_INV_CORR;   			\
+    t2 = tp12 - tm12+RND_INV_CORR;
+
+#define DCT_8_INV_COL(x, y)				\
+  {							\
+    DCT_8_INV_COL_TERMS(x)				\
     							\
     y[8*0] = SHIFT_COL ( CLIP(t0 + t7 ));		\
     y[8*7] = SHIFT_COL (  CLIP(t0 - t7 ));	\
@@ -745,7 +750,66 @@ __declspec(align(16)) short tab_i_35[] =
     y[8*4] = SHIFT_COL (  CLIP(t3 - t4 ));	\
   }
 
+/* column iDCT fused with the prediction add: the column result goes
+   straight into the picture column d (line stride lx) */
+#define DCT_8_INV_COL_ADD(x, d, lx, add)		\
+  {							\
+    DCT_8_INV_COL_TERMS(x)				\
+    							\
+    ADD_PEL(d[0],    (short)SHIFT_COL(CLIP(t0 + t7)), add);	\
+    ADD_PEL(d[7*lx], (short)SHIFT_COL(CLIP(t0 - t7)), add);	\
+    ADD_PEL(d[lx],   (short)SHIFT_COL(CLIP(t1 + t6)), add);	\
+    ADD_PEL(d[6*lx], (short)SHIFT_COL(CLIP(t1 - t6)), add);	\
+    ADD_PEL(d[2*lx], (short)SHIFT_COL(CLIP(t2 + t5)), add);	\
+    ADD_PEL(d[5*lx], (short)SHIFT_COL(CLIP(t2 - t5)), add);	\
+    ADD_PEL(d[3*lx], (short)SHIFT_COL(CLIP(t3 + t4)), add);	\
+    ADD_PEL(d[4*lx], (short)SHIFT_COL(CLIP(t3 - t4)), add);	\
+  }
+
+/* row iDCTs of a row whose coefficients 4..7 are zero, and of a row
+   holding only coefficient 7 (mismatch control's toggle of the last
+   coefficient) */
+#define DCT_4_INV_ROW_SCALAR(x, w) \
+{ \
+  int a0, a1, a2, a3, b0, b1, b2, b3; \
+ \
+  a0 = x[0] * w[ 0] + x[2] * w[ 1]; \
+  a1 = x[0] * w[ 4] + x[2] * w[ 5]; \
+  a2 = x[0] * w[ 8] + x[2] * w[ 9]; \
+  a3 = x[0] * w[12] + x[2] * w[13]; \
+  b0 = x[1] * w[16] + x[3] * w[17]; \
+  b1 = x[1] * w[20] + x[3] * w[21]; \
+  b2 = x[1] * w[24] + x[3] * w[25]; \
+  b3 = x[1] * w[28] + x[3] * w[29]; \
+\
+  x[0] = SHIFT_ROUND_ROW ( a0 + b0 );\
+  x[1] = SHIFT_ROUND_ROW ( a1 + b1 );\
+  x[2] = SHIFT_ROUND_ROW ( a2 + b2 );\
+  x[3] = SHIFT_ROUND_ROW ( a3 + b3 );\
+  x[4] = SHIFT_ROUND_ROW ( a3 - b3 );\
+  x[5] = SHIFT_ROUND_ROW ( a2 - b2 );\
+  x[6] = SHIFT_ROUND_ROW ( a1 - b1 );\
+  x[7] = SHIFT_ROUND_ROW ( a0 - b0 );\
+}
 
+#define DCT_LAST_INV_ROW_SCALAR(x, w) \
+{ \
+  int b0, b1, b2, b3; \
+ \
+  b0 = x[7] * w[19]; \
+  b1 = x[7] * w[23]; \
+  b2 = x[7] * w[27]; \
+  b3 = x[7] * w[31]; \
+\
+  x[0] = SHIFT_ROUND_ROW ( b0 );\
+  x[1] = SHIFT_ROUND_ROW ( b1 );\
+  x[2] = SHIFT_ROUND_ROW ( b2 );\
+  x[3] = SHIFT_ROUND_ROW ( b3 );\
+  x[4] = SHIFT_ROUND_ROW ( -b3 );\
+  x[5] = SHIFT_ROUND_ROW ( -b2 );\
+  x[6] = SHIFT_ROUND_ROW ( -b1 );\
+  x[7] = SHIFT_ROUND_ROW ( -b0 );\
+}
 
 static void idct_M128ASM_scalar(short* src)
 {
@@ -1017,6 +1081,88 @@ short *block;
 }
 
 
+/* add the prediction (addflag) or the intra offset 128 to a pel and
+   clamp it to 0..255 */
+#define ADD_PEL(d, v, add) \
+  { int p_ = ((add) ? (d) : 128) + (v); (d) = (p_<0) ? 0 : (p_>255) ? 255 : p_; }
+
+/* inverse DCT fused with the add and clamp of Add_Block, written
+   straight into the picture at dst (line stride lx). pos is the OR of
+   the raster positions of the coded coefficients: 0 means DC only,
+   bits 2 and 5 clear mean the top-left 4x4 only. Coefficient 63 is
+   checked in the block itself since mismatch control toggles it. The sparse cases compute exactly what Fast_IDCT does,
+   only skipping the terms known to be zero. */
+void Fast_IDCT_Add(block,pos,dst,lx,addflag)
+short *block;
+int pos;
+unsigned char *dst;
+int lx, addflag;
+{
+#if !(ORIGINAL_IDCT) && !(MATRIX_IDCT) && !defined(SSE2)
+  int i, j, v, r[8];
+
+  if ((pos&0x24)==0)
+  {
+    if (pos==0)
+    {
+      /* a DC only row transforms to 4*DC in every column */
+      v = block[0]<<2;
+      if (block[63]==0)
+      {
+        /* DC only: the columns all transform to the same values */
+        r[0] = (v+17)>>5;
+        r[1] = r[6] = (v+16)>>5;
+        r[2] = r[3] = r[4] = r[5] = r[7] = (v+15)>>5;
+        for (i=0; i<8; i++)
+        {
+          for (j=0; j<8; j++)
+            ADD_PEL(dst[j], r[i], addflag);
+          dst += lx;
+        }
+        return;
+      }
+      for (i=0; i<8; i++)
+        block[i] = v;
+    }
+    else
+    {
+      DCT_4_INV_ROW_SCALAR(block,tab_i_04);
+      DCT_4_INV_ROW_SCALAR((block+8),tab_i_17);
+      DCT_4_INV_ROW_SCALAR((block+8*2),tab_i_26);
+      DCT_4_INV_ROW_SCALAR((block+8*3),tab_i_35);
+    }
+    if (block[63])
+      DCT_LAST_INV_ROW_SCALAR((block+8*7),tab_i_17);
+  }
+  else
+  {
+    DCT_8_INV_ROW_SCALAR(block,block,tab_i_04);
+    DCT_8_INV_ROW_SCALAR((block+8*4),(block+8*4),tab_i_04);
+    DCT_8_INV_ROW_SCALAR((block+8),(block+8),tab_i_17);
+    DCT_8_INV_ROW_SCALAR((block+8*7),(block+8*7),tab_i_17);
+    DCT_8_INV_ROW_SCALAR((block+8*2),(block+8*2),tab_i_26);
+    DCT_8_INV_ROW_SCALAR((block+8*6),(block+8*6),tab_i_26);
+    DCT_8_INV_ROW_SCALAR((block+8*3),(block+8*3),tab_i_35);
+    DCT_8_INV_ROW_SCALAR((block+8*5),(block+8*5),tab_i_35);
+  }
+
+  for (i=0; i<8; i++)
+    DCT_8_INV_COL_ADD((block+i),(dst+i),lx,addflag);
+#else
+  int i, j;
+
+  Fast_IDCT(block);
+
+  for (i=0; i<8; i++)
+  {
+    for (j=0; j<8; j++)
+      ADD_PEL(dst[j], block[8*i+j], addflag);
+    dst += lx;
+  }
+#endif
+}
+
+
 void Initialize_Fast_IDCT()
 {
   int i, j;
@@ -0,0 +1,434 @@
+/*
+ * 
+ * This file is part of the ALPBench Benchmark Suite Version 1.0
+ * 
+ * Copyright (c) 2005 The Board of Trustees of the University of Illinois
+ * 
+ * All rights reserved.
+ * 
+ * ALPBench is a derivative of several codes, and restricted by licenses
+ * for those codes, as indicated in the source files and the ALPBench
+ * license at http://www.cs.uiuc.edu/alp/alpbench/alpbench-license.html
+ * 
+ * The multithreading and SSE2 modifications for SpeechRec, FaceRec,
+ * MPEGenc, and MPEGdec were done by Man-Lap (Alex) Li and Ruchira
+ * Sasanka as part of the ALP research project at the University of
+ * Illinois at Urbana-Champaign (http://www.cs.uiuc.edu/alp/), directed
+ * by Prof. Sarita V. Adve, Dr. Yen-Kuang Chen, and Dr. Eric Debes.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal with the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimers.
+ * 
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimers in the documentation and/or other materials provided
+ *       with the distribution.
+ * 
+ *     * Neither the names of Professor Sarita Adve's research group, the
+ *       University of Illinois at Urbana-Champaign, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this Software without specific prior written permission.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE
+ * SOFTWARE.
+ * 
+ */
+
+
+/* mcpred.c, motion compensation prediction kernels                      */
+
+/*
+ * One kernel per block width (8 or 16), half-pel case and averaging
+ * flag, for every backend.  form_component_prediction() in recon.c picks
+ * the kernel from Pred_Table[average][xh][yh][w==16], which
+ * Initialize_Predict() fills from the best backend the CPU supports (or
+ * the one named with -mc).  All backends are bit-exact with the C
+ * reference of ISO/IEC 13818-2 section 7.6.4; "-mc test" checks that.
+ *
+ *   c     reference loops
+ *   swar  64-bit words, eight pels per operation, any 64-bit CPU
+ *   vec   GCC vector extensions, built when the target has SIMD
+ *         (SSE2, NEON, RISC-V V)
+ *   sse2  SSE2 intrinsics, x86 only
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* before global.h, which maps _mm_malloc() to malloc() */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define PRED_SSE2
+#endif
+
+#include "config.h"
+#include "global.h"
+
+#if defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON) || \
+    defined(__riscv_vector))
+#define PRED_VEC
+#endif
+
+#if defined(__riscv_vector) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+typedef unsigned long long pel8;
+
+/* lane-wise rounded averages, (a+b+1)>>1 and (a+b+c+e+2)>>2; the four
+   pel average adds the top six and the low two bits of every pel
+   separately so nothing carries into the next lane */
+#define LANE_AVG2(a,b,fe) (((a)|(b)) - ((((a)^(b))&(fe))>>1))
+#define LANE_AVG4(a,b,c,e,m3f,m03,m02) \
+  ( ((((a)>>2)&(m3f)) + (((b)>>2)&(m3f)) + (((c)>>2)&(m3f)) + \
+     (((e)>>2)&(m3f))) + \
+    (((((a)&(m03)) + ((b)&(m03)) + ((c)&(m03)) + ((e)&(m03)) + \
+       (m02)) >> 2) & (m03)) )
+
+/* the kernels: b is a generic routine taking w, xh, yh and average as
+   constants, PRED_KERNELS() instantiates all 16 of them */
+#define PRED_KERNEL(b,w,a,x,y) \
+static void b##_##w##a##x##y(d,s,lx,lx2,h) \
+unsigned char *d, *s; \
+int lx, lx2, h; \
+{ \
+  b(d,s,lx,lx2,w,h,x,y,a); \
+}
+
+#define PRED_KERNELS(b) \
+  PRED_KERNEL(b,8,0,0,0)  PRED_KERNEL(b,8,0,0,1) \
+  PRED_KERNEL(b,8,0,1,0)  PRED_KERNEL(b,8,0,1,1) \
+  PRED_KERNEL(b,8,1,0,0)  PRED_KERNEL(b,8,1,0,1) \
+  PRED_KERNEL(b,8,1,1,0)  PRED_KERNEL(b,8,1,1,1) \
+  PRED_KERNEL(b,16,0,0,0) PRED_KERNEL(b,16,0,0,1) \
+  PRED_KERNEL(b,16,0,1,0) PRED_KERNEL(b,16,0,1,1) \
+  PRED_KERNEL(b,16,1,0,0) PRED_KERNEL(b,16,1,0,1) \
+  PRED_KERNEL(b,16,1,1,0) PRED_KERNEL(b,16,1,1,1)
+
+#define PRED_SET(t,b,w,a,x,y) t[a][x][y][(w)>>4] = b##_##w##a##x##y;
+#define PRED_TABLE(t,b) \
+  PRED_SET(t,b,8,0,0,0)  PRED_SET(t,b,8,0,0,1) \
+  PRED_SET(t,b,8,0,1,0)  PRED_SET(t,b,8,0,1,1) \
+  PRED_SET(t,b,8,1,0,0)  PRED_SET(t,b,8,1,0,1) \
+  PRED_SET(t,b,8,1,1,0)  PRED_SET(t,b,8,1,1,1) \
+  PRED_SET(t,b,16,0,0,0) PRED_SET(t,b,16,0,0,1) \
+  PRED_SET(t,b,16,0,1,0) PRED_SET(t,b,16,0,1,1) \
+  PRED_SET(t,b,16,1,0,0) PRED_SET(t,b,16,1,0,1) \
+  PRED_SET(t,b,16,1,1,0) PRED_SET(t,b,16,1,1,1)
+
+
+/* C reference */
+static __inline__ void pred_c(d,s,lx,lx2,w,h,xh,yh,average)
+unsigned char *d, *s;
+int lx, lx2, w, h, xh, yh, average;
+{
+  int i, j, v;
+
+  for (j=0; j<h; j++)
+  {
+    for (i=0; i<w; i++)
+    {
+      if (!xh && !yh)
+        v = s[i];
+      else if (!xh)
+        v = (s[i]+s[i+lx]+1)>>1;
+      else if (!yh)
+        v = (s[i]+s[i+1]+1)>>1;
+      else
+        v = (s[i]+s[i+1]+s[i+lx]+s[i+lx+1]+2)>>2;
+
+      d[i] = average ? (d[i]+v+1)>>1 : v;
+    }
+    s+= lx2;
+    d+= lx2;
+  }
+}
+
+PRED_KERNELS(pred_c)
+
+
+/* eight pels in a 64-bit word; the lanes are independent, so byte order
+   does not matter */
+static __inline__ pel8 load8(p)
+unsigned char *p;
+{
+  pel8 v;
+
+  memcpy(&v,p,8);
+  return v;
+}
+
+static __inline__ void pred_swar(d,s,lx,lx2,w,h,xh,yh,average)
+unsigned char *d, *s;
+int lx, lx2, w, h, xh, yh, average;
+{
+  const pel8 fe = 0xfefefefefefefefeULL;
+  const pel8 m3f = 0x3f3f3f3f3f3f3f3fULL;
+  const pel8 m03 = 0x0303030303030303ULL;
+  const pel8 m02 = 0x0202020202020202ULL;
+  int i, j;
+  pel8 v;
+
+  for (j=0; j<h; j++)
+  {
+    for (i=0; i<w; i+=8)
+    {
+      if (!xh && !yh)
+        v = load8(s+i);
+      else if (!xh)
+        v = LANE_AVG2(load8(s+i),load8(s+i+lx),fe);
+      else if (!yh)
+        v = LANE_AVG2(load8(s+i),load8(s+i+1),fe);
+      else
+        v = LANE_AVG4(load8(s+i),load8(s+i+1),load8(s+i+lx),
+                      load8(s+i+lx+1),m3f,m03,m02);
+
+      if (average)
+        v = LANE_AVG2(load8(d+i),v,fe);
+      memcpy(d+i,&v,8);
+    }
+    s+= lx2;
+    d+= lx2;
+  }
+}
+
+PRED_KERNELS(pred_swar)
+
+
+#ifdef PRED_VEC
+/* the same arithmetic on native vectors, a whole row per operation */
+typedef unsigned char pel16v __attribute__((vector_size(16)));
+typedef unsigned char pel8v __attribute__((vector_size(8)));
+
+#define VEC_ROW(T,d,s,lx,xh,yh,average) \
+  { \
+    T a, b, c, e, v; \
+    if (!xh && !yh) \
+      memcpy(&v,s,sizeof(T)); \
+    else if (!xh || !yh) \
+    { \
+      memcpy(&a,s,sizeof(T)); \
+      memcpy(&b,s+(xh?1:lx),sizeof(T)); \
+      v = LANE_AVG2(a,b,0xfe); \
+    } \
+    else \
+    { \
+      memcpy(&a,s,sizeof(T)); \
+      memcpy(&b,s+1,sizeof(T)); \
+      memcpy(&c,s+lx,sizeof(T)); \
+      memcpy(&e,s+lx+1,sizeof(T)); \
+      v = LANE_AVG4(a,b,c,e,0x3f,0x03,0x02); \
+    } \
+    if (average) \
+    { \
+      memcpy(&a,d,sizeof(T)); \
+      v = LANE_AVG2(a,v,0xfe); \
+    } \
+    memcpy(d,&v,sizeof(T)); \
+  }
+
+static __inline__ void pred_vec(d,s,lx,lx2,w,h,xh,yh,average)
+unsigned char *d, *s;
+int lx, lx2, w, h, xh, yh, average;
+{
+  int j;
+
+  for (j=0; j<h; j++)
+  {
+    if (w==16)
+      VEC_ROW(pel16v,d,s,lx,xh,yh,average)
+    else
+      VEC_ROW(pel8v,d,s,lx,xh,yh,average)
+    s+= lx2;
+    d+= lx2;
+  }
+}
+
+PRED_KERNELS(pred_vec)
+#endif /* PRED_VEC */
+
+
+#ifdef PRED_SSE2
+static __inline__ __m128i sse2_load(p,w)
+unsigned char *p;
+int w;
+{
+  return w==16 ? _mm_loadu_si128((__m128i *)p)
+               : _mm_loadl_epi64((__m128i *)p);
+}
+
+static __inline__ void pred_sse2(d,s,lx,lx2,w,h,xh,yh,average)
+unsigned char *d, *s;
+int lx, lx2, w, h, xh, yh, average;
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i two = _mm_set1_epi16(2);
+  __m128i a, b, c, e, lo, hi;
+  int j;
+
+  for (j=0; j<h; j++)
+  {
+    a = sse2_load(s,w);
+    if (xh && yh)
+    {
+      /* pavgb rounds twice, so widen for the four pel average */
+      b = sse2_load(s+1,w);
+      c = sse2_load(s+lx,w);
+      e = sse2_load(s+lx+1,w);
+      lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a,zero),
+                                       _mm_unpacklo_epi8(b,zero)),
+                         _mm_add_epi16(_mm_unpacklo_epi8(c,zero),
+                                       _mm_unpacklo_epi8(e,zero)));
+      hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a,zero),
+                                       _mm_unpackhi_epi8(b,zero)),
+                         _mm_add_epi16(_mm_unpackhi_epi8(c,zero),
+                                       _mm_unpackhi_epi8(e,zero)));
+      lo = _mm_srli_epi16(_mm_add_epi16(lo,two),2);
+      hi = _mm_srli_epi16(_mm_add_epi16(hi,two),2);
+      a = _mm_packus_epi16(lo,hi);
+    }
+    else if (xh || yh)
+      a = _mm_avg_epu8(a,sse2_load(s+(xh?1:lx),w));
+
+    if (average)
+      a = _mm_avg_epu8(a,sse2_load(d,w));
+
+    if (w==16)
+      _mm_storeu_si128((__m128i *)d,a);
+    else
+      _mm_storel_epi64((__m128i *)d,a);
+    s+= lx2;
+    d+= lx2;
+  }
+}
+
+PRED_KERNELS(pred_sse2)
+#endif /* PRED_SSE2 */
+
+
+static Pred_Kernel Pred_C[2][2][2][2];
+
+/* fill t with the kernels of the named backend, 0 if not available */
+static int Pred_Backend(name,t)
+char *name;
+Pred_Kernel t[2][2][2][2];
+{
+  if (!strcmp(name,"c"))
+  {
+    PRED_TABLE(t,pred_c)
+    return 1;
+  }
+  if (!strcmp(name,"swar"))
+  {
+    PRED_TABLE(t,pred_swar)
+    return 1;
+  }
+#ifdef PRED_VEC
+  if (!strcmp(name,"vec"))
+  {
+#if defined(__riscv_vector) && defined(__linux__)
+    if (!(getauxval(AT_HWCAP) & (1<<('V'-'A'))))
+      return 0;
+#endif
+    PRED_TABLE(t,pred_vec)
+    return 1;
+  }
+#endif
+#ifdef PRED_SSE2
+  if (!strcmp(name,"sse2"))
+  {
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("sse2"))
+      return 0;
+#endif
+    PRED_TABLE(t,pred_sse2)
+    return 1;
+  }
+#endif
+  return 0;
+}
+
+static char *Pred_Names[] = {"sse2", "vec", "swar", "c", NULL};
+
+void Initialize_Predict()
+{
+  int i;
+
+  if (strcmp(Pred_Name,"auto"))
+  {
+    if (!Pred_Backend(Pred_Name,Pred_Table))
+    {
+      sprintf(Error_Text,"prediction kernels \"%s\" not available\n",
+        Pred_Name);
+      Error(Error_Text);
+    }
+    return;
+  }
+
+  for (i=0; !Pred_Backend(Pred_Names[i],Pred_Table); i++)
+    ;
+  Pred_Name = Pred_Names[i];
+}
+
+/* -mc test: run every kernel of every available backend on random
+   blocks and compare with the C reference; returns the mismatches */
+int Check_Predict()
+{
+  static unsigned char src[64*40], ref[64*40], dst[64*40];
+  static int heights[3] = {4, 8, 16};
+  Pred_Kernel t[2][2][2][2];
+  int b, n, a, x, y, w, k, lx2, bad, total;
+
+  Pred_Backend("c",Pred_C);
+  srand(1);
+  total = 0;
+
+  for (b=0; Pred_Names[b]; b++)
+  {
+    if (!Pred_Backend(Pred_Names[b],t))
+    {
+      printf("%-5s not available\n",Pred_Names[b]);
+      continue;
+    }
+
+    bad = 0;
+    for (n=0; n<200; n++)
+      for (a=0; a<2; a++)
+        for (x=0; x<2; x++)
+          for (y=0; y<2; y++)
+            for (w=0; w<2; w++)
+            {
+              /* frame (lx2==lx) and field (lx2==2*lx) strides */
+              lx2 = (n&1) ? 64 : 32;
+              for (k=0; k<(int)sizeof(src); k++)
+              {
+                src[k] = rand()>>7;
+                ref[k] = dst[k] = rand()>>7;
+              }
+              Pred_C[a][x][y][w](ref+n%3,src+n%5,32,lx2,heights[n%3]);
+              t[a][x][y][w](dst+n%3,src+n%5,32,lx2,heights[n%3]);
+              if (memcmp(ref,dst,sizeof(dst)))
+                bad++;
+            }
+
+    printf("%-5s %d mismatches\n",Pred_Names[b],bad);
+    total += bad;
+  }
+  return total;
+}
@@ -82,9 +82,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <string.h>
 #include <fcntl.h>
 #include <assert.h>
 #include <unistd.h>
+#ifdef FRAME_THRD
+#include <pthread.h>
+#endif
 
 #define GLOBAL
 #include "config.h"
@@ -93,6 +97,10 @@
 /* private prototypes */
 static int  video_sequence _ANSI_ARGS_((int *framenum));
 static int Decode_Bitstream _ANSI_ARGS_((void));
+static int Decode_Streams _ANSI_ARGS_((void));
+#ifdef THRD
+static void Benchmark _ANSI_ARGS_((void));
+#endif
 static int  Headers _ANSI_ARGS_((void));
 static void Initialize_Sequence _ANSI_ARGS_((void));
 static void Initialize_Decoder _ANSI_ARGS_((void));
@@ -102,6 +110,25 @@ static void Process_Options _ANSI_ARGS_((int argc, char *argv[]));
 static void Initialize_Frame_Buffer _ANSI_ARGS_((void));
 #endif
 
+/* video streams of a demultiplexed input, 0 for an elementary stream */
+static int Num_Streams;
+
+/* one video stream to decode, see Decode_Streams() */
+typedef struct {
+  int k;
+  char *name;                    /* output name */
+  char outname[FILENAME_LENGTH];
+  int ret;
+#ifdef FRAME_THRD
+  pthread_t thread;
+#endif
+} Stream_Args;
+
+static void Decode_Stream _ANSI_ARGS_((Stream_Args *sa));
+#ifdef FRAME_THRD
+static void *Decode_Stream_Thread _ANSI_ARGS_((void *arg));
+#endif
+
 #if OLD
 static int  Get_Val _ANSI_ARGS_((char *argv[]));
 #endif
@@ -124,6 +151,10 @@ char *argv[];
   /* decode command line arguments */
   Process_Options(argc,argv);
 
+  /* -mc test: check the prediction kernels against the C reference */
+  if (!strcmp(Pred_Name,"test"))
+    exit(Check_Predict() ? ERROR : 0);
+
 #ifdef DEBUG
   Print_Options();
 #endif
@@ -138,6 +169,10 @@ char *argv[];
     exit(1);
   }
 
+#ifdef ZERO_COPY
+  Map_Buffer();
+  Num_Streams = Demux_Input();
+#endif
 
   if(base.Infile != 0)
   {
@@ -201,7 +236,17 @@ char *argv[];
   Initialize_Frame_Buffer();
 #endif
 
-  ret = Decode_Bitstream();
+#ifdef THRD
+  if (Bench_Runs)
+    Benchmark();
+  else
+#endif
+  ret = Decode_Streams();
+
+#ifdef THRD
+  if (!Quiet_Flag && !Bench_Runs)
+    Thrd_Report();
+#endif
 
   close(base.Infile);
 
@@ -222,7 +267,7 @@ static void Initialize_Frame_Buffer() {
   for (i=0; i<NUM_THREADS; i++) {
     tb[i].frame_buf_size = INIT_BUF_SIZE;
     tb[i].frame_buf = 
-      (unsigned char *) malloc(sizeof(unsigned char)*INIT_BUF_SIZE);
+      (unsigned char *) malloc(sizeof(unsigned char)*(INIT_BUF_SIZE+BITS_SLACK));
   }
 #endif
 }
@@ -233,6 +278,9 @@ static void Initialize_Decoder()
 {
   int i;
 
+  /* motion compensation kernels, see mcpred.c */
+  Initialize_Predict();
+
   /* Clip table */
   if (!(Clip=(unsigned char *)malloc(1024)))
     Error("Clip[] malloc failed\n");
@@ -253,7 +301,6 @@ static void Initialize_Decoder()
 /* mostly IMPLEMENTAION specific rouintes */
 static void Initialize_Sequence()
 {
-  int cc, size;
   static int Table_6_20[3] = {6,8,12};
 
   /* check scalability mode of enhancement layer */
@@ -281,7 +328,8 @@ static void Initialize_Sequence()
   Coded_Picture_Width = 16*mb_width;
   Coded_Picture_Height = 16*mb_height;
 
-  printf("height %d width %d\n",Coded_Picture_Height, Coded_Picture_Width);
+  if (!Quiet_Flag)
+    printf("height %d width %d\n",Coded_Picture_Height, Coded_Picture_Width);
 
   /* ISO/IEC 13818-2 sections 6.1.1.8, 6.1.1.9, and 6.1.1.10 */
   Chroma_Width = (chroma_format==CHROMA444) ? Coded_Picture_Width
@@ -292,37 +340,35 @@ static void Initialize_Sequence()
   /* derived based on Table 6-20 in ISO/IEC 13818-2 section 6.3.17 */
   block_count = Table_6_20[chroma_format-1];
 
-  for (cc=0; cc<3; cc++)
-  {
-    if (cc==0)
-      size = Coded_Picture_Width*Coded_Picture_Height;
-    else
-      size = Chroma_Width*Chroma_Height;
-
-    if (!(backward_reference_frame[cc] = (unsigned char *)_mm_malloc(size,16)))
-      Error("backward_reference_frame[] malloc failed\n");
+  /* picture buffers come from the frame pool (frames.c) */
+  Frame_New(backward_reference_frame, Coded_Picture_Width,
+            Coded_Picture_Height, Chroma_Width, Chroma_Height);
+  Frame_New(forward_reference_frame, Coded_Picture_Width,
+            Coded_Picture_Height, Chroma_Width, Chroma_Height);
+  Frame_New(auxframe, Coded_Picture_Width,
+            Coded_Picture_Height, Chroma_Width, Chroma_Height);
 
-    if (!(forward_reference_frame[cc] = (unsigned char *)_mm_malloc(size,16)))
-      Error("forward_reference_frame[] malloc failed\n");
+  if (Ersatz_Flag)
+    Frame_New(substitute_frame, Coded_Picture_Width,
+              Coded_Picture_Height, Chroma_Width, Chroma_Height);
 
-    if (!(auxframe[cc] = (unsigned char *)_mm_malloc(size,16)))
-      Error("auxframe[] malloc failed\n");
-
-    if(Ersatz_Flag)
-      if (!(substitute_frame[cc] = (unsigned char *)_mm_malloc(size,16)))
-        Error("substitute_frame[] malloc failed\n");
-
-
-    if (base.scalable_mode==SC_SPAT)
-    {
-      /* this assumes lower layer is 4:2:0 */
-      if (!(llframe0[cc] = (unsigned char *)_mm_malloc((lower_layer_prediction_horizontal_size*lower_layer_prediction_vertical_size)/(cc?4:1),16)))
-        Error("llframe0 malloc failed\n");
-      if (!(llframe1[cc] = (unsigned char *)_mm_malloc((lower_layer_prediction_horizontal_size*lower_layer_prediction_vertical_size)/(cc?4:1),16)))
-        Error("llframe1 malloc failed\n");
-    }
+  if (base.scalable_mode==SC_SPAT)
+  {
+    /* this assumes lower layer is 4:2:0 */
+    Frame_New(llframe0, lower_layer_prediction_horizontal_size,
+              lower_layer_prediction_vertical_size,
+              lower_layer_prediction_horizontal_size>>1,
+              lower_layer_prediction_vertical_size>>1);
+    Frame_New(llframe1, lower_layer_prediction_horizontal_size,
+              lower_layer_prediction_vertical_size,
+              lower_layer_prediction_horizontal_size>>1,
+              lower_layer_prediction_vertical_size>>1);
   }
 
+#ifdef FRAME_THRD
+  Thrd_Init_Frames();
+#endif
+
   /* SCALABILITY: Spatial */
   if (base.scalable_mode==SC_SPAT)
   {
@@ -371,6 +417,7 @@ char *argv[];              /* argument vector */
     printf("\n%s, %s\n",Version,Author);
     printf("Usage:  mpeg2decode {options}\n\
 Options: -b  file  main bitstream (base or spatial enhancement layer)\n\
+         -bench n  decode n times, print a CSV timing report (threaded build)\n\
          -cn file  conformance report (n: level)\n\
          -e  file  enhancement layer bitstream (SNR or Data Partitioning)\n\
          -f        store/display interlaced video in frame format\n\
@@ -378,12 +425,18 @@ Options: -b  file  main bitstream (base or spatial enhancement layer)\n\
          -in file  information & statistics report  (n: level)\n\
          -l  file  file name pattern for lower layer sequence\n\
                    (for spatial scalability)\n\
-         -on file  output format (0:YUV 1:SIF 2:TGA 3:PPM 4:X11 5:X11HiQ)\n\
+         -mc name  motion compensation kernels: c swar vec sse2\n\
+                   (default: fastest available), test: check and exit\n\
+         -direct   write -o6/-o7 streams with O_DIRECT\n\
+         -on file  output format (0:YUV 1:SIF 2:TGA 3:PPM 4:X11 5:X11HiQ\n\
+                   6:YUV stream 7:Y4M stream, file \"-\" is stdout)\n\
          -q        disable warnings to stderr\n\
          -r        use double precision reference IDCT\n\
          -t        enable low level tracing to stdout\n\
+         -threads n  number of decoding threads (threaded build only)\n\
          -u  file  print user_data to stdio or file\n\
          -vn       verbose output (n: level)\n\
+         -warmup n decode n times unmeasured before -bench\n\
          -x  file  filename pattern of picture substitution sequence\n\n\
 File patterns:  for sequential filenames, \"printf\" style, e.g. rec%%d\n\
                  or rec%%d%%c for fieldwise storage\n\
@@ -407,7 +460,7 @@ Example:       mpeg2decode -b bitstream.mpg -f -r -o0 rec%%d\n\
     /* parse ahead to see if another flag immediately follows current
        argument (this is used to tell if a filename is missing) */
     if(!LastArg)
-      NextArg = (argv[i+1][0]=='-');
+      NextArg = (argv[i+1][0]=='-' && argv[i+1][1]!='\0'); /* "-" is stdout */
     else
       NextArg = 0;
 
@@ -418,6 +471,19 @@ Example:       mpeg2decode -b bitstream.mpg -f -r -o0 rec%%d\n\
       {
         /* third character. [2], is the value */
       case 'B':
+        if (!strcmp(argv[i],"-bench"))
+        {
+          if (NextArg || LastArg || (Bench_Runs = atoi(argv[++i])) < 1)
+          {
+            printf("ERROR: -bench must be followed by the number of runs\n");
+            exit(ERROR);
+          }
+#ifndef THRD
+          printf("WARNING: This program not compiled for -bench option\n");
+          Bench_Runs = 0;
+#endif
+          break;
+        }
         Main_Bitstream_Flag = 1;
 
         if(NextArg || LastArg)
@@ -446,6 +512,16 @@ Example:       mpeg2decode -b bitstream.mpg -f -r -o0 rec%%d\n\
 #endif /* VERIFY */
         break;
 
+      case 'D':
+        if (strcmp(argv[i],"-direct"))
+        {
+          fprintf(stderr,"undefined option %s ignored. Exiting program\n", 
+            argv[i]);
+          exit(ERROR);
+        }
+        Direct_Flag = 1;
+        break;
+
       case 'E':
         Two_Streams = 1; /* either Data Partitioning (DP) or SNR Scalability enhancment */
 	                   
@@ -490,6 +566,15 @@ Example:       mpeg2decode -b bitstream.mpg -f -r -o0 rec%%d\n\
 
         break;
 
+      case 'M':
+        if (strcmp(argv[i],"-mc") || NextArg || LastArg)
+        {
+          printf("ERROR: -mc must be followed by c, swar, vec, sse2 or test\n");
+          exit(ERROR);
+        }
+        Pred_Name = argv[++i];
+        break;
+
       case 'O':
   
         Output_Type = atoi(&argv[i][2]); 
@@ -523,6 +608,27 @@ Example:       mpeg2decode -b bitstream.mpg -f -r -o0 rec%%d\n\
         break;
     
       case 'T':
+        if (!strcmp(argv[i],"-threads"))
+        {
+#ifdef THRD
+          if (NextArg || LastArg)
+          {
+            printf("ERROR: -threads must be followed by the number of threads\n");
+            exit(ERROR);
+          }
+          Num_Threads = atoi(argv[++i]);
+          if (Num_Threads < 1 || Num_Threads > NUM_THREADS)
+          {
+            printf("ERROR: -threads %d out of range [1,%d]\n",
+              Num_Threads, NUM_THREADS);
+            exit(ERROR);
+          }
+#else /* THRD */
+          printf("WARNING: This program not compiled for -threads option\n");
+          i++;
+#endif /* THRD */
+          break;
+        }
 #ifdef TRACE
         Trace_Flag = 1;
 #else /* TRACE */
@@ -542,6 +648,15 @@ Example:       mpeg2decode -b bitstream.mpg -f -r -o0 rec%%d\n\
         break;
 
 
+      case 'W':
+        if (strcmp(argv[i],"-warmup") || NextArg || LastArg
+            || (Bench_Warmup = atoi(argv[++i])) < 0)
+        {
+          printf("ERROR: -warmup must be followed by the number of runs\n");
+          exit(ERROR);
+        }
+        break;
+
       case 'X':
         Ersatz_Flag = 1;
 
@@ -703,28 +818,150 @@ static int Decode_Bitstream()
 }
 
 
-static void Deinitialize_Sequence()
+/* decode video stream sa->k of a demultiplexed input, or the elementary
+   stream, to sa->name */
+static void Decode_Stream(sa)
+Stream_Args *sa;
 {
-  int i;
+#ifdef ZERO_COPY
+  if (Num_Streams)
+  {
+    Demux_Select(sa->k);
+    Initialize_Buffer();
+  }
+#endif
 
-  /* clear flags */
-  base.MPEG2_Flag=0;
+  Output_Picture_Filename = sa->name;
+
+  if (Output_Type==T_YUVS || Output_Type==T_Y4M)
+    Open_Stream();
+
+  sa->ret = Decode_Bitstream();
+
+  if (Output_Type==T_YUVS || Output_Type==T_Y4M)
+    Close_Stream();
+}
+
+#ifdef FRAME_THRD
+static void *Decode_Stream_Thread(arg)
+void *arg;
+{
+  Decode_Stream((Stream_Args *) arg);
+  return NULL;
+}
+#endif
+
+/* decode every video stream of the input; with more than one, stream k
+   is written to the output name followed by _k.  With FRAME_THRD the
+   streams are decoded at once, each parsed by a thread of its own and
+   all sharing the slice workers, unless their frames would interleave
+   on stdout or the display; otherwise they are decoded in turn. */
+static int Decode_Streams()
+{
+  int k, n, ret;
+  char *name;
+  Stream_Args *sa;
+
+  name = Output_Picture_Filename;
+  n = Num_Streams ? Num_Streams : 1;
+
+  if (!(sa = (Stream_Args *) calloc(n, sizeof(Stream_Args))))
+    Error("malloc failed\n");
+  for (k=0; k<n; k++)
+  {
+    sa[k].k = k;
+    sa[k].name = name;
+    if (n>1 && *name && strcmp(name,"-"))
+    {
+      sprintf(sa[k].outname,"%s_%d",name,k);
+      sa[k].name = sa[k].outname;
+    }
+  }
+
+#ifdef FRAME_THRD
+  if (n>1 && strcmp(name,"-") && Output_Type!=T_X11)
+  {
+    for (k=0; k<n; k++)
+      if (pthread_create(&sa[k].thread, NULL, Decode_Stream_Thread, &sa[k]))
+        Error("Couldn't start a stream decoder\n");
+    for (k=0; k<n; k++)
+      pthread_join(sa[k].thread, NULL);
+  }
+  else
+#endif
+  for (k=0; k<n; k++)
+    Decode_Stream(&sa[k]);
+
+  ret = sa[n-1].ret;
+  free(sa);
+
+  Output_Picture_Filename = name;
+  return ret;
+}
 
-  for(i=0;i<3;i++)
+
+#ifdef THRD
+/* -bench: decode the whole input Bench_Warmup times unmeasured, then
+   Bench_Runs times, and report.  The input is rewound in between; with
+   ZERO_COPY it is decoded from memory every time. */
+static void Benchmark()
+{
+  int run;
+  double t0 = 0.0;
+  BENCH_TICKS c0 = 0, c1;
+
+  for (run=0; run<Bench_Warmup+Bench_Runs; run++)
   {
-    _mm_free(backward_reference_frame[i]);
-    _mm_free(forward_reference_frame[i]);
-    _mm_free(auxframe[i]);
+    if (run==Bench_Warmup)
+    {
+      Bench_Reset();
+      t0 = Thrd_Time();
+      BENCH_CLOCK(c0);
+    }
 
-    if (base.scalable_mode==SC_SPAT)
+    if (run && !Num_Streams)
     {
-     _mm_free(llframe0[i]);
-     _mm_free(llframe1[i]);
+      ld = &base;
+#ifndef ZERO_COPY
+      if (lseek(base.Infile, 0l, 0)<0)
+        Error("-bench needs a seekable input\n");
+#endif
+      Initialize_Buffer();
     }
+
+    Decode_Streams();
   }
 
+  BENCH_CLOCK(c1);
+  Bench_Report(Bench_Runs, Thrd_Time()-t0, c1-c0);
+}
+#endif
+
+
+static void Deinitialize_Sequence()
+{
+  /* clear flags */
+  base.MPEG2_Flag=0;
+
+#ifdef FRAME_THRD
+  /* the frame buffers rotate, free them all at once */
+  Thrd_Free_Frames();
+#endif
+
+#ifndef FRAME_THRD
+  Frame_Release(backward_reference_frame);
+  Frame_Release(forward_reference_frame);
+  Frame_Release(auxframe);
+#endif
+  if (Ersatz_Flag)
+    Frame_Release(substitute_frame);
+
   if (base.scalable_mode==SC_SPAT)
+  {
+    Frame_Release(llframe0);
+    Frame_Release(llframe1);
     _mm_free(lltmp);
+  }
 
 #ifdef DISPLAY
   if (Output_Type==T_X11) 
@@ -811,6 +1048,13 @@ static void Clear_Options()
   Verify_Flag = 0;
   Stats_Flag  = 0;
   User_Data_Flag = 0; 
+  Direct_Flag = 0;
+  Pred_Name = "auto";
+  Bench_Runs = 0;
+  Bench_Warmup = 0;
+#ifdef THRD
+  Num_Threads = NUM_THREADS;
+#endif
 }
 
 
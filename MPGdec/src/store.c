@@ -78,11 +78,17 @@
  *
  */
 
+#define _GNU_SOURCE /* O_DIRECT */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <assert.h>
+#ifdef THRD
+#include <pthread.h>
+#endif
 
 #include "config.h"
 #include "global.h"
@@ -105,12 +111,34 @@ static void conv420to422 _ANSI_ARGS_((unsigned char *src, unsigned char *dst));
 
 static void store_yuv_progressive _ANSI_ARGS_((char *outname, unsigned char *src[],
 				   int offset, int incr, int height));
+struct out_stream;
+static void Stream_Frame _ANSI_ARGS_((unsigned char *src[]));
+static void Stream_Header _ANSI_ARGS_((void));
+static void Stream_Slot _ANSI_ARGS_((struct out_stream *st, int s));
+static void Stream_Write _ANSI_ARGS_((struct out_stream *st, unsigned char *p,
+  long n));
+static void Stream_Out _ANSI_ARGS_((struct out_stream *st, unsigned char *p,
+  long n));
+#ifdef THRD
+static void *Stream_Writer _ANSI_ARGS_((void *arg));
+#endif
 
 #define OBFRSIZE 8192 /*4096*/
 static unsigned char obfr[OBFRSIZE];
 static unsigned char *optr;
 static int outfile;
 
+/* the file writers share obfr and their conversion buffers, and with
+   FRAME_THRD the parsers of several streams write at once */
+#ifdef FRAME_THRD
+static pthread_mutex_t store_lock = PTHREAD_MUTEX_INITIALIZER;
+#define STORE_LOCK() pthread_mutex_lock(&store_lock)
+#define STORE_UNLOCK() pthread_mutex_unlock(&store_lock)
+#else
+#define STORE_LOCK()
+#define STORE_UNLOCK()
+#endif
+
 /*
  * store a picture as either one frame or two fields
  */
@@ -119,23 +147,43 @@ unsigned char *src[];
 int frame;
 {
   char outname[FILENAME_LENGTH];
+#ifdef THRD
+  double t0 = 0.0;
 
-  if (progressive_sequence || progressive_frame || Frame_Store_Flag)
+  if (Bench_Runs)
+    t0 = Thrd_Time();
+#endif
+
+  if (Output_Type==T_YUVS || Output_Type==T_Y4M)
   {
-    /* progressive */
-    sprintf(outname,Output_Picture_Filename,frame,'f');
-    store_one(outname,src,0,Coded_Picture_Width,vertical_size);
+    /* streams always hold whole frames */
+    Stream_Frame(src);
   }
   else
   {
-    /* interlaced */
-    sprintf(outname,Output_Picture_Filename,frame,'a');
-    store_one(outname,src,0,Coded_Picture_Width<<1,vertical_size>>1);
+    STORE_LOCK();
+    if (progressive_sequence || progressive_frame || Frame_Store_Flag)
+    {
+      /* progressive */
+      sprintf(outname,Output_Picture_Filename,frame,'f');
+      store_one(outname,src,0,Coded_Picture_Width,vertical_size);
+    }
+    else
+    {
+      /* interlaced */
+      sprintf(outname,Output_Picture_Filename,frame,'a');
+      store_one(outname,src,0,Coded_Picture_Width<<1,vertical_size>>1);
 
-    sprintf(outname,Output_Picture_Filename,frame,'b');
-    store_one(outname,src,
-      Coded_Picture_Width,Coded_Picture_Width<<1,vertical_size>>1);
+      sprintf(outname,Output_Picture_Filename,frame,'b');
+      store_one(outname,src,
+        Coded_Picture_Width,Coded_Picture_Width<<1,vertical_size>>1);
+    }
+    STORE_UNLOCK();
   }
+
+#ifdef THRD
+  Bench_Frame(Bench_Runs ? Thrd_Time() - t0 : 0.0);
+#endif
 }
 
 /*
@@ -685,3 +733,339 @@ unsigned char *src,*dst;
     }
   }
 }
+
+
+/*
+ * streaming output (-o6 planar YUV, -o7 YUV4MPEG2): all frames go to one
+ * file, or to stdout for "-".  Write_Frame() queues the frame in a ring
+ * slot and a writer thread does the write()s, so decoding only waits for
+ * the disk when the whole ring is queued.  Unless the picture is cropped
+ * horizontally (its planes are then not contiguous) the slot just holds
+ * a reference to the decoded frame (Frame_Hold() in frames.c); otherwise
+ * the cropped frame is copied into the slot.
+ */
+
+#define STREAM_SLOTS 8
+#define DIRECT_ALIGN 4096
+#define DIRECT_STAGE (1<<22)
+
+typedef struct out_stream {
+  int fd;
+  int y4m;
+  int direct;               /* written with O_DIRECT */
+  int size;                 /* bytes per slot */
+  int plane[3];             /* bytes per plane */
+  int hold;                 /* slots may hold decoded frames */
+  unsigned char *slot[STREAM_SLOTS];
+  unsigned char *held[STREAM_SLOTS][3];
+  int head, tail;           /* next slot to write, next slot to fill */
+  int done;
+  unsigned char *stage;     /* O_DIRECT: aligned staging buffer */
+  long staged;
+  long total;
+#ifdef THRD
+  pthread_t writer;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+#endif
+} Out_Stream;
+
+/* the output of the stream this thread decodes, see SEQ_LOCAL in
+   global.h; the writer thread gets a pointer to it */
+static SEQ_LOCAL Out_Stream stream;
+
+/* frame_rate_code as a fraction, ISO/IEC 13818-2 table 6-4 */
+static int frame_rate_num[16] =
+  {0, 24000, 24, 25, 30000, 30, 50, 60000, 60, 0,0,0,0,0,0,0};
+static int frame_rate_den[16] =
+  {1, 1001, 1, 1, 1001, 1, 1, 1001, 1, 1,1,1,1,1,1,1};
+
+void Open_Stream()
+{
+  static int saved_stdout = -1;
+
+  /* opened once per video stream of a demultiplexed input */
+  memset(&stream, 0, sizeof(stream));
+  stream.y4m = Output_Type==T_Y4M;
+  stream.direct = Direct_Flag;
+
+  if (!strcmp(Output_Picture_Filename,"-"))
+  {
+    /* keep the video on the real stdout and send messages to stderr */
+    fflush(stdout);
+    if (saved_stdout<0 && ((saved_stdout = dup(1))<0 || dup2(2,1)<0))
+      Error("Couldn't redirect stdout\n");
+    if ((stream.fd = dup(saved_stdout))<0)
+      Error("Couldn't redirect stdout\n");
+    stream.direct = 0;
+  }
+  else
+  {
+    stream.fd = -1;
+#ifdef O_DIRECT
+    if (stream.direct)
+    {
+      stream.fd = open(Output_Picture_Filename,
+                       O_CREAT|O_TRUNC|O_WRONLY|O_BINARY|O_DIRECT,0666);
+      if (stream.fd==-1 && !Quiet_Flag)
+        fprintf(stderr,"O_DIRECT not supported for %s\n",
+                Output_Picture_Filename);
+    }
+#endif
+    if (stream.fd==-1)
+    {
+      stream.direct = 0;
+      stream.fd = open(Output_Picture_Filename,
+                       O_CREAT|O_TRUNC|O_WRONLY|O_BINARY,0666);
+    }
+    if (stream.fd==-1)
+    {
+      sprintf(Error_Text,"Couldn't create %s\n",Output_Picture_Filename);
+      Error(Error_Text);
+    }
+    if (stream.direct &&
+        posix_memalign((void **)&stream.stage,DIRECT_ALIGN,DIRECT_STAGE))
+      Error("malloc failed\n");
+  }
+
+  if (!Quiet_Flag)
+    fprintf(stderr,"streaming to %s\n",Output_Picture_Filename);
+}
+
+void Close_Stream()
+{
+  int n;
+
+  if (!stream.size)
+  {
+    close(stream.fd);
+    return;
+  }
+
+#ifdef THRD
+  pthread_mutex_lock(&stream.lock);
+  stream.done = 1;
+  pthread_cond_broadcast(&stream.cond);
+  pthread_mutex_unlock(&stream.lock);
+  pthread_join(stream.writer, NULL);
+#endif
+
+  if (stream.direct && stream.staged)
+  {
+    /* write the tail a whole block at a time, then cut the file back */
+    n = (stream.staged + DIRECT_ALIGN-1) & ~(DIRECT_ALIGN-1);
+    memset(stream.stage+stream.staged, 0, n-stream.staged);
+    stream.total += stream.staged;
+    stream.staged = 0;
+    Stream_Out(&stream, stream.stage, n);
+    if (ftruncate(stream.fd, stream.total))
+      Error("stream truncate failed\n");
+  }
+  close(stream.fd);
+
+  for (n=0; n<STREAM_SLOTS; n++)
+    free(stream.slot[n]);
+  free(stream.stage);
+}
+
+static void Stream_Header()
+{
+  char header[128];
+  int num, den;
+
+  num = frame_rate_num[frame_rate_code] * (frame_rate_extension_n+1);
+  den = frame_rate_den[frame_rate_code] * (frame_rate_extension_d+1);
+
+  sprintf(header,"YUV4MPEG2 W%d H%d F%d:%d I%c C%s\n",
+          horizontal_size, vertical_size, num, den,
+          progressive_sequence ? 'p' : top_field_first ? 't' : 'b',
+          chroma_format==CHROMA420 ? "420mpeg2" :
+          chroma_format==CHROMA422 ? "422" : "444");
+  Stream_Write(&stream, (unsigned char *)header, strlen(header));
+}
+
+static void Stream_Frame(src)
+unsigned char *src[];
+{
+  int i, s, cc, width, height, incr;
+  unsigned char *p;
+
+  if (!stream.size)
+  {
+    width = horizontal_size;
+    height = vertical_size;
+    if (chroma_format!=CHROMA444)
+      width >>= 1;
+    if (chroma_format==CHROMA420)
+      height >>= 1;
+    stream.plane[0] = horizontal_size*vertical_size;
+    stream.plane[1] = stream.plane[2] = width*height;
+    stream.size = stream.plane[0] + 2*stream.plane[1]
+                  + (stream.y4m ? 6 : 0);
+    stream.hold = horizontal_size==Coded_Picture_Width;
+
+    if (stream.y4m)
+      Stream_Header();
+
+#ifdef THRD
+    pthread_mutex_init(&stream.lock, NULL);
+    pthread_cond_init(&stream.cond, NULL);
+    if (pthread_create(&stream.writer, NULL, Stream_Writer, &stream))
+      Error("Couldn't start the stream writer\n");
+#endif
+  }
+
+#ifdef THRD
+  pthread_mutex_lock(&stream.lock);
+  while (stream.tail - stream.head == STREAM_SLOTS)
+    pthread_cond_wait(&stream.cond, &stream.lock);
+  pthread_mutex_unlock(&stream.lock);
+#endif
+
+  s = stream.tail%STREAM_SLOTS;
+  if (stream.hold && Frame_Hold(src))
+  {
+    /* no copy, the writer releases the frame */
+    for (cc=0; cc<3; cc++)
+      stream.held[s][cc] = src[cc];
+  }
+  else
+  {
+    if (!stream.slot[s] &&
+        !(stream.slot[s] = (unsigned char *)malloc(stream.size)))
+      Error("malloc failed\n");
+
+    p = stream.slot[s];
+    if (stream.y4m)
+    {
+      memcpy(p,"FRAME\n",6);
+      p += 6;
+    }
+
+    for (cc=0; cc<3; cc++)
+    {
+      width = horizontal_size;
+      height = vertical_size;
+      incr = Coded_Picture_Width;
+      if (cc && chroma_format!=CHROMA444)
+      {
+        width >>= 1;
+        incr = Chroma_Width;
+      }
+      if (cc && chroma_format==CHROMA420)
+        height >>= 1;
+
+      for (i=0; i<height; i++)
+      {
+        memcpy(p, src[cc] + incr*i, width);
+        p += width;
+      }
+    }
+  }
+
+#ifdef THRD
+  pthread_mutex_lock(&stream.lock);
+  stream.tail++;
+  pthread_cond_broadcast(&stream.cond);
+  pthread_mutex_unlock(&stream.lock);
+#else
+  Stream_Slot(&stream, s);
+  stream.tail++;
+#endif
+}
+
+#ifdef THRD
+static void *Stream_Writer(arg)
+void *arg;
+{
+  Out_Stream *st = (Out_Stream *) arg;
+
+  pthread_mutex_lock(&st->lock);
+  for (;;)
+  {
+    while (st->head==st->tail && !st->done)
+      pthread_cond_wait(&st->cond, &st->lock);
+    if (st->head==st->tail)
+      break;
+    pthread_mutex_unlock(&st->lock);
+
+    Stream_Slot(st, st->head%STREAM_SLOTS);
+
+    pthread_mutex_lock(&st->lock);
+    st->head++;
+    pthread_cond_broadcast(&st->cond);
+  }
+  pthread_mutex_unlock(&st->lock);
+  return NULL;
+}
+#endif
+
+/* write ring slot s: a held frame plane by plane, or the copy */
+static void Stream_Slot(st, s)
+Out_Stream *st;
+int s;
+{
+  int cc;
+
+  if (!st->held[s][0])
+  {
+    Stream_Write(st, st->slot[s], st->size);
+    return;
+  }
+
+  if (st->y4m)
+    Stream_Write(st, (unsigned char *)"FRAME\n", 6);
+  for (cc=0; cc<3; cc++)
+    Stream_Write(st, st->held[s][cc], st->plane[cc]);
+  Frame_Release(st->held[s]);
+}
+
+static void Stream_Write(st, p, n)
+Out_Stream *st;
+unsigned char *p;
+long n;
+{
+  long k;
+
+  if (st->direct)
+  {
+    /* O_DIRECT wants aligned, whole-block writes: go through the stage */
+    while (n > 0)
+    {
+      k = DIRECT_STAGE - st->staged;
+      if (k > n)
+        k = n;
+      memcpy(st->stage+st->staged, p, k);
+      st->staged += k;
+      p += k;
+      n -= k;
+      if (st->staged==DIRECT_STAGE)
+      {
+        Stream_Out(st, st->stage, DIRECT_STAGE);
+        st->total += DIRECT_STAGE;
+        st->staged = 0;
+      }
+    }
+    return;
+  }
+
+  Stream_Out(st, p, n);
+}
+
+/* write() all n bytes */
+static void Stream_Out(st, p, n)
+Out_Stream *st;
+unsigned char *p;
+long n;
+{
+  long k;
+
+  for (; n>0; n-=k, p+=k)
+    if ((k = write(st->fd, p, n)) <= 0)
+    {
+      if (k<0 && errno==EINTR)
+        k = 0;
+      else
+        Error("stream write failed\n");
+    }
+}
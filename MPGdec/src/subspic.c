@@ -106,12 +106,12 @@ int bitstream_framenum;
 int sequence_framenum;
 {
   /* static tracking variables */
-  static int previous_temporal_reference;
-  static int previous_bitstream_framenum;
-  static int previous_anchor_temporal_reference;
-  static int previous_anchor_bitstream_framenum;
-  static int previous_picture_coding_type;
-  static int bgate;
+  static SEQ_LOCAL int previous_temporal_reference;
+  static SEQ_LOCAL int previous_bitstream_framenum;
+  static SEQ_LOCAL int previous_anchor_temporal_reference;
+  static SEQ_LOCAL int previous_anchor_bitstream_framenum;
+  static SEQ_LOCAL int previous_picture_coding_type;
+  static SEQ_LOCAL int bgate;
   
   /* local temporary variables */
   int substitute_display_framenum;
@@ -171,7 +171,7 @@ void Next_Packet()
         ld->Rdbfr[l++] = SEQUENCE_END_CODE&0xff;
       }
       ld->Rdptr = ld->Rdbfr;
-      ld->Rdmax = ld->Rdbfr + 2048;
+      ld->Rdmax = ld->Rdend = ld->Rdbfr + 2048;
       return;
     default:
       if(code>=SYSTEM_START_CODE)
@@ -192,40 +192,10 @@ void Next_Packet()
 
 
 
+/* the 64-bit cache makes a 32-bit flush an ordinary one */
 void Flush_Buffer32()
 {
-  int Incnt;
-
-  ld->Bfr = 0;
-
-  Incnt = ld->Incnt;
-  Incnt -= 32;
-
-  if (System_Stream_Flag && (ld->Rdptr >= ld->Rdmax-4))
-  {
-    while (Incnt <= 24)
-    {
-      if (ld->Rdptr >= ld->Rdmax)
-        Next_Packet();
-      ld->Bfr |= Get_Byte() << (24 - Incnt);
-      Incnt += 8;
-    }
-  }
-  else
-  {
-    while (Incnt <= 24)
-    {
-      if (ld->Rdptr >= ld->Rdbfr+2048)
-        Fill_Buffer();
-      ld->Bfr |= *ld->Rdptr++ << (24 - Incnt);
-      Incnt += 8;
-    }
-  }
-  ld->Incnt = Incnt;
-
-#ifdef VERIFY 
-  ld->Bitcnt += 32;
-#endif /* VERIFY */
+  Flush_Buffer(32);
 }
 
 
@@ -252,34 +222,7 @@ int Get_Long()
 #ifdef THRD
 void Thrd_Flush_Buffer32(int t)
 {
-  int Incnt;
-
-  thrd_buf[t] = 0;
-
-  Incnt = thrd_Incnt[t];
-  Incnt -= 32;
-
-  if (System_Stream_Flag && (ld->Rdptr >= ld->Rdmax-4))
-  {
-    if (System_Stream_Flag) { printf("System_Stream_Flag is 1\n"); exit(1); }
-    while (Incnt <= 24)
-    {
-      if (ld->Rdptr >= ld->Rdmax)
-        Next_Packet();
-      ld->Bfr |= Get_Byte() << (24 - Incnt);
-      Incnt += 8;
-    }
-  }
-  else
-  {
-    while (Incnt <= 24)
-    {
-      thrd_buf[t] |= *thrd_ptr[t]++ << (24 - Incnt);
-      Incnt += 8;
-    }
-  }
-  thrd_Incnt[t] = Incnt;
-
+  Thrd_Flush_Buffer(t,32);
 }
 
 
@@ -128,14 +128,14 @@ int Sequence_Framenum;
   int d;
   int internal_vbv_delay;
   
-  static int previous_IorP_picture_structure;
-  static int previous_IorP_repeat_first_field;
-  static int previous_IorP_top_field_first;
-  static int previous_vbv_delay;
-  static int previous_bitstream_position;
-
-  static double previous_Bn;
-  static double E;      /* maximum quantization error or mismatch */
+  static SEQ_LOCAL int previous_IorP_picture_structure;
+  static SEQ_LOCAL int previous_IorP_repeat_first_field;
+  static SEQ_LOCAL int previous_IorP_top_field_first;
+  static SEQ_LOCAL int previous_vbv_delay;
+  static SEQ_LOCAL int previous_bitstream_position;
+
+  static SEQ_LOCAL double previous_Bn;
+  static SEQ_LOCAL double E;      /* maximum quantization error or mismatch */
 
   
 
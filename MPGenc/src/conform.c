@@ -91,6 +91,9 @@ void range_checks()
 
   /* range and value checks */
 
+  if (inputtype<T_Y_U_V || inputtype>T_Y4M)
+    error("input picture file format must be between 0 and 4");
+
   if (horizontal_size<1 || horizontal_size>16383)
     error("horizontal_size must be between 1 and 16383");
   if (mpeg1 && horizontal_size>4095)
@@ -0,0 +1,298 @@
+/*
+ * 
+ * This file is part of the ALPBench Benchmark Suite Version 1.0
+ * 
+ * Copyright (c) 2005 The Board of Trustees of the University of Illinois
+ * 
+ * All rights reserved.
+ * 
+ * ALPBench is a derivative of several codes, and restricted by licenses
+ * for those codes, as indicated in the source files and the ALPBench
+ * license at http://www.cs.uiuc.edu/alp/alpbench/alpbench-license.html
+ * 
+ * The multithreading and SSE2 modifications for SpeechRec, FaceRec,
+ * MPEGenc, and MPEGdec were done by Man-Lap (Alex) Li and Ruchira
+ * Sasanka as part of the ALP research project at the University of
+ * Illinois at Urbana-Champaign (http://www.cs.uiuc.edu/alp/), directed
+ * by Prof. Sarita V. Adve, Dr. Yen-Kuang Chen, and Dr. Eric Debes.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal with the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimers.
+ * 
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimers in the documentation and/or other materials provided
+ *       with the distribution.
+ * 
+ *     * Neither the names of Professor Sarita Adve's research group, the
+ *       University of Illinois at Urbana-Champaign, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this Software without specific prior written permission.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE CONTRIBUTORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH THE
+ * SOFTWARE.
+ * 
+ */
+
+
+/* fdctquant.c, fused forward DCT, quantization and coefficient scan       */
+
+/* The forward DCT is the Arai-Agui-Nakajima factorization in integer
+ * arithmetic. Its outputs are left scaled by 8*aan[u]*aan[v]; that scale
+ * is folded into reciprocal quantizer tables together with the weighting
+ * matrix and mquant, so each coefficient is quantized with one multiply
+ * and one shift. The quantized block is written back in scan order
+ * (zig-zag or alternate, as selected by altscan) and the scan position
+ * after the last nonzero coefficient is returned, which is all the VLC
+ * coder needs.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "config.h"
+#include "global.h"
+
+#define PASS_BITS  2  /* fraction bits kept between the two passes */
+#define CONST_BITS 13 /* fraction bits of the rotation constants */
+#define QSHIFT     28 /* fraction bits of the reciprocal tables */
+
+#define FIX(x) ((int)((x)*(1<<CONST_BITS)+0.5))
+#define MUL(v,c) (((v)*(c)+(1<<(CONST_BITS-1)))>>CONST_BITS)
+
+#define C_0_382683433 FIX(0.382683433)
+#define C_0_541196100 FIX(0.541196100)
+#define C_0_707106781 FIX(0.707106781)
+#define C_1_306562965 FIX(1.306562965)
+
+/* private data */
+static unsigned int qrecip[2][113][64]; /* [intra][mquant][coefficient] */
+static unsigned int qbias[2][113];      /* rounding, same units as qrecip */
+static unsigned char iscan[2][64];      /* coefficient -> scan position */
+
+/* private prototypes */
+static void aan_fdct _ANSI_ARGS_((short *blk, int *ws));
+static int quant_scan _ANSI_ARGS_((int *ws, short *blk, int intra,
+  int mquant, int first));
+
+void init_fdct_quant()
+{
+  int i, u, v, mq, intra;
+  double aan[8], s;
+  unsigned char *qm;
+
+  aan[0] = 1.0;
+  for (u=1; u<8; u++)
+    aan[u] = sqrt(2.0)*cos(u*3.14159265358979323846/16.0);
+
+  for (intra=0; intra<2; intra++)
+  {
+    qm = intra ? intra_q : inter_q;
+
+    for (mq=1; mq<113; mq++)
+    {
+      /* y = 32*|x|/(2*mquant*W): TM5 adds 3/8 of a step (intra) or
+       * truncates towards zero (non-intra), both after rounding 32*x/W
+       */
+      s = intra ? 0.5 + ((3*mq+2)>>2) : 0.5;
+      qbias[intra][mq] = (unsigned int)(s/(2*mq)*(1<<QSHIFT) + 0.5);
+
+      for (i=0; i<64; i++)
+      {
+        u = i>>3;
+        v = i&7;
+        s = 32.0/(2*mq*qm[i]*8.0*aan[u]*aan[v]*(1<<PASS_BITS));
+        qrecip[intra][mq][i] = (unsigned int)(s*(1<<QSHIFT) + 0.5);
+      }
+    }
+  }
+
+  for (i=0; i<64; i++)
+  {
+    iscan[0][zig_zag_scan[i]] = i;
+    iscan[1][alternate_scan[i]] = i;
+  }
+}
+
+/* two 1-D AAN passes, rows then columns, into ws[] (natural order) */
+static void aan_fdct(blk,ws)
+short *blk;
+int *ws;
+{
+  int i;
+  int *p;
+  int tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+  int tmp10, tmp11, tmp12, tmp13;
+  int z1, z2, z3, z4, z5, z11, z13;
+
+  for (i=0; i<8; i++)
+  {
+    p = ws + 8*i;
+
+    tmp0 = (blk[8*i+0] + blk[8*i+7]) << PASS_BITS;
+    tmp7 = (blk[8*i+0] - blk[8*i+7]) << PASS_BITS;
+    tmp1 = (blk[8*i+1] + blk[8*i+6]) << PASS_BITS;
+    tmp6 = (blk[8*i+1] - blk[8*i+6]) << PASS_BITS;
+    tmp2 = (blk[8*i+2] + blk[8*i+5]) << PASS_BITS;
+    tmp5 = (blk[8*i+2] - blk[8*i+5]) << PASS_BITS;
+    tmp3 = (blk[8*i+3] + blk[8*i+4]) << PASS_BITS;
+    tmp4 = (blk[8*i+3] - blk[8*i+4]) << PASS_BITS;
+
+    /* even part */
+    tmp10 = tmp0 + tmp3;
+    tmp13 = tmp0 - tmp3;
+    tmp11 = tmp1 + tmp2;
+    tmp12 = tmp1 - tmp2;
+
+    p[0] = tmp10 + tmp11;
+    p[4] = tmp10 - tmp11;
+
+    z1 = MUL(tmp12 + tmp13, C_0_707106781);
+    p[2] = tmp13 + z1;
+    p[6] = tmp13 - z1;
+
+    /* odd part */
+    tmp10 = tmp4 + tmp5;
+    tmp11 = tmp5 + tmp6;
+    tmp12 = tmp6 + tmp7;
+
+    z5 = MUL(tmp10 - tmp12, C_0_382683433);
+    z2 = MUL(tmp10, C_0_541196100) + z5;
+    z4 = MUL(tmp12, C_1_306562965) + z5;
+    z3 = MUL(tmp11, C_0_707106781);
+
+    z11 = tmp7 + z3;
+    z13 = tmp7 - z3;
+
+    p[5] = z13 + z2;
+    p[3] = z13 - z2;
+    p[1] = z11 + z4;
+    p[7] = z11 - z4;
+  }
+
+  for (i=0; i<8; i++)
+  {
+    p = ws + i;
+
+    tmp0 = p[8*0] + p[8*7];
+    tmp7 = p[8*0] - p[8*7];
+    tmp1 = p[8*1] + p[8*6];
+    tmp6 = p[8*1] - p[8*6];
+    tmp2 = p[8*2] + p[8*5];
+    tmp5 = p[8*2] - p[8*5];
+    tmp3 = p[8*3] + p[8*4];
+    tmp4 = p[8*3] - p[8*4];
+
+    tmp10 = tmp0 + tmp3;
+    tmp13 = tmp0 - tmp3;
+    tmp11 = tmp1 + tmp2;
+    tmp12 = tmp1 - tmp2;
+
+    p[8*0] = tmp10 + tmp11;
+    p[8*4] = tmp10 - tmp11;
+
+    z1 = MUL(tmp12 + tmp13, C_0_707106781);
+    p[8*2] = tmp13 + z1;
+    p[8*6] = tmp13 - z1;
+
+    tmp10 = tmp4 + tmp5;
+    tmp11 = tmp5 + tmp6;
+    tmp12 = tmp6 + tmp7;
+
+    z5 = MUL(tmp10 - tmp12, C_0_382683433);
+    z2 = MUL(tmp10, C_0_541196100) + z5;
+    z4 = MUL(tmp12, C_1_306562965) + z5;
+    z3 = MUL(tmp11, C_0_707106781);
+
+    z11 = tmp7 + z3;
+    z13 = tmp7 - z3;
+
+    p[8*5] = z13 + z2;
+    p[8*3] = z13 - z2;
+    p[8*1] = z11 + z4;
+    p[8*7] = z11 - z4;
+  }
+}
+
+/* quantize ws[first..63] into blk[] in scan order, return last+1 */
+static int quant_scan(ws,blk,intra,mquant,first)
+int *ws;
+short *blk;
+int intra, mquant, first;
+{
+  int i, x, y, n, last;
+  unsigned int *rq, bias;
+  unsigned char *is;
+
+  rq = qrecip[intra][mquant];
+  bias = qbias[intra][mquant];
+  is = iscan[altscan];
+  last = 0;
+
+  for (i=first; i<64; i++)
+  {
+    x = ws[i];
+    y = (int)(((unsigned long long)(x>=0 ? x : -x)*rq[i] + bias) >> QSHIFT);
+
+    if (y)
+    {
+      if (y > QUANT_THRESHOLD)
+        y = QUANT_THRESHOLD;
+      n = is[i];
+      blk[n] = (x>=0) ? y : -y;
+      if (n >= last)
+        last = n+1;
+    }
+  }
+
+  return last;
+}
+
+/* intra block: DC by intra_dc_mult, AC as quant_intra; cbp is implied */
+int fdct_quant_intra(blk,dc_prec,mquant)
+short *blk;
+int dc_prec, mquant;
+{
+  int ws[64];
+  int x, s, last;
+
+  aan_fdct(blk,ws);
+  memset(blk,0,64*sizeof(short));
+
+  /* ws[0] is 8<<PASS_BITS times the DC coefficient, so round(dc/d)
+   * with d = 8>>dc_prec is a rounding shift
+   */
+  x = ws[0];
+  s = PASS_BITS + 6 - dc_prec;
+  blk[0] = (x>=0) ? (x + (1<<(s-1))) >> s : -((-x + (1<<(s-1))) >> s);
+
+  last = quant_scan(ws,blk,1,mquant,1);
+
+  return last ? last : 1;
+}
+
+/* non-intra block as quant_non_intra; returns 0 if nothing is coded */
+int fdct_quant_non_intra(blk,mquant)
+short *blk;
+int mquant;
+{
+  int ws[64];
+
+  aan_fdct(blk,ws);
+  memset(blk,0,64*sizeof(short));
+
+  return quant_scan(ws,blk,0,mquant,0);
+}
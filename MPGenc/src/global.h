@@ -102,6 +102,11 @@ void profile_and_level_checks _ANSI_ARGS_((void));
 void init_fdct _ANSI_ARGS_((void));
 void fdct _ANSI_ARGS_((short *block));
 
+/* fdctquant.c */
+void init_fdct_quant _ANSI_ARGS_((void));
+int fdct_quant_intra _ANSI_ARGS_((short *blk, int dc_prec, int mquant));
+int fdct_quant_non_intra _ANSI_ARGS_((short *blk, int mquant));
+
 /* idct.c */
 void idct _ANSI_ARGS_((short *block));
 void init_idct _ANSI_ARGS_((void));
@@ -155,8 +160,8 @@ void putintrablk _ANSI_ARGS_((short *blk, int cc));
 void putnonintrablk _ANSI_ARGS_((short *blk));
 void putmv _ANSI_ARGS_((int dmv, int f_code));
 #ifdef LTHREAD
-void put_intrablk _ANSI_ARGS_((short *blk, int cc, int id));
-void put_nonintrablk _ANSI_ARGS_((short *blk, int id));
+void put_intrablk _ANSI_ARGS_((short *blk, int last, int cc, int id));
+void put_nonintrablk _ANSI_ARGS_((short *blk, int last, int id));
 void put_mv _ANSI_ARGS_((int dmv, int f_code, int id));
 #endif
 
@@ -172,6 +177,7 @@ void putpichelper _ANSI_ARGS_((unsigned char *frame));
 void putseq _ANSI_ARGS_((void));
 
 /* putvlc.c */
+void init_vlc _ANSI_ARGS_((void));
 void putDClum _ANSI_ARGS_((int val));
 void putDCchrom _ANSI_ARGS_((int val));
 void putACfirst _ANSI_ARGS_((int run, int val));
@@ -204,7 +210,6 @@ void iquant_non_intra _ANSI_ARGS_((short *src, short *dst,
   unsigned char *quant_mat, int mquant));
 #ifdef LTHREAD
 void ptiquant _ANSI_ARGS_((int start_k, int end_k));
-void ptquant _ANSI_ARGS_((int start_k, int end_k));
 #endif
 
 
@@ -219,11 +224,17 @@ void vbv_end_of_picture _ANSI_ARGS_((void));
 void calc_vbv_delay _ANSI_ARGS_((void));
 
 /* readpic.c */
-void readframe _ANSI_ARGS_((char *fname, unsigned char *frame[]));
+void init_readpic _ANSI_ARGS_((void));
+void readframe _ANSI_ARGS_((int n, unsigned char *frame[]));
+void close_readpic _ANSI_ARGS_((void));
 
 /* stats.c */
 void calcSNR _ANSI_ARGS_((unsigned char *org[3], unsigned char *rec[3]));
 void stats _ANSI_ARGS_((void));
+#ifdef FAST_MODE_DECISION
+void early_stats _ANSI_ARGS_((void));
+void early_report _ANSI_ARGS_((void));
+#endif
 
 /* transfrm.c */
 void transform _ANSI_ARGS_((unsigned char *pred[], unsigned char *cur[],
@@ -236,7 +247,8 @@ void dct_type_estimation _ANSI_ARGS_((unsigned char *pred, unsigned char *cur,
 void ptdct_type_estimation _ANSI_ARGS_((unsigned char *pred, unsigned char *cur,
   struct mbinfo *mbi, int start_height, int end_height));
 void pttransform _ANSI_ARGS_((unsigned char *pred[], unsigned char *cur[],
-  struct mbinfo *mbi, short blocks[][64], int start_height, int end_height));
+  struct mbinfo *mbi, short blocks[][64], int mquant, int start_height,
+  int end_height));
 void ptitransform _ANSI_ARGS_((unsigned char *pred[], unsigned char *cur[],
   struct mbinfo *mbi, short blocks[][64], int start_height, int end_height));
 #endif
@@ -79,6 +79,7 @@
  */
 
 #include <stdio.h>
+#include <limits.h>
 #include "config.h"
 #include "global.h"
 
@@ -138,6 +139,26 @@ static int bdist2 _ANSI_ARGS_((unsigned char *pf, unsigned char *pb,
 
 static int variance _ANSI_ARGS_((unsigned char *p, int lx));
 
+#ifdef FAST_MODE_DECISION
+/* early mode decision thresholds (sums over the 16x16 macroblock)
+ *
+ * ED_SKIP_DIST:   zero vector error below which no search is done; the
+ *                 full decision would pick No-MC (P) here anyway
+ * ED_INTRA_VAR:   flat macroblocks below this variance ...
+ * ED_INTRA_DIST:  ... whose zero vector error is above this are coded
+ *                 intra without searching (lighting changes, uncovered
+ *                 background)
+ * ED_BIDIR_RATIO: interpolated prediction is not tried when one
+ *                 direction's distance exceeds the other's by this factor
+ */
+#define ED_SKIP_DIST   (9*256)
+#define ED_INTRA_VAR   (4*256)
+#define ED_INTRA_DIST  (16*256)
+#define ED_BIDIR_RATIO 2
+
+#define ED_DIVERGE(a,b) ((a)>ED_BIDIR_RATIO*(b) || (b)>ED_BIDIR_RATIO*(a))
+#endif
+
 
 /*
  * motion estimation for progressive and interlaced frame pictures
@@ -249,11 +270,37 @@ struct mbinfo *mbi;
   mb = cur + i + width*j;
 
   var = variance(mb,width);
+  mbi->early = 0;
 
   if (pict_type==I_TYPE)
     mbi->mb_type = MB_INTRA;
   else if (pict_type==P_TYPE)
   {
+#ifdef FAST_MODE_DECISION
+    /* zero vector error against the co-located reference block */
+    v0 = dist2(oldref+i+width*j,mb,width,0,0,16);
+
+    if (v0<ED_SKIP_DIST)
+    {
+      /* static: No-MC, skippable if nothing is coded */
+      mbi->early = ED_SKIP;
+      mbi->mb_type = 0;
+      mbi->motion_type = MC_FRAME;
+      mbi->MV[0][0][0] = 0;
+      mbi->MV[0][0][1] = 0;
+      mbi->var = v0;
+      return;
+    }
+
+    if (var<ED_INTRA_VAR && v0>=ED_INTRA_DIST)
+    {
+      mbi->early = ED_INTRA;
+      mbi->mb_type = MB_INTRA;
+      mbi->var = var;
+      return;
+    }
+#endif
+
     if (frame_pred_dct)
     {
       dmc = fullsearch(oldorg,oldref,mb,
@@ -316,7 +363,9 @@ struct mbinfo *mbi;
        * blocks with small prediction error are always coded as No-MC
        * (requires no motion vectors, allows skipping)
        */
+#ifndef FAST_MODE_DECISION
       v0 = dist2(oldref+i+width*j,mb,width,0,0,16);
+#endif
       if (4*v0>5*vmc && v0>=9*256)
       {
         /* use MC */
@@ -362,6 +411,48 @@ struct mbinfo *mbi;
   }
   else /* if (pict_type==B_TYPE) */
   {
+#ifdef FAST_MODE_DECISION
+    /* zero vector errors against both co-located reference blocks;
+     * static in both directions is interpolated (averages the noise),
+     * runs of identical zero vector decisions remain skippable
+     */
+    v0 = dist2(oldref+i+width*j,mb,width,0,0,16);
+    vmc = dist2(newref+i+width*j,mb,width,0,0,16);
+
+    if (v0<ED_SKIP_DIST || vmc<ED_SKIP_DIST)
+    {
+      mbi->early = ED_SKIP;
+      if (v0<ED_SKIP_DIST && vmc<ED_SKIP_DIST)
+      {
+        mbi->mb_type = MB_FORWARD|MB_BACKWARD;
+        var = bdist2(oldref+i+width*j,newref+i+width*j,mb,width,0,0,0,0,16);
+      }
+      else if (v0<ED_SKIP_DIST)
+      {
+        mbi->mb_type = MB_FORWARD;
+        var = v0;
+      }
+      else
+      {
+        mbi->mb_type = MB_BACKWARD;
+        var = vmc;
+      }
+      mbi->motion_type = MC_FRAME;
+      mbi->MV[0][0][0] = mbi->MV[0][0][1] = 0;
+      mbi->MV[0][1][0] = mbi->MV[0][1][1] = 0;
+      mbi->var = var;
+      return;
+    }
+
+    if (var<ED_INTRA_VAR && v0>=ED_INTRA_DIST && vmc>=ED_INTRA_DIST)
+    {
+      mbi->early = ED_INTRA;
+      mbi->mb_type = MB_INTRA;
+      mbi->var = var;
+      return;
+    }
+#endif
+
     if (frame_pred_dct)
     {
       /* forward */
@@ -377,6 +468,14 @@ struct mbinfo *mbi;
                    width,iminr&1,jminr&1,16);
 
       /* interpolated (bidirectional) */
+#ifdef FAST_MODE_DECISION
+      if (ED_DIVERGE(dmcf,dmcr))
+      {
+        mbi->early = ED_NOBIDIR;
+        vmci = INT_MAX;
+      }
+      else
+#endif
       vmci = bdist2(oldref+(iminf>>1)+width*(jminf>>1),
                     newref+(iminr>>1)+width*(jminr>>1),
                     mb,width,iminf&1,jminf&1,iminr&1,jminr&1,16);
@@ -417,6 +516,16 @@ struct mbinfo *mbi;
         &dmcr,&dmcfieldr,&tselr,&bselr,imins,jmins);
 
       /* calculate interpolated distance */
+#ifdef FAST_MODE_DECISION
+      if (ED_DIVERGE(dmcf<dmcfieldf ? dmcf : dmcfieldf,
+                     dmcr<dmcfieldr ? dmcr : dmcfieldr))
+      {
+        mbi->early = ED_NOBIDIR;
+        dmci = dmcfieldi = INT_MAX;
+      }
+      else
+      {
+#endif
       /* frame */
       dmci = bdist1(oldref+(iminf>>1)+width*(jminf>>1),
                     newref+(iminr>>1)+width*(jminr>>1),
@@ -433,6 +542,9 @@ struct mbinfo *mbi;
                     oldref+(iminbf>>1)+(bself?width:0)+(width<<1)*(jminbf>>1),
                     newref+(iminbr>>1)+(bselr?width:0)+(width<<1)*(jminbr>>1),
                     mb+width,width<<1,iminbf&1,jminbf&1,iminbr&1,jminbr&1,8);
+#ifdef FAST_MODE_DECISION
+      }
+#endif
 
       /* select prediction type of minimum distance from the
        * six candidates (field/frame * forward/backward/interpolated)
@@ -594,6 +706,7 @@ int secondfield,ipflag;
     mb += width;
 
   var = variance(mb,w2);
+  mbi->early = 0;
 
   if (pict_type==I_TYPE)
     mbi->mb_type = MB_INTRA;
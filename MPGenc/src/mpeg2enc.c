@@ -130,6 +130,7 @@ char *argv[];
 
   putseq();
 
+  close_readpic();
   fclose(outfile);
   fclose(statfile);
 
@@ -142,7 +143,9 @@ static void init()
   static int block_count_tab[3] = {6,8,12};
 
   initbits();
+  init_vlc();
   init_fdct();
+  init_fdct_quant();
   init_idct();
 
   /* round picture dimensions to nearest multiple of 16 or 32 */
@@ -211,6 +214,9 @@ static void init()
     sprintf(errortext,"Couldn't create statistics output file %s",statname);
     error(errortext);
   }
+
+  /* open the input and start reading ahead */
+  init_readpic();
 }
 
 void error(text)
@@ -108,6 +108,11 @@
 #define MB_FORWARD  8
 #define MB_QUANT    16
 
+/* fast mode decisions taken by frame_ME (mbinfo.early) */
+#define ED_SKIP     1 /* zero vector accepted without search */
+#define ED_INTRA    2 /* intra chosen without search */
+#define ED_NOBIDIR  4 /* interpolated prediction not evaluated */
+
 /* motion_type */
 #define MC_FIELD 1
 #define MC_FRAME 2
@@ -138,6 +143,8 @@
 #define T_Y_U_V 0
 #define T_YUV   1
 #define T_PPM   2
+#define T_RAW   3 /* all frames in one planar file or stdin */
+#define T_Y4M   4 /* YUV4MPEG2 file or stdin */
 
 /* macroblock information */
 struct mbinfo {
@@ -146,7 +153,9 @@ struct mbinfo {
   int dct_type; /* field/frame DCT */
   int mquant; /* quantization parameter */
   int cbp; /* coded block pattern */
+  unsigned char last[12]; /* scan position after last nonzero coefficient */
   int skipped; /* skipped macroblock */
+  int early; /* fast mode decisions (ED_*) */
   int MV[2][2][2]; /* motion vectors */
   int mv_field_sel[2][2]; /* motion vertical field select */
   int dmvector[2]; /* dual prime vectors */
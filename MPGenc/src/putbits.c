@@ -79,90 +79,99 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "config.h"
-#ifdef LTHREAD
-#include <malloc.h>
-#endif
+#include "global.h"
+
+/* Bits are collected right justified in a 64 bit accumulator and written
+ * out MSB first as complete 32 bit words, so the per-bit shifting of the
+ * original implementation is replaced by one shift/or per code word.
+ * Between calls at most 31 bits are pending, hence a code word of up to
+ * 32 bits always fits.
+ */
+typedef unsigned long long bitacc_t;
 
-extern FILE *outfile; /* the only global var we need here */
+#define BITMASK(n) ((((bitacc_t)1)<<(n))-1)
 
 /* private data */
-static unsigned char outbfr;
-static int outcnt;
+static bitacc_t outacc; /* pending bits, right justified */
+static int outcnt;      /* number of pending bits in outacc */
 static int bytecnt;
 
 #ifdef LTHREAD
-#define OUT_FB_LEN 128
+#define OUT_FB_LEN 4096 /* minimum size of a slice buffer */
+#define OUT_FB_MARGIN 4 /* slack over the nominal bits per picture */
 int buf_ptr[NUM_THREADS];  /* pointer to outfrmbuf */
 int cur_size[NUM_THREADS]; 
 unsigned char *outfrmbuf[NUM_THREADS];
 
-static unsigned char out_bfr[NUM_THREADS];
+static bitacc_t out_acc[NUM_THREADS];
 static int out_cnt[NUM_THREADS];
-int byte_cnt[NUM_THREADS];
 
-void write_buf(unsigned char val, int id) {
-
-  if (buf_ptr[id]==cur_size[id]-1) {
-    unsigned char* tmp;
+/* make room for at least n more bytes in the slice buffer of thread id */
+static void grow_buf(int n, int id)
+{
+  unsigned char *tmp;
 
+  while (buf_ptr[id]+n > cur_size[id])
     cur_size[id] <<= 1;
-    tmp = malloc(cur_size[id] * sizeof(unsigned char));
-    memcpy(tmp, outfrmbuf[id], cur_size[id]>>1);
-    free(outfrmbuf[id]);
-    outfrmbuf[id]=tmp;
-    /*    outfrmbuf[id] = (unsigned char *) realloc(outfrmbuf[id], \
-	  cur_size[id] * sizeof(unsigned char));*/
-  }
-    outfrmbuf[id][buf_ptr[id]++] = val;
+
+  if (!(tmp = (unsigned char *)realloc(outfrmbuf[id], cur_size[id])))
+    error("realloc failed\n");
+
+  outfrmbuf[id] = tmp;
 }
 
-/* write rightmost n (0<=n<=32) bits of val to outfile */
+/* write rightmost n (0<=n<=32) bits of val to the slice buffer of thread id */
 void put_bits(val,n,id)
-     int val;
+int val;
 int n;
 int id;
 {
-  int i;
-  unsigned int mask;
+  bitacc_t acc;
+  unsigned char *p;
 
-  mask = 1 << (n-1); /* selects first (leftmost) bit */
-  
-  for (i=0; i<n; i++)
+  acc = (out_acc[id] << n) | ((bitacc_t)(unsigned int)val & BITMASK(n));
+  out_acc[id] = acc;
+
+  if ((out_cnt[id] += n) >= 32)
   {
-    out_bfr[id] <<= 1;
-    
-    if (val & mask)
-      out_bfr[id]|= 1;
-    
-    mask >>= 1; /* select next bit */
-    out_cnt[id]--;
-
-    if (out_cnt[id]==0) /* 8 bit buffer full */
-      {
-	write_buf(out_bfr[id],id);
-	out_cnt[id] = 8;
-	byte_cnt[id]++;
-      }
-  }
+    /* batch flush of one complete 32 bit word */
+    out_cnt[id] -= 32;
+
+    if (buf_ptr[id]+4 > cur_size[id])
+      grow_buf(4,id);
 
+    p = outfrmbuf[id] + buf_ptr[id];
+    p[0] = (unsigned char)(acc >> (out_cnt[id]+24));
+    p[1] = (unsigned char)(acc >> (out_cnt[id]+16));
+    p[2] = (unsigned char)(acc >> (out_cnt[id]+8));
+    p[3] = (unsigned char)(acc >> out_cnt[id]);
+    buf_ptr[id] += 4;
+  }
 }
 
 /* zero bit stuffing to next byte boundary (5.2.3, 6.2.1) */
 void align_bits(int id)
 {
-  if (out_cnt[id]!=8)
-    put_bits(0,out_cnt[id],id);
+  if (out_cnt[id]&7)
+    put_bits(0,8-(out_cnt[id]&7),id);
+
+  /* move the remaining whole bytes into the slice buffer */
+  if (buf_ptr[id]+4 > cur_size[id])
+    grow_buf(4,id);
+
+  while (out_cnt[id])
+  {
+    out_cnt[id] -= 8;
+    outfrmbuf[id][buf_ptr[id]++] = (unsigned char)(out_acc[id] >> out_cnt[id]);
+  }
 }
 
 void flushbits(int id) {
-  int i;
 
   align_bits(id);
-  /*  for (i = 0; i<buf_ptr[id]; i++) {
-    fputc(outfrmbuf[id][i],outfile);
-    }*/
   fwrite(outfrmbuf[id], sizeof(unsigned char), buf_ptr[id], outfile);
 
   buf_ptr[id] = 0;
@@ -175,18 +184,27 @@ void flushbits(int id) {
 void initbits()
 {
 #ifdef LTHREAD
-  int id;
+  int id, size;
+
+  /* preallocate the slice buffers from the nominal picture size so that
+   * they normally never have to grow inside the encode loop
+   */
+  size = (int)(OUT_FB_MARGIN*bit_rate/(8.0*frame_rate*NUM_THREADS));
+  if (size < OUT_FB_LEN)
+    size = OUT_FB_LEN;
 #endif
   
-  outcnt = 8;
+  outacc = 0;
+  outcnt = 0;
   bytecnt = 0;
 #ifdef LTHREAD
   for (id=0; id<NUM_THREADS; id++) {
-    out_cnt[id] = 8;
-    byte_cnt[id] = 0;
+    out_acc[id] = 0;
+    out_cnt[id] = 0;
     buf_ptr[id] = 0;
-    outfrmbuf[id] = (unsigned char *) malloc(OUT_FB_LEN*sizeof(unsigned char));
-    cur_size[id] = OUT_FB_LEN;
+    if (!(outfrmbuf[id] = (unsigned char *) malloc(size*sizeof(unsigned char))))
+      error("malloc failed\n");
+    cur_size[id] = size;
   }
 #endif
 }
@@ -197,40 +215,42 @@ void putbits(val,n)
      int val;
      int n;
 {
-  int i;
-  unsigned int mask;
+  bitacc_t acc;
 
-  mask = 1 << (n-1); /* selects first (leftmost) bit */
-  
-  for (i=0; i<n; i++)
-    {
-      outbfr <<= 1;
-      
-      if (val & mask)
-	outbfr|= 1;
-      
-      mask >>= 1; /* select next bit */
-      outcnt--;
-      
-      if (outcnt==0) /* 8 bit buffer full */
-	{
-	  fputc(outbfr,outfile);
-	  outcnt = 8;
-	  bytecnt++;
-	}
-    }
+  acc = (outacc << n) | ((bitacc_t)(unsigned int)val & BITMASK(n));
+  outacc = acc;
+
+  if ((outcnt += n) >= 32)
+  {
+    outcnt -= 32;
+    putc((int)(acc >> (outcnt+24)) & 255, outfile);
+    putc((int)(acc >> (outcnt+16)) & 255, outfile);
+    putc((int)(acc >> (outcnt+8)) & 255, outfile);
+    putc((int)(acc >> outcnt) & 255, outfile);
+    bytecnt += 4;
+  }
 }
 
-/* zero bit stuffing to next byte boundary (5.2.3, 6.2.1) */
+/* zero bit stuffing to next byte boundary (5.2.3, 6.2.1)
+ *
+ * leaves no bits pending, so that the thread buffers written by
+ * flushbits() follow the common bitstream in the right order
+ */
 void alignbits()
 {
+  if (outcnt&7)
+    putbits(0,8-(outcnt&7));
 
-  if (outcnt!=8)
-    putbits(0,outcnt);
+  while (outcnt)
+  {
+    outcnt -= 8;
+    putc((int)(outacc >> outcnt) & 255, outfile);
+    bytecnt++;
+  }
 }
 
 /* return total number of generated bits */
 int bitcount()
 {
-  return 8*bytecnt + (8-outcnt);
+  return 8*bytecnt + outcnt;
 }
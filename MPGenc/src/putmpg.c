@@ -88,6 +88,7 @@ short *blk;
 int cc;
 {
   int n, dct_diff, run, signed_level;
+  unsigned char *scan;
 
   /* DC coefficient (7.2.1) */
   dct_diff = blk[0] - dc_dct_pred[cc]; /* difference to previous block */
@@ -99,11 +100,11 @@ int cc;
     putDCchrom(dct_diff);
 
   /* AC coefficients (7.2.2) */
+  scan = altscan ? alternate_scan : zig_zag_scan; /* entropy scanning pattern */
   run = 0;
   for (n=1; n<64; n++)
   {
-    /* use appropriate entropy scanning pattern */
-    signed_level = blk[(altscan ? alternate_scan : zig_zag_scan)[n]];
+    signed_level = blk[scan[n]];
     if (signed_level!=0)
     {
       putAC(run,signed_level,intravlc);
@@ -125,14 +126,15 @@ void putnonintrablk(blk)
 short *blk;
 {
   int n, run, signed_level, first;
+  unsigned char *scan;
 
+  scan = altscan ? alternate_scan : zig_zag_scan; /* entropy scanning pattern */
   run = 0;
   first = 1;
 
   for (n=0; n<64; n++)
   {
-    /* use appropriate entropy scanning pattern */
-    signed_level = blk[(altscan ? alternate_scan : zig_zag_scan)[n]];
+    signed_level = blk[scan[n]];
 
     if (signed_level!=0)
     {
@@ -226,9 +228,13 @@ int dmv,f_code,id;
   if (r_size!=0 && motion_code!=0)
     put_bits(motion_residual,r_size,id); /* fixed length code */
 }
-void put_intrablk(blk,cc,id)
+/* the threaded coder gets blocks already quantized in scan order
+ * (fdctquant.c), together with the scan position after the last
+ * nonzero coefficient
+ */
+void put_intrablk(blk,last,cc,id)
 short *blk;
-int cc,id;
+int last,cc,id;
 {
   int n, dct_diff, run, signed_level;
 
@@ -243,10 +249,9 @@ int cc,id;
 
   /* AC coefficients (7.2.2) */
   run = 0;
-  for (n=1; n<64; n++)
+  for (n=1; n<last; n++)
   {
-    /* use appropriate entropy scanning pattern */
-    signed_level = blk[(altscan ? alternate_scan : zig_zag_scan)[n]];
+    signed_level = blk[n];
     if (signed_level!=0)
     {
       put_AC(run,signed_level,intravlc,id);
@@ -264,19 +269,18 @@ int cc,id;
 }
 
 /* generate variable length codes for a non-intra-coded block (6.2.6, 6.3.17) */
-void put_nonintrablk(blk,id)
+void put_nonintrablk(blk,last,id)
 short *blk;
-int id;
+int last,id;
 {
   int n, run, signed_level, first;
 
   run = 0;
   first = 1;
 
-  for (n=0; n<64; n++)
+  for (n=0; n<last; n++)
   {
-    /* use appropriate entropy scanning pattern */
-    signed_level = blk[(altscan ? alternate_scan : zig_zag_scan)[n]];
+    signed_level = blk[n];
 
     if (signed_level!=0)
     {
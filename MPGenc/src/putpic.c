@@ -590,10 +590,12 @@ int start_mbh, end_mbh, pmq, id;
           if (mb_type & MB_INTRA)
           {
             cc = (comp<4) ? 0 : (comp&1)+1;
-            put_intrablk(blocks[k*block_count+comp],cc,id);
+            put_intrablk(blocks[k*block_count+comp],
+                         mbinfo[k].last[comp],cc,id);
           }
           else
-            put_nonintrablk(blocks[k*block_count+comp],id);
+            put_nonintrablk(blocks[k*block_count+comp],
+                            mbinfo[k].last[comp],id);
         }
       }
 
@@ -111,9 +111,7 @@ void *thread_work(void* threadargs) {
   ptdct_type_estimation(mda->pred,mda->dte_cur,mbi, start_height, end_height);
   
   pttransform(mda->pd_cur, mda->trfm_cur,mbi,(short (*)[64])mda->blocks,
-	       start_height, end_height);
-  
-  ptquant(my_data->s_mbh, my_data->e_mbh);
+	      mda->prev_mquant, start_height, end_height);
   
   ptputpict(mda->dte_cur, my_data->pp_smbh, my_data->pp_embh, 
 	    mda->prev_mquant, my_data->id);
@@ -224,12 +222,52 @@ void thread_work_dist()
 
 }
 
+/* encode one picture (frame or field) with the band-parallel pipeline;
+ * pict_struct, pict_type and the f_codes must already be set up
+ */
+static void pt_encode_picture(neworg,newref,sxf,syf,sxb,syb,secondfield,ipflag)
+unsigned char *neworg[],*newref[];
+int sxf,syf,sxb,syb,secondfield,ipflag;
+{
+  data_args.oldorg = oldorgframe[0];
+  data_args.neworg = neworgframe[0];
+  data_args.oldref = oldrefframe[0];
+  data_args.newref = newrefframe[0];
+  data_args.cur = neworg[0];
+  data_args.curref = newref[0];
+  data_args.sxf = sxf;
+  data_args.syf = syf;
+  data_args.sxb = sxb;
+  data_args.syb = syb;
+  data_args.mbi = mbinfo;
+  data_args.secondfield = secondfield;
+  data_args.ipflag = ipflag;
+
+  data_args.reff = oldrefframe;
+  data_args.refb = newrefframe;
+  data_args.pd_cur = predframe;
+
+  data_args.pred = predframe[0];
+  data_args.dte_cur = neworg[0];
+
+  data_args.trfm_cur = neworg;
+  data_args.blocks = (short **)blocks;
+
+  data_args.prev_mquant = 20;
+  data_args.itrfm_cur = newref;
+
+  thread_work_dist();
+}
+
 #endif
 
 void putseq()
 {
   /* this routine assumes (N % M) == 0 */
-  int i, j, k, f, f0, n, np, nb, sxf, syf, sxb, syb;
+  int i, j, f, f0, n, np, nb, sxf, syf, sxb, syb;
+#ifndef LTHREAD
+  int k;
+#endif
   int ipflag;
   /*FILE *fd;*/
   char name[256];
@@ -387,10 +425,8 @@ void putseq()
         -(4<<back_vert_f_code),(4<<back_vert_f_code)-1);
     }
 #endif
-    sprintf(name,tplorg,f+frame0);
-    readframe(name,neworg);
+    readframe(f,neworg);
 
-    /*** WE DO ONLY FRAME PIC *** Partha */
     if (fieldpic)
     {
       if (!quiet)
@@ -401,6 +437,13 @@ void putseq()
 
       pict_struct = topfirst ? TOP_FIELD : BOTTOM_FIELD;
 
+#ifdef LTHREAD
+      pt_encode_picture(neworg,newref,sxf,syf,sxb,syb,0,0);
+#ifndef QUIET
+      calcSNR(neworg,newref);
+      stats();
+#endif
+#else
       motion_estimation(oldorgframe[0],neworgframe[0],
                         oldrefframe[0],newrefframe[0],
                         neworg[0],newref[0],
@@ -427,6 +470,10 @@ void putseq()
       itransform(predframe,newref,mbinfo,blocks);
       calcSNR(neworg,newref);
       stats();
+#endif
+#ifdef FAST_MODE_DECISION
+      early_stats();
+#endif
 
       if (!quiet)
       {
@@ -448,6 +495,16 @@ void putseq()
         syf = motion_data[0].syf;
       }
 
+#ifdef LTHREAD
+      /* the second field predicts from the first one, which is complete
+       * in newref once all bands of the first field have been joined
+       */
+      pt_encode_picture(neworg,newref,sxf,syf,sxb,syb,1,ipflag);
+#ifndef QUIET
+      calcSNR(neworg,newref);
+      stats();
+#endif
+#else
       motion_estimation(oldorgframe[0],neworgframe[0],
                         oldrefframe[0],newrefframe[0],
                         neworg[0],newref[0],
@@ -474,6 +531,10 @@ void putseq()
       itransform(predframe,newref,mbinfo,blocks);
       calcSNR(neworg,newref);
       stats();
+#endif
+#ifdef FAST_MODE_DECISION
+      early_stats();
+#endif
     }
     else
     {
@@ -485,35 +546,7 @@ void putseq()
        * and reconstructed frames (...refframe) for half pel search
        */
 #ifdef LTHREAD
-
-      data_args.oldorg = oldorgframe[0];
-      data_args.neworg = neworgframe[0];
-      data_args.oldref = oldrefframe[0];
-      data_args.newref = newrefframe[0];
-      data_args.cur = neworg[0];
-      data_args.curref = newref[0];
-      data_args.sxf = sxf;
-      data_args.syf = syf;
-      data_args.sxb = sxb;
-      data_args.syb = syb;
-      data_args.mbi = mbinfo;
-      data_args.secondfield = 0;
-      data_args.ipflag = 0;
-
-      data_args.reff = oldrefframe;
-      data_args.refb = newrefframe;
-      data_args.pd_cur = predframe;
-
-      data_args.pred = predframe[0];
-      data_args.dte_cur = neworg[0];
-
-      data_args.trfm_cur = neworg;
-      data_args.blocks = (short **)blocks;
-      
-      data_args.prev_mquant = 20;
-      data_args.itrfm_cur = newref;
-
-      thread_work_dist();
+      pt_encode_picture(neworg,newref,sxf,syf,sxb,syb,0,0);
 
 #else
       motion_estimation(oldorgframe[0],neworgframe[0],
@@ -552,7 +585,9 @@ void putseq()
       calcSNR(neworg,newref);
       stats();
 #endif
-
+#ifdef FAST_MODE_DECISION
+      early_stats();
+#endif
     }
     sprintf(name,tplref,f+frame0);
     writeframe(name,newref);
@@ -560,5 +595,8 @@ void putseq()
 
   putseqend();
 
+#ifdef FAST_MODE_DECISION
+  early_report();
+#endif
 }
 
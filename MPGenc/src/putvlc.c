@@ -84,9 +84,48 @@
 #include "global.h"
 #include "vlc.h"
 
+/* combined run/level VLC table (Table B-14 / B-15) with the sign bit
+ * appended to the code word, indexed by [vlcformat][run][level];
+ * len==0 marks (run, level) combinations that require escape coding
+ */
+typedef struct
+{
+  unsigned int code; /* right justified, sign bit position cleared */
+  int len;
+} ACVLCtable;
+
+static ACVLCtable ac_vlc_tab[2][32][41];
+
 /* private prototypes */
 static void putDC _ANSI_ARGS_((sVLCtable *tab, int val));
 
+/* build the combined run/level table, call once before putAC / put_AC */
+void init_vlc()
+{
+  int fmt, run, level;
+  VLCtable *ptab;
+
+  for (fmt=0; fmt<2; fmt++)
+    for (run=0; run<32; run++)
+      for (level=1; level<41; level++)
+      {
+        ptab = 0;
+
+        if (run<2)
+          ptab = fmt ? &dct_code_tab1a[run][level-1]
+                     : &dct_code_tab1[run][level-1];
+        else if (level<6)
+          ptab = fmt ? &dct_code_tab2a[run-2][level-1]
+                     : &dct_code_tab2[run-2][level-1];
+
+        if (ptab && ptab->len)
+        {
+          ac_vlc_tab[fmt][run][level].code = ptab->code << 1;
+          ac_vlc_tab[fmt][run][level].len = ptab->len + 1;
+        }
+      }
+}
+
 #ifdef LTHREAD
 static void put_DC _ANSI_ARGS_((sVLCtable *tab, int val, int id));
 
@@ -159,8 +198,8 @@ int run,val,id;
 void put_AC(run,signed_level,vlcformat,id)
 int run,signed_level,vlcformat,id;
 {
-  int level, len;
-  VLCtable *ptab;
+  int level;
+  ACVLCtable *ptab;
 
   level = (signed_level<0) ? -signed_level : signed_level; /* abs(signed_level) */
 
@@ -172,53 +211,29 @@ int run,signed_level,vlcformat,id;
     error(errortext);
   }
 
-  len = 0;
-
-  if (run<2 && level<41)
+  if (run<32 && level<41 && (ptab = &ac_vlc_tab[vlcformat][run][level])->len)
   {
-    /* vlcformat selects either of Table B-14 / B-15 */
-    if (vlcformat)
-      ptab = &dct_code_tab1a[run][level-1];
-    else
-      ptab = &dct_code_tab1[run][level-1];
-
-    len = ptab->len;
+    /* a VLC code exists, code word and sign in one go */
+    put_bits(ptab->code|(signed_level<0),ptab->len,id);
   }
-  else if (run<32 && level<6)
+  else if (!mpeg1)
   {
-    /* vlcformat selects either of Table B-14 / B-15 */
-    if (vlcformat)
-      ptab = &dct_code_tab2a[run-2][level-1];
-    else
-      ptab = &dct_code_tab2[run-2][level-1];
-
-    len = ptab->len;
-  }
-
-  if (len!=0) /* a VLC code exists */
-  {
-    put_bits(ptab->code,len,id);
-    put_bits(signed_level<0,1,id); /* sign */
+    /* no VLC for this (run, level) combination: use escape coding (7.2.2.3)
+     * Escape, 6 bit code for run, 12 bit code for level (Table B-16)
+     */
+    put_bits((1<<18)|(run<<12)|(signed_level&0xfff),24,id);
   }
   else
   {
-    /* no VLC for this (run, level) combination: use escape coding (7.2.2.3) */
     put_bits(1l,6,id); /* Escape */
     put_bits(run,6,id); /* 6 bit code for run */
-    if (mpeg1)
-    {
-      /* ISO/IEC 11172-2 uses a 8 or 16 bit code */
-      if (signed_level>127)
-        put_bits(0,8,id);
-      if (signed_level<-127)
-        put_bits(128,8,id);
-      put_bits(signed_level,8,id);
-    }
-    else
-    {
-      /* ISO/IEC 13818-2 uses a 12 bit code, Table B-16 */
-      put_bits(signed_level,12,id);
-    }
+
+    /* ISO/IEC 11172-2 uses a 8 or 16 bit code */
+    if (signed_level>127)
+      put_bits(0,8,id);
+    if (signed_level<-127)
+      put_bits(128,8,id);
+    put_bits(signed_level,8,id);
   }
 }
 
@@ -348,8 +363,8 @@ int run,val;
 void putAC(run,signed_level,vlcformat)
 int run,signed_level,vlcformat;
 {
-  int level, len;
-  VLCtable *ptab;
+  int level;
+  ACVLCtable *ptab;
 
   level = (signed_level<0) ? -signed_level : signed_level; /* abs(signed_level) */
 
@@ -361,53 +376,29 @@ int run,signed_level,vlcformat;
     error(errortext);
   }
 
-  len = 0;
-
-  if (run<2 && level<41)
+  if (run<32 && level<41 && (ptab = &ac_vlc_tab[vlcformat][run][level])->len)
   {
-    /* vlcformat selects either of Table B-14 / B-15 */
-    if (vlcformat)
-      ptab = &dct_code_tab1a[run][level-1];
-    else
-      ptab = &dct_code_tab1[run][level-1];
-
-    len = ptab->len;
+    /* a VLC code exists, code word and sign in one go */
+    putbits(ptab->code|(signed_level<0),ptab->len);
   }
-  else if (run<32 && level<6)
+  else if (!mpeg1)
   {
-    /* vlcformat selects either of Table B-14 / B-15 */
-    if (vlcformat)
-      ptab = &dct_code_tab2a[run-2][level-1];
-    else
-      ptab = &dct_code_tab2[run-2][level-1];
-
-    len = ptab->len;
-  }
-
-  if (len!=0) /* a VLC code exists */
-  {
-    putbits(ptab->code,len);
-    putbits(signed_level<0,1); /* sign */
+    /* no VLC for this (run, level) combination: use escape coding (7.2.2.3)
+     * Escape, 6 bit code for run, 12 bit code for level (Table B-16)
+     */
+    putbits((1<<18)|(run<<12)|(signed_level&0xfff),24);
   }
   else
   {
-    /* no VLC for this (run, level) combination: use escape coding (7.2.2.3) */
     putbits(1l,6); /* Escape */
     putbits(run,6); /* 6 bit code for run */
-    if (mpeg1)
-    {
-      /* ISO/IEC 11172-2 uses a 8 or 16 bit code */
-      if (signed_level>127)
-        putbits(0,8);
-      if (signed_level<-127)
-        putbits(128,8);
-      putbits(signed_level,8);
-    }
-    else
-    {
-      /* ISO/IEC 13818-2 uses a 12 bit code, Table B-16 */
-      putbits(signed_level,12);
-    }
+
+    /* ISO/IEC 11172-2 uses a 8 or 16 bit code */
+    if (signed_level>127)
+      putbits(0,8);
+    if (signed_level<-127)
+      putbits(128,8);
+    putbits(signed_level,8);
   }
 }
 
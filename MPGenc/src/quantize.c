@@ -79,6 +79,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include "config.h"
 #include "global.h"
 
@@ -92,81 +93,35 @@ static void iquant1_non_intra _ANSI_ARGS_((short *src, short *dst,
 
 
 #ifdef LTHREAD
-void ptquant(start_mbh, end_mbh)
-int start_mbh, end_mbh;
-{
-  int k, mb_type, comp, cbp;
-
-  /* load quantization matirices into v0 and v1, which are used by
-     quant_intra, quant_non_intra, iquant_intra, iquant_non_intra.
-     At this point, we are loading the matricies for child threads.
-  */
-
-  for (k=start_mbh; k<end_mbh; k++) {
-
-      mb_type = mbinfo[k].mb_type;
-
-      /* determine mquant (rate control) */
-      /*mbinfo[k].mquant = rc_calc_mquant(k);*/
-      mbinfo[k].mquant = 20;
-
-      /* quantize macroblock */
-      if (mb_type & MB_INTRA)
-      {
-	for (comp=0; comp<block_count; comp++) {
-	  int ind = k*block_count+comp;
-	  
-	  quant_intra(blocks[ind],blocks[ind],
-                      dc_prec,intra_q,mbinfo[k].mquant);
-	}
-        mbinfo[k].cbp = cbp = (1<<block_count) - 1;
-	
-      }
-      else
-      {
-        cbp = 0;
-        
-	for (comp=0;comp<block_count;comp++) {
-	  
-	  int ind = k*block_count+comp;
-	  
-          cbp = (cbp<<1) | quant_non_intra(blocks[ind],blocks[ind],
-                                           inter_q, mbinfo[k].mquant);
-	}
-	
-        mbinfo[k].cbp = cbp;
-	
-      }
-
-  }
-
-}
-
-
+/* blocks come from pttransform quantized in scan order; restore natural
+ * order (only up to the last nonzero coefficient) before dequantizing
+ * in place for ptitransform
+ */
 void ptiquant(start_k, end_k)
 int start_k, end_k;
 {
-  int k, j;
+  int k, j, n, last;
+  short tmp[64], *blk;
+  unsigned char *scan;
 
+  scan = altscan ? alternate_scan : zig_zag_scan;
 
   for (k=start_k; k<end_k; k++) {
 
-      if (mbinfo[k].mb_type & MB_INTRA)
-	for (j=0; j<block_count; j++) {
-
-	  int ind = k*block_count+j;
+    for (j=0; j<block_count; j++) {
 
-	  iquant_intra(blocks[ind],blocks[ind],
-		       dc_prec, intra_q, mbinfo[k].mquant);
-	}
-      else
-	for (j=0;j<block_count;j++) {
+      blk = blocks[k*block_count+j];
+      last = mbinfo[k].last[j];
 
-	  int ind = k*block_count+j;
+      memset(tmp,0,sizeof(tmp));
+      for (n=0; n<last; n++)
+        tmp[scan[n]] = blk[n];
 
-	  iquant_non_intra(blocks[ind],blocks[ind],
-			   inter_q,mbinfo[k].mquant);
-	}
+      if (mbinfo[k].mb_type & MB_INTRA)
+        iquant_intra(tmp,blk,dc_prec,intra_q,mbinfo[k].mquant);
+      else
+        iquant_non_intra(tmp,blk,inter_q,mbinfo[k].mquant);
+    }
 
   }
 
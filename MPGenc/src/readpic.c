@@ -80,46 +80,519 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#ifdef READ_AHEAD
+#include <pthread.h>
+#endif
 #include "config.h"
 #include "global.h"
 
 /* private prototypes */
+static void load_frame _ANSI_ARGS_((int n, unsigned char *frame[]));
 static void read_y_u_v _ANSI_ARGS_((char *fname, unsigned char *frame[]));
 static void read_yuv _ANSI_ARGS_((char *fname, unsigned char *frame[]));
 static void read_ppm _ANSI_ARGS_((char *fname, unsigned char *frame[]));
+static void open_stream _ANSI_ARGS_((void));
+static void read_stream _ANSI_ARGS_((int n, unsigned char *frame[]));
+static void copy_stream_frame _ANSI_ARGS_((unsigned char *src,
+  unsigned char *frame[]));
+static int parse_y4m_header _ANSI_ARGS_((char *hdr));
+static void read_fully _ANSI_ARGS_((unsigned char *buf, int len));
 static void border_extend _ANSI_ARGS_((unsigned char *frame, int w1, int h1,
   int w2, int h2));
 static void conv444to422 _ANSI_ARGS_((unsigned char *src, unsigned char *dst));
 static void conv422to420 _ANSI_ARGS_((unsigned char *src, unsigned char *dst));
 static int pbm_getint _ANSI_ARGS_((FILE* file));
+static void ring_load _ANSI_ARGS_((int n));
+#ifdef READ_AHEAD
+static void *loader_thread _ANSI_ARGS_((void *arg));
+#endif
 
-void readframe(fname,frame)
-char *fname;
+/* single file input (T_RAW, T_Y4M) */
+static int in_fd = -1;
+static unsigned char *in_map;   /* whole input file, if it could be mapped */
+static size_t in_maplen;
+static size_t *in_index;        /* offset of the picture data of each frame */
+static int in_nindex;           /* number of complete frames in the file */
+static int in_hdrlen;           /* stream header (y4m) */
+static int in_chroma;           /* chroma format of the input stream */
+static int in_framesize;        /* bytes of picture data per frame */
+static int in_next;             /* next stream frame of a sequential input */
+static unsigned char *in_buf;   /* picture data read from a sequential input */
+static unsigned char *in_u, *in_v, *in_u422, *in_v422; /* chroma conversion */
+
+/* ring of frames read ahead of the encoder, in display order
+ *
+ * frame n lives in slot n%nslots; a slot is free (num==-1) once the
+ * encoder has copied its frame out. The encoder requests frames in coding
+ * order, which runs at most M frames ahead of the oldest unread frame, so
+ * M+1 slots are always sufficient to avoid a deadlock.
+ */
+struct ring_slot
+{
+  unsigned char *frame[3];
+  int num; /* display frame number held by this slot, -1: free */
+};
+
+static struct ring_slot *ring;
+static int nslots;
+static int ring_next; /* next frame to be loaded into the ring */
+
+#ifdef READ_AHEAD
+static pthread_t loader;
+static pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ring_cond = PTHREAD_COND_INITIALIZER;
+#endif
+
+/* open the input, set up the read-ahead ring and start the loader
+ *
+ * call once after the picture dimensions have been determined
+ */
+void init_readpic()
+{
+  int i, j, size;
+
+  if (inputtype==T_RAW || inputtype==T_Y4M)
+    open_stream();
+
+#ifdef READ_AHEAD
+  nslots = (READ_AHEAD > M) ? READ_AHEAD : M+1;
+#else
+  /* a stream that can't be accessed randomly is buffered in display
+   * order and handed out in coding order
+   */
+  if (in_fd<0 || in_map)
+    return;
+  nslots = M+1;
+#endif
+
+  if (!(ring = (struct ring_slot *)malloc(nslots*sizeof(struct ring_slot))))
+    error("malloc failed\n");
+
+  for (i=0; i<nslots; i++)
+  {
+    for (j=0; j<3; j++)
+    {
+      size = (j==0) ? width*height : chrom_width*chrom_height;
+      if (!(ring[i].frame[j] = (unsigned char *)malloc(size)))
+        error("malloc failed\n");
+    }
+    ring[i].num = -1;
+  }
+
+  ring_next = 0;
+
+#ifdef READ_AHEAD
+  if (pthread_create(&loader,NULL,loader_thread,NULL))
+    error("couldn't create loader thread\n");
+#endif
+}
+
+/* wait for the loader and release the input */
+void close_readpic()
+{
+#ifdef READ_AHEAD
+  if (ring)
+    pthread_join(loader,NULL);
+#endif
+
+  if (in_map)
+    munmap(in_map,in_maplen);
+  if (in_fd>0)
+    close(in_fd);
+}
+
+/* deliver display frame n (0..nframes-1) into frame */
+void readframe(n,frame)
+int n;
 unsigned char *frame[];
 {
+  struct ring_slot *slot;
+
+  if (!ring)
+  {
+    load_frame(n,frame);
+    return;
+  }
+
+#ifndef READ_AHEAD
+  while (ring_next<=n)
+    ring_load(ring_next++);
+#endif
+
+  slot = &ring[n%nslots];
+
+#ifdef READ_AHEAD
+  pthread_mutex_lock(&ring_mutex);
+  while (slot->num!=n)
+    pthread_cond_wait(&ring_cond,&ring_mutex);
+  pthread_mutex_unlock(&ring_mutex);
+#endif
+
+  memcpy(frame[0],slot->frame[0],width*height);
+  memcpy(frame[1],slot->frame[1],chrom_width*chrom_height);
+  memcpy(frame[2],slot->frame[2],chrom_width*chrom_height);
+
+#ifdef READ_AHEAD
+  pthread_mutex_lock(&ring_mutex);
+  slot->num = -1;
+  pthread_cond_broadcast(&ring_cond);
+  pthread_mutex_unlock(&ring_mutex);
+#else
+  slot->num = -1;
+#endif
+}
+
+/* load display frame n into its ring slot, waiting for the slot first */
+static void ring_load(n)
+int n;
+{
+  struct ring_slot *slot;
+
+  slot = &ring[n%nslots];
+
+#ifdef READ_AHEAD
+  pthread_mutex_lock(&ring_mutex);
+  while (slot->num!=-1)
+    pthread_cond_wait(&ring_cond,&ring_mutex);
+  pthread_mutex_unlock(&ring_mutex);
+#endif
+
+  load_frame(n,slot->frame);
+
+#ifdef READ_AHEAD
+  pthread_mutex_lock(&ring_mutex);
+  slot->num = n;
+  pthread_cond_broadcast(&ring_cond);
+  pthread_mutex_unlock(&ring_mutex);
+#else
+  slot->num = n;
+#endif
+}
+
+#ifdef READ_AHEAD
+/* reads all frames in display order, overlapping file I/O and color
+ * conversion with the encoding of the previous frames
+ */
+static void *loader_thread(arg)
+void *arg;
+{
+  while (ring_next<nframes)
+    ring_load(ring_next++);
+
+  return NULL;
+}
+#endif
+
+/* read display frame n from the input files into frame */
+static void load_frame(n,frame)
+int n;
+unsigned char *frame[];
+{
+  char name[256];
+
+  if (inputtype==T_RAW || inputtype==T_Y4M)
+  {
+    read_stream(n,frame);
+    return;
+  }
+
+  snprintf(name,sizeof name,tplorg,n+frame0);
+
   switch (inputtype)
   {
   case T_Y_U_V:
-    read_y_u_v(fname,frame);
+    read_y_u_v(name,frame);
     break;
   case T_YUV:
-    read_yuv(fname,frame);
+    read_yuv(name,frame);
     break;
   case T_PPM:
-    read_ppm(fname,frame);
+    read_ppm(name,frame);
     break;
   default:
     break;
   }
 }
 
+/* open a single file holding all frames ("-": standard input)
+ *
+ * T_RAW is a plain concatenation of planar frames in the chroma format of
+ * the sequence, T_Y4M a YUV4MPEG2 stream. Regular files are memory-mapped,
+ * anything else is read sequentially.
+ */
+static void open_stream()
+{
+  int i, n, chrom_hsize, chrom_vsize;
+  size_t pos;
+  unsigned char *nl;
+  struct stat st;
+  char hdr[256];
+
+  if (tplorg[0]=='-' && tplorg[1]==0)
+    in_fd = 0;
+  else if ((in_fd = open(tplorg,O_RDONLY))<0)
+  {
+    snprintf(errortext,sizeof errortext,"Couldn't open %.200s\n",tplorg);
+    error(errortext);
+  }
+
+  if (fstat(in_fd,&st)==0 && S_ISREG(st.st_mode) && st.st_size>0)
+  {
+    in_maplen = st.st_size;
+    in_map = (unsigned char *)mmap(NULL,in_maplen,PROT_READ,MAP_SHARED,in_fd,0);
+    if (in_map==(unsigned char *)MAP_FAILED)
+      in_map = NULL;
+    else
+      madvise(in_map,in_maplen,MADV_SEQUENTIAL);
+  }
+
+  in_chroma = chroma_format;
+  in_hdrlen = 0;
+
+  if (inputtype==T_Y4M)
+  {
+    /* stream header, terminated by a newline */
+    for (i=0; i<(int)sizeof(hdr)-1; i++)
+    {
+      if (in_map)
+      {
+        if (i>=(int)in_maplen)
+          break;
+        hdr[i] = in_map[i];
+      }
+      else if (read(in_fd,hdr+i,1)!=1)
+        break;
+      if (hdr[i]=='\n')
+        break;
+    }
+    hdr[i] = 0;
+    in_hdrlen = i+1;
+
+    if (!parse_y4m_header(hdr))
+    {
+      snprintf(errortext,sizeof errortext,
+        "%.200s is not a suitable YUV4MPEG2 stream\n",tplorg);
+      error(errortext);
+    }
+  }
+
+  chrom_hsize = (in_chroma==CHROMA444) ? horizontal_size : horizontal_size>>1;
+  chrom_vsize = (in_chroma!=CHROMA420) ? vertical_size : vertical_size>>1;
+  in_framesize = horizontal_size*vertical_size + 2*chrom_hsize*chrom_vsize;
+
+  if (in_chroma!=chroma_format)
+  {
+    if (!(in_u = (unsigned char *)malloc(width*height))
+        || !(in_v = (unsigned char *)malloc(width*height))
+        || !(in_u422 = (unsigned char *)malloc((width>>1)*height))
+        || !(in_v422 = (unsigned char *)malloc((width>>1)*height)))
+      error("malloc failed\n");
+  }
+
+  if (!in_map)
+  {
+    if (!(in_buf = (unsigned char *)malloc(in_framesize)))
+      error("malloc failed\n");
+    in_next = 0;
+    return;
+  }
+
+  /* index the frames of the mapped file */
+  n = frame0 + nframes;
+  if (!(in_index = (size_t *)malloc(n*sizeof(size_t))))
+    error("malloc failed\n");
+
+  pos = in_hdrlen;
+  for (in_nindex=0; in_nindex<n; in_nindex++)
+  {
+    if (inputtype==T_Y4M)
+    {
+      if (pos+5>in_maplen || memcmp(in_map+pos,"FRAME",5))
+        break;
+      if (!(nl = (unsigned char *)memchr(in_map+pos,'\n',in_maplen-pos)))
+        break;
+      pos = nl + 1 - in_map;
+    }
+    if (pos+in_framesize>in_maplen)
+      break;
+    in_index[in_nindex] = pos;
+    pos += in_framesize;
+  }
+}
+
+/* check a YUV4MPEG2 stream header against the sequence parameters */
+static int parse_y4m_header(hdr)
+char *hdr;
+{
+  char *tok;
+  int w, h;
+
+  if (strncmp(hdr,"YUV4MPEG2",9))
+    return 0;
+
+  w = h = -1;
+
+  for (tok=strtok(hdr+9," \n"); tok; tok=strtok(NULL," \n"))
+  {
+    switch (tok[0])
+    {
+    case 'W':
+      w = atoi(tok+1);
+      break;
+    case 'H':
+      h = atoi(tok+1);
+      break;
+    case 'C':
+      if (!strncmp(tok+1,"420",3))
+        in_chroma = CHROMA420;
+      else if (!strncmp(tok+1,"422",3))
+        in_chroma = CHROMA422;
+      else if (!strncmp(tok+1,"444",3) && strcmp(tok+1,"444alpha"))
+        in_chroma = CHROMA444;
+      else
+        return 0;
+      break;
+    default:
+      break; /* frame rate, interlacing, aspect ratio: taken from .par */
+    }
+  }
+
+  if (w!=horizontal_size || h!=vertical_size)
+  {
+    snprintf(errortext,sizeof errortext,
+      "YUV4MPEG2 size %dx%d doesn't match %dx%d\n",
+      w,h,horizontal_size,vertical_size);
+    error(errortext);
+  }
+
+  /* chroma is only ever downsampled */
+  return in_chroma>=chroma_format;
+}
+
+/* read display frame n from the single input file */
+static void read_stream(n,frame)
+int n;
+unsigned char *frame[];
+{
+  unsigned char c;
+
+  n += frame0;
+
+  if (in_map)
+  {
+    if (n>=in_nindex)
+    {
+      snprintf(errortext,sizeof errortext,
+        "Premature end of input file %.200s (frame %d)\n",tplorg,n);
+      error(errortext);
+    }
+    copy_stream_frame(in_map+in_index[n],frame);
+    return;
+  }
+
+  /* sequential input, skip up to the requested frame */
+  for (; in_next<=n; in_next++)
+  {
+    if (inputtype==T_Y4M)
+    {
+      do
+        read_fully(&c,1);
+      while (c!='\n');
+    }
+    read_fully(in_buf,in_framesize);
+  }
+
+  copy_stream_frame(in_buf,frame);
+}
+
+static void read_fully(buf,len)
+unsigned char *buf;
+int len;
+{
+  int i, k;
+
+  for (i=0; i<len; i+=k)
+  {
+    if ((k = read(in_fd,buf+i,len-i))<=0)
+    {
+      snprintf(errortext,sizeof errortext,
+        "Premature end of input file %.200s\n",tplorg);
+      error(errortext);
+    }
+  }
+}
+
+/* copy one frame of planar input data into the (padded) frame buffers,
+ * downsampling the chroma if the input format has more chroma samples
+ */
+static void copy_stream_frame(src,frame)
+unsigned char *src;
+unsigned char *frame[];
+{
+  int i, cc;
+  int chrom_hsize, chrom_vsize, w, h;
+  unsigned char *dst, *u422;
+
+  for (i=0; i<vertical_size; i++)
+    memcpy(frame[0]+i*width,src+i*horizontal_size,horizontal_size);
+  border_extend(frame[0],horizontal_size,vertical_size,width,height);
+  src += horizontal_size*vertical_size;
+
+  chrom_hsize = (in_chroma==CHROMA444) ? horizontal_size : horizontal_size>>1;
+  chrom_vsize = (in_chroma!=CHROMA420) ? vertical_size : vertical_size>>1;
+
+  for (cc=1; cc<3; cc++)
+  {
+    if (in_chroma==chroma_format)
+    {
+      dst = frame[cc];
+      w = chrom_width;
+      h = chrom_height;
+    }
+    else if (in_chroma==CHROMA444)
+    {
+      dst = (cc==1) ? in_u : in_v;
+      w = width;
+      h = height;
+    }
+    else
+    {
+      dst = (cc==1) ? in_u422 : in_v422;
+      w = width>>1;
+      h = height;
+    }
+
+    for (i=0; i<chrom_vsize; i++)
+      memcpy(dst+i*w,src+i*chrom_hsize,chrom_hsize);
+    border_extend(dst,chrom_hsize,chrom_vsize,w,h);
+    src += chrom_hsize*chrom_vsize;
+
+    if (in_chroma==chroma_format)
+      continue;
+
+    u422 = (cc==1) ? in_u422 : in_v422;
+
+    if (in_chroma==CHROMA444)
+      conv444to422(dst,(chroma_format==CHROMA422) ? frame[cc] : u422);
+
+    if (chroma_format==CHROMA420)
+      conv422to420(u422,frame[cc]);
+  }
+}
+
 static void read_y_u_v(fname,frame)
 char *fname;
 unsigned char *frame[];
 {
   int i;
   int chrom_hsize, chrom_vsize;
-  char name[128];
+  char name[256+8];
   FILE *fd;
 
   chrom_hsize = (chroma_format==CHROMA444) ? horizontal_size
@@ -127,10 +600,10 @@ unsigned char *frame[];
   chrom_vsize = (chroma_format!=CHROMA420) ? vertical_size
                                            : vertical_size>>1;
 
-  sprintf(name,"%s.Y",fname);
+  snprintf(name,sizeof name,"%s.Y",fname);
   if (!(fd = fopen(name,"rb")))
   {
-    sprintf(errortext,"Couldn't open %s\n",name);
+    snprintf(errortext,sizeof errortext,"Couldn't open %.200s\n",name);
     error(errortext);
   }
   for (i=0; i<vertical_size; i++)
@@ -138,10 +611,10 @@ unsigned char *frame[];
   fclose(fd);
   border_extend(frame[0],horizontal_size,vertical_size,width,height);
 
-  sprintf(name,"%s.U",fname);
+  snprintf(name,sizeof name,"%s.U",fname);
   if (!(fd = fopen(name,"rb")))
   {
-    sprintf(errortext,"Couldn't open %s\n",name);
+    snprintf(errortext,sizeof errortext,"Couldn't open %.200s\n",name);
     error(errortext);
   }
   for (i=0; i<chrom_vsize; i++)
@@ -149,10 +622,10 @@ unsigned char *frame[];
   fclose(fd);
   border_extend(frame[1],chrom_hsize,chrom_vsize,chrom_width,chrom_height);
 
-  sprintf(name,"%s.V",fname);
+  snprintf(name,sizeof name,"%s.V",fname);
   if (!(fd = fopen(name,"rb")))
   {
-    sprintf(errortext,"Couldn't open %s\n",name);
+    snprintf(errortext,sizeof errortext,"Couldn't open %.200s\n",name);
     error(errortext);
   }
   for (i=0; i<chrom_vsize; i++)
@@ -167,7 +640,7 @@ unsigned char *frame[];
 {
   int i;
   int chrom_hsize, chrom_vsize;
-  char name[128];
+  char name[256+8];
   FILE *fd;
 
   chrom_hsize = (chroma_format==CHROMA444) ? horizontal_size
@@ -175,10 +648,10 @@ unsigned char *frame[];
   chrom_vsize = (chroma_format!=CHROMA420) ? vertical_size
                                            : vertical_size>>1;
 
-  sprintf(name,"%s.yuv",fname);
+  snprintf(name,sizeof name,"%s.yuv",fname);
   if (!(fd = fopen(name,"rb")))
   {
-    sprintf(errortext,"Couldn't open %s\n",name);
+    snprintf(errortext,sizeof errortext,"Couldn't open %.200s\n",name);
     error(errortext);
   }
 
@@ -208,7 +681,7 @@ unsigned char *frame[];
   int r, g, b;
   double y, u, v;
   double cr, cg, cb, cu, cv;
-  char name[128];
+  char name[256+8];
   FILE *fd;
   unsigned char *yp, *up, *vp;
   static unsigned char *u444, *v444, *u422, *v422;
@@ -254,11 +727,11 @@ unsigned char *frame[];
     }
   }
 
-  sprintf(name,"%s.ppm",fname);
+  snprintf(name,sizeof name,"%s.ppm",fname);
 
   if (!(fd = fopen(name,"rb")))
   {
-    sprintf(errortext,"Couldn't open %s\n",name);
+    snprintf(errortext,sizeof errortext,"Couldn't open %.200s\n",name);
     error(errortext);
   }
 
@@ -309,192 +782,232 @@ static void border_extend(frame,w1,h1,w2,h2)
 unsigned char *frame;
 int w1,h1,w2,h2;
 {
-  int i, j;
+  int j;
   unsigned char *fp;
 
   /* horizontal pixel replication (right border) */
 
-  for (j=0; j<h1; j++)
-  {
-    fp = frame + j*w2;
-    for (i=w1; i<w2; i++)
-      fp[i] = fp[i-1];
-  }
+  if (w1<w2)
+    for (j=0; j<h1; j++)
+    {
+      fp = frame + j*w2;
+      memset(fp+w1,fp[w1-1],w2-w1);
+    }
 
   /* vertical pixel replication (bottom border) */
 
   for (j=h1; j<h2; j++)
   {
     fp = frame + j*w2;
-    for (i=0; i<w2; i++)
-      fp[i] = fp[i-w2];
+    memcpy(fp,fp-w2,w2);
   }
 }
 
+/* saturation to 0..255, same as clp[] but transparent to the vectorizer */
+#define CLIP8(x) ((x)<0 ? 0 : ((x)>255 ? 255 : (x)))
+
+/* The filters below are split into border samples, whose taps have to be
+ * clamped to the picture, and interior samples with fixed offsets. The
+ * interior loops run over whole rows without table lookups so that the
+ * compiler can vectorize them.
+ */
+
+/* one output sample of the horizontal filters, taps clamped to the row */
+static int h_filter(src,i)
+unsigned char *src;
+int i;
+{
+  int im5, im4, im3, im2, im1, ip1, ip2, ip3, ip4, ip5, ip6;
+
+  im5 = (i<5) ? 0 : i-5;
+  im4 = (i<4) ? 0 : i-4;
+  im3 = (i<3) ? 0 : i-3;
+  im2 = (i<2) ? 0 : i-2;
+  im1 = (i<1) ? 0 : i-1;
+  ip1 = (i<width-1) ? i+1 : width-1;
+  ip2 = (i<width-2) ? i+2 : width-1;
+  ip3 = (i<width-3) ? i+3 : width-1;
+  ip4 = (i<width-4) ? i+4 : width-1;
+  ip5 = (i<width-5) ? i+5 : width-1;
+  ip6 = (i<width-6) ? i+6 : width-1;
+
+  if (mpeg1)
+    /* FIR filter with 0.5 sample interval phase shift */
+    return clp[(int)(228*(src[i]+src[ip1])
+                     +70*(src[im1]+src[ip2])
+                     -37*(src[im2]+src[ip3])
+                     -21*(src[im3]+src[ip4])
+                     +11*(src[im4]+src[ip5])
+                     + 5*(src[im5]+src[ip6])+256)>>9];
+
+  /* FIR filter coefficients (*512): 22 0 -52 0 159 256 159 0 -52 0 22 */
+  return clp[(int)(  22*(src[im5]+src[ip5])-52*(src[im3]+src[ip3])
+                   +159*(src[im1]+src[ip1])+256*src[i]+256)>>9];
+}
+
 /* horizontal filter and 2:1 subsampling */
 static void conv444to422(src,dst)
 unsigned char *src, *dst;
 {
-  int i, j, im5, im4, im3, im2, im1, ip1, ip2, ip3, ip4, ip5, ip6;
+  int i, j, v, iend;
 
-  if (mpeg1)
+  /* last (even) sample whose taps all lie inside the row */
+  iend = mpeg1 ? width-7 : width-6;
+
+  for (j=0; j<height; j++)
   {
-    for (j=0; j<height; j++)
+    for (i=0; i<6 && i<width; i+=2)
+      dst[i>>1] = h_filter(src,i);
+
+    if (mpeg1)
     {
-      for (i=0; i<width; i+=2)
+      for (; i<=iend; i+=2)
       {
-        im5 = (i<5) ? 0 : i-5;
-        im4 = (i<4) ? 0 : i-4;
-        im3 = (i<3) ? 0 : i-3;
-        im2 = (i<2) ? 0 : i-2;
-        im1 = (i<1) ? 0 : i-1;
-        ip1 = (i<width-1) ? i+1 : width-1;
-        ip2 = (i<width-2) ? i+2 : width-1;
-        ip3 = (i<width-3) ? i+3 : width-1;
-        ip4 = (i<width-4) ? i+4 : width-1;
-        ip5 = (i<width-5) ? i+5 : width-1;
-        ip6 = (i<width-5) ? i+6 : width-1;
-
-        /* FIR filter with 0.5 sample interval phase shift */
-        dst[i>>1] = clp[(int)(228*(src[i]+src[ip1])
-                         +70*(src[im1]+src[ip2])
-                         -37*(src[im2]+src[ip3])
-                         -21*(src[im3]+src[ip4])
-                         +11*(src[im4]+src[ip5])
-                         + 5*(src[im5]+src[ip6])+256)>>9];
+        v = (228*(src[i]+src[i+1])
+             +70*(src[i-1]+src[i+2])
+             -37*(src[i-2]+src[i+3])
+             -21*(src[i-3]+src[i+4])
+             +11*(src[i-4]+src[i+5])
+             + 5*(src[i-5]+src[i+6])+256)>>9;
+        dst[i>>1] = CLIP8(v);
       }
-      src+= width;
-      dst+= width>>1;
     }
-  }
-  else
-  {
-    /* MPEG-2 */
-    for (j=0; j<height; j++)
+    else
     {
-      for (i=0; i<width; i+=2)
+      for (; i<=iend; i+=2)
       {
-        im5 = (i<5) ? 0 : i-5;
-        im3 = (i<3) ? 0 : i-3;
-        im1 = (i<1) ? 0 : i-1;
-        ip1 = (i<width-1) ? i+1 : width-1;
-        ip3 = (i<width-3) ? i+3 : width-1;
-        ip5 = (i<width-5) ? i+5 : width-1;
-
-        /* FIR filter coefficients (*512): 22 0 -52 0 159 256 159 0 -52 0 22 */
-        dst[i>>1] = clp[(int)(  22*(src[im5]+src[ip5])-52*(src[im3]+src[ip3])
-                         +159*(src[im1]+src[ip1])+256*src[i]+256)>>9];
+        v = (  22*(src[i-5]+src[i+5])-52*(src[i-3]+src[i+3])
+             +159*(src[i-1]+src[i+1])+256*src[i]+256)>>9;
+        dst[i>>1] = CLIP8(v);
       }
-      src+= width;
-      dst+= width>>1;
     }
+
+    for (; i<width; i+=2)
+      dst[i>>1] = h_filter(src,i);
+
+    src+= width;
+    dst+= width>>1;
   }
 }
 
-/* vertical filter and 2:1 subsampling */
+/* vertical filter and 2:1 subsampling
+ *
+ * each output row is a weighted sum of up to twelve input rows; the row
+ * indices are clamped once per output row and the columns are processed
+ * in one contiguous pass
+ */
 static void conv422to420(src,dst)
 unsigned char *src, *dst;
 {
-  int w, i, j, jm6, jm5, jm4, jm3, jm2, jm1;
-  int jp1, jp2, jp3, jp4, jp5, jp6;
+  int w, i, j, v;
+  unsigned char *sm6, *sm5, *sm4, *sm3, *sm2, *sm1, *s0;
+  unsigned char *sp1, *sp2, *sp3, *sp4, *sp5, *sp6;
+  unsigned char *d;
 
   w = width>>1;
 
   if (prog_frame)
   {
     /* intra frame */
-    for (i=0; i<w; i++)
+    for (j=0; j<height; j+=2)
     {
-      for (j=0; j<height; j+=2)
+      sm5 = src + w*((j<5) ? 0 : j-5);
+      sm4 = src + w*((j<4) ? 0 : j-4);
+      sm3 = src + w*((j<3) ? 0 : j-3);
+      sm2 = src + w*((j<2) ? 0 : j-2);
+      sm1 = src + w*((j<1) ? 0 : j-1);
+      s0  = src + w*j;
+      sp1 = src + w*((j<height-1) ? j+1 : height-1);
+      sp2 = src + w*((j<height-2) ? j+2 : height-1);
+      sp3 = src + w*((j<height-3) ? j+3 : height-1);
+      sp4 = src + w*((j<height-4) ? j+4 : height-1);
+      sp5 = src + w*((j<height-5) ? j+5 : height-1);
+      sp6 = src + w*((j<height-6) ? j+6 : height-1);
+      d = dst + w*(j>>1);
+
+      /* FIR filter with 0.5 sample interval phase shift */
+      for (i=0; i<w; i++)
       {
-        jm5 = (j<5) ? 0 : j-5;
-        jm4 = (j<4) ? 0 : j-4;
-        jm3 = (j<3) ? 0 : j-3;
-        jm2 = (j<2) ? 0 : j-2;
-        jm1 = (j<1) ? 0 : j-1;
-        jp1 = (j<height-1) ? j+1 : height-1;
-        jp2 = (j<height-2) ? j+2 : height-1;
-        jp3 = (j<height-3) ? j+3 : height-1;
-        jp4 = (j<height-4) ? j+4 : height-1;
-        jp5 = (j<height-5) ? j+5 : height-1;
-        jp6 = (j<height-5) ? j+6 : height-1;
-
-        /* FIR filter with 0.5 sample interval phase shift */
-        dst[w*(j>>1)] = clp[(int)(228*(src[w*j]+src[w*jp1])
-                             +70*(src[w*jm1]+src[w*jp2])
-                             -37*(src[w*jm2]+src[w*jp3])
-                             -21*(src[w*jm3]+src[w*jp4])
-                             +11*(src[w*jm4]+src[w*jp5])
-                             + 5*(src[w*jm5]+src[w*jp6])+256)>>9];
+        v = (228*(s0[i]+sp1[i])
+             +70*(sm1[i]+sp2[i])
+             -37*(sm2[i]+sp3[i])
+             -21*(sm3[i]+sp4[i])
+             +11*(sm4[i]+sp5[i])
+             + 5*(sm5[i]+sp6[i])+256)>>9;
+        d[i] = CLIP8(v);
       }
-      src++;
-      dst++;
     }
   }
   else
   {
     /* intra field */
-    for (i=0; i<w; i++)
+    for (j=0; j<height; j+=4)
     {
-      for (j=0; j<height; j+=4)
+      /* top field */
+      sm5 = src + w*((j<10) ? 0 : j-10);
+      sm4 = src + w*((j<8) ? 0 : j-8);
+      sm3 = src + w*((j<6) ? 0 : j-6);
+      sm2 = src + w*((j<4) ? 0 : j-4);
+      sm1 = src + w*((j<2) ? 0 : j-2);
+      s0  = src + w*j;
+      sp1 = src + w*((j<height-2) ? j+2 : height-2);
+      sp2 = src + w*((j<height-4) ? j+4 : height-2);
+      sp3 = src + w*((j<height-6) ? j+6 : height-2);
+      sp4 = src + w*((j<height-8) ? j+8 : height-2);
+      sp5 = src + w*((j<height-10) ? j+10 : height-2);
+      sp6 = src + w*((j<height-12) ? j+12 : height-2);
+      d = dst + w*(j>>1);
+
+      /* FIR filter with 0.25 sample interval phase shift */
+      for (i=0; i<w; i++)
+      {
+        v = (8*sm5[i]
+            +5*sm4[i]
+           -30*sm3[i]
+           -18*sm2[i]
+          +113*sm1[i]
+          +242*s0[i]
+          +192*sp1[i]
+           +35*sp2[i]
+           -38*sp3[i]
+           -10*sp4[i]
+           +11*sp5[i]
+            +2*sp6[i]+256)>>9;
+        d[i] = CLIP8(v);
+      }
+
+      /* bottom field */
+      sm6 = src + w*((j<9) ? 1 : j-9);
+      sm5 = src + w*((j<7) ? 1 : j-7);
+      sm4 = src + w*((j<5) ? 1 : j-5);
+      sm3 = src + w*((j<3) ? 1 : j-3);
+      sm2 = src + w*((j<1) ? 1 : j-1);
+      sm1 = src + w*((j<height-1) ? j+1 : height-1);
+      sp1 = src + w*((j<height-3) ? j+3 : height-1);
+      sp2 = src + w*((j<height-5) ? j+5 : height-1);
+      sp3 = src + w*((j<height-7) ? j+7 : height-1);
+      sp4 = src + w*((j<height-9) ? j+9 : height-1);
+      sp5 = src + w*((j<height-11) ? j+11 : height-1);
+      sp6 = src + w*((j<height-13) ? j+13 : height-1);
+      d = dst + w*((j>>1)+1);
+
+      /* FIR filter with 0.25 sample interval phase shift */
+      for (i=0; i<w; i++)
       {
-        /* top field */
-        jm5 = (j<10) ? 0 : j-10;
-        jm4 = (j<8) ? 0 : j-8;
-        jm3 = (j<6) ? 0 : j-6;
-        jm2 = (j<4) ? 0 : j-4;
-        jm1 = (j<2) ? 0 : j-2;
-        jp1 = (j<height-2) ? j+2 : height-2;
-        jp2 = (j<height-4) ? j+4 : height-2;
-        jp3 = (j<height-6) ? j+6 : height-2;
-        jp4 = (j<height-8) ? j+8 : height-2;
-        jp5 = (j<height-10) ? j+10 : height-2;
-        jp6 = (j<height-12) ? j+12 : height-2;
-
-        /* FIR filter with 0.25 sample interval phase shift */
-        dst[w*(j>>1)] = clp[(int)(8*src[w*jm5]
-                            +5*src[w*jm4]
-                           -30*src[w*jm3]
-                           -18*src[w*jm2]
-                          +113*src[w*jm1]
-                          +242*src[w*j]
-                          +192*src[w*jp1]
-                           +35*src[w*jp2]
-                           -38*src[w*jp3]
-                           -10*src[w*jp4]
-                           +11*src[w*jp5]
-                            +2*src[w*jp6]+256)>>9];
-
-        /* bottom field */
-        jm6 = (j<9) ? 1 : j-9;
-        jm5 = (j<7) ? 1 : j-7;
-        jm4 = (j<5) ? 1 : j-5;
-        jm3 = (j<3) ? 1 : j-3;
-        jm2 = (j<1) ? 1 : j-1;
-        jm1 = (j<height-1) ? j+1 : height-1;
-        jp1 = (j<height-3) ? j+3 : height-1;
-        jp2 = (j<height-5) ? j+5 : height-1;
-        jp3 = (j<height-7) ? j+7 : height-1;
-        jp4 = (j<height-9) ? j+9 : height-1;
-        jp5 = (j<height-11) ? j+11 : height-1;
-        jp6 = (j<height-13) ? j+13 : height-1;
-
-        /* FIR filter with 0.25 sample interval phase shift */
-        dst[w*((j>>1)+1)] = clp[(int)(8*src[w*jp6]
-                                +5*src[w*jp5]
-                               -30*src[w*jp4]
-                               -18*src[w*jp3]
-                              +113*src[w*jp2]
-                              +242*src[w*jp1]
-                              +192*src[w*jm1]
-                               +35*src[w*jm2]
-                               -38*src[w*jm3]
-                               -10*src[w*jm4]
-                               +11*src[w*jm5]
-                                +2*src[w*jm6]+256)>>9];
+        v = (8*sp6[i]
+            +5*sp5[i]
+           -30*sp4[i]
+           -18*sp3[i]
+          +113*sp2[i]
+          +242*sp1[i]
+          +192*sm1[i]
+           +35*sm2[i]
+           -38*sm3[i]
+           -10*sm4[i]
+           +11*sm5[i]
+            +2*sm6[i]+256)>>9;
+        d[i] = CLIP8(v);
       }
-      src++;
-      dst++;
     }
   }
 }
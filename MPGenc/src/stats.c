@@ -158,6 +158,58 @@ double *pv,*pe;
   *pe = e2;         /* MSE */
 }
 
+#ifdef FAST_MODE_DECISION
+/* fast mode decision counts, accumulated over the sequence by picture
+ * type (0: P, 1: B), see frame_ME
+ */
+static long ed_mbs[2], ed_skip[2], ed_intra[2], ed_nobidir[2];
+
+void early_stats()
+{
+  int k, t, nmb;
+
+  if (pict_type==I_TYPE)
+    return;
+
+  t = (pict_type==B_TYPE);
+  nmb = mb_width*mb_height2;
+  ed_mbs[t]+= nmb;
+
+  for (k=0; k<nmb; k++)
+  {
+    if (mbinfo[k].early & ED_SKIP)
+      ed_skip[t]++;
+    if (mbinfo[k].early & ED_INTRA)
+      ed_intra[t]++;
+    if (mbinfo[k].early & ED_NOBIDIR)
+      ed_nobidir[t]++;
+  }
+}
+
+void early_report()
+{
+  int t;
+
+  fprintf(statfile,"\nfast mode decisions:\n");
+
+  for (t=0; t<2; t++)
+  {
+    if (ed_mbs[t]==0)
+      continue;
+
+    fprintf(statfile," %c pictures, %ld macroblocks:\n",t ? 'B' : 'P',
+      ed_mbs[t]);
+    fprintf(statfile,"  early skip (zero vector): %8ld (%.1f%%)\n",
+      ed_skip[t],100.0*(double)ed_skip[t]/ed_mbs[t]);
+    fprintf(statfile,"  early intra:              %8ld (%.1f%%)\n",
+      ed_intra[t],100.0*(double)ed_intra[t]/ed_mbs[t]);
+    if (t)
+      fprintf(statfile,"  interpolation pruned:     %8ld (%.1f%%)\n",
+        ed_nobidir[t],100.0*(double)ed_nobidir[t]/ed_mbs[t]);
+  }
+}
+#endif
+
 void stats()
 {
   int i, j, k, nmb, mb_type;
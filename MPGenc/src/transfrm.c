@@ -163,19 +163,26 @@ short blocks[][64];
 
 
 #ifdef LTHREAD
-void pttransform(pred,cur,mbi,blocks,start_height,end_height)
+/* subtract prediction, then fused fdct + quantization + scan (fdctquant.c);
+ * blocks are left quantized in scan order with mbi[k].cbp, mquant and
+ * last[] set, so there is no separate quantization pass
+ */
+void pttransform(pred,cur,mbi,blocks,mquant,start_height,end_height)
 unsigned char *pred[], *cur[];
 struct mbinfo *mbi;
 short blocks[][64];
-int start_height,end_height;
+int mquant,start_height,end_height;
 {
-  int i, j, i1, j1, k, n, cc, offs, lx;
+  int i, j, i1, j1, k, n, cc, offs, lx, intra, cbp, last;
 
   k = (start_height>>4)*(width>>4);
 
   for (j=start_height; j<end_height; j+=16)
     for (i=0; i<width; i+=16)
     {
+      intra = mbi[k].mb_type & MB_INTRA;
+      cbp = 0;
+
       for (n=0; n<block_count; n++)
       {
         cc = (n<4) ? 0 : (n&1)+1; /* color component index */
@@ -224,12 +231,19 @@ int start_height,end_height;
             offs += chrom_width;
         }
 
-	/* Note: sub pred writes into v1 (block) and fdct uses (v1) */
-
         sub_pred(pred[cc]+offs,cur[cc]+offs,lx,blocks[k*block_count+n]);
-        fdct(blocks[k*block_count+n]);
+
+        if (intra)
+          last = fdct_quant_intra(blocks[k*block_count+n],dc_prec,mquant);
+        else
+          last = fdct_quant_non_intra(blocks[k*block_count+n],mquant);
+
+        mbi[k].last[n] = last;
+        cbp = (cbp<<1) | (last!=0);
       }
 
+      mbi[k].mquant = mquant;
+      mbi[k].cbp = cbp;
       k++;
     }
 
@@ -350,25 +350,60 @@ static apivector tri_normal(apivector * v0, apivector * v1, apivector * v2) {
   return norm;
 }
 
-static void gen_triangles(SceneHandle scene, tri_list * tlist, 
+/*
+ * Emit the triangles of an object as one indexed mesh for each material
+ * and smoothing combination it uses, sharing the vertex and normal arrays.
+ */
+static void gen_triangles(SceneHandle scene, tri_list * tlist, int numverts,
                           apivector * vertex, apivector * normal) {
-  tri_list * cur;
-
-  cur = tlist;
-  while (cur != NULL) {
-    if (cur->smooth) {
-      rt_stri(scene, textable[cur->texnum].tex, 
-        vertex[cur->v0], vertex[cur->v1], vertex[cur->v2],
-        normal[cur->v0], normal[cur->v1], normal[cur->v2]);
-     
-    }
-    else {
-      rt_tri(scene, textable[cur->texnum].tex, 
-        vertex[cur->v0], vertex[cur->v1], vertex[cur->v2]);
+  tri_list * cur, * first;
+  float * v, * n;
+  int * facets;
+  int i, numtris;
+
+  numtris = 0;
+  for (cur = tlist; cur != NULL; cur = cur->next)
+    numtris++;
+  if (numtris == 0)
+    return;
+
+  v = (float *) malloc(numverts * 3 * sizeof(float));
+  n = (float *) malloc(numverts * 3 * sizeof(float));
+  for (i=0; i<numverts; i++) {
+    v[i*3    ] = vertex[i].x;
+    v[i*3 + 1] = vertex[i].y;
+    v[i*3 + 2] = vertex[i].z;
+    n[i*3    ] = normal[i].x;
+    n[i*3 + 1] = normal[i].y;
+    n[i*3 + 2] = normal[i].z;
+  }
+  facets = (int *) malloc(numtris * 3 * sizeof(int));
+
+  /* the texnum of emitted triangles is set to -1 */
+  for (first = tlist; first != NULL; first = first->next) {
+    if (first->texnum < 0)
+      continue;
+
+    numtris = 0;
+    for (cur = first; cur != NULL; cur = cur->next) {
+      if (cur->texnum == first->texnum && cur->smooth == first->smooth) {
+        facets[numtris*3    ] = cur->v0;
+        facets[numtris*3 + 1] = cur->v1;
+        facets[numtris*3 + 2] = cur->v2;
+        numtris++;
+        if (cur != first)
+          cur->texnum = -1;
+      }
     }
 
-    cur = cur->next;
+    rt_trimesh(scene, textable[first->texnum].tex, numverts, v,
+               (first->smooth) ? n : NULL, NULL, numtris, facets);
+    first->texnum = -1;
   }
+
+  free(facets);
+  free(v);
+  free(n);
 }
 
 
@@ -545,7 +580,7 @@ static errcode GetRecurseObject(SceneHandle scene, FILE *dfile,
     /* now that all vertex normals have been summed, we'll renormalize */
     renormalize_normals(normalarray, numvert);
 
-    gen_triangles(scene, tlist, vertexarray, normalarray);
+    gen_triangles(scene, tlist, numvert, vertexarray, normalarray);
     tlist_delete(&tlist); 
   }
 
@@ -43,8 +43,8 @@ static void clear_normals(apivector * normals, int numverts);
 static void normalize(apivector * vec);
 static void renormalize_normals(apivector * normals, int numverts);
 static apivector tri_normal(apivector * v0, apivector * v1, apivector * v2);
-static void gen_triangles(SceneHandle, tri_list * tlist, apivector * vertex,
-                          apivector * normal);
+static void gen_triangles(SceneHandle, tri_list * tlist, int numverts,
+                          apivector * vertex, apivector * normal);
 static errcode GetMaterial(FILE *, SceneHandle);
 static errcode GetString(FILE *, char *);
 static errcode GetScenedefs(FILE *, SceneHandle);
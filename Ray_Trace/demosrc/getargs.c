@@ -45,7 +45,12 @@ static void printusage(char **argv) {
   printf("Speed Tuning Options:\n");
   printf(" -numthreads xxx   (** default is auto-determined)\n");
   printf(" -nobounding\n");
+  printf(" -bvh              use a bounding volume hierarchy, not grids\n");
   printf(" -boundthresh xxx  (** default threshold is 16)\n");
+  printf(" -packet xxx       trace primary rays in packets of 4, 8 or 16\n");
+  printf(" -tile xxx         render in xxx by xxx tiles, 0 for scanlines\n");
+  printf(" -cache            load .dat scenes from, or save them to, a\n");
+  printf("                   binary scene cache, filename.dat.cache\n");
   printf("\n");
   printf("Shading Options:\n");
   printf("  -fullshade    best quality rendering (and slowest) **\n");
@@ -86,6 +91,9 @@ static void printusage(char **argv) {
   printf("Antialiasing Options:\n");
   printf("  -aasamples xxx  (maximum supersamples taken per pixel)\n");
   printf("                  (** default is 0, or scene file determined)\n");
+  printf("  -aathresh xxx   stop supersampling a pixel once its color is\n");
+  printf("                  known to within xxx (** default 0, never)\n");
+  printf("  -progressive    take the samples one pass over the image at a time\n");
   printf("\n");
   printf("Output Options:\n");
   printf("  -res Xres Yres  override scene-defined output image size\n");
@@ -134,8 +142,12 @@ static void initoptions(argoptions * opt) {
   opt->ysize = 0;
   opt->verbosemode = -1;
   opt->aa_maxsamples = -1;
+  opt->aa_threshold = -1.0;
+  opt->progressive = -1;
   opt->boundmode = -1; 
   opt->boundthresh = -1; 
+  opt->packetsize = -1;
+  opt->tilesize = -1;
   opt->usecamfile = -1;
   opt->shadermode = -1;
   opt->phongfunc = -1;
@@ -293,6 +305,14 @@ int postsceneoptions(argoptions * opt, SceneHandle scene) {
     rt_aa_maxsamples(scene, opt->aa_maxsamples);
   } 
 
+  if (opt->aa_threshold >= 0.0) {
+    rt_aa_threshold(scene, opt->aa_threshold);
+  } 
+
+  if (opt->progressive != -1) {
+    rt_progressive(scene, opt->progressive);
+  } 
+
   if (opt->boundmode != -1) {
     rt_boundmode(scene, opt->boundmode);
   }
@@ -301,6 +321,14 @@ int postsceneoptions(argoptions * opt, SceneHandle scene) {
     rt_boundthresh(scene, opt->boundthresh);
   }
 
+  if (opt->packetsize != -1) {
+    rt_packetsize(scene, opt->packetsize);
+  }
+
+  if (opt->tilesize != -1) {
+    rt_tilesize(scene, opt->tilesize);
+  }
+
   if (opt->shadermode != -1) {
     rt_shadermode(scene, opt->shadermode);
   }
@@ -360,6 +388,15 @@ static int getparm(int argc, char **argv, int num, argoptions * opt, int node) {
     sscanf(argv[num + 1], "%d", &opt->aa_maxsamples);
     return 2;
   }
+  if (!strcmp(argv[num], "-aathresh")) {
+    sscanf(argv[num + 1], "%f", &opt->aa_threshold);
+    return 2;
+  }
+  if (!strcmp(argv[num], "-progressive")) {
+    /* render the image in refining passes */
+    opt->progressive = 1;
+    return 1;
+  }
   if (!strcmp(argv[num], "-V")) {
     /* turn verbose messages off */
     opt->verbosemode = 0;
@@ -375,11 +412,31 @@ static int getparm(int argc, char **argv, int num, argoptions * opt, int node) {
     opt->boundmode = RT_BOUNDING_DISABLED;
     return 1;
   }
+  if (!strcmp(argv[num], "-bvh")) {
+    /* use a bounding volume hierarchy instead of hierarchical grids */
+    opt->boundmode = RT_BOUNDING_BVH;
+    return 1;
+  }
+  if (!strcmp(argv[num], "-cache")) {
+    /* use binary scene caches instead of parsing .dat files */
+    opt->usecache = 1;
+    return 1;
+  }
   if (!strcmp(argv[num], "-boundthresh")) {
     /* set automatic bounding threshold control value */
     sscanf(argv[num + 1], "%d", &opt->boundthresh);
     return 2;
   }
+  if (!strcmp(argv[num], "-packet")) {
+    /* trace coherent primary rays in packets */
+    sscanf(argv[num + 1], "%d", &opt->packetsize);
+    return 2;
+  }
+  if (!strcmp(argv[num], "-tile")) {
+    /* set the size of the tiles handed out to the threads */
+    sscanf(argv[num + 1], "%d", &opt->tilesize);
+    return 2;
+  }
   if (!strcmp(argv[num], "-fullshade")) {
     opt->shadermode = RT_SHADER_FULL;
     return 1;
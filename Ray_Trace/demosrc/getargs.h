@@ -8,8 +8,13 @@ typedef struct {
   int outimageformat;             /* format of output image */
   int verbosemode;                /* verbose flags */
   int aa_maxsamples;              /* antialiasing setting */
+  float aa_threshold;             /* adaptive antialiasing error threshold */
+  int progressive;                /* render in refining passes */
   int boundmode;                  /* bounding mode */
   int boundthresh;                /* bounding threshold */
+  int packetsize;                 /* primary rays traced together */
+  int tilesize;                   /* edge of scheduled image tiles */
+  int usecache;                   /* use binary scene caches */
   int usecamfile;                 /* use camera file */
   char camfilename[FILENAME_MAX]; /* camera filename */
   int shadermode;                 /* quality level */
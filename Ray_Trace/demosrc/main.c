@@ -11,6 +11,7 @@
 #include "tachyon.h"    /* The Tachyon ray tracing library API */
 #include "getargs.h"    /* command line argument/option parsing */
 #include "parse.h"      /* Support for my own scene file format */
+#include "scenecache.h" /* Binary caches of parsed scene files */
 #include "nffparse.h"   /* Support for NFF files, as in SPD */
 #include "ac3dparse.h"  /* Support for AC3D files */
 #include "mgfparse.h"   /* Support for MGF files */
@@ -333,6 +334,7 @@ int main(int argc, char **argv) {
   SceneHandle scene;
   unsigned int rc;
   argoptions opt;
+  void * cache;
   char * filename;
   int node, fileindex;
   rt_timerhandle parsetimer;
@@ -372,6 +374,7 @@ int main(int argc, char **argv) {
 
     parsetimer=rt_timer_create();
     rt_timer_start(parsetimer);
+    cache = NULL;
 
     if (strstr(filename, ".nff") || strstr(filename, ".NFF")) {
       rc = ParseNFF(filename, scene); /* must be an NFF file */
@@ -384,6 +387,9 @@ int main(int argc, char **argv) {
       rc = ParseMGF(filename, scene, 1); /* Must be an MGF file */
     }
 #endif
+    else if (opt.usecache) {
+      cache = sc_open(filename, scene, &rc); /* Tachyon scene file, cached */
+    }
     else {  
       rc = readmodel(filename, scene); /* Assume its a Tachyon scene file */
     }
@@ -416,6 +422,7 @@ int main(int argc, char **argv) {
       else
         printf("Aborting render.\n");
 
+      sc_close(cache);
       rt_deletescene(scene); /* free the scene */
       continue;              /* process the next scene */
     }
@@ -423,6 +430,12 @@ int main(int argc, char **argv) {
     /* process command line overrides */
     postsceneoptions(&opt, scene);
 
+    /* write a new or outdated scene cache, with the BVH if it's used */
+    if (cache != NULL) {
+      sc_save(cache, scene, opt.boundmode == RT_BOUNDING_BVH);
+      sc_close(cache);
+    }
+
     /* choose which rendering mode to use */
     if (opt.usecamfile == 1) {
       return animate_scene(opt, scene, node); /* fly using prerecorded data */
@@ -11,6 +11,7 @@
 #include <ctype.h> /* needed for toupper(), macro.. */
 
 #include "tachyon.h"  /* Tachyon ray tracer API */
+#include "scenecache.h" /* binary scene caches */
 
 #ifdef USELIBMGF
 #include "mgfparse.h" /* MGF parser code */
@@ -59,7 +60,7 @@ static void reset_tex_table(parsehandle * ph, SceneHandle scene) {
   apitex.opacity=1.0;
   apitex.texturefunc=0;
 
-  ph->defaulttex.tex=rt_texture(scene, &apitex);
+  ph->defaulttex.tex=sc_texture(ph->cache, scene, &apitex);
   rt_hash_init(&ph->texhash, 1024);
 }
 
@@ -219,16 +220,24 @@ static errcode GetString(parsehandle * ph, const char * string) {
 }
 
 unsigned int readmodel(const char * modelfile, SceneHandle scene) {
+  return recordmodel(modelfile, scene, NULL);
+}
+
+/* parse a scene file, recording it into a scene cache unless it's NULL */
+unsigned int recordmodel(const char * modelfile, SceneHandle scene,
+                         void * cache) {
   parsehandle ph;
   errcode rc;
   int done;
 
   memset(&ph, 0, sizeof(ph));
   ph.filename = modelfile;
+  ph.cache = cache;
   ph.ifp=fopen(modelfile, "r");
   if (ph.ifp == NULL) {
     return PARSEBADFILE;
   }
+  sc_depend(cache, modelfile);
 
   reset_tex_table(&ph, scene); 
 
@@ -295,6 +304,7 @@ static errcode ReadIncludeFile(parsehandle * ph, const char * includefile, Scene
 
     return PARSEBADSUBFILE;
   }
+  sc_depend(ph->cache, includefile);
 
   while ((rc = GetObject(ph, scene)) == PARSENOERR) {
     ph->numobjectsparsed++;
@@ -319,9 +329,9 @@ static errcode GetScenedefs(parsehandle * ph, SceneHandle scene) {
   rc |= GetString(ph, "RESOLUTION");
   fscanf(ph->ifp, "%d %d", &xres, &yres);
 
-  rt_outputfile(scene, "outfile.tga");
-  rt_resolution(scene, xres, yres);
-  rt_verbose(scene, 0);
+  sc_outputfile(ph->cache, scene, "outfile.tga");
+  sc_resolution(ph->cache, scene, xres, yres);
+  sc_verbose(ph->cache, scene, 0);
 
   return rc;
 }
@@ -332,13 +342,13 @@ static errcode GetShaderMode(parsehandle * ph, SceneHandle scene) {
 
   fscanf(ph->ifp, "%s", data);
   if (!stringcmp(data, "FULL")) {
-    rt_shadermode(scene, RT_SHADER_FULL);
+    sc_shadermode(ph->cache, scene, RT_SHADER_FULL);
   } else if (!stringcmp(data, "MEDIUM")) {
-    rt_shadermode(scene, RT_SHADER_MEDIUM);
+    sc_shadermode(ph->cache, scene, RT_SHADER_MEDIUM);
   } else if (!stringcmp(data, "LOW")) {
-    rt_shadermode(scene, RT_SHADER_LOW);
+    sc_shadermode(ph->cache, scene, RT_SHADER_LOW);
   } else if (!stringcmp(data, "LOWEST")) {
-    rt_shadermode(scene, RT_SHADER_LOWEST);
+    sc_shadermode(ph->cache, scene, RT_SHADER_LOWEST);
   } else {
     printf("Bad token '%s' while reading shader mode block\n", data);
     return PARSEBADSYNTAX;
@@ -349,9 +359,9 @@ static errcode GetShaderMode(parsehandle * ph, SceneHandle scene) {
     if (!stringcmp(data, "END_SHADER_MODE")) {
       return rc;
     } else if (!stringcmp(data, "TRANS_VMD")) {
-      rt_trans_mode(scene, RT_TRANS_VMD);
+      sc_trans_mode(ph->cache, scene, RT_TRANS_VMD);
     } else if (!stringcmp(data, "FOG_VMD")) {
-      rt_fog_rendering_mode(scene, RT_FOG_VMD);
+      sc_fog_rendering_mode(ph->cache, scene, RT_FOG_VMD);
     } else if (!stringcmp(data, "AMBIENT_OCCLUSION")) {
       int aosamples;
       float aodirect;
@@ -366,8 +376,8 @@ static errcode GetShaderMode(parsehandle * ph, SceneHandle scene) {
       rc |= GetString(ph, "SAMPLES");
       fscanf(ph->ifp, "%d", &aosamples);
 
-      rt_rescale_lights(scene, aodirect);
-      rt_ambient_occlusion(scene, aosamples, aoambient);
+      sc_rescale_lights(ph->cache, scene, aodirect);
+      sc_ambient_occlusion(ph->cache, scene, aosamples, aoambient);
     } else {
       printf("Bad token '%s' while reading optional shader modes\n", data);
       return PARSEBADSYNTAX;
@@ -389,11 +399,11 @@ static errcode GetCamera(parsehandle * ph, SceneHandle scene) {
   if (stringcmp(data, "PROJECTION") == 0) {
     fscanf(ph->ifp, "%s", data);
     if (stringcmp(data, "FISHEYE") == 0) {
-      rt_camera_projection(scene, RT_PROJECTION_FISHEYE);
+      sc_camera_projection(ph->cache, scene, RT_PROJECTION_FISHEYE);
     } else if (stringcmp(data, "PERSPECTIVE") ==0) {
-      rt_camera_projection(scene, RT_PROJECTION_PERSPECTIVE);
+      sc_camera_projection(ph->cache, scene, RT_PROJECTION_PERSPECTIVE);
     } else if (stringcmp(data, "PERSPECTIVE_DOF") ==0) {
-      rt_camera_projection(scene, RT_PROJECTION_PERSPECTIVE_DOF);
+      sc_camera_projection(ph->cache, scene, RT_PROJECTION_PERSPECTIVE_DOF);
 
       rc |= GetString(ph, "FOCALLENGTH");
       fscanf(ph->ifp, "%f", &a);  
@@ -401,9 +411,9 @@ static errcode GetCamera(parsehandle * ph, SceneHandle scene) {
       rc |= GetString(ph, "APERTURE");
       fscanf(ph->ifp, "%f", &b);  
 
-      rt_camera_dof(scene, a, b);
+      sc_camera_dof(ph->cache, scene, a, b);
     } else if (stringcmp(data, "ORTHOGRAPHIC") ==0) {
-      rt_camera_projection(scene, RT_PROJECTION_ORTHOGRAPHIC);
+      sc_camera_projection(ph->cache, scene, RT_PROJECTION_ORTHOGRAPHIC);
     }
 
     rc |= GetString(ph, "ZOOM");
@@ -445,13 +455,13 @@ static errcode GetCamera(parsehandle * ph, SceneHandle scene) {
   Cup.y = b;
   Cup.z = c;
 
-  rt_camera_setup(scene, zoom, aspectratio, antialiasing, raydepth,
+  sc_camera_setup(ph->cache, scene, zoom, aspectratio, antialiasing, raydepth,
                   Ccenter, Cview, Cup);
 
   fscanf(ph->ifp, "%s", data);
   if (stringcmp(data, "FRUSTUM") == 0) {
     fscanf(ph->ifp, "%f %f %f %f", &a, &b, &c, &d);
-    rt_camera_frustum(scene, a, b, c, d);
+    sc_camera_frustum(ph->cache, scene, a, b, c, d);
     fscanf(ph->ifp, "%s", data);
     if (stringcmp(data, "END_CAMERA") != 0) {
       rc |= PARSEBADSYNTAX;
@@ -707,7 +717,7 @@ static errcode GetImageDef(parsehandle * ph, SceneHandle scene) {
   }
 
   if (rc == PARSENOERR) {
-    rt_define_image(texname, xres, yres, zres, rgb);
+    sc_define_image(ph->cache, texname, xres, yres, zres, rgb);
   }
 
   return rc;
@@ -899,9 +909,9 @@ void * GetTexBody(parsehandle * ph, SceneHandle scene, int modeflag) {
     tex.texturefunc = 0; /* set to none by default, gets reset anyway */
   }
 
-  voidtex = rt_texture(scene, &tex);
-  rt_tex_phong(voidtex, phong, phongexp, phongtype);
-  rt_tex_outline(voidtex, outline, outlinewidth);
+  voidtex = sc_texture(ph->cache, scene, &tex);
+  sc_tex_phong(ph->cache, voidtex, phong, phongexp, phongtype);
+  sc_tex_outline(ph->cache, voidtex, outline, outlinewidth);
 
   return voidtex;
 }
@@ -925,7 +935,8 @@ static errcode GetDirLight(parsehandle * ph, SceneHandle scene) {
     tex.col.g=g;
     tex.col.b=b;
 
-    rt_directional_light(scene, rt_texture(scene, &tex), dir);
+    sc_directional_light(ph->cache, scene,
+                         sc_texture(ph->cache, scene, &tex), dir);
   }
 
   return rc;
@@ -955,7 +966,8 @@ static errcode GetLight(parsehandle * ph, SceneHandle scene) {
     tex.col.g=g;
     tex.col.b=b;
 
-    li = rt_light(scene, rt_texture(scene, &tex), ctr, rad);
+    li = sc_light(ph->cache, scene, sc_texture(ph->cache, scene, &tex),
+                  ctr, rad);
   }
   else { 
     if (stringcmp(tmp, "ATTENUATION"))
@@ -972,9 +984,10 @@ static errcode GetLight(parsehandle * ph, SceneHandle scene) {
     Kq=a;
     rc |= GetColor(ph, &tex.col);
 
-    li = rt_light(scene, rt_texture(scene, &tex), ctr, rad);
+    li = sc_light(ph->cache, scene, sc_texture(ph->cache, scene, &tex),
+                  ctr, rad);
 
-    rt_light_attenuation(li, Kc, Kl, Kq);
+    sc_light_attenuation(ph->cache, li, Kc, Kl, Kq);
   } 
 
   return rc;
@@ -995,7 +1008,7 @@ static errcode GetSkyLight(parsehandle * ph, SceneHandle scene) {
   rc |= GetString(ph, "COLOR");
   fscanf(ph->ifp, "%f %f %f", &ambcol.r, &ambcol.g, &ambcol.b);
 
-  rt_ambient_occlusion(scene, numsamples, ambcol);
+  sc_ambient_occlusion(ph->cache, scene, numsamples, ambcol);
 
   return rc;
 }
@@ -1035,7 +1048,8 @@ static errcode GetSpotLight(parsehandle * ph, SceneHandle scene) {
     tex.col.g=g;
     tex.col.b=b;
 
-    li = rt_spotlight(scene, rt_texture(scene, &tex), ctr, rad, direction, start, end);
+    li = sc_spotlight(ph->cache, scene, sc_texture(ph->cache, scene, &tex),
+                      ctr, rad, direction, start, end);
   } 
   else {
     if (stringcmp(tmp, "ATTENUATION"))
@@ -1051,8 +1065,9 @@ static errcode GetSpotLight(parsehandle * ph, SceneHandle scene) {
     Kq=a;
     rc |= GetColor(ph, &tex.col);
 
-    li = rt_spotlight(scene, rt_texture(scene, &tex), ctr, rad, direction, start, end);
-    rt_light_attenuation(li, Kc, Kl, Kq);
+    li = sc_spotlight(ph->cache, scene, sc_texture(ph->cache, scene, &tex),
+                      ctr, rad, direction, start, end);
+    sc_light_attenuation(ph->cache, li, Kc, Kl, Kq);
   }
 
   return rc;
@@ -1067,13 +1082,13 @@ static errcode GetFog(parsehandle * ph, SceneHandle scene) {
  
   fscanf(ph->ifp, "%s", tmp); 
   if (!stringcmp(tmp, "LINEAR")) {
-    rt_fog_mode(scene, RT_FOG_LINEAR);
+    sc_fog_mode(ph->cache, scene, RT_FOG_LINEAR);
   } else if (!stringcmp(tmp, "EXP")) {
-    rt_fog_mode(scene, RT_FOG_EXP);
+    sc_fog_mode(ph->cache, scene, RT_FOG_EXP);
   } else if (!stringcmp(tmp, "EXP2")) {
-    rt_fog_mode(scene, RT_FOG_EXP2);
+    sc_fog_mode(ph->cache, scene, RT_FOG_EXP2);
   } else if (!stringcmp(tmp, "OFF")) {
-    rt_fog_mode(scene, RT_FOG_NONE);
+    sc_fog_mode(ph->cache, scene, RT_FOG_NONE);
   }
 
   rc |= GetString(ph, "START");
@@ -1087,7 +1102,7 @@ static errcode GetFog(parsehandle * ph, SceneHandle scene) {
 
   rc |= GetColor(ph, &fogcol);
 
-  rt_fog_parms(scene, fogcol, start, end, density);
+  sc_fog_parms(ph->cache, scene, fogcol, start, end, density);
 
   return PARSENOERR;
 }
@@ -1102,7 +1117,7 @@ static errcode GetBackGnd(parsehandle * ph, SceneHandle scene) {
   scenebackcol.r=r;
   scenebackcol.g=g;
   scenebackcol.b=b;
-  rt_background(scene, scenebackcol);
+  sc_background(ph->cache, scene, scenebackcol);
 
   return PARSENOERR;
 }
@@ -1124,7 +1139,7 @@ static errcode GetCylinder(parsehandle * ph, SceneHandle scene) {
   rad=a;
 
   rc |= GetTexture(ph, scene, &tex);
-  rt_cylinder(scene, tex, ctr, axis, rad); 
+  sc_cylinder(ph->cache, scene, tex, ctr, axis, rad); 
 
   return rc;
 }
@@ -1153,7 +1168,7 @@ static errcode GetFCylinder(parsehandle * ph, SceneHandle scene) {
   rad=a;
 
   rc |= GetTexture(ph, scene, &tex);
-  rt_fcylinder(scene, tex, ctr, axis, rad); 
+  sc_fcylinder(ph->cache, scene, tex, ctr, axis, rad); 
 
   return rc;
 }
@@ -1180,7 +1195,7 @@ static errcode GetPolyCylinder(parsehandle * ph, SceneHandle scene) {
   rad=a;
 
   rc |= GetTexture(ph, scene, &tex);
-  rt_polycylinder(scene, tex, temp, numpts, rad); 
+  sc_polycylinder(ph->cache, scene, tex, temp, numpts, rad); 
 
   free(temp);
 
@@ -1203,7 +1218,7 @@ static errcode GetSphere(parsehandle * ph, SceneHandle scene) {
 
   rc |= GetTexture(ph, scene, &tex); 
  
-  rt_sphere(scene, tex, ctr, rad);
+  sc_sphere(ph->cache, scene, tex, ctr, rad);
 
   return rc;
 }
@@ -1220,7 +1235,7 @@ static errcode GetPlane(parsehandle * ph, SceneHandle scene) {
   rc |= GetVector(ph, &normal);
   rc |= GetTexture(ph, scene, &tex);
 
-  rt_plane(scene, tex, ctr, normal);
+  sc_plane(ph->cache, scene, tex, ctr, normal);
 
   return rc;
 }
@@ -1242,7 +1257,7 @@ static errcode GetVol(parsehandle * ph, SceneHandle scene) {
   fscanf(ph->ifp, "%s", fname);  
   rc |= GetTexture(ph, scene, &tex);
  
-  rt_scalarvol(scene, tex, min, max, x, y, z, fname, NULL); 
+  sc_scalarvol(ph->cache, scene, tex, min, max, x, y, z, fname); 
 
   return rc;
 }
@@ -1258,7 +1273,7 @@ static errcode GetBox(parsehandle * ph, SceneHandle scene) {
   rc |= GetVector(ph, &max);
   rc |= GetTexture(ph, scene, &tex);
 
-  rt_box(scene, tex, min, max);
+  sc_box(ph->cache, scene, tex, min, max);
 
   return rc;
 }
@@ -1280,7 +1295,7 @@ static errcode GetRing(parsehandle * ph, SceneHandle scene) {
   fscanf(ph->ifp, " %f ", &b);
   rc |= GetTexture(ph, scene, &tex);
  
-  rt_ring(scene, tex, ctr, normal, a, b);
+  sc_ring(ph->cache, scene, tex, ctr, normal, a, b);
 
   return rc;
 }
@@ -1301,7 +1316,7 @@ static errcode GetTri(parsehandle * ph, SceneHandle scene) {
 
   rc |= GetTexture(ph, scene, &tex);
 
-  rt_tri(scene, tex, v0, v1, v2);
+  sc_tri(ph->cache, scene, tex, v0, v1, v2);
 
   return rc;
 }
@@ -1331,7 +1346,7 @@ static errcode GetSTri(parsehandle * ph, SceneHandle scene) {
 
   rc |= GetTexture(ph, scene, &tex);
   
-  rt_stri(scene, tex, v0, v1, v2, n0, n1, n2);
+  sc_stri(ph->cache, scene, tex, v0, v1, v2, n0, n1, n2);
 
   return rc;
 }
@@ -1382,7 +1397,7 @@ static errcode GetVCSTri(parsehandle * ph, SceneHandle scene) {
 
   tex = GetTexBody(ph, scene, 1);
   
-  rt_vcstri(scene, tex, v0, v1, v2, n0, n1, n2, c0, c1, c2);
+  sc_vcstri(ph->cache, scene, tex, v0, v1, v2, n0, n1, n2, c0, c1, c2);
 
   return rc;
 }
@@ -1390,7 +1405,7 @@ static errcode GetVCSTri(parsehandle * ph, SceneHandle scene) {
 
 static errcode GetVertexArray(parsehandle * ph, SceneHandle scene) {
   char arraytype[1024];
-  int done, i, texusecount;
+  int done, i;
   int vertexcount=0;
   errcode rc=PARSENOERR;
   void * tex=NULL;
@@ -1434,7 +1449,6 @@ static errcode GetVertexArray(parsehandle * ph, SceneHandle scene) {
   /* use the default texture until we parse a subsequent texture command */
   tex = ph->defaulttex.tex; 
 
-  texusecount=1;
   done = 0;
   while (!done) {
     /* read vertex colors */
@@ -1468,12 +1482,12 @@ static errcode GetVertexArray(parsehandle * ph, SceneHandle scene) {
         rc |=  PARSEBADSYNTAX;
         done = 1;
       }
-      texusecount=0;
     } else if (!stringcmp(arraytype, "TRISTRIP")) {
       int t;
       int numv=0;
       int stripaddr[2][3] = { {0, 1, 2}, {1, 0, 2} };
       int * facets=NULL;
+      int * tris=NULL;
 
       rc |= GetInt(ph, &numv);
       if (rc!= PARSENOERR)
@@ -1484,13 +1498,15 @@ static errcode GetVertexArray(parsehandle * ph, SceneHandle scene) {
         fscanf(ph->ifp, "%d", &facets[i]); 
       }
 
-      /* render triangle strips one triangle at a time        */
+      /* turn the triangle strip into an indexed mesh         */
       /* triangle winding order is:                           */
       /*   v0, v1, v2, then v2, v1, v3, then v2, v3, v4, etc. */
+      if (numv > 2)
+        tris = (int *) malloc((numv - 2) * 3 * sizeof(int));
 
       /* loop over all triangles in this triangle strip       */
       for (t=0; t < (numv - 2); t++) {
-        /* render one triangle, using lookup table to fix winding order */
+        /* use lookup table to fix winding order */
         int v0 = facets[t + (stripaddr[t & 0x01][0])];
         int v1 = facets[t + (stripaddr[t & 0x01][1])];
         int v2 = facets[t + (stripaddr[t & 0x01][2])];
@@ -1498,33 +1514,9 @@ static errcode GetVertexArray(parsehandle * ph, SceneHandle scene) {
         if ((v0 >= 0) && (v0 < vertexcount) &&
             (v1 >= 0) && (v1 < vertexcount) &&
             (v2 >= 0) && (v2 < vertexcount)) {
-          v0 *= 3;
-          v1 *= 3;
-          v2 *= 3;
-
-          if (c != NULL) {
-            if (texusecount > 0)
-              tex = rt_texture_copy_vcstri(scene, tex); /* create a new one */
-
-            rt_vcstri(scene, tex, 
-                      rt_vector(v[v0], v[v0 + 1], v[v0 + 2]),
-                      rt_vector(v[v1], v[v1 + 1], v[v1 + 2]),
-                      rt_vector(v[v2], v[v2 + 1], v[v2 + 2]),
-                      rt_vector(n[v0], n[v0 + 1], n[v0 + 2]),
-                      rt_vector(n[v1], n[v1 + 1], n[v1 + 2]),
-                      rt_vector(n[v2], n[v2 + 1], n[v2 + 2]),
-                       rt_color(c[v0], c[v0 + 1], c[v0 + 2]),
-                       rt_color(c[v1], c[v1 + 1], c[v1 + 2]),
-                       rt_color(c[v2], c[v2 + 1], c[v2 + 2]));
-          } else {
-            rt_stri(scene, tex, 
-                    rt_vector(v[v0], v[v0 + 1], v[v0 + 2]),
-                    rt_vector(v[v1], v[v1 + 1], v[v1 + 2]),
-                    rt_vector(v[v2], v[v2 + 1], v[v2 + 2]),
-                    rt_vector(n[v0], n[v0 + 1], n[v0 + 2]),
-                    rt_vector(n[v1], n[v1 + 1], n[v1 + 2]),
-                    rt_vector(n[v2], n[v2 + 1], n[v2 + 2]));
-          }
+          tris[t*3    ] = v0;
+          tris[t*3 + 1] = v1;
+          tris[t*3 + 2] = v2;
         } else {
           printf("tristrip error: skipping invalid strip vertex %d\n", t);
           printf("  vertexcount: %d\n", vertexcount);
@@ -1533,10 +1525,15 @@ static errcode GetVertexArray(parsehandle * ph, SceneHandle scene) {
           done = 1;
           break;
         }
-
-        texusecount++; /* don't reuse textures */
       }
 
+      /* the mesh copies the vertex data and any colored texture */
+      if (!done && numv > 2)
+        sc_trimesh(ph->cache, scene, tex, vertexcount, v, n, c,
+                   numv - 2, tris);
+
+      if (tris != NULL)
+        free(tris);
       free(facets);
     } else if (!stringcmp(arraytype, "TRIMESH")) {
       int numfacets=0;
@@ -1551,43 +1548,15 @@ static errcode GetVertexArray(parsehandle * ph, SceneHandle scene) {
         fscanf(ph->ifp, "%d %d %d", &facets[i], &facets[i+1], &facets[i+2]); 
       }
 
-      /* loop over all triangles in this mesh */
+      /* check all triangles in this mesh */
       for (i=0; i < numfacets*3; i+=3) {
         int v0 = facets[i    ];
         int v1 = facets[i + 1];
         int v2 = facets[i + 2];
 
-
-        if ((v0 >= 0) && (v0 < vertexcount) &&
-            (v1 >= 0) && (v1 < vertexcount) &&
-            (v2 >= 0) && (v2 < vertexcount)) {
-          v0 *= 3;
-          v1 *= 3;
-          v2 *= 3;
-
-          if (c != NULL) {
-            if (texusecount > 0)
-              tex = rt_texture_copy_vcstri(scene, tex); /* create a new one */
-            rt_vcstri(scene, tex, 
-                      rt_vector(v[v0], v[v0 + 1], v[v0 + 2]),
-                      rt_vector(v[v1], v[v1 + 1], v[v1 + 2]),
-                      rt_vector(v[v2], v[v2 + 1], v[v2 + 2]),
-                      rt_vector(n[v0], n[v0 + 1], n[v0 + 2]),
-                      rt_vector(n[v1], n[v1 + 1], n[v1 + 2]),
-                      rt_vector(n[v2], n[v2 + 1], n[v2 + 2]),
-                      rt_color(c[v0], c[v0 + 1], c[v0 + 2]),
-                      rt_color(c[v1], c[v1 + 1], c[v1 + 2]),
-                      rt_color(c[v2], c[v2 + 1], c[v2 + 2]));
-          } else {
-            rt_stri(scene, tex, 
-                    rt_vector(v[v0], v[v0 + 1], v[v0 + 2]),
-                    rt_vector(v[v1], v[v1 + 1], v[v1 + 2]),
-                    rt_vector(v[v2], v[v2 + 1], v[v2 + 2]),
-                    rt_vector(n[v0], n[v0 + 1], n[v0 + 2]),
-                    rt_vector(n[v1], n[v1 + 1], n[v1 + 2]),
-                    rt_vector(n[v2], n[v2 + 1], n[v2 + 2]));
-          }
-        } else {
+        if (!((v0 >= 0) && (v0 < vertexcount) &&
+              (v1 >= 0) && (v1 < vertexcount) &&
+              (v2 >= 0) && (v2 < vertexcount))) {
           printf("trimesh error: skipping invalid vertex in facet %d\n", i/3);
           printf("  numfacets: %d  vertexcount: %d\n", numfacets, vertexcount);
           printf("  verts: %d %d %d\n", v0, v1, v2);
@@ -1595,10 +1564,13 @@ static errcode GetVertexArray(parsehandle * ph, SceneHandle scene) {
           done = 1;
           break;
         }
-
-        texusecount++; /* don't reuse textures */
       }
 
+      /* the mesh copies the vertex data and any colored texture */
+      if (!done)
+        sc_trimesh(ph->cache, scene, tex, vertexcount, v, n, c,
+                   numfacets, facets);
+
       free(facets);
     } else if (!stringcmp(arraytype, "END_VERTEXARRAY")) {
       done = 1;
@@ -1645,7 +1617,7 @@ static errcode GetLandScape(parsehandle * ph, SceneHandle scene) {
 
   rc |= GetTexture(ph, scene, &tex);
 
-  rt_landscape(scene, tex, m, n, ctr, wx, wy);
+  sc_landscape(ph->cache, scene, tex, m, n, ctr, wx, wy);
 
   return rc;
 }
@@ -1686,6 +1658,7 @@ static errcode GetTPolyFile(parsehandle * ph, SceneHandle scene) {
     printf("Can't open data file %s for input!! Aborting...\n", ifname);
     return PARSEBADSUBFILE;
   }
+  sc_depend(ph->cache, ifname);
 
   while (!feof(ifp)) {
     fscanf(ifp, "%d", &v);
@@ -1710,7 +1683,7 @@ static errcode GetTPolyFile(parsehandle * ph, SceneHandle scene) {
     Trans3d(&ctr, &v1);
     Trans3d(&ctr, &v2);
 
-    rt_tri(scene, tex, v1, v0, v2);
+    sc_tri(ph->cache, scene, tex, v1, v0, v2);
   }
 
   fclose(ifp);
@@ -1740,7 +1713,7 @@ static errcode GetClipGroup(parsehandle * ph, SceneHandle scene) {
         return PARSEBADSYNTAX;
     } 
 
-    rt_clip_fv(scene, numplanes, planes);
+    sc_clip_fv(ph->cache, scene, numplanes, planes);
     free(planes);
 
     return PARSENOERR;
@@ -1751,7 +1724,7 @@ static errcode GetClipGroup(parsehandle * ph, SceneHandle scene) {
 
 
 static errcode GetClipGroupEnd(parsehandle * ph, SceneHandle scene) {
-  rt_clip_off(scene);
+  sc_clip_off(ph->cache, scene);
   return PARSENOERR;
 }
 
@@ -1761,6 +1734,7 @@ static errcode GetMGFFile(parsehandle * ph, SceneHandle scene) {
   char ifname[255];
 
   fscanf(ph->ifp, "%s", ifname); /* get MGF filename */
+  sc_uncacheable(ph->cache);     /* its objects aren't recorded */
   if (ParseMGF(ifname, scene, 0) == MGF_NOERR)
     return PARSENOERR;
   
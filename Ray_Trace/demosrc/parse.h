@@ -12,6 +12,7 @@
 #define PARSEALLOCERR    16
  
 unsigned int readmodel(const char *, SceneHandle);
+unsigned int recordmodel(const char *, SceneHandle, void * cache);
 
 #ifdef PARSE_INTERNAL
 #define TEXNAMELEN 255
@@ -30,6 +31,7 @@ typedef struct {
   int maxtextures;       /* number of TEXDEF textures               */
   int numobjectsparsed;  /* total number of objects parsed so far   */
   rt_hash_t texhash;     /* hash table for texture name lookup      */
+  void * cache;          /* scene cache being recorded, or NULL     */
 } parsehandle;  
 
 typedef struct {
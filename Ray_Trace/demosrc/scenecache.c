@@ -0,0 +1,1509 @@
+/*
+ * scenecache.c - binary caches of parsed Tachyon scene files
+ *
+ * The parser makes its API calls through the sc_ functions below, which
+ * make the call and, while a cache is being recorded, append it to the
+ * cache's call stream.  Replaying the stream makes the same calls with
+ * the same arguments, so the scene comes out exactly as parsed, without
+ * reading any text.  The file is mapped rather than read, and large
+ * arrays such as mesh vertices are handed to the library in place.
+ *
+ *  $Id$
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_MSC_VER) || defined(WIN32)
+#define SC_NOMMAP   /* read the file into memory instead */
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include "tachyon.h"
+#include "parse.h"
+
+#define SCENECACHE_PRIVATE
+#include "scenecache.h"
+
+/* true while calls are being recorded */
+#define RECORDING(sc) ((sc) != NULL && !(sc)->uncacheable)
+
+/* slot of a handle in a table of size entries, a power of two */
+#define PTRHASH(ptr, size) \
+  ((int) ((((size_t) (ptr)) >> 3) * 2654435761U) & ((size) - 1))
+
+static const char sc_magic[8] = "TACHYSC";
+static const char sc_pad[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+
+/*
+ * Writing the call stream
+ */
+
+static void sc_put(scenecache * sc, const void * data, size_t len) {
+  unsigned char * newbuf;
+  size_t newmax;
+
+  if (sc->len + len > sc->max) {
+    newmax = (sc->max > 0) ? sc->max : 65536;
+    while (sc->len + len > newmax)
+      newmax *= 2;
+
+    if (sc->max > 0) {
+      newbuf = (unsigned char *) realloc(sc->buf, newmax);
+    } else {
+      /* a loaded stream is copied out of the map before it grows */
+      newbuf = (unsigned char *) malloc(newmax);
+      if (newbuf != NULL && sc->len > 0)
+        memcpy(newbuf, sc->buf, sc->len);
+    }
+
+    if (newbuf == NULL) {
+      printf("Scene cache: out of memory, not caching this scene.\n");
+      sc->uncacheable = 1;
+      return;
+    }
+    sc->buf = newbuf;
+    sc->max = newmax;
+  }
+
+  memcpy(sc->buf + sc->len, data, len);
+  sc->len += len;
+}
+
+static void put_int(scenecache * sc, int i) {
+  sc_put(sc, &i, sizeof(int));
+}
+
+static void put_flt(scenecache * sc, apiflt f) {
+  sc_put(sc, &f, sizeof(apiflt));
+}
+
+static void put_vec(scenecache * sc, apivector v) {
+  sc_put(sc, &v, sizeof(apivector));
+}
+
+static void put_col(scenecache * sc, apicolor c) {
+  sc_put(sc, &c, sizeof(apicolor));
+}
+
+/* len bytes of data, or NULL, aligned to 8 bytes */
+static void put_array(scenecache * sc, const void * data, int len) {
+  put_int(sc, (data != NULL) ? len : -1);
+  if (data != NULL) {
+    sc_put(sc, sc_pad, (8 - sc->len % 8) % 8);
+    sc_put(sc, data, len);
+  }
+}
+
+static void put_string(scenecache * sc, const char * s) {
+  put_array(sc, s, strlen(s) + 1);
+}
+
+/* number a handle returned by the library */
+static void new_handle(scenecache * sc, void * ptr) {
+  schandle * newhash;
+  int i, j, newsize;
+
+  if (2 * (sc->numhandles + 1) > sc->hashsize) {
+    newsize = (sc->hashsize > 0) ? 2 * sc->hashsize : 1024;
+    newhash = (schandle *) calloc(newsize, sizeof(schandle));
+    if (newhash == NULL) {
+      sc->uncacheable = 1;
+      return;
+    }
+    for (j=0; j<sc->hashsize; j++) {
+      if (sc->hash[j].ptr != NULL) {
+        i = PTRHASH(sc->hash[j].ptr, newsize);
+        while (newhash[i].ptr != NULL)
+          i = (i + 1) & (newsize - 1);
+        newhash[i] = sc->hash[j];
+      }
+    }
+    free(sc->hash);
+    sc->hash = newhash;
+    sc->hashsize = newsize;
+  }
+
+  if (ptr != NULL) {
+    i = PTRHASH(ptr, sc->hashsize);
+    while (sc->hash[i].ptr != NULL)
+      i = (i + 1) & (sc->hashsize - 1);
+    sc->hash[i].ptr = ptr;
+    sc->hash[i].idx = sc->numhandles;
+  }
+  sc->numhandles++;
+}
+
+/* store a handle by its number, -1 for NULL */
+static void put_handle(scenecache * sc, void * ptr) {
+  int i, idx;
+
+  idx = -1;
+  if (ptr != NULL && sc->hashsize > 0) {
+    i = PTRHASH(ptr, sc->hashsize);
+    while (sc->hash[i].ptr != NULL) {
+      if (sc->hash[i].ptr == ptr) {
+        idx = sc->hash[i].idx;
+        break;
+      }
+      i = (i + 1) & (sc->hashsize - 1);
+    }
+  }
+
+  /* a handle the recording didn't see being made can't be replayed */
+  if (ptr != NULL && idx < 0)
+    sc->uncacheable = 1;
+
+  put_int(sc, idx);
+}
+
+
+/*
+ * Reading the call stream
+ */
+
+static void sc_get(scenecache * sc, void * data, size_t len) {
+  if (sc->bad || sc->pos + len > sc->len) {
+    sc->bad = 1;
+    memset(data, 0, len);
+    return;
+  }
+  memcpy(data, sc->buf + sc->pos, len);
+  sc->pos += len;
+}
+
+static int get_int(scenecache * sc) {
+  int i;
+  sc_get(sc, &i, sizeof(int));
+  return i;
+}
+
+static apiflt get_flt(scenecache * sc) {
+  apiflt f;
+  sc_get(sc, &f, sizeof(apiflt));
+  return f;
+}
+
+static apivector get_vec(scenecache * sc) {
+  apivector v;
+  sc_get(sc, &v, sizeof(apivector));
+  return v;
+}
+
+static apicolor get_col(scenecache * sc) {
+  apicolor c;
+  sc_get(sc, &c, sizeof(apicolor));
+  return c;
+}
+
+/* an array in place in the stream, NULL if none was stored */
+static const void * get_array(scenecache * sc, int * len) {
+  const void * data;
+  int n;
+
+  *len = 0;
+  n = get_int(sc);
+  if (n < 0 || sc->bad)
+    return NULL;
+
+  sc->pos += (8 - sc->pos % 8) % 8;
+  if (sc->pos + n > sc->len) {
+    sc->bad = 1;
+    return NULL;
+  }
+  data = sc->buf + sc->pos;
+  sc->pos += n;
+  *len = n;
+  return data;
+}
+
+static const char * get_string(scenecache * sc) {
+  const char * s;
+  int len;
+
+  s = (const char *) get_array(sc, &len);
+  if (s == NULL || len < 1 || s[len - 1] != '\0') {
+    sc->bad = 1;
+    return "";
+  }
+  return s;
+}
+
+static void add_handle(scenecache * sc, void * ptr) {
+  void ** newhandles;
+  int newmax;
+
+  if (sc->numhandles >= sc->maxhandles) {
+    newmax = (sc->maxhandles > 0) ? 2 * sc->maxhandles : 1024;
+    newhandles = (void **) realloc(sc->handles, newmax * sizeof(void *));
+    if (newhandles == NULL) {
+      sc->bad = 1;
+      return;
+    }
+    sc->handles = newhandles;
+    sc->maxhandles = newmax;
+  }
+  sc->handles[sc->numhandles++] = ptr;
+}
+
+static void * get_handle(scenecache * sc) {
+  int i = get_int(sc);
+
+  if (i < 0)
+    return NULL;
+  if (i >= sc->numhandles) {
+    sc->bad = 1;
+    return NULL;
+  }
+  return sc->handles[i];
+}
+
+
+/*
+ * FNV-1a hash of a file, with its size (-1 if it can't be read) and time.
+ * Times only have whole seconds, so a file written in the second it was
+ * hashed could change again without its time moving; its time is given
+ * as -1 instead, which never matches and makes the next load hash it.
+ */
+static unsigned int sc_hashfile(const char * filename, double * size,
+                                double * mtime) {
+  unsigned char buf[16384];
+  unsigned int h = 2166136261U;
+  struct stat st;
+  time_t now;
+  size_t i, n;
+  FILE * ifp;
+
+  *size = -1.0;
+  now = time(NULL);
+  if (stat(filename, &st) != 0 || (ifp = fopen(filename, "rb")) == NULL)
+    return 0;
+
+  while ((n = fread(buf, 1, sizeof(buf), ifp)) > 0) {
+    for (i=0; i<n; i++)
+      h = (h ^ buf[i]) * 16777619U;
+  }
+  fclose(ifp);
+
+  *size = (double) st.st_size;
+  *mtime = (st.st_mtime >= now - 1) ? -1.0 : (double) st.st_mtime;
+  return h;
+}
+
+void sc_depend(void * cache, const char * filename) {
+  scenecache * sc = (scenecache *) cache;
+  scdepend d, * newdeps;
+  char ** newnames;
+  int i;
+
+  if (!RECORDING(sc))
+    return;
+
+  for (i=0; i<sc->numdeps; i++) {
+    if (!strcmp(sc->depnames[i], filename))
+      return;
+  }
+
+  memset(&d, 0, sizeof(d));
+  d.hash = sc_hashfile(filename, &d.size, &d.mtime);
+  newdeps = (scdepend *) realloc(sc->deps,
+                                 (sc->numdeps + 1) * sizeof(scdepend));
+  if (newdeps != NULL)
+    sc->deps = newdeps;
+  newnames = (char **) realloc(sc->depnames,
+                               (sc->numdeps + 1) * sizeof(char *));
+  if (newnames != NULL)
+    sc->depnames = newnames;
+  if (d.size < 0.0 || newdeps == NULL || newnames == NULL) {
+    sc->uncacheable = 1;
+    return;
+  }
+
+  sc->deps[sc->numdeps] = d;
+  sc->depnames[sc->numdeps] = (char *) malloc(strlen(filename) + 1);
+  strcpy(sc->depnames[sc->numdeps], filename);
+  sc->numdeps++;
+}
+
+void sc_uncacheable(void * cache) {
+  scenecache * sc = (scenecache *) cache;
+
+  if (sc != NULL)
+    sc->uncacheable = 1;
+}
+
+
+/*
+ * Map a cache file and check that it was written by this build for the
+ * same files as the scene's, leaving sc->buf at the call stream.  Files
+ * that were touched but have the same contents mark the cache stale, so
+ * it's written again with their new times.
+ */
+static int sc_load(scenecache * sc, const char * modelfile) {
+  scheader hdr;
+  scdepend d;
+  struct stat st;
+  const char * name;
+  double size, mtime;
+  unsigned int hash;
+  int i, ok;
+
+#ifdef SC_NOMMAP
+  FILE * ifp;
+
+  if ((ifp = fopen(sc->cachefile, "rb")) == NULL)
+    return 0;
+  fseek(ifp, 0, SEEK_END);
+  sc->maplen = ftell(ifp);
+  fseek(ifp, 0, SEEK_SET);
+  sc->map = (unsigned char *) malloc(sc->maplen);
+  if (sc->map == NULL || fread(sc->map, 1, sc->maplen, ifp) != sc->maplen) {
+    fclose(ifp);
+    sc_reset(sc);
+    return 0;
+  }
+  fclose(ifp);
+#else
+  void * map;
+  int fd;
+
+  if ((fd = open(sc->cachefile, O_RDONLY)) < 0)
+    return 0;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(scheader)) {
+    close(fd);
+    return 0;
+  }
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return 0;
+  sc->map = (unsigned char *) map;
+  sc->maplen = st.st_size;
+#endif
+
+  sc->buf = sc->map;
+  sc->len = sc->maplen;
+  sc->pos = 0;
+  sc_get(sc, &hdr, sizeof(hdr));
+  if (sc->bad || memcmp(hdr.magic, sc_magic, sizeof(sc_magic)) ||
+      hdr.version != SCENECACHE_VERSION || hdr.byteorder != 0x01020304 ||
+      hdr.fltsize != sizeof(apiflt) || hdr.length != (double) sc->maplen ||
+      hdr.numdeps < 1) {
+    printf("Ignoring scene cache %s, incomplete or from another build.\n",
+           sc->cachefile);
+    sc_reset(sc);
+    return 0;
+  }
+
+  sc->deps = (scdepend *) calloc(hdr.numdeps, sizeof(scdepend));
+  sc->depnames = (char **) calloc(hdr.numdeps, sizeof(char *));
+  ok = 1;
+  for (i=0; i<hdr.numdeps && ok; i++) {
+    sc_get(sc, &d, sizeof(d));
+    name = (const char *) sc->buf + sc->pos;
+    if (sc->bad || d.namelen < 1 || sc->pos + d.namelen > sc->len ||
+        name[d.namelen - 1] != '\0') {
+      ok = 0;
+      break;
+    }
+    sc->pos += d.namelen;
+
+    sc->deps[i] = d;
+    sc->depnames[i] = (char *) malloc(strlen(name) + 1);
+    strcpy(sc->depnames[i], name);
+    sc->numdeps++;
+
+    if ((i == 0 && strcmp(name, modelfile)) || stat(name, &st) != 0 ||
+        (double) st.st_size != d.size) {
+      ok = 0;
+    } else if ((double) st.st_mtime != d.mtime) {
+      hash = sc_hashfile(name, &size, &mtime);
+      if (hash != d.hash || size != d.size) {
+        ok = 0;
+      } else {
+        sc->deps[i].mtime = mtime;
+        if (mtime != d.mtime)
+          sc->stale = 1;
+      }
+    }
+  }
+
+  if (!ok) {
+    printf("Scene cache %s is out of date, parsing %s.\n",
+           sc->cachefile, modelfile);
+    sc_reset(sc);
+    return 0;
+  }
+
+  sc->buf = sc->map + sc->pos;
+  sc->len = sc->maplen - sc->pos;
+  sc->pos = 0;
+  return 1;
+}
+
+
+/* make the recorded calls, returns 0 if the stream is damaged */
+static int sc_replay(scenecache * sc, SceneHandle scene) {
+  apivector v0, v1, v2, n0, n1, n2;
+  apicolor c0, c1, c2;
+  apiflt f0, f1, f2, f3;
+  apitexture apitex;
+  const void * d0, * d1, * d2, * d3;
+  const char * name;
+  void * tex;
+  int op, i0, i1, i2, l0, l1, l2, l3;
+  size_t opstart;
+
+  for (;;) {
+    opstart = sc->pos;
+    op = get_int(sc);
+    if (sc->bad)
+      return 0;
+
+    switch (op) {
+      case SC_END:
+        /* appending starts over the end marker */
+        sc->len = opstart;
+        return 1;
+
+      case SC_TEXTURE:
+        sc_get(sc, &apitex, sizeof(apitexture));
+        if (!sc->bad)
+          add_handle(sc, rt_texture(scene, &apitex));
+        break;
+
+      case SC_TEX_PHONG:
+        tex = get_handle(sc);
+        f0 = get_flt(sc);
+        f1 = get_flt(sc);
+        i0 = get_int(sc);
+        if (!sc->bad)
+          rt_tex_phong(tex, f0, f1, i0);
+        break;
+
+      case SC_TEX_OUTLINE:
+        tex = get_handle(sc);
+        f0 = get_flt(sc);
+        f1 = get_flt(sc);
+        if (!sc->bad)
+          rt_tex_outline(tex, f0, f1);
+        break;
+
+      case SC_DEFINE_IMAGE:
+        name = get_string(sc);
+        i0 = get_int(sc);
+        i1 = get_int(sc);
+        i2 = get_int(sc);
+        d0 = get_array(sc, &l0);
+        if (d0 == NULL || l0 != i0 * i1 * i2 * 3)
+          sc->bad = 1;
+        if (!sc->bad) {
+          /* the library keeps the image, so it can't stay in the map */
+          unsigned char * rgb = (unsigned char *) malloc(l0);
+          memcpy(rgb, d0, l0);
+          rt_define_image(name, i0, i1, i2, rgb);
+        }
+        break;
+
+      case SC_OUTPUTFILE:
+        name = get_string(sc);
+        if (!sc->bad)
+          rt_outputfile(scene, name);
+        break;
+
+      case SC_RESOLUTION:
+        i0 = get_int(sc);
+        i1 = get_int(sc);
+        if (!sc->bad)
+          rt_resolution(scene, i0, i1);
+        break;
+
+      case SC_VERBOSE:
+        i0 = get_int(sc);
+        if (!sc->bad)
+          rt_verbose(scene, i0);
+        break;
+
+      case SC_SHADERMODE:
+        i0 = get_int(sc);
+        if (!sc->bad)
+          rt_shadermode(scene, i0);
+        break;
+
+      case SC_TRANS_MODE:
+        i0 = get_int(sc);
+        if (!sc->bad)
+          rt_trans_mode(scene, i0);
+        break;
+
+      case SC_FOG_RENDERING_MODE:
+        i0 = get_int(sc);
+        if (!sc->bad)
+          rt_fog_rendering_mode(scene, i0);
+        break;
+
+      case SC_FOG_MODE:
+        i0 = get_int(sc);
+        if (!sc->bad)
+          rt_fog_mode(scene, i0);
+        break;
+
+      case SC_FOG_PARMS:
+        c0 = get_col(sc);
+        f0 = get_flt(sc);
+        f1 = get_flt(sc);
+        f2 = get_flt(sc);
+        if (!sc->bad)
+          rt_fog_parms(scene, c0, f0, f1, f2);
+        break;
+
+      case SC_BACKGROUND:
+        c0 = get_col(sc);
+        if (!sc->bad)
+          rt_background(scene, c0);
+        break;
+
+      case SC_RESCALE_LIGHTS:
+        f0 = get_flt(sc);
+        if (!sc->bad)
+          rt_rescale_lights(scene, f0);
+        break;
+
+      case SC_AMBIENT_OCCLUSION:
+        i0 = get_int(sc);
+        c0 = get_col(sc);
+        if (!sc->bad)
+          rt_ambient_occlusion(scene, i0, c0);
+        break;
+
+      case SC_CAMERA_SETUP:
+        f0 = get_flt(sc);
+        f1 = get_flt(sc);
+        i0 = get_int(sc);
+        i1 = get_int(sc);
+        v0 = get_vec(sc);
+        v1 = get_vec(sc);
+        v2 = get_vec(sc);
+        if (!sc->bad)
+          rt_camera_setup(scene, f0, f1, i0, i1, v0, v1, v2);
+        break;
+
+      case SC_CAMERA_PROJECTION:
+        i0 = get_int(sc);
+        if (!sc->bad)
+          rt_camera_projection(scene, i0);
+        break;
+
+      case SC_CAMERA_DOF:
+        f0 = get_flt(sc);
+        f1 = get_flt(sc);
+        if (!sc->bad)
+          rt_camera_dof(scene, f0, f1);
+        break;
+
+      case SC_CAMERA_FRUSTUM:
+        f0 = get_flt(sc);
+        f1 = get_flt(sc);
+        f2 = get_flt(sc);
+        f3 = get_flt(sc);
+        if (!sc->bad)
+          rt_camera_frustum(scene, f0, f1, f2, f3);
+        break;
+
+      case SC_LIGHT:
+        tex = get_handle(sc);
+        v0 = get_vec(sc);
+        f0 = get_flt(sc);
+        if (!sc->bad)
+          add_handle(sc, rt_light(scene, tex, v0, f0));
+        break;
+
+      case SC_DIRECTIONAL_LIGHT:
+        tex = get_handle(sc);
+        v0 = get_vec(sc);
+        if (!sc->bad)
+          add_handle(sc, rt_directional_light(scene, tex, v0));
+        break;
+
+      case SC_SPOTLIGHT:
+        tex = get_handle(sc);
+        v0 = get_vec(sc);
+        f0 = get_flt(sc);
+        v1 = get_vec(sc);
+        f1 = get_flt(sc);
+        f2 = get_flt(sc);
+        if (!sc->bad)
+          add_handle(sc, rt_spotlight(scene, tex, v0, f0, v1, f1, f2));
+        break;
+
+      case SC_LIGHT_ATTENUATION:
+        tex = get_handle(sc);
+        f0 = get_flt(sc);
+        f1 = get_flt(sc);
+        f2 = get_flt(sc);
+        if (!sc->bad)
+          rt_light_attenuation(tex, f0, f1, f2);
+        break;
+
+      case SC_SPHERE:
+        tex = get_handle(sc);
+        v0 = get_vec(sc);
+        f0 = get_flt(sc);
+        if (!sc->bad)
+          rt_sphere(scene, tex, v0, f0);
+        break;
+
+      case SC_PLANE:
+        tex = get_handle(sc);
+        v0 = get_vec(sc);
+        v1 = get_vec(sc);
+        if (!sc->bad)
+          rt_plane(scene, tex, v0, v1);
+        break;
+
+      case SC_RING:
+        tex = get_handle(sc);
+        v0 = get_vec(sc);
+        v1 = get_vec(sc);
+        f0 = get_flt(sc);
+        f1 = get_flt(sc);
+        if (!sc->bad)
+          rt_ring(scene, tex, v0, v1, f0, f1);
+        break;
+
+      case SC_BOX:
+        tex = get_handle(sc);
+        v0 = get_vec(sc);
+        v1 = get_vec(sc);
+        if (!sc->bad)
+          rt_box(scene, tex, v0, v1);
+        break;
+
+      case SC_CYLINDER:
+      case SC_FCYLINDER:
+        tex = get_handle(sc);
+        v0 = get_vec(sc);
+        v1 = get_vec(sc);
+        f0 = get_flt(sc);
+        if (!sc->bad && op == SC_CYLINDER)
+          rt_cylinder(scene, tex, v0, v1, f0);
+        else if (!sc->bad)
+          rt_fcylinder(scene, tex, v0, v1, f0);
+        break;
+
+      case SC_POLYCYLINDER:
+        tex = get_handle(sc);
+        i0 = get_int(sc);
+        d0 = get_array(sc, &l0);
+        f0 = get_flt(sc);
+        if (d0 == NULL || l0 != i0 * (int) sizeof(apivector))
+          sc->bad = 1;
+        if (!sc->bad)
+          rt_polycylinder(scene, tex, (apivector *) d0, i0, f0);
+        break;
+
+      case SC_SCALARVOL:
+        tex = get_handle(sc);
+        v0 = get_vec(sc);
+        v1 = get_vec(sc);
+        i0 = get_int(sc);
+        i1 = get_int(sc);
+        i2 = get_int(sc);
+        name = get_string(sc);
+        if (!sc->bad)
+          rt_scalarvol(scene, tex, v0, v1, i0, i1, i2, name, NULL);
+        break;
+
+      case SC_TRI:
+        tex = get_handle(sc);
+        v0 = get_vec(sc);
+        v1 = get_vec(sc);
+        v2 = get_vec(sc);
+        if (!sc->bad)
+          rt_tri(scene, tex, v0, v1, v2);
+        break;
+
+      case SC_STRI:
+        tex = get_handle(sc);
+        v0 = get_vec(sc);
+        v1 = get_vec(sc);
+        v2 = get_vec(sc);
+        n0 = get_vec(sc);
+        n1 = get_vec(sc);
+        n2 = get_vec(sc);
+        if (!sc->bad)
+          rt_stri(scene, tex, v0, v1, v2, n0, n1, n2);
+        break;
+
+      case SC_VCSTRI:
+        tex = get_handle(sc);
+        v0 = get_vec(sc);
+        v1 = get_vec(sc);
+        v2 = get_vec(sc);
+        n0 = get_vec(sc);
+        n1 = get_vec(sc);
+        n2 = get_vec(sc);
+        c0 = get_col(sc);
+        c1 = get_col(sc);
+        c2 = get_col(sc);
+        if (!sc->bad)
+          rt_vcstri(scene, tex, v0, v1, v2, n0, n1, n2, c0, c1, c2);
+        break;
+
+      case SC_TRIMESH:
+        tex = get_handle(sc);
+        i0 = get_int(sc);
+        d0 = get_array(sc, &l0);
+        d1 = get_array(sc, &l1);
+        d2 = get_array(sc, &l2);
+        i1 = get_int(sc);
+        d3 = get_array(sc, &l3);
+        if (d0 == NULL || l0 != i0 * 3 * (int) sizeof(float) ||
+            (d1 != NULL && l1 != l0) || (d2 != NULL && l2 != l0) ||
+            d3 == NULL || l3 != i1 * 3 * (int) sizeof(int))
+          sc->bad = 1;
+        if (!sc->bad)
+          rt_trimesh(scene, tex, i0, (const float *) d0, (const float *) d1,
+                     (const float *) d2, i1, (const int *) d3);
+        break;
+
+      case SC_LANDSCAPE:
+        tex = get_handle(sc);
+        i0 = get_int(sc);
+        i1 = get_int(sc);
+        v0 = get_vec(sc);
+        f0 = get_flt(sc);
+        f1 = get_flt(sc);
+        if (!sc->bad)
+          rt_landscape(scene, tex, i0, i1, v0, f0, f1);
+        break;
+
+      case SC_CLIP_FV:
+        i0 = get_int(sc);
+        d0 = get_array(sc, &l0);
+        if (d0 == NULL || l0 != i0 * 4 * (int) sizeof(float))
+          sc->bad = 1;
+        if (!sc->bad)
+          rt_clip_fv(scene, i0, (float *) d0);
+        break;
+
+      case SC_CLIP_OFF:
+        rt_clip_off(scene);
+        break;
+
+      case SC_BVH:
+        i0 = get_int(sc);
+        d0 = get_array(sc, &l0);
+        i1 = get_int(sc);
+        d1 = get_array(sc, &l1);
+        if (d0 == NULL || l0 != i0 * SC_BVHNODESIZE ||
+            d1 == NULL || l1 != i1 * (int) sizeof(int))
+          sc->bad = 1;
+        if (!sc->bad) {
+          rt_bvh_import(scene, i0, d0, i1, (const int *) d1);
+          sc->hasbvh = 1;
+        }
+        break;
+
+      default:
+        sc->bad = 1;
+        break;
+    }
+  }
+}
+
+
+/*
+ * Opening, saving and closing caches
+ */
+
+void * sc_open(const char * modelfile, SceneHandle scene, unsigned int * rc) {
+  scenecache * sc;
+
+  sc = (scenecache *) calloc(1, sizeof(scenecache));
+  sc->cachefile = (char *) malloc(strlen(modelfile) + 7);
+  sprintf(sc->cachefile, "%s.cache", modelfile);
+
+  if (sc_load(sc, modelfile)) {
+    if (sc_replay(sc, scene)) {
+      *rc = PARSENOERR;
+    } else {
+      printf("Scene cache %s is damaged, removing it.\n", sc->cachefile);
+      remove(sc->cachefile);
+      sc->uncacheable = 1;
+      *rc = PARSEBADSYNTAX;
+    }
+    return sc;
+  }
+
+  /* parse the scene file, recording the calls it makes */
+  sc->stale = 1;
+  *rc = recordmodel(modelfile, scene, sc);
+  if (*rc != PARSENOERR)
+    sc->uncacheable = 1;
+
+  return sc;
+}
+
+/*
+ * Write the cache file if it is new or out of date.  With withbvh the
+ * scene's BVH is added if the cache doesn't have it yet, and handed back
+ * to the scene so it isn't built a second time for rendering.
+ */
+int sc_save(void * cache, SceneHandle scene, int withbvh) {
+  scenecache * sc = (scenecache *) cache;
+  scheader hdr;
+  scdepend d;
+  char * tmpfile;
+  void * nodes;
+  int i, ok, numnodes, numobj, * order, namelen[2];
+  double length;
+  FILE * ofp;
+
+  if (sc == NULL || sc->uncacheable)
+    return 0;
+
+  if (withbvh && !sc->hasbvh &&
+      rt_bvh_export(scene, &numnodes, &nodes, &numobj, &order)) {
+    rt_bvh_import(scene, numnodes, nodes, numobj, order);
+    put_int(sc, SC_BVH);
+    put_int(sc, numnodes);
+    put_array(sc, nodes, numnodes * SC_BVHNODESIZE);
+    put_int(sc, numobj);
+    put_array(sc, order, numobj * sizeof(int));
+    free(nodes);
+    free(order);
+    sc->hasbvh = 1;
+    sc->stale = 1;
+  }
+
+  if (sc->uncacheable)
+    return 0;
+  if (!sc->stale)
+    return 1;
+
+  length = sizeof(scheader) + sc->len + sizeof(int);
+  for (i=0; i<sc->numdeps; i++)
+    length += sizeof(scdepend) + ((strlen(sc->depnames[i]) + 8) & ~7);
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, sc_magic, sizeof(sc_magic));
+  hdr.version = SCENECACHE_VERSION;
+  hdr.byteorder = 0x01020304;
+  hdr.fltsize = sizeof(apiflt);
+  hdr.numdeps = sc->numdeps;
+  hdr.length = length;
+
+  /* write a new file and rename it, a mapped old one stays intact */
+  tmpfile = (char *) malloc(strlen(sc->cachefile) + 5);
+  sprintf(tmpfile, "%s.tmp", sc->cachefile);
+  if ((ofp = fopen(tmpfile, "wb")) == NULL) {
+    printf("Can't write scene cache %s\n", tmpfile);
+    free(tmpfile);
+    return 0;
+  }
+
+  fwrite(&hdr, sizeof(hdr), 1, ofp);
+  for (i=0; i<sc->numdeps; i++) {
+    namelen[0] = strlen(sc->depnames[i]) + 1;
+    namelen[1] = (namelen[0] + 7) & ~7;
+    d = sc->deps[i];
+    d.namelen = namelen[1];
+    fwrite(&d, sizeof(d), 1, ofp);
+    fwrite(sc->depnames[i], namelen[0], 1, ofp);
+    fwrite(sc_pad, namelen[1] - namelen[0], 1, ofp);
+  }
+  fwrite(sc->buf, 1, sc->len, ofp);
+  i = SC_END;
+  fwrite(&i, sizeof(int), 1, ofp);
+
+  ok = !ferror(ofp);
+  ok &= (fclose(ofp) == 0);
+#ifdef SC_NOMMAP
+  remove(sc->cachefile);
+#endif
+  if (ok && rename(tmpfile, sc->cachefile) == 0) {
+    printf("Wrote scene cache %s, %.1f MB\n", sc->cachefile,
+           length / (1024.0 * 1024.0));
+    sc->stale = 0;
+  } else {
+    printf("Can't write scene cache %s\n", sc->cachefile);
+    remove(tmpfile);
+    ok = 0;
+  }
+  free(tmpfile);
+
+  return ok;
+}
+
+static void sc_reset(scenecache * sc) {
+  int i;
+
+  if (sc->max > 0)
+    free(sc->buf);
+  if (sc->map != NULL) {
+#ifdef SC_NOMMAP
+    free(sc->map);
+#else
+    munmap(sc->map, sc->maplen);
+#endif
+  }
+  for (i=0; i<sc->numdeps; i++)
+    free(sc->depnames[i]);
+  free(sc->depnames);
+  free(sc->deps);
+  free(sc->hash);
+  free(sc->handles);
+
+  sc->buf = NULL;
+  sc->len = sc->max = sc->pos = 0;
+  sc->bad = 0;
+  sc->map = NULL;
+  sc->maplen = 0;
+  sc->numdeps = 0;
+  sc->depnames = NULL;
+  sc->deps = NULL;
+  sc->numhandles = 0;
+  sc->hash = NULL;
+  sc->hashsize = 0;
+  sc->handles = NULL;
+  sc->maxhandles = 0;
+  sc->hasbvh = 0;
+  sc->stale = 0;
+}
+
+void sc_close(void * cache) {
+  scenecache * sc = (scenecache *) cache;
+
+  if (sc != NULL) {
+    sc_reset(sc);
+    free(sc->cachefile);
+    free(sc);
+  }
+}
+
+
+/*
+ * The API calls made by the parser
+ */
+
+void * sc_texture(void * cache, SceneHandle scene, apitexture * apitex) {
+  scenecache * sc = (scenecache *) cache;
+  void * tex;
+
+  tex = rt_texture(scene, apitex);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_TEXTURE);
+    sc_put(sc, apitex, sizeof(apitexture));
+    new_handle(sc, tex);
+  }
+  return tex;
+}
+
+void sc_tex_phong(void * cache, void * tex, apiflt phong, apiflt phongexp,
+                  int type) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_tex_phong(tex, phong, phongexp, type);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_TEX_PHONG);
+    put_handle(sc, tex);
+    put_flt(sc, phong);
+    put_flt(sc, phongexp);
+    put_int(sc, type);
+  }
+}
+
+void sc_tex_outline(void * cache, void * tex, apiflt outline,
+                    apiflt outlinewidth) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_tex_outline(tex, outline, outlinewidth);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_TEX_OUTLINE);
+    put_handle(sc, tex);
+    put_flt(sc, outline);
+    put_flt(sc, outlinewidth);
+  }
+}
+
+void sc_define_image(void * cache, const char * name, int xs, int ys,
+                     int zs, unsigned char * rgb) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_define_image(name, xs, ys, zs, rgb);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_DEFINE_IMAGE);
+    put_string(sc, name);
+    put_int(sc, xs);
+    put_int(sc, ys);
+    put_int(sc, zs);
+    put_array(sc, rgb, xs * ys * zs * 3);
+  }
+}
+
+void sc_outputfile(void * cache, SceneHandle scene, const char * outname) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_outputfile(scene, outname);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_OUTPUTFILE);
+    put_string(sc, outname);
+  }
+}
+
+void sc_resolution(void * cache, SceneHandle scene, int hres, int vres) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_resolution(scene, hres, vres);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_RESOLUTION);
+    put_int(sc, hres);
+    put_int(sc, vres);
+  }
+}
+
+void sc_verbose(void * cache, SceneHandle scene, int v) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_verbose(scene, v);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_VERBOSE);
+    put_int(sc, v);
+  }
+}
+
+void sc_shadermode(void * cache, SceneHandle scene, int mode) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_shadermode(scene, mode);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_SHADERMODE);
+    put_int(sc, mode);
+  }
+}
+
+void sc_trans_mode(void * cache, SceneHandle scene, int mode) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_trans_mode(scene, mode);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_TRANS_MODE);
+    put_int(sc, mode);
+  }
+}
+
+void sc_fog_rendering_mode(void * cache, SceneHandle scene, int mode) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_fog_rendering_mode(scene, mode);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_FOG_RENDERING_MODE);
+    put_int(sc, mode);
+  }
+}
+
+void sc_fog_mode(void * cache, SceneHandle scene, int mode) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_fog_mode(scene, mode);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_FOG_MODE);
+    put_int(sc, mode);
+  }
+}
+
+void sc_fog_parms(void * cache, SceneHandle scene, apicolor col,
+                  apiflt start, apiflt end, apiflt density) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_fog_parms(scene, col, start, end, density);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_FOG_PARMS);
+    put_col(sc, col);
+    put_flt(sc, start);
+    put_flt(sc, end);
+    put_flt(sc, density);
+  }
+}
+
+void sc_background(void * cache, SceneHandle scene, apicolor col) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_background(scene, col);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_BACKGROUND);
+    put_col(sc, col);
+  }
+}
+
+void sc_rescale_lights(void * cache, SceneHandle scene, apiflt lightscale) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_rescale_lights(scene, lightscale);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_RESCALE_LIGHTS);
+    put_flt(sc, lightscale);
+  }
+}
+
+void sc_ambient_occlusion(void * cache, SceneHandle scene, int numsamples,
+                          apicolor col) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_ambient_occlusion(scene, numsamples, col);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_AMBIENT_OCCLUSION);
+    put_int(sc, numsamples);
+    put_col(sc, col);
+  }
+}
+
+void sc_camera_setup(void * cache, SceneHandle scene, apiflt zoom,
+                     apiflt aspectratio, int antialiasing, int raydepth,
+                     apivector camcent, apivector viewvec, apivector upvec) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_camera_setup(scene, zoom, aspectratio, antialiasing, raydepth,
+                  camcent, viewvec, upvec);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_CAMERA_SETUP);
+    put_flt(sc, zoom);
+    put_flt(sc, aspectratio);
+    put_int(sc, antialiasing);
+    put_int(sc, raydepth);
+    put_vec(sc, camcent);
+    put_vec(sc, viewvec);
+    put_vec(sc, upvec);
+  }
+}
+
+void sc_camera_projection(void * cache, SceneHandle scene, int mode) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_camera_projection(scene, mode);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_CAMERA_PROJECTION);
+    put_int(sc, mode);
+  }
+}
+
+void sc_camera_dof(void * cache, SceneHandle scene, apiflt focallength,
+                   apiflt aperture) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_camera_dof(scene, focallength, aperture);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_CAMERA_DOF);
+    put_flt(sc, focallength);
+    put_flt(sc, aperture);
+  }
+}
+
+void sc_camera_frustum(void * cache, SceneHandle scene, apiflt left,
+                       apiflt right, apiflt bottom, apiflt top) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_camera_frustum(scene, left, right, bottom, top);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_CAMERA_FRUSTUM);
+    put_flt(sc, left);
+    put_flt(sc, right);
+    put_flt(sc, bottom);
+    put_flt(sc, top);
+  }
+}
+
+void * sc_light(void * cache, SceneHandle scene, void * tex, apivector ctr,
+                apiflt rad) {
+  scenecache * sc = (scenecache *) cache;
+  void * li;
+
+  li = rt_light(scene, tex, ctr, rad);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_LIGHT);
+    put_handle(sc, tex);
+    put_vec(sc, ctr);
+    put_flt(sc, rad);
+    new_handle(sc, li);
+  }
+  return li;
+}
+
+void * sc_directional_light(void * cache, SceneHandle scene, void * tex,
+                            apivector dir) {
+  scenecache * sc = (scenecache *) cache;
+  void * li;
+
+  li = rt_directional_light(scene, tex, dir);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_DIRECTIONAL_LIGHT);
+    put_handle(sc, tex);
+    put_vec(sc, dir);
+    new_handle(sc, li);
+  }
+  return li;
+}
+
+void * sc_spotlight(void * cache, SceneHandle scene, void * tex,
+                    apivector ctr, apiflt rad, apivector dir,
+                    apiflt start, apiflt end) {
+  scenecache * sc = (scenecache *) cache;
+  void * li;
+
+  li = rt_spotlight(scene, tex, ctr, rad, dir, start, end);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_SPOTLIGHT);
+    put_handle(sc, tex);
+    put_vec(sc, ctr);
+    put_flt(sc, rad);
+    put_vec(sc, dir);
+    put_flt(sc, start);
+    put_flt(sc, end);
+    new_handle(sc, li);
+  }
+  return li;
+}
+
+void sc_light_attenuation(void * cache, void * li, apiflt kc, apiflt kl,
+                          apiflt kq) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_light_attenuation(li, kc, kl, kq);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_LIGHT_ATTENUATION);
+    put_handle(sc, li);
+    put_flt(sc, kc);
+    put_flt(sc, kl);
+    put_flt(sc, kq);
+  }
+}
+
+void sc_sphere(void * cache, SceneHandle scene, void * tex, apivector ctr,
+               apiflt rad) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_sphere(scene, tex, ctr, rad);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_SPHERE);
+    put_handle(sc, tex);
+    put_vec(sc, ctr);
+    put_flt(sc, rad);
+  }
+}
+
+void sc_plane(void * cache, SceneHandle scene, void * tex, apivector ctr,
+              apivector norm) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_plane(scene, tex, ctr, norm);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_PLANE);
+    put_handle(sc, tex);
+    put_vec(sc, ctr);
+    put_vec(sc, norm);
+  }
+}
+
+void sc_ring(void * cache, SceneHandle scene, void * tex, apivector ctr,
+             apivector norm, apiflt inner, apiflt outer) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_ring(scene, tex, ctr, norm, inner, outer);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_RING);
+    put_handle(sc, tex);
+    put_vec(sc, ctr);
+    put_vec(sc, norm);
+    put_flt(sc, inner);
+    put_flt(sc, outer);
+  }
+}
+
+void sc_box(void * cache, SceneHandle scene, void * tex, apivector min,
+            apivector max) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_box(scene, tex, min, max);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_BOX);
+    put_handle(sc, tex);
+    put_vec(sc, min);
+    put_vec(sc, max);
+  }
+}
+
+void sc_cylinder(void * cache, SceneHandle scene, void * tex, apivector ctr,
+                 apivector axis, apiflt rad) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_cylinder(scene, tex, ctr, axis, rad);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_CYLINDER);
+    put_handle(sc, tex);
+    put_vec(sc, ctr);
+    put_vec(sc, axis);
+    put_flt(sc, rad);
+  }
+}
+
+void sc_fcylinder(void * cache, SceneHandle scene, void * tex,
+                  apivector ctr, apivector axis, apiflt rad) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_fcylinder(scene, tex, ctr, axis, rad);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_FCYLINDER);
+    put_handle(sc, tex);
+    put_vec(sc, ctr);
+    put_vec(sc, axis);
+    put_flt(sc, rad);
+  }
+}
+
+void sc_polycylinder(void * cache, SceneHandle scene, void * tex,
+                     apivector * points, int numpts, apiflt rad) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_polycylinder(scene, tex, points, numpts, rad);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_POLYCYLINDER);
+    put_handle(sc, tex);
+    put_int(sc, numpts);
+    put_array(sc, points, numpts * sizeof(apivector));
+    put_flt(sc, rad);
+  }
+}
+
+void sc_scalarvol(void * cache, SceneHandle scene, void * tex,
+                  apivector min, apivector max, int xs, int ys, int zs,
+                  const char * fname) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_scalarvol(scene, tex, min, max, xs, ys, zs, fname, NULL);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_SCALARVOL);
+    put_handle(sc, tex);
+    put_vec(sc, min);
+    put_vec(sc, max);
+    put_int(sc, xs);
+    put_int(sc, ys);
+    put_int(sc, zs);
+    put_string(sc, fname);
+  }
+}
+
+void sc_tri(void * cache, SceneHandle scene, void * tex, apivector v0,
+            apivector v1, apivector v2) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_tri(scene, tex, v0, v1, v2);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_TRI);
+    put_handle(sc, tex);
+    put_vec(sc, v0);
+    put_vec(sc, v1);
+    put_vec(sc, v2);
+  }
+}
+
+void sc_stri(void * cache, SceneHandle scene, void * tex, apivector v0,
+             apivector v1, apivector v2, apivector n0, apivector n1,
+             apivector n2) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_stri(scene, tex, v0, v1, v2, n0, n1, n2);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_STRI);
+    put_handle(sc, tex);
+    put_vec(sc, v0);
+    put_vec(sc, v1);
+    put_vec(sc, v2);
+    put_vec(sc, n0);
+    put_vec(sc, n1);
+    put_vec(sc, n2);
+  }
+}
+
+void sc_vcstri(void * cache, SceneHandle scene, void * tex, apivector v0,
+               apivector v1, apivector v2, apivector n0, apivector n1,
+               apivector n2, apicolor c0, apicolor c1, apicolor c2) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_vcstri(scene, tex, v0, v1, v2, n0, n1, n2, c0, c1, c2);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_VCSTRI);
+    put_handle(sc, tex);
+    put_vec(sc, v0);
+    put_vec(sc, v1);
+    put_vec(sc, v2);
+    put_vec(sc, n0);
+    put_vec(sc, n1);
+    put_vec(sc, n2);
+    put_col(sc, c0);
+    put_col(sc, c1);
+    put_col(sc, c2);
+  }
+}
+
+void sc_trimesh(void * cache, SceneHandle scene, void * tex, int numverts,
+                const float * v, const float * n, const float * c,
+                int numtris, const int * facets) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_trimesh(scene, tex, numverts, v, n, c, numtris, facets);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_TRIMESH);
+    put_handle(sc, tex);
+    put_int(sc, numverts);
+    put_array(sc, v, numverts * 3 * sizeof(float));
+    put_array(sc, n, numverts * 3 * sizeof(float));
+    put_array(sc, c, numverts * 3 * sizeof(float));
+    put_int(sc, numtris);
+    put_array(sc, facets, numtris * 3 * sizeof(int));
+  }
+}
+
+void sc_landscape(void * cache, SceneHandle scene, void * tex, int m, int n,
+                  apivector ctr, apiflt wx, apiflt wy) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_landscape(scene, tex, m, n, ctr, wx, wy);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_LANDSCAPE);
+    put_handle(sc, tex);
+    put_int(sc, m);
+    put_int(sc, n);
+    put_vec(sc, ctr);
+    put_flt(sc, wx);
+    put_flt(sc, wy);
+  }
+}
+
+void sc_clip_fv(void * cache, SceneHandle scene, int numplanes,
+                float * planes) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_clip_fv(scene, numplanes, planes);
+  if (RECORDING(sc)) {
+    put_int(sc, SC_CLIP_FV);
+    put_int(sc, numplanes);
+    put_array(sc, planes, numplanes * 4 * sizeof(float));
+  }
+}
+
+void sc_clip_off(void * cache, SceneHandle scene) {
+  scenecache * sc = (scenecache *) cache;
+
+  rt_clip_off(scene);
+  if (RECORDING(sc))
+    put_int(sc, SC_CLIP_OFF);
+}
@@ -0,0 +1,156 @@
+/*
+ * scenecache.h - binary caches of parsed Tachyon scene files
+ *
+ *  $Id$
+ */
+
+#define SCENECACHE_VERSION 1   /* bump whenever the file layout changes */
+
+/*
+ * A cache file, <scene file>.cache, holds the Tachyon API calls made by
+ * the parser for a scene, with their arguments in binary form, and
+ * optionally the scene's bounding volume hierarchy.  sc_open() replays a
+ * cache that is still valid for the scene and its included files, or
+ * parses the scene file and records the calls for sc_save().
+ */
+void * sc_open(const char * modelfile, SceneHandle scene, unsigned int * rc);
+int sc_save(void * cache, SceneHandle scene, int withbvh);
+void sc_close(void * cache);
+
+/* used by the parser while recording, cache may be NULL */
+void sc_depend(void * cache, const char * filename);
+void sc_uncacheable(void * cache);
+
+/* recording versions of the API calls made by the parser */
+void * sc_texture(void * cache, SceneHandle, apitexture *);
+void sc_tex_phong(void * cache, void * tex, apiflt, apiflt, int);
+void sc_tex_outline(void * cache, void * tex, apiflt, apiflt);
+void sc_define_image(void * cache, const char *, int, int, int,
+                     unsigned char *);
+void sc_outputfile(void * cache, SceneHandle, const char *);
+void sc_resolution(void * cache, SceneHandle, int, int);
+void sc_verbose(void * cache, SceneHandle, int);
+void sc_shadermode(void * cache, SceneHandle, int);
+void sc_trans_mode(void * cache, SceneHandle, int);
+void sc_fog_rendering_mode(void * cache, SceneHandle, int);
+void sc_fog_mode(void * cache, SceneHandle, int);
+void sc_fog_parms(void * cache, SceneHandle, apicolor, apiflt, apiflt,
+                  apiflt);
+void sc_background(void * cache, SceneHandle, apicolor);
+void sc_rescale_lights(void * cache, SceneHandle, apiflt);
+void sc_ambient_occlusion(void * cache, SceneHandle, int, apicolor);
+void sc_camera_setup(void * cache, SceneHandle, apiflt, apiflt, int, int,
+                     apivector, apivector, apivector);
+void sc_camera_projection(void * cache, SceneHandle, int);
+void sc_camera_dof(void * cache, SceneHandle, apiflt, apiflt);
+void sc_camera_frustum(void * cache, SceneHandle, apiflt, apiflt, apiflt,
+                       apiflt);
+void * sc_light(void * cache, SceneHandle, void *, apivector, apiflt);
+void * sc_directional_light(void * cache, SceneHandle, void *, apivector);
+void * sc_spotlight(void * cache, SceneHandle, void *, apivector, apiflt,
+                    apivector, apiflt, apiflt);
+void sc_light_attenuation(void * cache, void * light, apiflt, apiflt, apiflt);
+void sc_sphere(void * cache, SceneHandle, void *, apivector, apiflt);
+void sc_plane(void * cache, SceneHandle, void *, apivector, apivector);
+void sc_ring(void * cache, SceneHandle, void *, apivector, apivector,
+             apiflt, apiflt);
+void sc_box(void * cache, SceneHandle, void *, apivector, apivector);
+void sc_cylinder(void * cache, SceneHandle, void *, apivector, apivector,
+                 apiflt);
+void sc_fcylinder(void * cache, SceneHandle, void *, apivector, apivector,
+                  apiflt);
+void sc_polycylinder(void * cache, SceneHandle, void *, apivector *, int,
+                     apiflt);
+void sc_scalarvol(void * cache, SceneHandle, void *, apivector, apivector,
+                  int, int, int, const char *);
+void sc_tri(void * cache, SceneHandle, void *, apivector, apivector,
+            apivector);
+void sc_stri(void * cache, SceneHandle, void *, apivector, apivector,
+             apivector, apivector, apivector, apivector);
+void sc_vcstri(void * cache, SceneHandle, void *, apivector, apivector,
+               apivector, apivector, apivector, apivector,
+               apicolor, apicolor, apicolor);
+void sc_trimesh(void * cache, SceneHandle, void *, int, const float *,
+                const float *, const float *, int, const int *);
+void sc_landscape(void * cache, SceneHandle, void *, int, int, apivector,
+                  apiflt, apiflt);
+void sc_clip_fv(void * cache, SceneHandle, int, float *);
+void sc_clip_off(void * cache, SceneHandle);
+
+#ifdef SCENECACHE_PRIVATE
+
+#define SC_BVHNODESIZE 32      /* bytes per node from rt_bvh_export()    */
+
+/* one opcode per recorded call, followed by its arguments */
+enum {
+  SC_END = 0, SC_TEXTURE, SC_TEX_PHONG, SC_TEX_OUTLINE, SC_DEFINE_IMAGE,
+  SC_OUTPUTFILE, SC_RESOLUTION, SC_VERBOSE, SC_SHADERMODE, SC_TRANS_MODE,
+  SC_FOG_RENDERING_MODE, SC_FOG_MODE, SC_FOG_PARMS, SC_BACKGROUND,
+  SC_RESCALE_LIGHTS, SC_AMBIENT_OCCLUSION, SC_CAMERA_SETUP,
+  SC_CAMERA_PROJECTION, SC_CAMERA_DOF, SC_CAMERA_FRUSTUM, SC_LIGHT,
+  SC_DIRECTIONAL_LIGHT, SC_SPOTLIGHT, SC_LIGHT_ATTENUATION, SC_SPHERE,
+  SC_PLANE, SC_RING, SC_BOX, SC_CYLINDER, SC_FCYLINDER, SC_POLYCYLINDER,
+  SC_SCALARVOL, SC_TRI, SC_STRI, SC_VCSTRI, SC_TRIMESH, SC_LANDSCAPE,
+  SC_CLIP_FV, SC_CLIP_OFF, SC_BVH
+};
+
+/*
+ * File layout: the header, the dependencies, then the call stream,
+ * which ends with SC_END.  Everything is in the byte order and apiflt
+ * size of the writer, arrays are padded to 8 bytes so they can be used
+ * in place, and handles returned by the library are numbered in the
+ * order they were created.
+ */
+typedef struct {
+  char magic[8];          /* "TACHYSC"                                   */
+  int version;            /* SCENECACHE_VERSION                          */
+  int byteorder;          /* 0x01020304 as written                       */
+  int fltsize;            /* sizeof(apiflt)                              */
+  int numdeps;            /* files the scene was read from               */
+  double length;          /* size of the whole file                      */
+} scheader;
+
+typedef struct {
+  double size;            /* file size and modification time             */
+  double mtime;
+  unsigned int hash;      /* FNV-1a hash of the contents                 */
+  int namelen;            /* length of the name following, padded        */
+} scdepend;
+
+/* record side map from handles to their numbers */
+typedef struct {
+  void * ptr;
+  int idx;
+} schandle;
+
+typedef struct {
+  char * cachefile;       /* name of the cache file                      */
+  unsigned char * buf;    /* call stream being recorded, or replayed     */
+  size_t len;             /* bytes in buf                                */
+  size_t max;             /* bytes allocated, 0 while buf is in the map  */
+  size_t pos;             /* replay position                             */
+  int bad;                /* replay ran off the end of the stream        */
+  unsigned char * map;    /* the whole cache file when replaying         */
+  size_t maplen;
+  int numdeps;            /* files the scene was read from               */
+  char ** depnames;
+  scdepend * deps;
+  int numhandles;         /* handles created so far                      */
+  schandle * hash;        /* recording: open addressing handle table     */
+  int hashsize;
+  void ** handles;        /* replaying: handles by number                */
+  int maxhandles;
+  int hasbvh;             /* the stream ends with the scene's BVH        */
+  int stale;              /* the file must be written again              */
+  int uncacheable;        /* the scene made calls that aren't recorded   */
+} scenecache;
+
+static unsigned int sc_hashfile(const char * filename, double * size,
+                                double * mtime);
+static int sc_load(scenecache * sc, const char * modelfile);
+static int sc_replay(scenecache * sc, SceneHandle scene);
+static void sc_put(scenecache * sc, const void * data, size_t len);
+static void sc_get(scenecache * sc, void * data, size_t len);
+static void sc_reset(scenecache * sc);
+
+#endif
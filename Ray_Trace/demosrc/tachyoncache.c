@@ -0,0 +1,52 @@
+/*
+ * tachyoncache.c - write binary scene caches for Tachyon scene files
+ *
+ * Parses each scene file given and writes filename.dat.cache next to it,
+ * with the scene's bounding volume hierarchy, for "tachyon -cache" to
+ * load.  Caches that are still valid are left alone.
+ *
+ *  $Id$
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tachyon.h"    /* The Tachyon ray tracing library API */
+#include "parse.h"      /* Support for my own scene file format */
+#include "scenecache.h" /* Binary caches of parsed scene files */
+
+static void my_ui_message(int a, char * msg) {
+  printf("%s\n", msg);
+}
+
+int main(int argc, char **argv) {
+  SceneHandle scene;
+  unsigned int rc;
+  void * cache;
+  int i, failed;
+
+  if (argc < 2) {
+    printf("Usage: %s filename.dat [filename.dat ...]\n", argv[0]);
+    printf("  Writes filename.dat.cache for tachyon -cache\n");
+    return 1;
+  }
+
+  rt_initialize(&argc, &argv);
+  rt_set_ui_message(my_ui_message);
+
+  failed = 0;
+  for (i=1; i<argc; i++) {
+    scene = rt_newscene();
+    cache = sc_open(argv[i], scene, &rc);
+    if (rc != PARSENOERR || !sc_save(cache, scene, 1)) {
+      printf("No scene cache written for %s\n", argv[i]);
+      failed = 1;
+    }
+    sc_close(cache);
+    rt_deletescene(scene);
+  }
+
+  rt_finalize();
+
+  return failed;
+}
@@ -153,6 +153,23 @@ SOURCE=..\..\..\src\box.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\bvh.c
+
+!IF  "$(CFG)" == "libtachyon - Win32 Release"
+
+# ADD CPP /GB /MT /Ob2 /I "..\..\src"
+# SUBTRACT CPP /YX
+
+!ELSEIF  "$(CFG)" == "libtachyon - Win32 Debug"
+
+# ADD CPP /MDd /I "..\..\src"
+# SUBTRACT CPP /YX
+
+!ENDIF 
+
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\camera.c
 
 !IF  "$(CFG)" == "libtachyon - Win32 Release"
@@ -353,6 +370,23 @@ SOURCE=..\..\..\src\light.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\packet.c
+
+!IF  "$(CFG)" == "libtachyon - Win32 Release"
+
+# ADD CPP /GB /MT /Ob2 /I "..\..\src"
+# SUBTRACT CPP /YX
+
+!ELSEIF  "$(CFG)" == "libtachyon - Win32 Debug"
+
+# ADD CPP /MDd /I "..\..\src"
+# SUBTRACT CPP /YX
+
+!ENDIF 
+
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\parallel.c
 
 !IF  "$(CFG)" == "libtachyon - Win32 Release"
@@ -617,6 +651,23 @@ SOURCE=..\..\..\src\triangle.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\trimesh.c
+
+!IF  "$(CFG)" == "libtachyon - Win32 Release"
+
+# ADD CPP /GB /MT /Ob2 /I "..\..\src"
+# SUBTRACT CPP /YX
+
+!ELSEIF  "$(CFG)" == "libtachyon - Win32 Debug"
+
+# ADD CPP /MDd /I "..\..\src"
+# SUBTRACT CPP /YX
+
+!ENDIF 
+
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\ui.c
 
 !IF  "$(CFG)" == "libtachyon - Win32 Release"
@@ -714,6 +765,10 @@ SOURCE=..\..\..\src\box.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\bvh.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\camera.h
 # End Source File
 # Begin Source File
@@ -774,6 +829,10 @@ SOURCE=..\..\..\src\objbound.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\packet.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\parallel.h
 # End Source File
 # Begin Source File
@@ -834,6 +893,10 @@ SOURCE=..\..\..\src\triangle.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\..\src\trimesh.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\..\src\types.h
 # End Source File
 # Begin Source File
@@ -111,6 +111,10 @@ SOURCE=..\..\..\demosrc\nffparse.c
 
 SOURCE=..\..\..\demosrc\parse.c
 # End Source File
+# Begin Source File
+
+SOURCE=..\..\..\demosrc\scenecache.c
+# End Source File
 # End Group
 # Begin Group "Header Files"
 
@@ -135,6 +139,10 @@ SOURCE=..\..\..\demosrc\nffparse.h
 
 SOURCE=..\..\..\demosrc\parse.h
 # End Source File
+# Begin Source File
+
+SOURCE=..\..\..\demosrc\scenecache.h
+# End Source File
 # End Group
 # Begin Group "Resource Files"
 
@@ -110,6 +110,10 @@ SOURCE=..\..\..\demosrc\nffparse.c
 
 SOURCE=..\..\..\demosrc\parse.c
 # End Source File
+# Begin Source File
+
+SOURCE=..\..\..\demosrc\scenecache.c
+# End Source File
 # End Group
 # Begin Group "Header Files"
 
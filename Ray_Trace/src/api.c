@@ -19,6 +19,8 @@
 #include "ring.h"
 #include "sphere.h"
 #include "triangle.h"
+#include "trimesh.h"
+#include "bvh.h"
 #include "vol.h"
 #include "extvol.h"
 
@@ -132,6 +134,28 @@ void rt_aa_maxsamples(SceneHandle voidscene, int maxsamples) {
     scene->antialiasing=0;
 }
 
+void rt_aa_threshold(SceneHandle voidscene, apiflt thresh) {
+  scenedef * scene = (scenedef *) voidscene;
+
+  if (thresh >= 0.0)
+    scene->aathresh=thresh;
+  else  
+    scene->aathresh=0.0;
+}
+
+void rt_progressive(SceneHandle voidscene, int onoff) {
+  scenedef * scene = (scenedef *) voidscene;
+  scene->progressive = (onoff != 0);
+  scene->scenecheck = 1;
+}
+
+void rt_set_progressive_callback(SceneHandle voidscene, 
+                                 int (* func)(void *, int, int), void * data) {
+  scenedef * scene = (scenedef *) voidscene;
+  scene->progressfunc = func;
+  scene->progressdata = data;
+}
+
 void rt_camera_setup(SceneHandle voidscene, apiflt zoom, apiflt aspectratio, 
 	int antialiasing, int raydepth, 
 	apivector camcent, apivector viewvec, apivector upvec) {
@@ -387,6 +411,35 @@ void rt_boundmode(SceneHandle voidscene, int mode) {
   scene->scenecheck = 1;
 }
 
+void rt_packetsize(SceneHandle voidscene, int size) {
+  scenedef * scene = (scenedef *) voidscene;
+
+  if (size == 0 || size == 1 || size == 4 || size == 8 || size == 16) {
+    scene->packetsize = (size > 1) ? size : 0;
+  } else {
+    if (rt_mynode() == 0) {
+      rt_ui_message(MSG_0, "Ray packet size must be 4, 8 or 16.\n");
+      rt_ui_message(MSG_0, "Ray packets disabled.\n");
+    }
+    scene->packetsize = 0;
+  }
+}
+
+void rt_tilesize(SceneHandle voidscene, int size) {
+  scenedef * scene = (scenedef *) voidscene;
+
+  if (size >= 0) {
+    scene->tilesize = size;
+  } else {
+    if (rt_mynode() == 0) {
+      rt_ui_message(MSG_0, "Tile size must not be negative.\n");
+      rt_ui_message(MSG_0, "Tile size reset to default.\n");
+    }
+    scene->tilesize = RT_TILESIZE;
+  }
+  scene->scenecheck = 1;
+}
+
 void rt_boundthresh(SceneHandle voidscene, int threshold) {
   scenedef * scene = (scenedef *) voidscene;
  
@@ -403,6 +456,20 @@ void rt_boundthresh(SceneHandle voidscene, int threshold) {
   scene->scenecheck = 1;
 }
 
+int rt_bvh_export(SceneHandle voidscene, int * numnodes, void ** nodes,
+                  int * numobj, int ** order) {
+  return bvh_export((scenedef *) voidscene, numnodes, (bvhnode **) nodes,
+                    numobj, order);
+}
+
+void rt_bvh_import(SceneHandle voidscene, int numnodes, const void * nodes,
+                   int numobj, const int * order) {
+  scenedef * scene = (scenedef *) voidscene;
+
+  bvh_import(scene, numnodes, (const bvhnode *) nodes, numobj, order);
+  scene->scenecheck = 1;
+}
+
 void rt_shadermode(SceneHandle voidscene, int mode) {
   scenedef * scene = (scenedef *) voidscene;
 
@@ -483,6 +550,10 @@ SceneHandle rt_newscene(void) {
 
   rt_boundmode(voidscene, RT_BOUNDING_ENABLED);   /* spatial subdivision on */
   rt_boundthresh(voidscene, BOUNDTHRESH);         /* default threshold      */
+  rt_packetsize(voidscene, 0);                    /* ray packets off        */
+  rt_tilesize(voidscene, RT_TILESIZE);            /* 16x16 pixel tiles      */
+  rt_aa_threshold(voidscene, 0.0);                /* fixed AA sample count  */
+  rt_progressive(voidscene, 0);                   /* single pass rendering  */
   rt_camera_setup(voidscene, 1.0, 1.0, 0, 6,
                   rt_vector(0.0, 0.0, 0.0),
                   rt_vector(0.0, 0.0, 1.0),
@@ -538,6 +609,12 @@ void rt_deletescene(SceneHandle voidscene) {
       free(scene->img);
     }
 
+    if (scene->aabuf != NULL) {
+      free(scene->aabuf);
+    }
+
+    bvh_free_import(scene);
+
     /* tear down and deallocate persistent rendering threads */
     destroy_render_threads(scene);
 
@@ -900,81 +977,93 @@ void rt_vcstri(SceneHandle voidscene, void * tex, apivector v0, apivector v1, ap
   }
 } 
 
+void rt_trimesh(SceneHandle voidscene, void * tex, int numverts,
+                const float * v, const float * n, const float * c,
+                int numtris, const int * facets) {
+  scenedef * scene = (scenedef *) voidscene;
+  vcstri_texture * newtex = NULL;
+  object * o;
+
+  /* vertex colors need a texture of their own that can find the mesh */
+  if (c != NULL)
+    tex = newtex = rt_texture_copy_vcstri(scene, tex);
+
+  o = newtrimesh(scene, tex, numverts, v, n, c, numtris, facets);
+
+  /* don't add meshes that are all degenerate triangles */
+  if (o != NULL) {
+    if (newtex != NULL) {
+      list * lst;
+
+      newtex->obj = o;
+      newtex->texfunc = (color(*)(const void *, const void *, void *))(trimesh_color);
+
+      /* add texture to the scene texture list */
+      lst = (list *) malloc(sizeof(list));
+      lst->item = (void *) newtex;
+      lst->next = scene->texlist;
+      scene->texlist = lst;
+    }
+    add_bounded_object(scene, o);
+  } else if (newtex != NULL) {
+    free(newtex);
+  }
+}
+
 void rt_tristripscnv3fv(SceneHandle voidscene, void * tex,
                         int numverts, const float * cnv, 
                         int numstrips, int *vertsperstrip, int *facets) {
-  int strip, t, v;
+  int strip, t, v, i, numtris;
   int stripaddr[2][3] = { {0, 1, 2}, {1, 0, 2} };
-  scenedef * scene = (scenedef *) voidscene;
+  float * vert, * norm, * col;
+  int * tris;
+
+  /* split the interleaved color, normal, vertex array */
+  vert = (float *) malloc(numverts * 3 * sizeof(float));
+  norm = (float *) malloc(numverts * 3 * sizeof(float));
+  col  = (float *) malloc(numverts * 3 * sizeof(float));
+  for (i=0; i<numverts; i++) {
+    col[i*3    ] = cnv[i*10 + 0];
+    col[i*3 + 1] = cnv[i*10 + 1];
+    col[i*3 + 2] = cnv[i*10 + 2];
+    norm[i*3    ] = cnv[i*10 + 4];
+    norm[i*3 + 1] = cnv[i*10 + 5];
+    norm[i*3 + 2] = cnv[i*10 + 6];
+    vert[i*3    ] = cnv[i*10 + 7];
+    vert[i*3 + 1] = cnv[i*10 + 8];
+    vert[i*3 + 2] = cnv[i*10 + 9];
+  }
 
-  /* render triangle strips one triangle at a time 
+  numtris = 0;
+  for (strip=0; strip < numstrips; strip++) {
+    if (vertsperstrip[strip] > 2)
+      numtris += vertsperstrip[strip] - 2;
+  }
+  tris = (int *) malloc(numtris * 3 * sizeof(int));
+
+  /* turn the triangle strips into one mesh
    * triangle winding order is:
    *   v0, v1, v2, then v2, v1, v3, then v2, v3, v4, etc.
    */
   /* loop over all of the triangle strips */
-  for (strip=0, v=0; strip < numstrips; strip++) {
+  for (strip=0, v=0, i=0; strip < numstrips; strip++) {
     /* loop over all triangles in this triangle strip */
     for (t=0; t < (vertsperstrip[strip] - 2); t++) {
-      apivector v0, v1, v2;
-      apivector n0, n1, n2;
-      apicolor  c0, c1, c2;
-      int a0, a1, a2;
-      list * lst;
-      object * o;
-
-      /* copy the original input texture to each of the triangles... */
-      /* converting to a vcstri texture if it isn't already          */
-      vcstri_texture * newtex=rt_texture_copy_vcstri(scene, tex);
-  
-      /* add texture to the scene texture list */
-      lst = (list *) malloc(sizeof(list));
-      lst->item = (void *) tex;
-      lst->next = scene->texlist;
-      scene->texlist = lst;
-
-      /* render one triangle, using lookup table to fix winding order */
-      a0 = facets[v + (stripaddr[t & 0x01][0])] * 10;
-      a1 = facets[v + (stripaddr[t & 0x01][1])] * 10;
-      a2 = facets[v + (stripaddr[t & 0x01][2])] * 10;
-
-      c0.r = cnv[a0 + 0];
-      c0.g = cnv[a0 + 1];
-      c0.b = cnv[a0 + 2];
-      n0.x = cnv[a0 + 4];
-      n0.y = cnv[a0 + 5];
-      n0.z = cnv[a0 + 6];
-      v0.x = cnv[a0 + 7];
-      v0.y = cnv[a0 + 8];
-      v0.z = cnv[a0 + 9];
-
-      c1.r = cnv[a1 + 0];
-      c1.g = cnv[a1 + 1];
-      c1.b = cnv[a1 + 2];
-      n1.x = cnv[a1 + 4];
-      n1.y = cnv[a1 + 5];
-      n1.z = cnv[a1 + 6];
-      v1.x = cnv[a1 + 7];
-      v1.y = cnv[a1 + 8];
-      v1.z = cnv[a1 + 9];
-
-      c2.r = cnv[a2 + 0];
-      c2.g = cnv[a2 + 1];
-      c2.b = cnv[a2 + 2];
-      n2.x = cnv[a2 + 4];
-      n2.y = cnv[a2 + 5];
-      n2.z = cnv[a2 + 6];
-      v2.x = cnv[a2 + 7];
-      v2.y = cnv[a2 + 8];
-      v2.z = cnv[a2 + 9];
-
-      o = newvcstri(newtex, v0, v1, v2, n0, n1, n2, c0, c1, c2); 
-      if (scene->normalfixupmode)
-        vcstri_normal_fixup(o, scene->normalfixupmode);
-      add_bounded_object((scenedef *) scene, o);
+      /* use lookup table to fix winding order */
+      tris[i++] = facets[v + (stripaddr[t & 0x01][0])];
+      tris[i++] = facets[v + (stripaddr[t & 0x01][1])];
+      tris[i++] = facets[v + (stripaddr[t & 0x01][2])];
       v++; /* move on to next vertex */
     }
     v+=2; /* last two vertices are already used by last triangle */
   }
+
+  rt_trimesh(voidscene, tex, numverts, vert, norm, col, numtris, tris);
+
+  free(tris);
+  free(vert);
+  free(norm);
+  free(col);
 }
 
 
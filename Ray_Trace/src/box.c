@@ -11,6 +11,7 @@
 #include "vector.h"
 #include "intersect.h"
 #include "util.h"
+#include "packet.h"
 
 int box_bbox(void * obj, vector * min, vector * max) {
   box * b = (box *) obj;
@@ -21,11 +22,14 @@ int box_bbox(void * obj, vector * min, vector * max) {
   return 1;
 }
 
+static void box_packet_intersect(const box *, raypacket *);
+
 static object_methods box_methods = {
   (void (*)(const void *, void *))(box_intersect),
   (void (*)(const void *, const void *, const void *, void *))(box_normal),
   box_bbox, 
-  free 
+  free,
+  (void (*)(const void *, void *))(box_packet_intersect)
 };
 
 box * newbox(void * tex, vector min, vector max) {
@@ -91,6 +95,42 @@ void box_intersect(const box * bx, ray * ry) {
   ry->add_intersection(tfar, (object *) bx, ry);
 }
 
+/*
+ * Slab test of box_intersect() on every lane of a packet.  Since tnear
+ * only grows and tfar only shrinks, testing them once at the end gives
+ * the same answer as the early outs of the scalar version.  A lane
+ * parallel to a slab and outside it gets an empty interval.
+ */
+#define BOX_SLAB(o, d, bmin, bmax) \
+  t1 = (bmin - o) / ((d != 0.0) ? d : 1.0); \
+  t2 = (bmax - o) / ((d != 0.0) ? d : 1.0); \
+  out = ((o < bmin) || (o > bmax)) ? FHUGE : -FHUGE; \
+  lo = (d != 0.0) ? MYMIN(t1, t2) :  out; \
+  hi = (d != 0.0) ? MYMAX(t1, t2) : -out; \
+  tn = MYMAX(tn, lo); \
+  tf = MYMIN(tf, hi);
+
+static void box_packet_intersect(const box * bx, raypacket * pk) {
+  flt tnear[RT_PACKET_MAX], tfar[RT_PACKET_MAX];
+  int i, n = pk->num;
+
+  for (i=0; i<n; i++) {
+    flt t1, t2, lo, hi, out, tn, tf, hit;
+
+    tn = -FHUGE;
+    tf = FHUGE;
+    BOX_SLAB(pk->ox[i], pk->dx[i], bx->min.x, bx->max.x)
+    BOX_SLAB(pk->oy[i], pk->dy[i], bx->min.y, bx->max.y)
+    BOX_SLAB(pk->oz[i], pk->dz[i], bx->min.z, bx->max.z)
+    hit = (tf >= 0.0) ? tf - tn : -1.0;
+    tnear[i] = (hit >= 0.0) ? tn : 0.0;
+    tfar[i]  = (hit >= 0.0) ? tf : 0.0;
+  }
+
+  packet_hits(pk, (object *) bx, tnear);
+  packet_hits(pk, (object *) bx, tfar);
+}
+
 void box_normal(const box * bx, const vector * pnt, const ray * incident, vector * N) {
   vector a, b, c; 
   flt t;
@@ -0,0 +1,808 @@
+/*
+ * bvh.c - bounding volume hierarchy efficiency structures
+ *
+ * A binned surface area heuristic (SAH) BVH, selected with
+ * rt_boundmode(scene, RT_BOUNDING_BVH) in place of the hierarchical grid.
+ * Every bounded object ends up in exactly one leaf, so no mailboxes are
+ * needed, and the tree is traversed near child first so maxdist shrinks
+ * early.  Large subtrees are built by separate threads.
+ *
+ * $Id$
+ *
+ */
+
+#include <float.h>
+#include "machine.h"
+#include "types.h"
+#include "macros.h"
+#include "vector.h"
+#include "intersect.h"
+#include "util.h"
+#include "ui.h"
+#include "threads.h"
+#include "packet.h"
+
+#define BVH_PRIVATE
+#include "bvh.h"
+
+/* component a (0, 1, 2 for X, Y, Z) of a vector */
+#define VAXIS(v, a) (((flt *) &(v))[a])
+
+static object_methods bvh_methods = {
+  (void (*)(const void *, void *))(bvh_intersect),
+  (void (*)(const void *, const void *, const void *, void *))(NULL),
+  bvh_bbox,
+  bvh_free,
+  (void (*)(const void *, void *))(bvh_packet_intersect)
+};
+
+static int bvh_bbox(void * obj, vector * min, vector * max) {
+  bvh * b = (bvh *) obj;
+
+  *min = b->min;
+  *max = b->max;
+
+  return 1;
+}
+
+static void bvh_free(void * v) {
+  bvh * b = (bvh *) v;
+
+  free(b->nodes);
+  free(b->objs);
+
+  /* free all objects on the hierarchy's object list */
+  free_objects(b->objects);
+
+  free(b);
+}
+
+/* half the surface area of a box */
+static flt halfarea(const vector * min, const vector * max) {
+  flt dx, dy, dz;
+
+  dx = max->x - min->x;
+  dy = max->y - min->y;
+  dz = max->z - min->z;
+  if (dx < 0.0 || dy < 0.0 || dz < 0.0)
+    return 0.0;
+
+  return dx*dy + dy*dz + dz*dx;
+}
+
+static void emptybox(vector * min, vector * max) {
+  min->x =  FHUGE;   min->y =  FHUGE;   min->z =  FHUGE;
+  max->x = -FHUGE;   max->y = -FHUGE;   max->z = -FHUGE;
+}
+
+static void growbox(vector * min, vector * max,
+                    const vector * omin, const vector * omax) {
+  min->x = MYMIN(min->x, omin->x);
+  min->y = MYMIN(min->y, omin->y);
+  min->z = MYMIN(min->z, omin->z);
+  max->x = MYMAX(max->x, omax->x);
+  max->y = MYMAX(max->y, omax->y);
+  max->z = MYMAX(max->z, omax->z);
+}
+
+/* round outwards by at least one unit in the last place of a float */
+static float floatdown(flt x) {
+  float f = (float) x;
+  return f - (float) (fabs(f) * FLT_EPSILON) - FLT_MIN;
+}
+
+static float floatup(flt x) {
+  float f = (float) x;
+  return f + (float) (fabs(f) * FLT_EPSILON) + FLT_MIN;
+}
+
+
+#ifdef THR
+static void * bvh_build_task(void * voidparms) {
+  bvh_build((bvhtask *) voidparms);
+  return NULL;
+}
+#endif
+
+/*
+ * Build the subtree over idx[start .. start+num-1]: split at the best of
+ * the BVH_BINS-1 candidate planes per axis, or make a leaf if that is
+ * cheaper.  Past half the depth limit the objects are split in halves
+ * instead, so the depth stays bounded.
+ */
+static void bvh_build(bvhtask * task) {
+  bvhdata * d = task->data;
+  bvhbuild * n;
+  bvhtask sub[2];
+  struct {
+    vector min, max;
+    int num;
+  } bins[3][BVH_BINS];
+  flt rarea[BVH_BINS], scale[3], ext, cost, bestcost, area;
+  vector cmin, cmax, lmin, lmax;
+  int i, j, k, a, num, start, lnum, rnum[BVH_BINS], bestaxis, bestsplit;
+  int *idx = d->idx;
+#ifdef THR
+  rt_thread_t thr;
+#endif
+
+  num = task->num;
+  start = task->start;
+
+  n = (bvhbuild *) malloc(sizeof(bvhbuild));
+  n->child[0] = n->child[1] = NULL;
+  n->start = start;
+  n->num = num;
+  n->axis = 0;
+  task->node = n;
+  task->numnodes = 1;
+  task->maxdepth = task->depth;
+
+  /* object bounds, and the bounds of their centers */
+  emptybox(&n->min, &n->max);
+  emptybox(&cmin, &cmax);
+  for (i=start; i<start+num; i++) {
+    growbox(&n->min, &n->max, &d->bmin[idx[i]], &d->bmax[idx[i]]);
+    growbox(&cmin, &cmax, &d->cent[idx[i]], &d->cent[idx[i]]);
+  }
+
+  if (num <= BVH_LEAFSIZE || task->depth >= BVH_MAXDEPTH)
+    return;
+
+  bestaxis = -1;
+  bestsplit = 0;
+  bestcost = FHUGE;
+
+  if (task->depth < BVH_MAXDEPTH / 2) {
+    /* drop the objects into bins along each axis */
+    for (a=0; a<3; a++) {
+      for (j=0; j<BVH_BINS; j++) {
+        emptybox(&bins[a][j].min, &bins[a][j].max);
+        bins[a][j].num = 0;
+      }
+      ext = VAXIS(cmax, a) - VAXIS(cmin, a);
+      scale[a] = (ext > ZEROEPSILON) ? (BVH_BINS * (1.0 - 1e-6)) / ext : 0.0;
+    }
+
+    for (i=start; i<start+num; i++) {
+      k = idx[i];
+      for (a=0; a<3; a++) {
+        if (scale[a] == 0.0)
+          continue;
+        j = (int) ((VAXIS(d->cent[k], a) - VAXIS(cmin, a)) * scale[a]);
+        if (j >= BVH_BINS) j = BVH_BINS - 1;
+        if (j < 0) j = 0;
+        growbox(&bins[a][j].min, &bins[a][j].max, &d->bmin[k], &d->bmax[k]);
+        bins[a][j].num++;
+      }
+    }
+
+    /* sweep from the right, then evaluate each plane from the left */
+    for (a=0; a<3; a++) {
+      if (scale[a] == 0.0)
+        continue;
+
+      emptybox(&lmin, &lmax);
+      lnum = 0;
+      for (j=BVH_BINS-1; j>0; j--) {
+        growbox(&lmin, &lmax, &bins[a][j].min, &bins[a][j].max);
+        lnum += bins[a][j].num;
+        rarea[j] = halfarea(&lmin, &lmax);
+        rnum[j] = lnum;
+      }
+
+      emptybox(&lmin, &lmax);
+      lnum = 0;
+      for (j=0; j<BVH_BINS-1; j++) {
+        growbox(&lmin, &lmax, &bins[a][j].min, &bins[a][j].max);
+        lnum += bins[a][j].num;
+        if (lnum == 0 || rnum[j+1] == 0)
+          continue;
+        cost = halfarea(&lmin, &lmax) * lnum + rarea[j+1] * rnum[j+1];
+        if (cost < bestcost) {
+          bestcost = cost;
+          bestaxis = a;
+          bestsplit = j;
+        }
+      }
+    }
+
+    area = halfarea(&n->min, &n->max);
+    if (bestaxis >= 0 && area > 0.0)
+      bestcost = BVH_TRAVCOST + BVH_OBJCOST * bestcost / area;
+    else
+      bestaxis = -1;
+
+    /* a leaf is cheaper */
+    if (num <= BVH_MAXLEAF &&
+        (bestaxis < 0 || bestcost >= BVH_OBJCOST * num))
+      return;
+  }
+
+  if (bestaxis >= 0) {
+    /* partition by bin */
+    i = start;
+    j = start + num - 1;
+    while (i <= j) {
+      k = (int) ((VAXIS(d->cent[idx[i]], bestaxis) - VAXIS(cmin, bestaxis))
+                 * scale[bestaxis]);
+      if (k <= bestsplit) {
+        i++;
+      } else {
+        k = idx[i]; idx[i] = idx[j]; idx[j] = k;
+        j--;
+      }
+    }
+    lnum = i - start;
+    n->axis = bestaxis;
+  } else {
+    /* no usable plane: halve the list along the longest center axis */
+    lnum = num / 2;
+    VSub(&cmax, &cmin, &lmax);
+    n->axis = (lmax.x > lmax.y) ? ((lmax.x > lmax.z) ? 0 : 2)
+                                : ((lmax.y > lmax.z) ? 1 : 2);
+  }
+
+  if (lnum == 0 || lnum == num)
+    lnum = num / 2;
+
+  n->num = 0;
+  for (i=0; i<2; i++) {
+    sub[i].data = d;
+    sub[i].depth = task->depth + 1;
+    sub[i].nthr = 1;
+  }
+  sub[0].start = start;
+  sub[0].num = lnum;
+  sub[1].start = start + lnum;
+  sub[1].num = num - lnum;
+
+#ifdef THR
+  if (task->nthr > 1 && num >= BVH_PARSIZE) {
+    /* hand the second half to another thread */
+    sub[0].nthr = task->nthr / 2;
+    sub[1].nthr = task->nthr - sub[0].nthr;
+    if (rt_thread_create(&thr, bvh_build_task, &sub[1]) == 0) {
+      bvh_build(&sub[0]);
+      rt_thread_join(thr, NULL);
+    } else {
+      bvh_build(&sub[0]);
+      bvh_build(&sub[1]);
+    }
+  } else
+#endif
+  {
+    bvh_build(&sub[0]);
+    bvh_build(&sub[1]);
+  }
+
+  for (i=0; i<2; i++) {
+    n->child[i] = sub[i].node;
+    task->numnodes += sub[i].numnodes;
+    task->maxdepth = MYMAX(task->maxdepth, sub[i].maxdepth);
+  }
+}
+
+/* store node n and its subtree depth first from nodes[next] on, and the
+   objects of its leaves in order[], return the index following the
+   subtree */
+static int bvh_flatten(bvhnode * nodes, const bvhdata * data, int * order,
+                       const bvhbuild * n, int next, int * nextobj) {
+  bvhnode * f = &nodes[next];
+  int i;
+
+  f->min[0] = floatdown(n->min.x);
+  f->min[1] = floatdown(n->min.y);
+  f->min[2] = floatdown(n->min.z);
+  f->max[0] = floatup(n->max.x);
+  f->max[1] = floatup(n->max.y);
+  f->max[2] = floatup(n->max.z);
+  f->axis = n->axis;
+  f->num = n->num;
+
+  if (n->num) {
+    f->offset = *nextobj;
+    for (i=0; i<n->num; i++)
+      order[(*nextobj)++] = data->idx[n->start + i];
+    return next + 1;
+  }
+
+  i = bvh_flatten(nodes, data, order, n->child[0], next + 1, nextobj);
+  f->offset = i;
+  return bvh_flatten(nodes, data, order, n->child[1], i, nextobj);
+}
+
+static void bvh_free_build(bvhbuild * n) {
+  if (n == NULL)
+    return;
+  bvh_free_build(n->child[0]);
+  bvh_free_build(n->child[1]);
+  free(n);
+}
+
+
+/*
+ * Build a hierarchy over num primitives with the given bounds, using up
+ * to nthr threads.  Returns the flattened nodes; leaf offsets index
+ * order[], which receives the primitive numbers in leaf order.
+ */
+bvhnode * bvh_build_nodes(int num, const vector * bmin, const vector * bmax,
+                          int nthr, int * order, int * numnodes,
+                          int * maxdepth) {
+  bvhnode * nodes;
+  bvhdata data;
+  bvhtask task;
+  int i, numleaves;
+
+  data.bmin = bmin;
+  data.bmax = bmax;
+  data.cent = (vector *) malloc(num * sizeof(vector));
+  data.idx = (int *) malloc(num * sizeof(int));
+  for (i=0; i<num; i++) {
+    data.cent[i].x = 0.5 * (bmin[i].x + bmax[i].x);
+    data.cent[i].y = 0.5 * (bmin[i].y + bmax[i].y);
+    data.cent[i].z = 0.5 * (bmin[i].z + bmax[i].z);
+    data.idx[i] = i;
+  }
+
+  task.data = &data;
+  task.start = 0;
+  task.num = num;
+  task.depth = 0;
+  task.nthr = (nthr > 1) ? nthr : 1;
+  bvh_build(&task);
+
+  nodes = (bvhnode *) malloc(task.numnodes * sizeof(bvhnode));
+  numleaves = 0;
+  bvh_flatten(nodes, &data, order, task.node, 0, &numleaves);
+  *numnodes = task.numnodes;
+  *maxdepth = task.maxdepth;
+  bvh_free_build(task.node);
+
+  free(data.cent);
+  free(data.idx);
+
+  return nodes;
+}
+
+
+int bvh_scene(scenedef * scene, int boundthresh) {
+  bvh * b;
+  bvhcache * c;
+  object ** objlist;
+  object * cur, * next, ** prev;
+  vector min, max, * bmin, * bmax;
+  int i, numobj, numleaves, maxdepth, nthr, * order;
+  rt_timerhandle t;
+  char msgtxt[256];
+
+  if (scene->objgroup.boundedobj == NULL)
+    return 0;
+
+  numobj = 0;
+  for (cur=scene->objgroup.boundedobj; cur != NULL; cur=cur->nextobj)
+    numobj++;
+
+  if (scene->mynode == 0) {
+    sprintf(msgtxt, "Scene contains %d objects.", numobj);
+    rt_ui_message(MSG_0, msgtxt);
+  }
+
+  if (numobj <= boundthresh)
+    return 1;
+
+  t = rt_timer_create();
+  rt_timer_start(t);
+
+  objlist = (object **) malloc(numobj * sizeof(object *));
+  bmin = (vector *) malloc(numobj * sizeof(vector));
+  bmax = (vector *) malloc(numobj * sizeof(vector));
+
+  b = (bvh *) malloc(sizeof(bvh));
+  memset(b, 0, sizeof(bvh));
+  b->methods = &bvh_methods;
+  b->id = new_objectid(scene);
+
+  /* take every object with bounds off the scene's list */
+  numobj = 0;
+  prev = &scene->objgroup.boundedobj;
+  for (cur=scene->objgroup.boundedobj; cur != NULL; cur=next) {
+    next = cur->nextobj;
+    min.x = -FHUGE; min.y = -FHUGE; min.z = -FHUGE;
+    max.x =  FHUGE; max.y =  FHUGE; max.z =  FHUGE;
+    if (cur->methods->bbox((void *) cur, &min, &max)) {
+      *prev = next;
+      cur->nextobj = b->objects;
+      b->objects = cur;
+
+      objlist[numobj] = cur;
+      bmin[numobj] = min;
+      bmax[numobj] = max;
+      numobj++;
+    } else {
+      prev = (object **) &cur->nextobj;
+    }
+  }
+
+  if (numobj > 0) {
+    /* use an imported hierarchy if it was built for these objects */
+    c = (bvhcache *) scene->bvhimport;
+    if (c != NULL && (maxdepth = bvh_check(c, numobj, bmin, bmax)) >= 0) {
+      nthr = 0;
+      b->numnodes = c->numnodes;
+      b->nodes = c->nodes;
+      order = c->order;
+      c->nodes = NULL;
+      c->order = NULL;
+    } else {
+      nthr = (scene->numthreads > 1) ? scene->numthreads : 1;
+      order = (int *) malloc(numobj * sizeof(int));
+      b->nodes = bvh_build_nodes(numobj, bmin, bmax, nthr, order,
+                                 &b->numnodes, &maxdepth);
+    }
+    bvh_free_import(scene);
+
+    b->objs = (object **) malloc(numobj * sizeof(object *));
+    for (i=0; i<numobj; i++)
+      b->objs[i] = objlist[order[i]];
+    free(order);
+
+    b->min = b->max = bmin[0];
+    for (i=0; i<numobj; i++)
+      growbox(&b->min, &b->max, &bmin[i], &bmax[i]);
+
+    /* add the hierarchy to the bounded object list */
+    b->nextobj = scene->objgroup.boundedobj;
+    scene->objgroup.boundedobj = (object *) b;
+
+    rt_timer_stop(t);
+    if (scene->verbosemode && scene->mynode == 0) {
+      numleaves = 0;
+      for (i=0; i<b->numnodes; i++)
+        if (b->nodes[i].num)
+          numleaves++;
+      sprintf(msgtxt, "BVH:  Nodes:%9d  Leaves:%9d  Depth:%3d  Obj:%9d  Obj/Leaf: %7.3f",
+              b->numnodes, numleaves, maxdepth, numobj,
+              ((float) numobj) / ((float) numleaves));
+      rt_ui_message(MSG_0, msgtxt);
+      if (nthr > 0)
+        sprintf(msgtxt, "BVH build time: %.3f seconds, %d threads",
+                rt_timer_time(t), nthr);
+      else
+        sprintf(msgtxt, "BVH import time: %.3f seconds", rt_timer_time(t));
+      rt_ui_message(MSG_0, msgtxt);
+    }
+  } else {
+    free(b);
+  }
+  rt_timer_destroy(t);
+
+  free(objlist);
+  free(bmin);
+  free(bmax);
+
+  return 1;
+}
+
+
+/*
+ * Check an imported hierarchy against the bounds of the num objects it is
+ * meant for: a tree no deeper than the traversal stack, whose leaves hold
+ * every object exactly once, in order, and whose boxes enclose their
+ * children and objects.  Returns the depth of the tree, or -1.
+ */
+static int bvh_check(const bvhcache * c, int num,
+                     const vector * bmin, const vector * bmax) {
+  const bvhnode * n, * p;
+  int stack[BVH_MAXDEPTH + 1], depth[BVH_MAXDEPTH + 1];
+  int sp, i, j, k, d, nextobj, maxdepth, ok;
+  unsigned char * seen;
+
+  if (c->numobj != num || c->numnodes < 1 ||
+      c->nodes == NULL || c->order == NULL)
+    return -1;
+
+  seen = (unsigned char *) calloc(num, 1);
+  ok = 1;
+  for (j=0; j<num && ok; j++) {
+    k = c->order[j];
+    if (k < 0 || k >= num || seen[k])
+      ok = 0;
+    else
+      seen[k] = 1;
+  }
+  free(seen);
+
+  /* walk the tree depth first, first child first, as it was flattened */
+  nextobj = 0;
+  maxdepth = 0;
+  sp = 0;
+  stack[0] = 0;
+  depth[0] = 0;
+  while (ok && sp >= 0) {
+    i = stack[sp];
+    d = depth[sp--];
+    n = &c->nodes[i];
+    maxdepth = MYMAX(maxdepth, d);
+
+    if (n->num) {
+      if (n->offset != nextobj || n->offset + n->num > num) {
+        ok = 0;
+        break;
+      }
+      for (j=n->offset; j<n->offset+n->num; j++) {
+        k = c->order[j];
+        if (bmin[k].x < n->min[0] || bmin[k].y < n->min[1] ||
+            bmin[k].z < n->min[2] || bmax[k].x > n->max[0] ||
+            bmax[k].y > n->max[1] || bmax[k].z > n->max[2])
+          ok = 0;
+      }
+      nextobj += n->num;
+      continue;
+    }
+
+    /* the second child follows the first child's subtree */
+    if (d >= BVH_MAXDEPTH || n->axis > 2 ||
+        i + 1 >= n->offset || n->offset >= c->numnodes) {
+      ok = 0;
+      break;
+    }
+    for (j=0; j<2; j++) {
+      p = &c->nodes[j ? n->offset : i + 1];
+      for (k=0; k<3; k++)
+        if (p->min[k] < n->min[k] || p->max[k] > n->max[k])
+          ok = 0;
+    }
+    stack[++sp] = n->offset;
+    depth[sp] = d + 1;
+    stack[++sp] = i + 1;
+    depth[sp] = d + 1;
+  }
+
+  if (!ok || nextobj != num)
+    return -1;
+
+  return maxdepth;
+}
+
+
+/*
+ * Build the hierarchy bvh_scene() would build for the objects currently
+ * on the scene's list, without changing the scene.  Returns 0 if it would
+ * not build one.
+ */
+int bvh_export(scenedef * scene, int * numnodes, bvhnode ** nodes,
+               int * numobj, int ** order) {
+  object * cur;
+  vector min, max, * bmin, * bmax;
+  int num, nthr, maxdepth;
+
+  num = 0;
+  for (cur=scene->objgroup.boundedobj; cur != NULL; cur=cur->nextobj)
+    num++;
+  if (num == 0 || num <= scene->boundthresh)
+    return 0;
+
+  bmin = (vector *) malloc(num * sizeof(vector));
+  bmax = (vector *) malloc(num * sizeof(vector));
+  num = 0;
+  for (cur=scene->objgroup.boundedobj; cur != NULL; cur=cur->nextobj) {
+    min.x = -FHUGE; min.y = -FHUGE; min.z = -FHUGE;
+    max.x =  FHUGE; max.y =  FHUGE; max.z =  FHUGE;
+    if (cur->methods->bbox((void *) cur, &min, &max)) {
+      bmin[num] = min;
+      bmax[num] = max;
+      num++;
+    }
+  }
+
+  if (num > 0) {
+    nthr = (scene->numthreads > 1) ? scene->numthreads : 1;
+    *order = (int *) malloc(num * sizeof(int));
+    *nodes = bvh_build_nodes(num, bmin, bmax, nthr, *order,
+                             numnodes, &maxdepth);
+    *numobj = num;
+  }
+
+  free(bmin);
+  free(bmax);
+
+  return num > 0;
+}
+
+
+/*
+ * Keep a copy of a hierarchy from bvh_export() for the next bvh_scene(),
+ * which uses it in place of building one if bvh_check() accepts it.
+ */
+void bvh_import(scenedef * scene, int numnodes, const bvhnode * nodes,
+                int numobj, const int * order) {
+  bvhcache * c;
+
+  bvh_free_import(scene);
+  if (numnodes < 1 || numobj < 1)
+    return;
+
+  c = (bvhcache *) malloc(sizeof(bvhcache));
+  c->numnodes = numnodes;
+  c->nodes = (bvhnode *) malloc(numnodes * sizeof(bvhnode));
+  memcpy(c->nodes, nodes, numnodes * sizeof(bvhnode));
+  c->numobj = numobj;
+  c->order = (int *) malloc(numobj * sizeof(int));
+  memcpy(c->order, order, numobj * sizeof(int));
+  scene->bvhimport = c;
+}
+
+void bvh_free_import(scenedef * scene) {
+  bvhcache * c = (bvhcache *) scene->bvhimport;
+
+  if (c != NULL) {
+    free(c->nodes);
+    free(c->order);
+    free(c);
+    scene->bvhimport = NULL;
+  }
+}
+
+
+/* the real thing */
+static void bvh_intersect(const bvh * b, ray * ry) {
+  const bvhnode * n;
+  int stack[BVH_MAXDEPTH + 1];
+  int sp, i, k, neg[3];
+  flt inv[3], org[3], t0, t1, tnear, tfar;
+
+  if (ry->flags & RT_RAY_FINISHED)
+    return;
+
+  org[0] = ry->o.x;  org[1] = ry->o.y;  org[2] = ry->o.z;
+  for (k=0; k<3; k++) {
+    t0 = VAXIS(ry->d, k);
+    if (t0 > 1e-20 || t0 < -1e-20)
+      inv[k] = 1.0f / t0;
+    else
+      inv[k] = (t0 < 0.0) ? -FHUGE : FHUGE;
+    neg[k] = inv[k] < 0.0;
+  }
+
+  sp = 0;
+  i = 0;
+  for (;;) {
+    n = &b->nodes[i];
+
+    /* slab test against [0, maxdist], maxdist shrinks with every hit */
+    tnear = 0.0;
+    tfar = ry->maxdist;
+    for (k=0; k<3; k++) {
+      t0 = ((neg[k] ? n->max[k] : n->min[k]) - org[k]) * inv[k];
+      t1 = ((neg[k] ? n->min[k] : n->max[k]) - org[k]) * inv[k];
+      if (t0 > tnear) tnear = t0;
+      if (t1 < tfar)  tfar = t1;
+    }
+
+    if (tnear <= tfar) {
+      if (n->num == 0) {
+        /* visit the child on the near side of the split first */
+        if (neg[n->axis]) {
+          stack[sp++] = i + 1;
+          i = n->offset;
+        } else {
+          stack[sp++] = n->offset;
+          i = i + 1;
+        }
+        continue;
+      }
+
+      for (k=n->offset; k<n->offset+n->num; k++)
+        b->objs[k]->methods->intersect(b->objs[k], ry);
+
+      if (ry->flags & RT_RAY_FINISHED)
+        return;
+    }
+
+    if (sp == 0)
+      return;
+    i = stack[--sp];
+  }
+}
+
+
+/*
+ * Slab test of one node against the lanes in mask, returns the lanes
+ * that overlap it within [0, maxdist].
+ */
+static unsigned int bvh_packet_node(const bvhnode * n, const raypacket * pk,
+                                    unsigned int mask) {
+  flt overlap[RT_PACKET_MAX];
+  unsigned int hits;
+  int i;
+
+  for (i=0; i<pk->num; i++) {
+    flt t0, t1, tnear, tfar;
+
+    tnear = 0.0;
+    tfar = pk->maxdist[i];
+    t0 = (n->min[0] - pk->ox[i]) * pk->ix[i];
+    t1 = (n->max[0] - pk->ox[i]) * pk->ix[i];
+    tnear = MYMAX(tnear, MYMIN(t0, t1));
+    tfar  = MYMIN(tfar,  MYMAX(t0, t1));
+    t0 = (n->min[1] - pk->oy[i]) * pk->iy[i];
+    t1 = (n->max[1] - pk->oy[i]) * pk->iy[i];
+    tnear = MYMAX(tnear, MYMIN(t0, t1));
+    tfar  = MYMIN(tfar,  MYMAX(t0, t1));
+    t0 = (n->min[2] - pk->oz[i]) * pk->iz[i];
+    t1 = (n->max[2] - pk->oz[i]) * pk->iz[i];
+    tnear = MYMAX(tnear, MYMIN(t0, t1));
+    tfar  = MYMIN(tfar,  MYMAX(t0, t1));
+    overlap[i] = tfar - tnear;
+  }
+
+  hits = 0;
+  for (i=0; i<pk->num; i++) {
+    if (overlap[i] >= 0.0)
+      hits |= 1u << i;
+  }
+
+  return hits & mask;
+}
+
+
+/*
+ * Walk a ray packet through the hierarchy.  A node is visited with the
+ * lanes that overlap it, and its children are ordered by the direction
+ * of the first of them.  Leaves test their objects against just those
+ * lanes.
+ */
+static void bvh_packet_intersect(const bvh * b, raypacket * pk) {
+  const bvhnode * n;
+  int stack[BVH_MAXDEPTH + 1];
+  unsigned int stackmask[BVH_MAXDEPTH + 1];
+  unsigned int saved, mask, finished;
+  int sp, i, k, first;
+  flt dir;
+
+  saved = pk->active;
+  finished = 0;
+  sp = 0;
+  i = 0;
+  mask = saved;
+  for (;;) {
+    n = &b->nodes[i];
+    mask = bvh_packet_node(n, pk, mask & ~finished);
+
+    if (mask != 0) {
+      if (n->num == 0) {
+        /* visit the child on the near side of the split first */
+        for (first=0; !(mask & (1u << first)); first++)
+          ;
+        dir = (n->axis == 0) ? pk->ix[first] :
+              (n->axis == 1) ? pk->iy[first] : pk->iz[first];
+        stackmask[sp] = mask;
+        if (dir < 0.0) {
+          stack[sp++] = i + 1;
+          i = n->offset;
+        } else {
+          stack[sp++] = n->offset;
+          i = i + 1;
+        }
+        continue;
+      }
+
+      pk->active = mask;
+      for (k=n->offset; k<n->offset+n->num && pk->active != 0; k++)
+        packet_intersect(b->objs[k], pk);
+      finished |= mask & ~pk->active;
+
+      if ((saved & ~finished) == 0)
+        break;
+    }
+
+    if (sp == 0)
+      break;
+    sp--;
+    i = stack[sp];
+    mask = stackmask[sp];
+  }
+
+  pk->active = saved & ~finished;
+}
@@ -0,0 +1,111 @@
+/*
+ * bvh.h - bounding volume hierarchy efficiency structures
+ *
+ * $Id$
+ *
+ */
+
+#define BVH_MAXDEPTH  60   /* depth limit, bounds the traversal stack      */
+
+/*
+ * Flattened node, 32 bytes.  Nodes are stored depth first, so the first
+ * child of an inner node immediately follows it.  The single precision
+ * bounds are rounded outwards from the double precision object bounds.
+ */
+typedef struct {
+  float min[3];           /* node bounds                                  */
+  float max[3];
+  int offset;             /* leaf: first object, inner: second child      */
+  unsigned short num;     /* leaf: number of objects, inner: 0            */
+  unsigned short axis;    /* inner: split axis, for ordered traversal     */
+} bvhnode;
+
+/*
+ * A scene hierarchy kept outside the scene, see rt_bvh_export() and
+ * rt_bvh_import().  Leaf offsets index order[], which holds the numbers
+ * of the scene's bounded objects in leaf order, counted in list order.
+ */
+typedef struct {
+  int numnodes;
+  bvhnode * nodes;
+  int numobj;
+  int * order;
+} bvhcache;
+
+int bvh_scene(scenedef * scene, int boundthresh);
+bvhnode * bvh_build_nodes(int num, const vector * bmin, const vector * bmax,
+                          int nthr, int * order, int * numnodes,
+                          int * maxdepth);
+int bvh_export(scenedef * scene, int * numnodes, bvhnode ** nodes,
+               int * numobj, int ** order);
+void bvh_import(scenedef * scene, int numnodes, const bvhnode * nodes,
+                int numobj, const int * order);
+void bvh_free_import(scenedef * scene);
+
+#ifdef BVH_PRIVATE
+
+#define BVH_BINS      16   /* SAH candidate planes per axis, plus one      */
+#define BVH_LEAFSIZE   4   /* always make a leaf at or below this size     */
+#define BVH_MAXLEAF   16   /* never make a leaf above this size            */
+#define BVH_PARSIZE 4096   /* smallest subtree handed to another thread    */
+#define BVH_TRAVCOST 1.0   /* SAH cost of visiting an inner node           */
+#define BVH_OBJCOST  1.0   /* SAH cost of intersecting one object          */
+
+typedef struct {
+  RT_OBJECT_HEAD
+  vector min;             /* bounds of the whole hierarchy                */
+  vector max;
+  int numnodes;           /* nodes in the flattened tree                  */
+  bvhnode * nodes;        /* the flattened tree                           */
+  object ** objs;         /* objects in leaf order                        */
+  object * objects;       /* all objects contained in the hierarchy       */
+} bvh;
+
+/* node of the tree as it is built, before it is flattened */
+typedef struct bvhbuild {
+  vector min;             /* bounds of the objects below                  */
+  vector max;
+  struct bvhbuild * child[2];
+  int start;              /* leaf: first object index                     */
+  int num;                /* leaf: number of objects, inner: 0            */
+  int axis;               /* inner: split axis                            */
+} bvhbuild;
+
+/* state shared by the threads building one hierarchy */
+typedef struct {
+  const vector * bmin;    /* object bounds                                */
+  const vector * bmax;
+  vector * cent;          /* object bound centers                         */
+  int * idx;              /* object indices, partitioned while building   */
+} bvhdata;
+
+typedef struct {
+  bvhdata * data;
+  int start;              /* objects idx[start .. start+num-1]            */
+  int num;
+  int depth;
+  int nthr;               /* threads this subtree may use                 */
+  bvhbuild * node;        /* result                                       */
+  int numnodes;           /* nodes created in the subtree                 */
+  int maxdepth;           /* deepest leaf in the subtree                  */
+} bvhtask;
+
+static int bvh_bbox(void * obj, vector * min, vector * max);
+static void bvh_free(void * v);
+static void bvh_intersect(const bvh *, ray *);
+static unsigned int bvh_packet_node(const bvhnode *, const raypacket *,
+                                    unsigned int);
+static void bvh_packet_intersect(const bvh *, raypacket *);
+
+#ifdef THR
+static void * bvh_build_task(void * voidparms);
+#endif
+static void bvh_build(bvhtask * task);
+static int bvh_flatten(bvhnode * nodes, const bvhdata * data, int * order,
+                       const bvhbuild * n, int next, int * nextobj);
+static void bvh_free_build(bvhbuild * n);
+static int bvh_check(const bvhcache * c, int num,
+                     const vector * bmin, const vector * bmax);
+
+#endif
+
@@ -21,32 +21,46 @@ void camera_init(scenedef *scene) {
   flt sx, sy;
   
   /* setup function pointer for camera ray generation */
+  /* progressive rendering takes its samples one pass at a time, */
+  /* so each pixel gets a single ray from cam_ray in a pass      */
+  scene->camera.cam_setup = NULL; /* no ray packets with AA or DOF */
   switch (scene->camera.projection) {
     case RT_PROJECTION_PERSPECTIVE:
-      if (scene->antialiasing > 0) {
+      scene->camera.cam_sample = (color (*)(void *,flt,flt)) cam_perspective_jitter_ray;
+      if (scene->antialiasing > 0 && !scene->progressive) {
         scene->camera.cam_ray = (color (*)(void *,flt,flt)) cam_aa_perspective_ray;
       } else {
         scene->camera.cam_ray = (color (*)(void *,flt,flt)) cam_perspective_ray;
+        scene->camera.cam_setup = (void (*)(void *,flt,flt)) cam_perspective_setup;
       }
       break;
 
     case RT_PROJECTION_PERSPECTIVE_DOF:
-      scene->camera.cam_ray = (color (*)(void *,flt,flt)) cam_aa_dof_ray;
+      scene->camera.cam_sample = (color (*)(void *,flt,flt)) cam_dof_jitter_ray;
+      if (!scene->progressive) {
+        scene->camera.cam_ray = (color (*)(void *,flt,flt)) cam_aa_dof_ray;
+      } else {
+        scene->camera.cam_ray = (color (*)(void *,flt,flt)) cam_dof_ray;
+      }
       break;
 
     case RT_PROJECTION_ORTHOGRAPHIC:
-      if (scene->antialiasing > 0) {
+      scene->camera.cam_sample = (color (*)(void *,flt,flt)) cam_orthographic_jitter_ray;
+      if (scene->antialiasing > 0 && !scene->progressive) {
         scene->camera.cam_ray = (color (*)(void *,flt,flt)) cam_aa_orthographic_ray;
       } else {
         scene->camera.cam_ray = (color (*)(void *,flt,flt)) cam_orthographic_ray;
+        scene->camera.cam_setup = (void (*)(void *,flt,flt)) cam_orthographic_setup;
       }
       break;
 
     case RT_PROJECTION_FISHEYE:
-      if (scene->antialiasing > 0) {
+      scene->camera.cam_sample = (color (*)(void *,flt,flt)) cam_fisheye_jitter_ray;
+      if (scene->antialiasing > 0 && !scene->progressive) {
         scene->camera.cam_ray = (color (*)(void *,flt,flt)) cam_aa_fisheye_ray;
       } else {
         scene->camera.cam_ray = (color (*)(void *,flt,flt)) cam_fisheye_ray;
+        scene->camera.cam_setup = (void (*)(void *,flt,flt)) cam_fisheye_setup;
       }
       break;
   }
@@ -156,7 +170,7 @@ void camera_init(scenedef *scene) {
  *   data to this ray.
  */
 void camray_init(scenedef *scene, ray *primary, unsigned long serial, 
-                 unsigned long * mbox, unsigned int randval) {
+                 mailbox * mbox, unsigned int randval) {
   /* setup the right function pointer depending on what features are in use */
   if (scene->flags & RT_SHADE_CLIPPING) {
     primary->add_intersection = add_clipped_intersection;
@@ -178,160 +192,143 @@ void camray_init(scenedef *scene, ray *primary, unsigned long serial,
   primary->o = scene->camera.center;
 }
 
+/*
+ * cam_aa_converged()
+ *  Test whether the mean of n color samples, given their sum and sum
+ *  of squares, is known to within thresh in each channel, taking the
+ *  standard error of the mean as the measure of what is left to gain.
+ */
+int cam_aa_converged(const color * sum, const color * sumsq, int n, 
+                     flt thresh) {
+  flt rn, mean, err2, thresh2;
+
+  rn = 1.0 / n;
+  thresh2 = thresh * thresh * n;       /* compare variance to n*thresh^2 */
+
+  mean = sum->r * rn;
+  err2 = sumsq->r * rn - mean*mean;
+  if (err2 > thresh2)
+    return 0;
+
+  mean = sum->g * rn;
+  err2 = sumsq->g * rn - mean*mean;
+  if (err2 > thresh2)
+    return 0;
+
+  mean = sum->b * rn;
+  err2 = sumsq->b * rn - mean*mean;
+  if (err2 > thresh2)
+    return 0;
+
+  return 1;
+}
+
 
-#if 0
 /*
- * cam_aa_dof_ray() 
- *  Generate a perspective camera ray incorporating
- *  antialiasing and depth-of-field.
+ * cam_aa_samples()
+ *  Add the jittered antialiasing samples of a pixel to the color of
+ *  its first ray and average them.  With no threshold set, a fixed
+ *  scene->antialiasing samples are taken.  Otherwise they are taken in
+ *  groups of RT_AA_GROUP, stopping as soon as the pixel has converged,
+ *  so flat areas and background cost little more than a single ray.
  */
-color cam_aa_dof_ray(ray * ry, flt x, flt y) {
-  color col, sample;
-  color colsum, colsumsq, colvar;
-  int samples, samplegroup; 
+static color cam_aa_samples(ray * ry, flt x, flt y, color col) {
+  color avcol, sumsq;
+  int n, last; 
   scenedef * scene=ry->scene;
-  flt dx, dy, rnsamples, ftmp;
-  flt maxvar;
-
-  sample=cam_dof_ray(ry, x, y);     /* generate primary ray */
-  colsum = sample;                  /* accumulate first sample */
-  colsumsq.r = colsum.r * colsum.r; /* accumulate first squared sample */
-  colsumsq.g = colsum.g * colsum.g;
-  colsumsq.b = colsum.b * colsum.b;
+  float scale;
 
-  /* perform antialiasing if enabled.                           */
   /* samples are run through a very simple box filter averaging */
   /* each of the sample pixel colors to produce a final result  */
-  /* No special weighting is done based on the jitter values in */
-  /* the circle of confusion nor for the jitter within the      */
-  /* pixel in the image plane.                                  */ 
-
-  samples = 1; /* only one ray cast so far */
-  while (samples < scene->antialiasing) {
-#if 0
-    samplegroup = scene->antialiasing;
-#else
-    if (samples > 32) {
-      samplegroup = samples + 1;
-    } else {
-      samplegroup = samples + 32;
-    }
-#endif
-
-    for (; samples <= samplegroup; samples++) {
-      /* calculate random eye aperture offset */
-      float jxy[2];
-      jitter_offset2f(&ry->randval, jxy);
-      dx = jxy[0] * ry->scene->camera.aperture * ry->scene->hres; 
-      dy = jxy[1] * ry->scene->camera.aperture * ry->scene->vres; 
-
-      /* perturb the eye center by the random aperture offset */
-      ry->o.x = ry->scene->camera.center.x + 
-                dx * ry->scene->camera.iplaneright.x +
-                dy * ry->scene->camera.iplaneup.x;
-      ry->o.y = ry->scene->camera.center.y + 
-                dx * ry->scene->camera.iplaneright.y +
-                dy * ry->scene->camera.iplaneup.y;
-      ry->o.z = ry->scene->camera.center.z + 
-                dx * ry->scene->camera.iplaneright.z +
-                dy * ry->scene->camera.iplaneup.z;
-
-      /* shoot the ray, jittering the pixel position in the image plane */
-      jitter_offset2f(&ry->randval, jxy);
-      sample=cam_dof_ray(ry, x + jxy[0], y + jxy[1]);
-  
-      colsum.r += sample.r;               /* accumulate samples */
-      colsum.g += sample.g;
-      colsum.b += sample.b;
+  if (scene->aathresh <= 0.0) {
+    for (n=1; n <= scene->antialiasing; n++) {
+      avcol=scene->camera.cam_sample(ry, x, y);
 
-      colsumsq.r += sample.r * sample.r;  /* accumulate squared samples */
-      colsumsq.g += sample.g * sample.g;
-      colsumsq.b += sample.b * sample.b;
+      col.r += avcol.r;       /* accumulate antialiasing samples */
+      col.g += avcol.g;
+      col.b += avcol.b;
     }
+  } else {
+    sumsq.r = col.r * col.r;
+    sumsq.g = col.g * col.g;
+    sumsq.b = col.b * col.b;
+
+    n = 1; /* only one ray cast so far */
+    while (n <= scene->antialiasing) {
+      last = MYMIN(n + RT_AA_GROUP, scene->antialiasing + 1);
+      for (; n < last; n++) {
+        avcol=scene->camera.cam_sample(ry, x, y);
+
+        col.r += avcol.r;     /* accumulate antialiasing samples */
+        col.g += avcol.g;
+        col.b += avcol.b;
+
+        sumsq.r += avcol.r * avcol.r;  /* accumulate squared samples */
+        sumsq.g += avcol.g * avcol.g;
+        sumsq.b += avcol.b * avcol.b;
+      }
 
-    /* calculate the variance for the color samples we've taken so far */
-    rnsamples = 1.0 / samples;
-    ftmp = colsum.r * rnsamples;
-    colvar.r = ((colsumsq.r * rnsamples) - ftmp*ftmp) * rnsamples;
-    ftmp = colsum.g * rnsamples;
-    colvar.g = ((colsumsq.g * rnsamples) - ftmp*ftmp) * rnsamples;
-    ftmp = colsum.b * rnsamples;
-    colvar.b = ((colsumsq.b * rnsamples) - ftmp*ftmp) * rnsamples;
-
-    maxvar = 0.002; /* default maximum color variance to accept */
- 
-    /* early exit antialiasing if we're below maximum allowed variance */
-    if ((colvar.r < maxvar) && (colvar.g < maxvar) && (colvar.b < maxvar)) {
-      break; /* no more samples should be needed, we are happy now */
-    } 
+      /* early exit antialiasing if the mean is accurate enough */
+      if (cam_aa_converged(&col, &sumsq, n, scene->aathresh))
+        break;
+    }
   }
 
   /* average sample colors, back to range 0.0 - 1.0 */ 
-  col.r = colsum.r * rnsamples;
-  col.g = colsum.g * rnsamples;
-  col.b = colsum.b * rnsamples;
+  scale = 1.0f / n; 
+  col.r *= scale;
+  col.g *= scale;
+  col.b *= scale;
 
   return col;
 }
 
 
-#else
+/*
+ * cam_dof_jitter_ray() 
+ *  Generate a depth-of-field camera ray from a random point of the 
+ *  aperture, through a random point of the pixel.
+ */
+color cam_dof_jitter_ray(ray * ry, flt x, flt y) {
+  float jxy[2];
+  flt dx, dy;
+
+  /* calculate random eye aperture offset */
+  jitter_offset2f(&ry->randval, jxy);
+  dx = jxy[0] * ry->scene->camera.aperture * ry->scene->hres; 
+  dy = jxy[1] * ry->scene->camera.aperture * ry->scene->vres; 
+
+  /* perturb the eye center by the random aperture offset */
+  ry->o.x = ry->scene->camera.center.x + 
+            dx * ry->scene->camera.iplaneright.x +
+            dy * ry->scene->camera.iplaneup.x;
+  ry->o.y = ry->scene->camera.center.y + 
+            dx * ry->scene->camera.iplaneright.y +
+            dy * ry->scene->camera.iplaneup.y;
+  ry->o.z = ry->scene->camera.center.z + 
+            dx * ry->scene->camera.iplaneright.z +
+            dy * ry->scene->camera.iplaneup.z;
+
+  /* shoot the ray, jittering the pixel position in the image plane */
+  jitter_offset2f(&ry->randval, jxy);
+  return cam_dof_ray(ry, x + jxy[0], y + jxy[1]);
+}
 
 /*
  * cam_aa_dof_ray() 
  *  Generate a perspective camera ray incorporating
  *  antialiasing and depth-of-field.
+ *  No special weighting is done based on the jitter values in 
+ *  the circle of confusion nor for the jitter within the
+ *  pixel in the image plane.
  */
 color cam_aa_dof_ray(ray * ry, flt x, flt y) {
-  color col, avcol;
-  int alias; 
-  scenedef * scene=ry->scene;
-  float scale;
-  flt dx, dy;
+  color col;
 
   col=cam_dof_ray(ry, x, y);   /* generate ray */
 
-  /* perform antialiasing if enabled.                           */
-  /* samples are run through a very simple box filter averaging */
-  /* each of the sample pixel colors to produce a final result  */
-  /* No special weighting is done based on the jitter values in */
-  /* the circle of confusion nor for the jitter within the      */
-  /* pixel in the image plane.                                  */ 
-  for (alias=1; alias <= scene->antialiasing; alias++) {
-    float jxy[2];
-    jitter_offset2f(&ry->randval, jxy);
-    dx = jxy[0] * ry->scene->camera.aperture * ry->scene->hres; 
-    dy = jxy[1] * ry->scene->camera.aperture * ry->scene->vres; 
-
-    /* perturb the eye center by the random aperture offset */
-    ry->o.x = ry->scene->camera.center.x + 
-              dx * ry->scene->camera.iplaneright.x +
-              dy * ry->scene->camera.iplaneup.x;
-    ry->o.y = ry->scene->camera.center.y + 
-              dx * ry->scene->camera.iplaneright.y +
-              dy * ry->scene->camera.iplaneup.y;
-    ry->o.z = ry->scene->camera.center.z + 
-              dx * ry->scene->camera.iplaneright.z +
-              dy * ry->scene->camera.iplaneup.z;
-
-    /* shoot the ray, jittering the pixel position in the image plane */
-    jitter_offset2f(&ry->randval, jxy);
-    avcol=cam_dof_ray(ry, x + jxy[0], y + jxy[1]);
-
-    col.r += avcol.r;       /* accumulate antialiasing samples */
-    col.g += avcol.g;
-    col.b += avcol.b;
-  }
-
-  /* average sample colors, back to range 0.0 - 1.0 */ 
-  scale = 1.0f / (scene->antialiasing + 1.0f); 
-  col.r *= scale;
-  col.g *= scale;
-  col.b *= scale;
-
-  return col;
+  return cam_aa_samples(ry, x, y, col);
 }
-#endif
 
 /*
  * cam_dof_ray() 
@@ -376,45 +373,35 @@ color cam_dof_ray(ray * ry, flt x, flt y) {
 }
 
 
+/*
+ * cam_perspective_jitter_ray() 
+ *  Generate a perspective camera ray through a random point of the pixel.
+ */
+color cam_perspective_jitter_ray(ray * ry, flt x, flt y) {
+  float jxy[2];
+
+  jitter_offset2f(&ry->randval, jxy);
+  return cam_perspective_ray(ry, x + jxy[0], y + jxy[1]);
+}
+
 /*
  * cam_aa_perspective_ray() 
  *  Generate a perspective camera ray incorporating antialiasing.
  */
 color cam_aa_perspective_ray(ray * ry, flt x, flt y) {
-  color col, avcol;
-  int alias; 
-  scenedef * scene=ry->scene;
-  float scale;
-  col=cam_perspective_ray(ry, x, y);   /* generate ray */
-
-  /* perform antialiasing if enabled.                           */
-  /* samples are run through a very simple box filter averaging */
-  /* each of the sample pixel colors to produce a final result  */
-  for (alias=1; alias <= scene->antialiasing; alias++) {
-    float jxy[2];
-    jitter_offset2f(&ry->randval, jxy);
-    avcol=cam_perspective_ray(ry, x + jxy[0], y + jxy[1]);
-
-    col.r += avcol.r;       /* accumulate antialiasing samples */
-    col.g += avcol.g;
-    col.b += avcol.b;
-  }
+  color col;
 
-  /* average sample colors, back to range 0.0 - 1.0 */ 
-  scale = 1.0f / (scene->antialiasing + 1.0f); 
-  col.r *= scale;
-  col.g *= scale;
-  col.b *= scale;
+  col=cam_perspective_ray(ry, x, y);   /* generate ray */
 
-  return col;
+  return cam_aa_samples(ry, x, y, col);
 }
 
 
 /*
- * cam_perspective_ray() 
- *  Generate a perspective camera ray, no antialiasing
+ * cam_perspective_setup() 
+ *  Set up a perspective camera ray without tracing it, for ray packets
  */
-color cam_perspective_ray(ray * ry, flt x, flt y) {
+void cam_perspective_setup(ray * ry, flt x, flt y) {
   flt rdx, rdy, rdz, len;
   scenedef * scene=ry->scene;
 
@@ -446,53 +433,49 @@ color cam_perspective_ray(ray * ry, flt x, flt y) {
 
   /* camera only generates primary rays */
   ry->flags = RT_RAY_PRIMARY | RT_RAY_REGULAR;  
+}
+
+/*
+ * cam_perspective_ray() 
+ *  Generate a perspective camera ray, no antialiasing
+ */
+color cam_perspective_ray(ray * ry, flt x, flt y) {
+  cam_perspective_setup(ry, x, y);  /* generate the ray */
 
   ry->serial++;                /* increment the ray serial number */
   intersect_objects(ry);       /* trace the ray */
-  return scene->shader(ry);    /* shade the hit point */
+  return ry->scene->shader(ry); /* shade the hit point */
 }
 
 
+/*
+ * cam_orthographic_jitter_ray() 
+ *  Generate an orthographic camera ray through a random point of the pixel.
+ */
+color cam_orthographic_jitter_ray(ray * ry, flt x, flt y) {
+  float jxy[2];
+
+  jitter_offset2f(&ry->randval, jxy);
+  return cam_orthographic_ray(ry, x + jxy[0], y + jxy[1]);
+}
+
 /*
  * cam_aa_orthographic_ray() 
- *  Generate an orthographic camera ray, potentially incorporating
- *  antialiasing.
+ *  Generate an orthographic camera ray incorporating antialiasing.
  */
 color cam_aa_orthographic_ray(ray * ry, flt x, flt y) {
-  color col, avcol;
-  int alias; 
-  scenedef * scene=ry->scene;
-  float scale;
+  color col;
 
   col=cam_orthographic_ray(ry, x, y);   /* generate ray */
 
-  /* perform antialiasing if enabled.                           */
-  /* samples are run through a very simple box filter averaging */
-  /* each of the sample pixel colors to produce a final result  */
-  for (alias=1; alias <= scene->antialiasing; alias++) {
-    float jxy[2];
-    jitter_offset2f(&ry->randval, jxy);
-    avcol=cam_orthographic_ray(ry, x + jxy[0], y + jxy[1]);
-
-    col.r += avcol.r;       /* accumulate antialiasing samples */
-    col.g += avcol.g;
-    col.b += avcol.b;
-  }
-
-  /* average sample colors, back to range 0.0 - 1.0 */ 
-  scale = 1.0f / (scene->antialiasing + 1.0f); 
-  col.r *= scale;
-  col.g *= scale;
-  col.b *= scale;
-
-  return col;
+  return cam_aa_samples(ry, x, y, col);
 }
 
 /*
- * cam_orthographic_ray() 
- *  Generate an orthographic camera ray, no antialiasing
+ * cam_orthographic_setup() 
+ *  Set up an orthographic camera ray without tracing it, for ray packets
  */
-color cam_orthographic_ray(ray * ry, flt x, flt y) {
+void cam_orthographic_setup(ray * ry, flt x, flt y) {
   scenedef * scene=ry->scene;
 
   /* starting from the lower left corner of the image plane, we move the   */
@@ -516,17 +499,25 @@ color cam_orthographic_ray(ray * ry, flt x, flt y) {
 
   /* camera only generates primary rays */
   ry->flags = RT_RAY_PRIMARY | RT_RAY_REGULAR;  
+}
+
+/*
+ * cam_orthographic_ray() 
+ *  Generate an orthographic camera ray, no antialiasing
+ */
+color cam_orthographic_ray(ray * ry, flt x, flt y) {
+  cam_orthographic_setup(ry, x, y);  /* generate the ray */
 
   ry->serial++;                /* increment the ray serial number */
   intersect_objects(ry);       /* trace the ray */
-  return scene->shader(ry);    /* shade the hit point */
+  return ry->scene->shader(ry); /* shade the hit point */
 }
 
 /*
- * cam_fisheye_ray() 
- *  Generate a perspective camera ray, no antialiasing
+ * cam_fisheye_setup() 
+ *  Set up a fisheye camera ray without tracing it, for ray packets
  */
-color cam_fisheye_ray(ray * ry, flt x, flt y) {
+void cam_fisheye_setup(ray * ry, flt x, flt y) {
   flt ax, ay;
   scenedef * scene=ry->scene;
 
@@ -551,45 +542,41 @@ color cam_fisheye_ray(ray * ry, flt x, flt y) {
 
   /* camera only generates primary rays */
   ry->flags = RT_RAY_PRIMARY | RT_RAY_REGULAR;  
+}
+
+/*
+ * cam_fisheye_ray() 
+ *  Generate a perspective camera ray, no antialiasing
+ */
+color cam_fisheye_ray(ray * ry, flt x, flt y) {
+  cam_fisheye_setup(ry, x, y);  /* generate the ray */
 
   ry->serial++;                /* increment the ray serial number */
   intersect_objects(ry);       /* trace the ray */
-  return scene->shader(ry);    /* shade the hit point */
+  return ry->scene->shader(ry); /* shade the hit point */
+}
+
+/*
+ * cam_fisheye_jitter_ray() 
+ *  Generate a fisheye camera ray through a random point of the pixel.
+ */
+color cam_fisheye_jitter_ray(ray * ry, flt x, flt y) {
+  float jxy[2];
+
+  jitter_offset2f(&ry->randval, jxy);
+  return cam_fisheye_ray(ry, x + jxy[0], y + jxy[1]);
 }
 
 /*
  * cam_aa_fisheye_ray() 
- *  Generate a fisheye camera ray, potentially incorporating
- *  antialiasing.
+ *  Generate a fisheye camera ray incorporating antialiasing.
  */
 color cam_aa_fisheye_ray(ray * ry, flt x, flt y) {
-  color col, avcol;
-  int alias; 
-  scenedef * scene=ry->scene;
-  float scale;
+  color col;
 
   col=cam_fisheye_ray(ry, x, y);   /* generate ray */
 
-  /* perform antialiasing if enabled.                           */
-  /* samples are run through a very simple box filter averaging */
-  /* each of the sample pixel colors to produce a final result  */
-  for (alias=1; alias <= scene->antialiasing; alias++) {
-    float jxy[2];
-    jitter_offset2f(&ry->randval, jxy);
-    avcol=cam_fisheye_ray(ry, x + jxy[0], y + jxy[1]);
-
-    col.r += avcol.r;       /* accumulate antialiasing samples */
-    col.g += avcol.g;
-    col.b += avcol.b;
-  }
-
-  /* average sample colors, back to range 0.0 - 1.0 */ 
-  scale = 1.0f / (scene->antialiasing + 1.0f); 
-  col.r *= scale;
-  col.g *= scale;
-  col.b *= scale;
-
-  return col;
+  return cam_aa_samples(ry, x, y, col);
 }
 
 
@@ -5,7 +5,7 @@
  */
 
 void camera_init(scenedef *);
-void camray_init(scenedef *, ray *, unsigned long, unsigned long *, unsigned int);
+void camray_init(scenedef *, ray *, unsigned long, mailbox *, unsigned int);
 
 void camerasetup(scenedef *, flt, vector, vector, vector);
 void cameraprojection(camdef *, int);
@@ -17,6 +17,17 @@ void cameraposition(camdef * camera, vector center, vector viewvec,
 void getcameraposition(camdef * camera, vector * center, vector * viewvec, 
                     vector * upvec, vector *rightvec);
 
+void cam_perspective_setup(ray *, flt, flt);
+void cam_orthographic_setup(ray *, flt, flt);
+void cam_fisheye_setup(ray *, flt, flt);
+
+int cam_aa_converged(const color * sum, const color * sumsq, int n, flt thresh);
+
+color cam_perspective_jitter_ray(ray *, flt, flt);
+color cam_orthographic_jitter_ray(ray *, flt, flt);
+color cam_fisheye_jitter_ray(ray *, flt, flt);
+color cam_dof_jitter_ray(ray *, flt, flt);
+
 color cam_aa_perspective_ray(ray *, flt, flt);
 color cam_perspective_ray(ray *, flt, flt);
 color cam_aa_dof_ray(ray *, flt, flt);
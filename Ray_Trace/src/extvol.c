@@ -253,6 +253,7 @@ color ext_volume_texture(const vector * hit, const texture * tx, ray * ry) {
     }   
     else { 
       sum=1.0;
+      break; /* opaque, nothing further along the ray shows through */
     }  
   }
 
@@ -13,6 +13,8 @@
 #include "util.h"
 #include "ui.h"
 #include "parallel.h"
+#include "threads.h"
+#include "packet.h"
 
 #define GRID_PRIVATE
 #include "grid.h"
@@ -26,7 +28,8 @@ static object_methods grid_methods = {
   (void (*)(const void *, void *))(grid_intersect),
   (void (*)(const void *, const void *, const void *, void *))(NULL),
   grid_bbox, 
-  grid_free 
+  grid_free,
+  (void (*)(const void *, void *))(grid_packet_intersect)
 };
 
 object * newgrid(scenedef * scene, int xsize, int ysize, int zsize, vector min, vector max) {
@@ -53,8 +56,11 @@ object * newgrid(scenedef * scene, int xsize, int ysize, int zsize, vector min,
   g->voxsize.y /= (flt) g->ysize; 
   g->voxsize.z /= (flt) g->zsize; 
 
-  g->cells = (objectlist **) malloc(numcells * sizeof(objectlist *));
-  memset(g->cells, 0, numcells * sizeof(objectlist *));
+  g->objs = NULL;
+  g->cells = (int *) calloc(numcells + 1, sizeof(int));
+  g->cellobjs = NULL;
+  g->occupied = (unsigned int *) calloc((numcells + 31) / 32, 
+                                        sizeof(unsigned int));
 
   return (object *) g;
 }
@@ -69,25 +75,13 @@ static int grid_bbox(void * obj, vector * min, vector * max) {
 }
 
 static void grid_free(void * v) {
-  int i, numvoxels;
   grid * g = (grid *) v;
 
-  /* loop through all voxels and free the object lists */
-  numvoxels = g->xsize * g->ysize * g->zsize; 
-  for (i=0; i<numvoxels; i++) {
-    objectlist * lcur;
-    objectlist * lnext;
-
-    lcur = g->cells[i];
-    while (lcur != NULL) {
-      lnext = lcur->next;
-      free(lcur);
-      lcur = lnext;
-    }
-  }
-
-  /* free the grid cells */ 
+  /* free the grid cells and their contents */ 
+  free(g->objs);
   free(g->cells);
+  free(g->cellobjs);
+  free(g->occupied);
 
   /* free all objects on the grid object list */
   free_objects(g->objects);   
@@ -95,45 +89,16 @@ static void grid_free(void * v) {
   free(g);
 }
 
-static void globalbound(object ** rootlist, vector * gmin, vector * gmax) {
-  vector min, max;
-  object * cur;
-
-  if (*rootlist == NULL)  /* don't bound non-existant objects */
-    return;
-
-  gmin->x =  FHUGE;   gmin->y =  FHUGE;   gmin->z =  FHUGE;
-  gmax->x = -FHUGE;   gmax->y = -FHUGE;   gmax->z = -FHUGE;
-
-  cur=*rootlist;
-  while (cur != NULL)  {  /* Go! */
-    min.x = -FHUGE; min.y = -FHUGE; min.z = -FHUGE;
-    max.x =  FHUGE; max.y =  FHUGE; max.z =  FHUGE;
-
-    if (cur->methods->bbox((void *) cur, &min, &max)) {
-      gmin->x = MYMIN( gmin->x , min.x);
-      gmin->y = MYMIN( gmin->y , min.y);
-      gmin->z = MYMIN( gmin->z , min.z);
-
-      gmax->x = MYMAX( gmax->x , max.x);
-      gmax->y = MYMAX( gmax->y , max.y);
-      gmax->z = MYMAX( gmax->z , max.z);
-    }
-
-    cur=cur->nextobj;
-  }
-}
-
-
 static int cellbound(const grid *g, const gridindex *index, vector * cmin, vector * cmax) {
   vector min, max, cellmin, cellmax;
-  objectlist * cur;
+  object * obj;
+  int i, voxindex;
   int numinbounds = 0;
 
-  cur = g->cells[index->z*g->xsize*g->ysize + index->y*g->xsize + index->x]; 
+  voxindex = index->z*g->xsize*g->ysize + index->y*g->xsize + index->x; 
 
-  if (cur == NULL)  /* don't bound non-existant objects */
-    return 0;
+  if (g->cells[voxindex] == g->cells[voxindex + 1]) 
+    return 0; /* don't bound non-existant objects */
 
   cellmin.x = voxel2x(g, index->x); 
   cellmin.y = voxel2y(g, index->y); 
@@ -143,14 +108,21 @@ static int cellbound(const grid *g, const gridindex *index, vector * cmin, vecto
   cellmax.y = cellmin.y + g->voxsize.y;
   cellmax.z = cellmin.z + g->voxsize.z;
 
+  /* cells on the far side end at the grid bounds themselves, rounding */
+  /* must not push objects touching them out of their last cell        */
+  if (index->x == g->xsize - 1) cellmax.x = g->max.x;
+  if (index->y == g->ysize - 1) cellmax.y = g->max.y;
+  if (index->z == g->zsize - 1) cellmax.z = g->max.z;
+
   cmin->x =  FHUGE;   cmin->y =  FHUGE;   cmin->z =  FHUGE;
   cmax->x = -FHUGE;   cmax->y = -FHUGE;   cmax->z = -FHUGE;
 
-  while (cur != NULL)  {  /* Go! */
+  for (i=g->cells[voxindex]; i<g->cells[voxindex + 1]; i++) {  /* Go! */
+    obj = g->objs[g->cellobjs[i]];
     min.x = -FHUGE; min.y = -FHUGE; min.z = -FHUGE;
     max.x =  FHUGE; max.y =  FHUGE; max.z =  FHUGE;
 
-    if (cur->obj->methods->bbox((void *) cur->obj, &min, &max)) {
+    if (obj->methods->bbox((void *) obj, &min, &max)) {
       if ((min.x >= cellmin.x) && (max.x <= cellmax.x) &&
           (min.y >= cellmin.y) && (max.y <= cellmax.y) &&
           (min.z >= cellmin.z) && (max.z <= cellmax.z)) {
@@ -166,8 +138,6 @@ static int cellbound(const grid *g, const gridindex *index, vector * cmin, vecto
         numinbounds++;
       }
     }
-
-    cur=cur->next;
   }
  
   /* in case we get a 0.0 sized axis on the cell bounds, we'll */
@@ -210,13 +180,35 @@ static void gridstats(int xs, int ys, int zs, int numobj) {
   rt_ui_message(MSG_0, t);
 }
 
+
+/*
+ * Grid construction runs as a series of passes, each split among the
+ * build threads.  The objects are bounded and mapped to the cells they
+ * span in parallel over object ranges.  Cells are then filled in two
+ * passes over Z slabs of the grid, each thread owning the cells of its
+ * slab: the first counts the objects landing in each cell, and after a
+ * prefix sum over the slab totals the second turns the counts into cell
+ * offsets and drops the objects into place.  Overfull cells are found in
+ * parallel over cell ranges, and their subgrids are filled in parallel,
+ * one subgrid per thread at a time.  Objects are visited in the same
+ * order, and handed out the same object ids, as by a serial build, so
+ * the grid does not depend on the number of threads.
+ */
 int engrid_scene(scenedef * scene, int boundthresh) {
   grid * g;
-  int numobj, numcbrt;
+  int numobj, numcbrt, numcells, numsubs, numentries, nthr, ntasks;
+  int i, xs, ys, zs;
   vector gmin={0,0,0};
   vector gmax={0,0,0};
-  gridindex index;
-  char msgtxt[128];
+  vector gsize;
+  flt len;
+  object ** list, ** prev;
+  object * cur;
+  gridindex * low, * high;
+  gridsubcell * subs;
+  gridtask * tasks;
+  rt_timerhandle t;
+  char msgtxt[256];
   int numsucceeded; 
   if (scene->objgroup.boundedobj == NULL)
     return 0;
@@ -229,30 +221,87 @@ int engrid_scene(scenedef * scene, int boundthresh) {
   }
 
   if (numobj > boundthresh) {
+    t = rt_timer_create();
+    rt_timer_start(t);
+
+    /* gather the objects where the build threads can share them */
+    list = (object **) malloc(numobj * sizeof(object *));
+    low = (gridindex *) malloc(numobj * sizeof(gridindex));
+    high = (gridindex *) malloc(numobj * sizeof(gridindex));
+    i = 0;
+    for (cur=scene->objgroup.boundedobj; cur != NULL; cur=cur->nextobj)
+      list[i++] = cur;
+
+    nthr = (scene->numthreads > 1) ? scene->numthreads : 1;
+    nthr = MYMIN(nthr, numobj / GRID_PARSIZE);
+    if (nthr < 1) nthr = 1;
+    tasks = (gridtask *) malloc(nthr * sizeof(gridtask));
+    memset(&tasks[0], 0, sizeof(gridtask));
+    tasks[0].list = list;
+    tasks[0].low = low;
+    tasks[0].high = high;
+    tasks[0].num = numobj;
+    tasks[0].boundthresh = boundthresh;
+
+    ntasks = grid_split(tasks, nthr, numobj);
+    grid_run(tasks, ntasks, grid_bound_task);
+    gmin = tasks[0].min;
+    gmax = tasks[0].max;
+    for (i=1; i<ntasks; i++) {
+      gmin.x = MYMIN( gmin.x , tasks[i].min.x);
+      gmin.y = MYMIN( gmin.y , tasks[i].min.y);
+      gmin.z = MYMIN( gmin.z , tasks[i].min.z);
+
+      gmax.x = MYMAX( gmax.x , tasks[i].max.x);
+      gmax.y = MYMAX( gmax.y , tasks[i].max.y);
+      gmax.z = MYMAX( gmax.z , tasks[i].max.z);
+    }
+
     numcbrt = (int) cbrt(4*numobj);
     
-    globalbound(&scene->objgroup.boundedobj, &gmin, &gmax);
     if (scene->verbosemode && scene->mynode == 0) {
-      char t[256]; /* msgtxt */
-      sprintf(t, "Global bounds: %g %g %g -> %g %g %g", 
+      sprintf(msgtxt, "Global bounds: %g %g %g -> %g %g %g", 
               gmin.x, gmin.y, gmin.z, gmax.x, gmax.y, gmax.z);  
-      rt_ui_message(MSG_0, t);
+      rt_ui_message(MSG_0, msgtxt);
 
-      sprintf(t, "Creating top level grid: X:%d Y:%d Z:%d", 
+      sprintf(msgtxt, "Creating top level grid: X:%d Y:%d Z:%d", 
               numcbrt, numcbrt, numcbrt);
-      rt_ui_message(MSG_0, t);
+      rt_ui_message(MSG_0, msgtxt);
     }
 
     g = (grid *) newgrid(scene, numcbrt, numcbrt, numcbrt, gmin, gmax);
-    numsucceeded = engrid_objlist(g, &scene->objgroup.boundedobj);
+    tasks[0].g = g;
+    ntasks = grid_split(tasks, nthr, numobj);
+    grid_run(tasks, ntasks, grid_index_task);
+
+    /* move the objects wholly inside the grid from the scene's list */
+    /* to the grid's own                                             */
+    numsucceeded = 0;
+    prev = &scene->objgroup.boundedobj;
+    for (i=0; i<numobj; i++) {
+      cur = list[i];
+      if (low[i].x >= 0) {
+        cur->nextobj = g->objects;
+        g->objects = cur;
+        numsucceeded++;
+      } else {
+        *prev = cur;
+        prev = (object **) &cur->nextobj;
+      }
+    }
+    *prev = NULL;
+
+    ntasks = grid_split(tasks, nthr, g->zsize);
+    grid_fill(tasks, ntasks);
+    g->objs = grid_renumber(g, list, numobj, numsucceeded);
+
     if (scene->verbosemode && scene->mynode == 0)
       gridstats(numcbrt, numcbrt, numcbrt, numsucceeded); 
 
     if (scene->verbosemode && scene->mynode == 0) {
-      char t[256]; /* msgtxt */
-      numobj = countobj(scene->objgroup.boundedobj);
-      sprintf(t, "Scene contains %d non-gridded objects\n", numobj);
-      rt_ui_message(MSG_0, t);
+      sprintf(msgtxt, "Scene contains %d non-gridded objects\n", 
+              numobj - numsucceeded);
+      rt_ui_message(MSG_0, msgtxt);
     } 
 
     /* add this grid to the bounded object list removing the objects */
@@ -260,182 +309,502 @@ int engrid_scene(scenedef * scene, int boundthresh) {
     g->nextobj = scene->objgroup.boundedobj;
     scene->objgroup.boundedobj = (object *) g;
 
-    /* create subgrids for overfull cell in the top level grid...    */
-    for (index.z=0; index.z<g->zsize; index.z++) {
-      for (index.y=0; index.y<g->ysize; index.y++) {
-        for (index.x=0; index.x<g->xsize; index.x++) {
-          engrid_cell(scene, boundthresh, g, &index);
-        }
+    /* find the overfull cells in the top level grid...              */
+    numcells = g->xsize * g->ysize * g->zsize;
+    ntasks = grid_split(tasks, nthr, numcells);
+    grid_run(tasks, ntasks, grid_cellbound_task);
+    numsubs = 0;
+    for (i=0; i<ntasks; i++) 
+      numsubs += tasks[i].numsubs;
+    subs = (gridsubcell *) malloc((numsubs + 1) * sizeof(gridsubcell));
+    numsubs = 0;
+    for (i=0; i<ntasks; i++) {
+      if (tasks[i].numsubs > 0)
+        memcpy(&subs[numsubs], tasks[i].subs, 
+               tasks[i].numsubs * sizeof(gridsubcell));
+      numsubs += tasks[i].numsubs;
+      free(tasks[i].subs);
+    }
+
+    /* ...create their subgrids, numbered in cell order...           */
+    for (i=0; i<numsubs; i++) {
+      VSub(&subs[i].max, &subs[i].min, &gsize);
+      len = 1.0 / (MYMAX( MYMAX(gsize.x, gsize.y), gsize.z ));
+      gsize.x *= len;  
+      gsize.y *= len;  
+      gsize.z *= len;  
+
+      numcbrt = (int) cbrt(2*subs[i].numobj); 
+    
+      xs = (int) ((flt) numcbrt * gsize.x);
+      if (xs < 1) xs = 1;
+      ys = (int) ((flt) numcbrt * gsize.y);
+      if (ys < 1) ys = 1;
+      zs = (int) ((flt) numcbrt * gsize.z);
+      if (zs < 1) zs = 1;
+
+      subs[i].sub = (grid *) newgrid(scene, xs, ys, zs, 
+                                     subs[i].min, subs[i].max);
+      subs[i].sub->nextobj = g->objects;
+      g->objects = (object *) subs[i].sub;
+    }
+
+    /* the subgrids follow the objects in the top level grid's objs   */
+    g->objs = (object **) realloc(g->objs, 
+                                  (numsucceeded + numsubs) * sizeof(object *));
+    for (i=0; i<numsubs; i++) 
+      g->objs[numsucceeded + i] = (object *) subs[i].sub;
+    tasks[0].num = numsucceeded;
+
+    /* ...fill them...                                                */
+    tasks[0].subs = subs;
+    tasks[0].numsubs = numsubs;
+    ntasks = grid_split(tasks, nthr, numsubs);
+    grid_run(tasks, ntasks, grid_subgrid_task);
+
+    if (scene->verbosemode && scene->mynode == 0) {
+      for (i=0; i<numsubs; i++)
+        gridstats(subs[i].sub->xsize, subs[i].sub->ysize, subs[i].sub->zsize,
+                  subs[i].numsucceeded);
+    }
+
+    /* ...and put them in their cells ahead of the objects left over  */
+    if (numsubs > 0) {
+      tasks[0].cells = NULL;
+      tasks[0].cellobjs = NULL;
+      ntasks = grid_split(tasks, nthr, g->zsize);
+      grid_run(tasks, ntasks, grid_relink_task);
+      numentries = 0;
+      for (i=0; i<ntasks; i++) {
+        xs = tasks[i].count;
+        tasks[i].count = numentries;
+        numentries += xs;
       }
-    } 
+      tasks[0].cells = (int *) malloc((numcells + 1) * sizeof(int));
+      tasks[0].cellobjs = (unsigned int *) malloc(numentries * 
+                                                  sizeof(unsigned int));
+      for (i=1; i<ntasks; i++) {
+        tasks[i].cells = tasks[0].cells;
+        tasks[i].cellobjs = tasks[0].cellobjs;
+      }
+      grid_run(tasks, ntasks, grid_relink_task);
+      free(g->cells);
+      free(g->cellobjs);
+      g->cells = tasks[0].cells;
+      g->cellobjs = tasks[0].cellobjs;
+      g->cells[numcells] = numentries;
+    }
+
+    free(subs);
+    free(tasks);
+    free(list);
+    free(low);
+    free(high);
+
+    rt_timer_stop(t);
+    if (scene->verbosemode && scene->mynode == 0) {
+      sprintf(msgtxt, "Grid build time: %.3f seconds, %d threads",
+              rt_timer_time(t), nthr);
+      rt_ui_message(MSG_0, msgtxt);
+    }
+    rt_timer_destroy(t);
   }
 
   return 1;
 }
 
 
-static int engrid_objlist(grid * g, object ** list) {
-  object * cur, * next, **prev;
-  int numsucceeded = 0;
+#ifdef THR
+static void * grid_task(void * voidparms) {
+  gridtask * t = (gridtask *) voidparms;
+  t->fctn(t);
+  return NULL;
+}
+#endif
 
-  if (*list == NULL) 
-    return 0;
-  
-  prev = list; 
-  cur = *list;
+/*
+ * Run a build pass, one task per thread, the first task in the calling
+ * thread.  Tasks that no thread could be started for run here as well.
+ */
+static void grid_run(gridtask * tasks, int ntasks, void (* fctn)(gridtask *)) {
+  int i;
+#ifdef THR
+  rt_thread_t * thr;
+  int * started;
+
+  if (ntasks > 1) {
+    thr = (rt_thread_t *) malloc(ntasks * sizeof(rt_thread_t));
+    started = (int *) malloc(ntasks * sizeof(int));
+    for (i=1; i<ntasks; i++) {
+      tasks[i].fctn = fctn;
+      started[i] = (rt_thread_create(&thr[i], grid_task, &tasks[i]) == 0);
+      if (!started[i])
+        fctn(&tasks[i]);
+    }
+    fctn(&tasks[0]);
+    for (i=1; i<ntasks; i++) {
+      if (started[i])
+        rt_thread_join(thr[i], NULL);
+    }
+    free(started);
+    free(thr);
+    return;
+  }
+#endif
 
-  while (cur != NULL) {
-    next = cur->nextobj;
+  for (i=0; i<ntasks; i++) 
+    fctn(&tasks[i]);
+}
 
-    if (engrid_object(g, cur, 1)) {
-      *prev = next;
-      numsucceeded++;
-    } else {
-      prev = (object **) &cur->nextobj;
-    }
 
-    cur = next;
-  } 
+/*
+ * Split 0 .. num-1 evenly among up to nthr tasks, which start out as
+ * copies of the first, and return the number of tasks.
+ */
+static int grid_split(gridtask * tasks, int nthr, int num) {
+  int i, ntasks;
+
+  ntasks = MYMIN(nthr, num);
+  if (ntasks < 1) 
+    ntasks = 1;
+
+  for (i=0; i<ntasks; i++) {
+    if (i > 0)
+      tasks[i] = tasks[0];
+    tasks[i].start = i * (num / ntasks) + MYMIN(i, num % ntasks);
+    tasks[i].end = (i + 1) * (num / ntasks) + MYMIN(i + 1, num % ntasks);
+  }
 
-  return numsucceeded;
+  return ntasks;
 }
 
 
-static int engrid_cell(scenedef * scene, int boundthresh, grid * gold, gridindex *index) {
-  vector gmin, gmax, gsize;
-  flt len;
-  int numobj, numcbrt, xs, ys, zs;
-  grid * g;
-  objectlist **list;
-  objectlist * newobj;
-  int numsucceeded;
+/* bound a range of objects, marking those without bounds */
+static void grid_bound_task(gridtask * t) {
+  vector min, max;
+  object * obj;
+  int i;
 
-  list = &gold->cells[index->z*gold->xsize*gold->ysize + 
-                     index->y*gold->xsize  + index->x];
+  t->min.x =  FHUGE;   t->min.y =  FHUGE;   t->min.z =  FHUGE;
+  t->max.x = -FHUGE;   t->max.y = -FHUGE;   t->max.z = -FHUGE;
 
-  if (*list == NULL)
-    return 0;
+  for (i=t->start; i<t->end; i++) {
+    obj = t->list[i];
+    min.x = -FHUGE; min.y = -FHUGE; min.z = -FHUGE;
+    max.x =  FHUGE; max.y =  FHUGE; max.z =  FHUGE;
 
-  numobj =  cellbound(gold, index, &gmin, &gmax);
+    if (obj->methods->bbox((void *) obj, &min, &max)) {
+      t->min.x = MYMIN( t->min.x , min.x);
+      t->min.y = MYMIN( t->min.y , min.y);
+      t->min.z = MYMIN( t->min.z , min.z);
 
-  VSub(&gmax, &gmin, &gsize);
-  len = 1.0 / (MYMAX( MYMAX(gsize.x, gsize.y), gsize.z ));
-  gsize.x *= len;  
-  gsize.y *= len;  
-  gsize.z *= len;  
+      t->max.x = MYMAX( t->max.x , max.x);
+      t->max.y = MYMAX( t->max.y , max.y);
+      t->max.z = MYMAX( t->max.z , max.z);
+      t->low[i].x = 0;
+    } else {
+      t->low[i].x = -1;
+    }
+  }
+}
 
-  if (numobj > boundthresh) {
-    numcbrt = (int) cbrt(2*numobj); 
-    
-    xs = (int) ((flt) numcbrt * gsize.x);
-    if (xs < 1) xs = 1;
-    ys = (int) ((flt) numcbrt * gsize.y);
-    if (ys < 1) ys = 1;
-    zs = (int) ((flt) numcbrt * gsize.z);
-    if (zs < 1) zs = 1;
 
-    g = (grid *) newgrid(scene, xs, ys, zs, gmin, gmax);
-    numsucceeded = engrid_objectlist(g, list);
+/* find the cells spanned by a range of objects */
+static void grid_index_task(gridtask * t) {
+  vector min, max;
+  object * obj;
+  int i;
 
-    if (scene->verbosemode && scene->mynode == 0)
-      gridstats(xs, ys, zs, numsucceeded); 
+  for (i=t->start; i<t->end; i++) {
+    if (t->low[i].x < 0)
+      continue;   /* object is unbounded, don't engrid this object */
 
-    newobj = (objectlist *) malloc(sizeof(objectlist));    
-    newobj->obj = (object *) g;
-    newobj->next = *list;
-    *list = newobj;
+    obj = t->list[i];
+    min.x = -FHUGE; min.y = -FHUGE; min.z = -FHUGE;
+    max.x =  FHUGE; max.y =  FHUGE; max.z =  FHUGE;
+    obj->methods->bbox((void *) obj, &min, &max);
 
-    g->nextobj = gold->objects;
-    gold->objects = (object *) g;
+    /* object is not wholly contained in the grid, don't engrid */
+    if (!pos2grid(t->g, &min, &t->low[i]) || 
+        !pos2grid(t->g, &max, &t->high[i]))
+      t->low[i].x = -1;
   }
+}
 
-  return 1;
+
+/* count the objects landing in each cell of a Z slab of the grid */
+static void grid_count_task(gridtask * t) {
+  grid * g = t->g;
+  int i, x, y, z, z0, z1, yindex, zindex;
+
+  t->count = 0;
+  for (i=0; i<t->num; i++) {
+    if (t->low[i].x < 0)
+      continue;
+    z0 = MYMAX(t->low[i].z, t->start);
+    z1 = MYMIN(t->high[i].z, t->end - 1);
+    for (z=z0; z<=z1; z++) {
+      zindex = z * g->xsize * g->ysize;
+      for (y=t->low[i].y; y<=t->high[i].y; y++) {
+        yindex = y * g->xsize;
+        for (x=t->low[i].x; x<=t->high[i].x; x++) 
+          g->cells[x + yindex + zindex]++;
+      }
+    }
+    if (z1 >= z0)
+      t->count += (z1 - z0 + 1) * (t->high[i].y - t->low[i].y + 1) * 
+                  (t->high[i].x - t->low[i].x + 1);
+  }
 }
 
-static int engrid_objectlist(grid * g, objectlist ** list) {
-  objectlist * cur, * next, **prev;
-  int numsucceeded = 0; 
 
-  if (*list == NULL) 
-    return 0;
-  
-  prev = list; 
-  cur = *list;
+/*
+ * Fill the cells of a Z slab, whose objects start at t->count.  Cells
+ * are filled from their end, so each holds its objects last one first,
+ * and is left with the offset of its first object.
+ */
+static void grid_fill_task(gridtask * t) {
+  grid * g = t->g;
+  int i, x, y, z, z0, z1, yindex, zindex, voxindex, sum;
+
+  sum = t->count;
+  for (voxindex = t->start * g->xsize * g->ysize; 
+       voxindex < t->end * g->xsize * g->ysize; voxindex++) {
+    sum += g->cells[voxindex];
+    g->cells[voxindex] = sum;
+  }
 
-  while (cur != NULL) {
-    next = cur->next;
+  for (i=0; i<t->num; i++) {
+    if (t->low[i].x < 0)
+      continue;
+    z0 = MYMAX(t->low[i].z, t->start);
+    z1 = MYMIN(t->high[i].z, t->end - 1);
+    for (z=z0; z<=z1; z++) {
+      zindex = z * g->xsize * g->ysize;
+      for (y=t->low[i].y; y<=t->high[i].y; y++) {
+        yindex = y * g->xsize;
+        for (x=t->low[i].x; x<=t->high[i].x; x++) {
+          voxindex = x + yindex + zindex; 
+          g->cellobjs[--g->cells[voxindex]] = i;
+        }
+      }
+    }
+  }
+}
 
-    if (engrid_object(g, cur->obj, 0)) {
-      *prev = next;
-      free(cur);
-      numsucceeded++;
-    } else {
-      prev = &cur->next;
+
+/* 
+ * Fill the cells of a grid from the object list of the tasks, which
+ * cover its Z slabs in order. 
+ */
+static void grid_fill(gridtask * tasks, int ntasks) {
+  grid * g = tasks[0].g;
+  int i, num, total, numcells;
+
+  grid_run(tasks, ntasks, grid_count_task);
+
+  /* the objects of each slab follow those of the slabs before it */
+  total = 0;
+  for (i=0; i<ntasks; i++) {
+    num = tasks[i].count;
+    tasks[i].count = total;
+    total += num;
+  }
+
+  numcells = g->xsize * g->ysize * g->zsize;
+  g->cellobjs = (unsigned int *) malloc((total + 1) * sizeof(unsigned int));
+  g->cells[numcells] = total;
+
+  grid_run(tasks, ntasks, grid_fill_task);
+
+  /* mark the occupied cells, 32 to a word */
+  ntasks = grid_split(tasks, ntasks, (numcells + 31) / 32);
+  grid_run(tasks, ntasks, grid_occupied_task);
+}
+
+
+/*
+ * Number the objects of a grid, filled from the num objects of list, in
+ * the order its cells first list them, so the objects of a cell, and of
+ * its neighbours along X, sit together in objs.  Returns the new objs.
+ */
+static object ** grid_renumber(grid * g, object ** list, int num, 
+                               int numingrid) {
+  object ** objs;
+  int * newidx;
+  int i, k, total;
+
+  objs = (object **) malloc((numingrid + 1) * sizeof(object *));
+  newidx = (int *) malloc(num * sizeof(int));
+  for (i=0; i<num; i++)
+    newidx[i] = -1;
+
+  total = g->cells[g->xsize * g->ysize * g->zsize];
+  k = 0;
+  for (i=0; i<total; i++) {
+    if (newidx[g->cellobjs[i]] < 0) {
+      newidx[g->cellobjs[i]] = k;
+      objs[k++] = list[g->cellobjs[i]];
     }
+    g->cellobjs[i] = newidx[g->cellobjs[i]];
+  }
 
-    cur = next;
-  } 
+  free(newidx);
 
-  return numsucceeded;
+  return objs;
 }
 
 
-static int engrid_object(grid * g, object * obj, int addtolist) {
-  vector omin, omax; 
-  gridindex low, high;
-  int x, y, z, zindex, yindex, voxindex;
-  objectlist * tmp;
- 
-  if (obj->methods->bbox(obj, &omin, &omax)) { 
-    if (!pos2grid(g, &omin, &low) || !pos2grid(g, &omax, &high)) {
-      return 0; /* object is not wholly contained in the grid, don't engrid */
+/* set the occupancy bits of a range of words of the cell bitmap */
+static void grid_occupied_task(gridtask * t) {
+  grid * g = t->g;
+  int i, voxindex, numcells;
+  unsigned int bits;
+
+  numcells = g->xsize * g->ysize * g->zsize;
+  for (i=t->start; i<t->end; i++) {
+    bits = 0;
+    for (voxindex=i*32; voxindex<i*32+32 && voxindex<numcells; voxindex++) {
+      if (g->cells[voxindex] != g->cells[voxindex + 1])
+        bits |= 1u << (voxindex & 31);
     }
-  } else {
-    return 0;   /* object is unbounded, don't engrid this object */
+    g->occupied[i] = bits;
   }
+}
 
-#if 0
-  /* test grid cell occupancy size to see if this object would   */
-  /* consume a huge number of grid cells (thus causing problems) */
-  /* in the special case of a top level grid, we could count the */
-  /* number of problematic objects, and if they exceed a maximum */
-  /* percentage or absolute number of these, we should cancel    */
-  /* filling the top level grid and rebuild a coarser top level  */
-  /* grid instead, to prevent an explosion of memory use.        */
-  {
-  int voxeloccupancy = (high.x - low.x) * (high.y - low.y) * (high.z - low.z);
-  if (voxeloccupancy > 22000) {
-    return 0; /* don't engrid this object */
+
+/* find the overfull cells within a range of cells */
+static void grid_cellbound_task(gridtask * t) {
+  grid * g = t->g;
+  gridindex index;
+  gridsubcell * s;
+  vector gmin, gmax;
+  int i, numobj;
+
+  t->subs = NULL;
+  t->numsubs = 0;
+  t->maxsubs = 0;
+  for (i=t->start; i<t->end; i++) {
+    if (!GRID_OCCUPIED(g, i))
+      continue;
+
+    index.x = i % g->xsize;
+    index.y = (i / g->xsize) % g->ysize;
+    index.z = i / (g->xsize * g->ysize);
+    numobj = cellbound(g, &index, &gmin, &gmax);
+    if (numobj > t->boundthresh) {
+      if (t->numsubs == t->maxsubs) {
+        t->maxsubs = (t->maxsubs > 0) ? t->maxsubs * 2 : 64;
+        t->subs = (gridsubcell *) realloc(t->subs, 
+                                          t->maxsubs * sizeof(gridsubcell));
+      }
+      s = &t->subs[t->numsubs++];
+      s->cell = i;
+      s->numobj = numobj;
+      s->min = gmin;
+      s->max = gmax;
+      s->sub = NULL;
+      s->numsucceeded = 0;
+    }
   }
+}
+
+
+/* 
+ * Fill the subgrids of a range of overfull cells, taking the objects 
+ * they hold out of the cells.
+ */
+static void grid_subgrid_task(gridtask * t) {
+  grid * gold = t->g;
+  gridsubcell * s;
+  gridtask sub;
+  vector min, max;
+  object * obj;
+  unsigned int * entries;
+  int i, j, num, maxnum;
+
+  memset(&sub, 0, sizeof(gridtask));
+  maxnum = 0;
+  for (i=t->start; i<t->end; i++) {
+    s = &t->subs[i];
+    entries = &gold->cellobjs[gold->cells[s->cell]];
+    num = gold->cells[s->cell + 1] - gold->cells[s->cell];
+    if (num > maxnum) {
+      maxnum = num;
+      sub.low = (gridindex *) realloc(sub.low, num * sizeof(gridindex));
+      sub.high = (gridindex *) realloc(sub.high, num * sizeof(gridindex));
+    }
+
+    /* the subgrid's objects, in the order the cell lists them */
+    sub.list = (object **) malloc(num * sizeof(object *));
+    sub.num = 0;
+    for (j=0; j<num; j++) {
+      obj = gold->objs[entries[j]];
+      min.x = -FHUGE; min.y = -FHUGE; min.z = -FHUGE;
+      max.x =  FHUGE; max.y =  FHUGE; max.z =  FHUGE;
+      if (obj->methods->bbox((void *) obj, &min, &max) &&
+          pos2grid(s->sub, &min, &sub.low[sub.num]) && 
+          pos2grid(s->sub, &max, &sub.high[sub.num])) {
+        sub.list[sub.num++] = obj;
+        entries[j] = GRID_MOVED;
+      }
+    }
+    s->numsucceeded = sub.num;
+
+    sub.g = s->sub;
+    sub.start = 0;
+    sub.end = s->sub->zsize;
+    s->sub->objs = sub.list;
+    grid_fill(&sub, 1);
   }
-#endif
 
-  /* add the object to the complete list of objects in the grid */
-  if (addtolist) { 
-    obj->nextobj = g->objects;
-    g->objects = obj;
-  }
-
-  /* add this object to all voxels it inhabits */
-  for (z=low.z; z<=high.z; z++) {
-    zindex = z * g->xsize * g->ysize;
-    for (y=low.y; y<=high.y; y++) {
-      yindex = y * g->xsize;
-      for (x=low.x; x<=high.x; x++) {
-        voxindex = x + yindex + zindex; 
-        tmp = (objectlist *) malloc(sizeof(objectlist));
-        tmp->next = g->cells[voxindex];
-        tmp->obj = obj;
-        g->cells[voxindex] = tmp;
+  free(sub.low);
+  free(sub.high);
+}
+
+
+/*
+ * Rebuild the cells of a Z slab of the top level grid with the subgrids
+ * in front of the objects they left behind.  The first pass, before
+ * t->cellobjs exists, counts the slab's new entries, the second copies
+ * them to t->cellobjs starting at t->count.
+ */
+static void grid_relink_task(gridtask * t) {
+  grid * g = t->g;
+  int i, j, num, voxindex, end;
+
+  voxindex = t->start * g->xsize * g->ysize;
+  end = t->end * g->xsize * g->ysize;
+  for (i=0; i<t->numsubs && t->subs[i].cell < voxindex; i++)
+    ;
+
+  num = (t->cellobjs != NULL) ? t->count : 0;
+  for (; voxindex < end; voxindex++) {
+    if (t->cellobjs != NULL) 
+      t->cells[voxindex] = num;
+
+    if (i < t->numsubs && t->subs[i].cell == voxindex) {
+      if (t->cellobjs != NULL) 
+        t->cellobjs[num] = t->num + i;
+      num++;
+      i++;
+    }
+
+    for (j=g->cells[voxindex]; j<g->cells[voxindex + 1]; j++) {
+      if (g->cellobjs[j] != GRID_MOVED) {
+        if (t->cellobjs != NULL) 
+          t->cellobjs[num] = g->cellobjs[j];
+        num++;
       }
     }
   }
- 
-  return 1;
+
+  if (t->cellobjs == NULL)
+    t->count = num;
 }
 
 
-static int pos2grid(grid * g, vector * pos, gridindex * index) {
+static int pos2grid(const grid * g, const vector * pos, gridindex * index) {
   index->x = (int) ((flt) (pos->x - g->min.x) / g->voxsize.x);
   index->y = (int) ((flt) (pos->y - g->min.y) / g->voxsize.y);
   index->z = (int) ((flt) (pos->z - g->min.z) / g->voxsize.z);
@@ -462,30 +831,13 @@ static int pos2grid(grid * g, vector * pos, gridindex * index) {
 
 
 /* the real thing */
-static void grid_intersect(const grid * g, ray * ry) {
-  flt tnear, tfar;
-  vector curpos, tmax, tdelta;
-  gridindex curvox, step, out; 
-  int voxindex, SY, SZ;
-  unsigned long serial;
-#if !defined(DISABLEMBOX)
-  unsigned long * mbox;
-#endif
-  objectlist * cur;
-
-  if (ry->flags & RT_RAY_FINISHED)
-    return;
-
-  if (!grid_bounds_intersect(g, ry, &tnear, &tfar))
-    return;
- 
-  if (ry->maxdist < tnear)
-    return;
-  
-  serial=ry->serial;
-#if !defined(DISABLEMBOX)
-  mbox=ry->mbox;
-#endif
+/*
+ * Set up the 3-D DDA walk of a ray through the grid cells, starting at
+ * the point where the ray enters the grid.
+ */
+static void grid_walk_start(const grid * g, const ray * ry, flt tnear,
+                            gridwalk * w) {
+  vector curpos;
 
   /* find the entry point in the grid from the near hit */ 
   curpos.x = ry->o.x + (ry->d.x * tnear);
@@ -493,130 +845,282 @@ static void grid_intersect(const grid * g, ray * ry) {
   curpos.z = ry->o.z + (ry->d.z * tnear);
 
   /* map the entry point to its nearest voxel */
-  curvox.x = (int) ((flt) (curpos.x - g->min.x) / g->voxsize.x);
-  curvox.y = (int) ((flt) (curpos.y - g->min.y) / g->voxsize.y);
-  curvox.z = (int) ((flt) (curpos.z - g->min.z) / g->voxsize.z);
-  if (curvox.x == g->xsize) curvox.x--;
-  if (curvox.y == g->ysize) curvox.y--;
-  if (curvox.z == g->zsize) curvox.z--;
+  w->curvox.x = (int) ((flt) (curpos.x - g->min.x) / g->voxsize.x);
+  w->curvox.y = (int) ((flt) (curpos.y - g->min.y) / g->voxsize.y);
+  w->curvox.z = (int) ((flt) (curpos.z - g->min.z) / g->voxsize.z);
+  if (w->curvox.x == g->xsize) w->curvox.x--;
+  if (w->curvox.y == g->ysize) w->curvox.y--;
+  if (w->curvox.z == g->zsize) w->curvox.z--;
 
   /* Setup X iterator stuff */
-  if (ry->d.x < -EPSILON) {
-    tmax.x = tnear + ((voxel2x(g, curvox.x) - curpos.x) / ry->d.x); 
-    tdelta.x = g->voxsize.x / - ry->d.x;
-    step.x = -1;
-    out.x = -1;
-  } else if (ry->d.x > EPSILON) {
-    tmax.x = tnear + ((voxel2x(g, curvox.x + 1) - curpos.x) / ry->d.x);
-    tdelta.x = g->voxsize.x / ry->d.x;
-    step.x = 1;
-    out.x = g->xsize;
+  if (ry->d.x < -ZEROEPSILON) {
+    w->tmax.x = tnear + ((voxel2x(g, w->curvox.x) - curpos.x) / ry->d.x); 
+    w->tdelta.x = g->voxsize.x / - ry->d.x;
+    w->step.x = -1;
+    w->out.x = -1;
+  } else if (ry->d.x > ZEROEPSILON) {
+    w->tmax.x = tnear + ((voxel2x(g, w->curvox.x + 1) - curpos.x) / ry->d.x);
+    w->tdelta.x = g->voxsize.x / ry->d.x;
+    w->step.x = 1;
+    w->out.x = g->xsize;
   } else {
-    tmax.x = FHUGE;
-    tdelta.x = 0.0;
-    step.x = 0;
-    out.x = 0; /* never goes out of bounds on this axis */
+    w->tmax.x = FHUGE;
+    w->tdelta.x = 0.0;
+    w->step.x = 0;
+    w->out.x = 0; /* never goes out of bounds on this axis */
   }
 
   /* Setup Y iterator stuff */
-  if (ry->d.y < -EPSILON) {
-    tmax.y = tnear + ((voxel2y(g, curvox.y) - curpos.y) / ry->d.y);
-    tdelta.y = g->voxsize.y / - ry->d.y;
-    step.y = -1;
-    out.y = -1;
-  } else if (ry->d.y > EPSILON) {
-    tmax.y = tnear + ((voxel2y(g, curvox.y + 1) - curpos.y) / ry->d.y);
-    tdelta.y = g->voxsize.y / ry->d.y;
-    step.y = 1;
-    out.y = g->ysize;
+  if (ry->d.y < -ZEROEPSILON) {
+    w->tmax.y = tnear + ((voxel2y(g, w->curvox.y) - curpos.y) / ry->d.y);
+    w->tdelta.y = g->voxsize.y / - ry->d.y;
+    w->step.y = -1;
+    w->out.y = -1;
+  } else if (ry->d.y > ZEROEPSILON) {
+    w->tmax.y = tnear + ((voxel2y(g, w->curvox.y + 1) - curpos.y) / ry->d.y);
+    w->tdelta.y = g->voxsize.y / ry->d.y;
+    w->step.y = 1;
+    w->out.y = g->ysize;
   } else {
-    tmax.y = FHUGE;
-    tdelta.y = 0.0; 
-    step.y = 0;
-    out.y = 0; /* never goes out of bounds on this axis */
+    w->tmax.y = FHUGE;
+    w->tdelta.y = 0.0; 
+    w->step.y = 0;
+    w->out.y = 0; /* never goes out of bounds on this axis */
   }
 
   /* Setup Z iterator stuff */
-  if (ry->d.z < -EPSILON) {
-    tmax.z = tnear + ((voxel2z(g, curvox.z) - curpos.z) / ry->d.z);
-    tdelta.z = g->voxsize.z / - ry->d.z;
-    step.z = -1;
-    out.z = -1;
-  } else if (ry->d.z > EPSILON) {
-    tmax.z = tnear + ((voxel2z(g, curvox.z + 1) - curpos.z) / ry->d.z);
-    tdelta.z = g->voxsize.z / ry->d.z;
-    step.z = 1;
-    out.z = g->zsize;
+  if (ry->d.z < -ZEROEPSILON) {
+    w->tmax.z = tnear + ((voxel2z(g, w->curvox.z) - curpos.z) / ry->d.z);
+    w->tdelta.z = g->voxsize.z / - ry->d.z;
+    w->step.z = -1;
+    w->out.z = -1;
+  } else if (ry->d.z > ZEROEPSILON) {
+    w->tmax.z = tnear + ((voxel2z(g, w->curvox.z + 1) - curpos.z) / ry->d.z);
+    w->tdelta.z = g->voxsize.z / ry->d.z;
+    w->step.z = 1;
+    w->out.z = g->zsize;
   } else {
-    tmax.z = FHUGE;
-    tdelta.z = 0.0; 
-    step.z = 0;
-    out.z = 0; /* never goes out of bounds on this axis */
+    w->tmax.z = FHUGE;
+    w->tdelta.z = 0.0; 
+    w->step.z = 0;
+    w->out.z = 0; /* never goes out of bounds on this axis */
   }
 
   /* pre-calculate row/column/plane offsets for stepping through grid */
-  SY = step.y * g->xsize;
-  SZ = step.z * g->xsize * g->ysize;
+  w->SY = w->step.y * g->xsize;
+  w->SZ = w->step.z * g->xsize * g->ysize;
 
   /* first cell we'll be testing */
-  voxindex = curvox.z*g->xsize*g->ysize + curvox.y*g->xsize + curvox.x; 
+  w->voxindex = w->curvox.z*g->xsize*g->ysize + w->curvox.y*g->xsize + w->curvox.x; 
+}
 
-  /* Unrolled while loop by one... */
-  /* Test all objects in the current cell for intersection */
-  cur = g->cells[voxindex];
-  while (cur != NULL) {
+
+/*
+ * Walk to the next cell, returns 0 once the ray leaves the grid or the
+ * next cell lies beyond maxdist.
+ */
+static int grid_walk_next(gridwalk * w, flt maxdist) {
+  if (w->tmax.x < w->tmax.y && w->tmax.x < w->tmax.z) {
+    w->curvox.x += w->step.x;
+    if (maxdist < w->tmax.x || w->curvox.x == w->out.x) 
+      return 0; 
+    w->tmax.x += w->tdelta.x;
+    w->voxindex += w->step.x;
+  }
+  else if (w->tmax.z < w->tmax.y) {
+    w->curvox.z += w->step.z;
+    if (maxdist < w->tmax.z || w->curvox.z == w->out.z) 
+      return 0;
+    w->tmax.z += w->tdelta.z;
+    w->voxindex += w->SZ;
+  }
+  else {
+    w->curvox.y += w->step.y;
+    if (maxdist < w->tmax.y || w->curvox.y == w->out.y) 
+      return 0;
+    w->tmax.y += w->tdelta.y;
+    w->voxindex += w->SY;
+  }
+
+  return 1;
+}
+
+
+/*
+ * Check the mailbox for an object, returns 1 if the ray with this serial
+ * number has been tested against it already, or records the test.
+ */
 #if !defined(DISABLEMBOX)
-    if (mbox[cur->obj->id] != serial) {
-      mbox[cur->obj->id] = serial; 
-      cur->obj->methods->intersect(cur->obj, ry);
-    }
-#else
-    cur->obj->methods->intersect(cur->obj, ry);
-#endif
-    cur = cur->next;
+static int grid_mbox_tested(mailbox * m, unsigned int id, 
+                            unsigned long serial) {
+  mboxentry * e;
+  unsigned int i;
+
+  if (m->direct != NULL) {
+    if (m->direct[id] == serial)
+      return 1;
+    m->direct[id] = serial;
+    return 0;
+  }
+
+  if (m->serial != serial) {
+    m->serial = serial;   /* a new ray, every entry is stale */
+    m->live = 0;
+  }
+
+  i = MBOX_HASH(id) & m->mask;
+  while ((e = &m->entries[i])->serial == serial) {
+    if (e->id == id) 
+      return 1;
+    i = (i + 1) & m->mask;
   }
 
+  e->serial = serial;
+  e->id = id;
+  if (++m->live > (m->mask >> 1))
+    grow_mailbox(m);
+
+  return 0;
+}
+#endif
+
+
+static void grid_intersect(const grid * g, ray * ry) {
+  flt tnear, tfar;
+  gridwalk w;
+#if !defined(DISABLEMBOX)
+  unsigned long serial;
+  mailbox * mbox;
+#endif
+  object * obj;
+  int i;
+
+  if (ry->flags & RT_RAY_FINISHED)
+    return;
+
+  if (!grid_bounds_intersect(g, ry, &tnear, &tfar))
+    return;
+ 
+  if (ry->maxdist < tnear)
+    return;
+  
+#if !defined(DISABLEMBOX)
+  serial=ry->serial;
+  mbox=ry->mbox;
+#endif
+
+  grid_walk_start(g, ry, tnear, &w);
+
+  /* skip the empty cells, by their occupancy bits */
+  if (!GRID_OCCUPIED(g, w.voxindex) && !grid_walk_on(g, &w, ry->maxdist))
+    return;
+
   /* Loop through grid cells until we're done */
-  while (!(ry->flags & RT_RAY_FINISHED)) {
-    /* Walk to next cell */
-    if (tmax.x < tmax.y && tmax.x < tmax.z) {
-      curvox.x += step.x;
-      if (ry->maxdist < tmax.x || curvox.x == out.x) 
-        break; 
-      tmax.x += tdelta.x;
-      voxindex += step.x;
-    }
-    else if (tmax.z < tmax.y) {
-      curvox.z += step.z;
-      if (ry->maxdist < tmax.z || curvox.z == out.z) 
-        break;
-      tmax.z += tdelta.z;
-      voxindex += SZ;
+  do {
+    /* Test all objects in the current cell for intersection */
+    for (i=g->cells[w.voxindex]; i<g->cells[w.voxindex + 1]; i++) {
+      obj = g->objs[g->cellobjs[i]];
+#if !defined(DISABLEMBOX)
+      if (!grid_mbox_tested(mbox, obj->id, serial))
+        obj->methods->intersect(obj, ry);
+#else
+      obj->methods->intersect(obj, ry);
+#endif
     }
-    else {
-      curvox.y += step.y;
-      if (ry->maxdist < tmax.y || curvox.y == out.y) 
-        break;
-      tmax.y += tdelta.y;
-      voxindex += SY;
+  } while (!(ry->flags & RT_RAY_FINISHED) && 
+           grid_walk_on(g, &w, ry->maxdist));
+}
+
+
+/*
+ * Walk to the next cell that holds any objects, returns 0 as
+ * grid_walk_next() does.
+ */
+static int grid_walk_on(const grid * g, gridwalk * w, flt maxdist) {
+  do {
+    if (!grid_walk_next(w, maxdist))
+      return 0;
+  } while (!GRID_OCCUPIED(g, w->voxindex));
+
+  return 1;
+}
+
+
+/*
+ * Walk a ray packet through the grid.  Every lane keeps its own DDA
+ * state and steps over empty cells on its own; the lanes that share the
+ * cell of the first lane still walking test its objects together, then
+ * step on.  An object is tested, once per packet thanks to the mailbox,
+ * against all lanes that entered the grid and are not finished, so a
+ * lane that reaches its cell later, or never, loses nothing.
+ */
+static void grid_packet_intersect(const grid * g, raypacket * pk) {
+  gridwalk w[RT_PACKET_MAX];
+  int vox[RT_PACKET_MAX];
+  unsigned int saved, inside, walking, cell, finished;
+  flt tnear, tfar;
+  object * obj;
+  int i, j, v;
+
+  inside = 0;
+  walking = 0;
+  for (i=0; i<pk->num; i++) {
+    if (!(pk->active & (1u << i)))
+      continue;
+    if (!grid_bounds_intersect(g, pk->rays[i], &tnear, &tfar))
+      continue;
+    if (pk->maxdist[i] < tnear)
+      continue;
+    grid_walk_start(g, pk->rays[i], tnear, &w[i]);
+    inside |= 1u << i;
+    if (GRID_OCCUPIED(g, w[i].voxindex) || 
+        grid_walk_on(g, &w[i], pk->maxdist[i]))
+      walking |= 1u << i;
+    vox[i] = w[i].voxindex;
+  }
+
+  saved = pk->active;
+  finished = 0;
+  while (walking != 0) {
+    /* find the lanes in the same cell as the first walking lane */
+    for (i=0; !(walking & (1u << i)); i++)
+      ;
+    v = vox[i];
+    cell = 0;
+    for (; i<pk->num; i++) {
+      if ((walking & (1u << i)) && vox[i] == v)
+        cell |= 1u << i;
     }
 
     /* Test all objects in the current cell for intersection */
-    cur = g->cells[voxindex];
-    while (cur != NULL) {
+    pk->active = inside;
+    for (j=g->cells[v]; j<g->cells[v + 1] && pk->active != 0; j++) {
+      obj = g->objs[g->cellobjs[j]];
 #if !defined(DISABLEMBOX)
-      if (mbox[cur->obj->id] != serial) {
-        mbox[cur->obj->id] = serial; 
-        cur->obj->methods->intersect(cur->obj, ry);
-      }
+      if (!grid_mbox_tested(pk->mbox, obj->id, pk->serial))
+        packet_intersect(obj, pk);
 #else
-      cur->obj->methods->intersect(cur->obj, ry);
+      packet_intersect(obj, pk);
 #endif
-      cur = cur->next;
+    }
+    finished |= inside & ~pk->active;
+    inside = pk->active;
+    walking &= inside;
+    cell &= inside;
+
+    /* Walk the lanes on to their next cell with objects */
+    for (i=0; cell != 0; i++, cell >>= 1) {
+      if (cell & 1) {
+        if (grid_walk_on(g, &w[i], pk->maxdist[i]))
+          vox[i] = w[i].voxindex;
+        else
+          walking &= ~(1u << i);
+      }
     }
   }
-}
 
+  pk->active = saved & ~finished;
+}
 
 
 static int grid_bounds_intersect(const grid * g, const ray * ry, flt *hitnear, flt *hitfar) {
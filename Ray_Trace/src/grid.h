@@ -11,11 +11,6 @@ object * newgrid(scenedef * scene, int xsize, int ysize, int zsize,
 
 #ifdef GRID_PRIVATE
 
-typedef struct objectlist {
-  struct objectlist * next; /* next link in the list */
-  object * obj;             /* the actual object     */
-} objectlist; 
-
 typedef struct {
   RT_OBJECT_HEAD
   int xsize;           /* number of cells along the X direction */
@@ -25,15 +20,71 @@ typedef struct {
   vector max;          /* the maximum coords for the box containing the grid */
   vector voxsize;      /* the size of a grid cell/voxel */
   object * objects;    /* all objects contained in the grid */
-  objectlist ** cells; /* the grid cells themselves */
+  object ** objs;      /* the objects the cells refer to by index */
+  int * cells;         /* the grid cells themselves, the offset of each */
+                       /* cell's objects in cellobjs, plus the total    */
+  unsigned int * cellobjs; /* objs indices of the objects of all cells,   */
+                       /* one cell after another                        */
+  unsigned int * occupied; /* bitmap of the cells holding any objects */
 } grid;
 
+/*
+ * Nonzero if cell v of the grid holds any objects.
+ */
+#define GRID_OCCUPIED(g, v) ((g)->occupied[(v) >> 5] & (1u << ((v) & 31)))
+
+#define GRID_MOVED 0xffffffffu /* cell entry taken over by a subgrid */
+
 typedef struct {
   int x;         /* Voxel X address */
   int y;         /* Voxel Y address */
   int z;         /* Voxel Z address */
 } gridindex; 
 
+typedef struct {
+  vector tmax;         /* ray distance to the next cell along X/Y/Z */
+  vector tdelta;       /* ray distance across one cell along X/Y/Z */
+  gridindex curvox;    /* current cell */
+  gridindex step;      /* cell step along X/Y/Z, -1, 0 or 1 */
+  gridindex out;       /* cell address where the ray leaves the grid */
+  int voxindex;        /* index of the current cell */
+  int SY;              /* voxindex offsets of a step along Y and Z */
+  int SZ;
+} gridwalk;
+
+#define GRID_PARSIZE 4096 /* fewest objects worth another build thread */
+
+/* an overfull cell of the top level grid that gets a subgrid */
+typedef struct {
+  int cell;            /* index of the cell */
+  int numobj;          /* objects wholly inside the cell */
+  vector min;          /* and their bounds */
+  vector max;
+  grid * sub;          /* the subgrid made for them */
+  int numsucceeded;    /* objects moved into the subgrid */
+} gridsubcell;
+
+/* one thread's share of a grid build pass */
+typedef struct gridtask {
+  void (* fctn)(struct gridtask *); /* the pass to run */
+  grid * g;            /* grid being built */
+  object ** list;      /* objects to engrid */
+  gridindex * low;     /* cells each object spans, low.x < 0 when the */
+  gridindex * high;    /* object is not to be engridded               */
+  int num;             /* number of objects */
+  int start;           /* range of objects, Z slabs, cells or subcells */
+  int end;             /* handled by this task */
+  int count;           /* cell entries counted, base of the task's slab */
+  vector min;          /* bounds of the task's objects */
+  vector max;
+  int boundthresh;     /* objects in a cell that warrant a subgrid */
+  gridsubcell * subs;  /* overfull cells found by or given to the task */
+  int numsubs;
+  int maxsubs;
+  int * cells;         /* top level cells being rebuilt with the subgrids */
+  unsigned int * cellobjs;
+} gridtask;
+
 /*
  * Convert from voxel number along X/Y/Z to corresponding coordinate.
  */
@@ -55,14 +106,31 @@ static void grid_free(void * v);
 
 static int cellbound(const grid *g, const gridindex *index, vector * cmin, vector * cmax);
 
-static int engrid_objlist(grid * g, object ** list);
-static int engrid_object(grid * g, object * obj, int addtolist);
-
-static int engrid_objectlist(grid * g, objectlist ** list);
-static int engrid_cell(scenedef *, int, grid *, gridindex *);
-
-static int pos2grid(grid * g, vector * pos, gridindex * index);
+#ifdef THR
+static void * grid_task(void * voidparms);
+#endif
+static void grid_run(gridtask * tasks, int ntasks, void (* fctn)(gridtask *));
+static void grid_bound_task(gridtask * t);
+static void grid_index_task(gridtask * t);
+static void grid_count_task(gridtask * t);
+static void grid_fill_task(gridtask * t);
+static void grid_cellbound_task(gridtask * t);
+static void grid_subgrid_task(gridtask * t);
+static void grid_relink_task(gridtask * t);
+static void grid_occupied_task(gridtask * t);
+static int grid_split(gridtask * tasks, int nthr, int num);
+static void grid_fill(gridtask * tasks, int ntasks);
+static object ** grid_renumber(grid *, object **, int, int);
+
+static int pos2grid(const grid * g, const vector * pos, gridindex * index);
+#if !defined(DISABLEMBOX)
+static int grid_mbox_tested(mailbox *, unsigned int, unsigned long);
+#endif
+static void grid_walk_start(const grid *, const ray *, flt, gridwalk *);
+static int grid_walk_next(gridwalk *, flt);
+static int grid_walk_on(const grid *, gridwalk *, flt);
 static void grid_intersect(const grid *, ray *);
+static void grid_packet_intersect(const grid *, raypacket *);
 static int grid_bounds_intersect(const grid * g, const ray * ry, flt *hitnear, flt *hitfar);
 
 #endif
@@ -30,6 +30,71 @@ void free_objects(object * start) {
 }
 
 
+#define MBOX_DIRECTMAX 16384 /* most objects for a direct mailbox array */
+#define MBOX_INITSIZE 256    /* hashed mailbox entries to start with    */
+
+mailbox * new_mailbox(unsigned int numobjects) {
+  mailbox * m;
+
+  m = (mailbox *) malloc(sizeof(mailbox));
+  m->direct = NULL;
+  m->numdirect = 0;
+  if (numobjects <= MBOX_DIRECTMAX) {
+    m->direct = (unsigned long *) calloc(numobjects, sizeof(unsigned long));
+    m->numdirect = numobjects;
+  }
+  m->entries = (mboxentry *) calloc(MBOX_INITSIZE, sizeof(mboxentry));
+  m->mask = MBOX_INITSIZE - 1;
+  m->live = 0;
+  m->serial = 0;
+
+  return m;
+}
+
+void free_mailbox(mailbox * m) {
+  if (m == NULL)
+    return;
+
+  free(m->direct);
+  free(m->entries);
+  free(m);
+}
+
+/* forget every ray, for when serial numbers start over */
+void reset_mailbox(mailbox * m) {
+  if (m->direct != NULL)
+    memset(m->direct, 0, m->numdirect * sizeof(unsigned long));
+  memset(m->entries, 0, (m->mask + 1) * sizeof(mboxentry));
+  m->live = 0;
+  m->serial = 0;
+}
+
+/* 
+ * Double the mailbox once the current ray fills half of it, keeping the 
+ * ray's entries; entries of earlier rays are dropped.
+ */
+void grow_mailbox(mailbox * m) {
+  mboxentry * old;
+  unsigned int i, j, oldsize;
+
+  old = m->entries;
+  oldsize = m->mask + 1;
+  m->mask = oldsize * 2 - 1;
+  m->entries = (mboxentry *) calloc(oldsize * 2, sizeof(mboxentry));
+
+  for (i=0; i<oldsize; i++) {
+    if (old[i].serial == m->serial && m->serial != 0) {
+      j = MBOX_HASH(old[i].id) & m->mask;
+      while (m->entries[j].serial == m->serial)
+        j = (j + 1) & m->mask;
+      m->entries[j] = old[i];
+    }
+  }
+
+  free(old);
+}
+
+
 void intersect_objects(ray * ry) {
   object * cur;
   object temp;
@@ -112,7 +177,7 @@ void add_shadow_intersection(flt t, const object * obj, ray * ry) {
       /* if this object doesn't cast a shadow, modulate the */
       /* light by its opacity value                         */
       if (!(obj->tex->flags & RT_TEXTURE_SHADOWCAST)) {
-        ry->intstruct.shadowfilter *= (1.0 - obj->tex->opacity);
+        ry->intstruct.shadowfilter *= (1.0f - obj->tex->opacity);
         return;
       }
 
@@ -134,7 +199,7 @@ void add_clipped_shadow_intersection(flt t, const object * obj, ray * ry) {
       /* if this object doesn't cast a shadow, modulate the */
       /* light by its opacity value                         */
       if (!(obj->tex->flags & RT_TEXTURE_SHADOWCAST)) {
-        ry->intstruct.shadowfilter *= (1.0 - obj->tex->opacity);
+        ry->intstruct.shadowfilter *= (1.0f - obj->tex->opacity);
         return;
       }
 
@@ -17,7 +17,16 @@ void add_shadow_intersection(flt, const object *, ray *);
 void add_clipped_shadow_intersection(flt, const object *, ray *);
 int shadow_intersection(ray *);
 
+mailbox * new_mailbox(unsigned int numobjects);
+void free_mailbox(mailbox *);
+void reset_mailbox(mailbox *);
+void grow_mailbox(mailbox *);
+
+/* hash of an object id, for the mailbox table */
+#define MBOX_HASH(id) ((id) * 2654435761u)
+
 #define reset_intersection(ry) \
 	(ry)->intstruct.num = 0; \
-	(ry)->intstruct.shadowfilter = 1.0;
+	(ry)->intstruct.shadowfilter = 1.0; \
+	(ry)->intstruct.shadows = NULL;
 
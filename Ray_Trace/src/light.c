@@ -155,7 +155,7 @@ static flt simple_point_light_shade_diffuse(point_light * li, shadedata *shadeva
   VSUB(li->ctr, (shadevars->hit), (shadevars->L))  /* find the light vector */
 
   /* calculate the distance to the light from the hit point */
-  len = sqrt(shadevars->L.x*shadevars->L.x + shadevars->L.y*shadevars->L.y + shadevars->L.z*shadevars->L.z) + EPSILON;
+  len = SQRT(shadevars->L.x*shadevars->L.x + shadevars->L.y*shadevars->L.y + shadevars->L.z*shadevars->L.z) + EPSILON;
 
   shadevars->L.x /= len;                  /* normalize the light direction */
   shadevars->L.y /= len;
@@ -177,7 +177,7 @@ static flt point_light_shade_diffuse(point_light * li, shadedata *shadevars) {
   VSUB(li->ctr, (shadevars->hit), (shadevars->L))  /* find the light vector */
 
   /* calculate the distance to the light from the hit point */
-  len = sqrt(shadevars->L.x*shadevars->L.x + shadevars->L.y*shadevars->L.y + shadevars->L.z*shadevars->L.z) + EPSILON;
+  len = SQRT(shadevars->L.x*shadevars->L.x + shadevars->L.y*shadevars->L.y + shadevars->L.z*shadevars->L.z) + EPSILON;
 
   shadevars->L.x /= len;                  /* normalize the light direction */
   shadevars->L.y /= len;
@@ -251,7 +251,7 @@ static void light_intersect(const point_light * l, ray * ry) {
   disc=b*b + l->rad*l->rad - temp;
 
   if (disc<=0.0) return;
-  disc=sqrt(disc);
+  disc=SQRT(disc);
 
   t2=b+disc;
   if (t2 <= SPEPSILON) 
@@ -270,7 +270,7 @@ static void light_normal(const point_light * l, const vector * pnt, const ray *
   N->y = pnt->y - l->ctr.y;
   N->z = pnt->z - l->ctr.z;
 
-  invlen = 1.0 / sqrt(N->x*N->x + N->y*N->y + N->z*N->z);
+  invlen = 1.0f / SQRT(N->x*N->x + N->y*N->y + N->z*N->z);
   N->x *= invlen;
   N->y *= invlen;
   N->z *= invlen;
@@ -0,0 +1,227 @@
+/*
+ * packet.c - tracing coherent groups of rays together
+ *
+ * A packet holds up to RT_PACKET_MAX primary rays from neighbouring pixels,
+ * or the shadow rays they send towards one light.  Objects that provide a
+ * packet_intersect method test all lanes of the packet at once, the grid
+ * and the BVH walk the packet through their cells and nodes together, and
+ * every other object is tested one lane at a time with its usual
+ * intersect method.  Lanes that are not in the active mask are skipped;
+ * shadow rays leave the mask as soon as they are blocked.
+ *
+ * $Id$
+ *
+ */
+
+#include "machine.h"
+#include "types.h"
+#include "macros.h"
+#include "vector.h"
+#include "intersect.h"
+#include "light.h"
+#include "packet.h"
+
+/*
+ * packet_setup()
+ *   copy the first num rays of pk->rays into the lanes of the packet,
+ *   reset their intersections and make every lane active.
+ */
+void packet_setup(raypacket * pk, int num) {
+  int i;
+
+  pk->num = num;
+  pk->active = 0;
+  for (i=0; i<num; i++) {
+    ray * ry = pk->rays[i];
+
+    reset_intersection(ry);
+    ry->serial = pk->serial;
+
+    pk->ox[i] = ry->o.x;
+    pk->oy[i] = ry->o.y;
+    pk->oz[i] = ry->o.z;
+    pk->dx[i] = ry->d.x;
+    pk->dy[i] = ry->d.y;
+    pk->dz[i] = ry->d.z;
+    pk->maxdist[i] = ry->maxdist;
+
+    /* same reciprocals as the scalar BVH slab test */
+    if (ry->d.x > 1e-20 || ry->d.x < -1e-20)
+      pk->ix[i] = 1.0f / ry->d.x;
+    else
+      pk->ix[i] = (ry->d.x < 0.0) ? -FHUGE : FHUGE;
+    if (ry->d.y > 1e-20 || ry->d.y < -1e-20)
+      pk->iy[i] = 1.0f / ry->d.y;
+    else
+      pk->iy[i] = (ry->d.y < 0.0) ? -FHUGE : FHUGE;
+    if (ry->d.z > 1e-20 || ry->d.z < -1e-20)
+      pk->iz[i] = 1.0f / ry->d.z;
+    else
+      pk->iz[i] = (ry->d.z < 0.0) ? -FHUGE : FHUGE;
+
+    pk->active |= 1u << i;
+  }
+}
+
+
+/*
+ * packet_intersect_objects()
+ *   the packet counterpart of intersect_objects(), unbounded objects first.
+ */
+void packet_intersect_objects(raypacket * pk) {
+  object * cur;
+  scenedef * scene = pk->rays[0]->scene;
+
+  for (cur=scene->objgroup.unboundedobj; cur != NULL; cur=cur->nextobj)
+    packet_intersect(cur, pk);
+
+  for (cur=scene->objgroup.boundedobj; cur != NULL; cur=cur->nextobj)
+    packet_intersect(cur, pk);
+}
+
+
+/*
+ * packet_intersect()
+ *   test the active lanes of the packet against one object, through its
+ *   packet method if it has one, otherwise ray by ray.
+ */
+void packet_intersect(const object * obj, raypacket * pk) {
+  unsigned int done;
+  int i;
+
+  if (pk->active == 0)
+    return;
+
+  if (obj->methods->packet_intersect != NULL) {
+    obj->methods->packet_intersect(obj, pk);
+    return;
+  }
+
+  done = 0;
+  for (i=0; i<pk->num; i++) {
+    if (pk->active & (1u << i)) {
+      ray * ry = pk->rays[i];
+      obj->methods->intersect(obj, ry);
+      pk->maxdist[i] = ry->maxdist;
+      if (ry->flags & RT_RAY_FINISHED)
+        done |= 1u << i;
+    }
+  }
+  pk->active &= ~done;
+}
+
+
+/*
+ * packet_hits()
+ *   record the hits of the active lanes, through each ray's own
+ *   add_intersection so clipping and shadow filtering work as usual.
+ *   Intersection routines store 0.0 for lanes that miss; as every
+ *   add_intersection method ignores t <= EPSILON anyway, only the
+ *   positive ones are passed on.
+ */
+void packet_hits(raypacket * pk, const object * obj, const flt * t) {
+  int i;
+
+  for (i=0; i<pk->num; i++) {
+    if (t[i] > 0.0 && (pk->active & (1u << i))) {
+      ray * ry = pk->rays[i];
+      ry->add_intersection(t[i], obj, ry);
+      pk->maxdist[i] = ry->maxdist;
+      if (ry->flags & RT_RAY_FINISHED)
+        pk->active &= ~(1u << i);
+    }
+  }
+}
+
+
+/*
+ * packet_shadows()
+ *   trace the shadow rays of an intersected packet of primary rays, one
+ *   packet per light, the way full_shader() would trace them one by one.
+ *   filters[i * numlights + l] receives the shadow filter of lane i for
+ *   light l, or -1.0 if the light is blocked, and each ray's intstruct
+ *   points at its row so that full_shader() uses it instead.
+ */
+void packet_shadows(raypacket * pk, flt * filters) {
+  scenedef * scene = pk->rays[0]->scene;
+  shadedata shadevars[RT_PACKET_MAX];
+  ray shadowrays[RT_PACKET_MAX];
+  int lane[RT_PACKET_MAX];
+  raypacket spk;
+  unsigned int lit;
+  list * cur;
+  int i, l, n, numlights;
+  flt t;
+
+  numlights = scene->numlights;
+  lit = 0;
+  for (i=0; i<pk->num; i++) {
+    ray * ry = pk->rays[i];
+    object const * obj;
+
+    if (closest_intersection(&t, &obj, ry) < 1)
+      continue;
+    if (obj->tex->flags & RT_TEXTURE_ISLIGHT)
+      continue;
+    if ((obj->tex->diffuse <= MINCONTRIB) && (obj->tex->phong <= MINCONTRIB))
+      continue;
+
+    RAYPNT(shadevars[i].hit, (*ry), t)
+    obj->methods->normal(obj, &shadevars[i].hit, ry, &shadevars[i].N);
+    lit |= 1u << i;
+
+    for (l=0; l<numlights; l++)
+      filters[i * numlights + l] = -1.0;
+    ry->intstruct.shadows = &filters[i * numlights];
+  }
+  if (lit == 0)
+    return;
+
+  spk.mbox = pk->mbox;
+  spk.serial = pk->serial;
+  for (cur=scene->lightlist, l=0; cur != NULL; cur=cur->next, l++) {
+    light * li = (light *) cur->item;
+
+    n = 0;
+    for (i=0; i<pk->num; i++) {
+      ray * sr;
+      flt inten;
+
+      if (!(lit & (1u << i)))
+        continue;
+
+      inten = scene->light_scale * li->shade_diffuse(li, &shadevars[i]);
+      if (inten <= MINCONTRIB)
+        continue;
+
+      sr = &shadowrays[n];
+      sr->o = shadevars[i].hit;
+      sr->d = shadevars[i].L;
+      sr->o = Rayoffset(sr, 0.0);
+      sr->maxdist = shadevars[i].Llen;
+      sr->flags = RT_RAY_SHADOW;
+      sr->mbox = pk->mbox;
+      sr->scene = scene;
+      if (scene->flags & RT_SHADE_CLIPPING)
+        sr->add_intersection = add_clipped_shadow_intersection;
+      else
+        sr->add_intersection = add_shadow_intersection;
+      lane[n] = i;
+      spk.rays[n++] = sr;
+    }
+    if (n == 0)
+      continue;
+
+    spk.serial += n;
+    packet_setup(&spk, n);
+    packet_intersect_objects(&spk);
+
+    for (i=0; i<n; i++) {
+      if (!shadow_intersection(spk.rays[i]))
+        filters[lane[i] * numlights + l] = spk.rays[i]->intstruct.shadowfilter;
+    }
+  }
+
+  pk->serial = spk.serial;
+}
+
@@ -0,0 +1,39 @@
+/*
+ * packet.h - tracing coherent groups of rays together
+ *
+ * $Id$
+ *
+ */
+
+#define RT_PACKET_MAX 16   /* most rays in one packet */
+
+/*
+ * The lanes of a packet, one per ray, stored as separate arrays so the
+ * per-lane loops of the intersection routines vectorize.  Hits are still
+ * recorded in the rays themselves through their add_intersection method,
+ * maxdist mirrors ray->maxdist.
+ */
+typedef struct {
+  flt ox[RT_PACKET_MAX];     /* ray origins                               */
+  flt oy[RT_PACKET_MAX];
+  flt oz[RT_PACKET_MAX];
+  flt dx[RT_PACKET_MAX];     /* ray directions                            */
+  flt dy[RT_PACKET_MAX];
+  flt dz[RT_PACKET_MAX];
+  flt ix[RT_PACKET_MAX];     /* reciprocal directions, for slab tests     */
+  flt iy[RT_PACKET_MAX];
+  flt iz[RT_PACKET_MAX];
+  flt maxdist[RT_PACKET_MAX]; /* closest hit so far, or the ray length   */
+  ray * rays[RT_PACKET_MAX]; /* the rays themselves                       */
+  int num;                   /* lanes in use                              */
+  unsigned int active;       /* lanes to test, one bit per lane           */
+  unsigned long serial;      /* mailbox serial number of the packet       */
+  mailbox * mbox;            /* mailbox of the thread                     */
+} raypacket;
+
+void packet_setup(raypacket *, int num);
+void packet_intersect_objects(raypacket *);
+void packet_intersect(const object *, raypacket *);
+void packet_hits(raypacket *, const object *, const flt * t);
+void packet_shadows(raypacket *, flt * filters);
+
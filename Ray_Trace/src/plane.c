@@ -10,6 +10,7 @@
 #include "vector.h"
 #include "intersect.h"
 #include "util.h"
+#include "packet.h"
 
 #define PLANE_PRIVATE
 #include "plane.h"
@@ -18,7 +19,8 @@ static object_methods plane_methods = {
   (void (*)(const void *, void *))(plane_intersect),
   (void (*)(const void *, const void *, const void *, void *))(plane_normal),
   plane_bbox, 
-  free 
+  free,
+  (void (*)(const void *, void *))(plane_packet_intersect)
 };
 
 object * newplane(void * tex, vector ctr, vector norm) {
@@ -58,6 +60,25 @@ static void plane_intersect(const plane * pln, ray * ry) {
   }
 }
 
+static void plane_packet_intersect(const plane * pln, raypacket * pk) {
+  flt t[RT_PACKET_MAX];
+  int i, n = pk->num;
+
+  for (i=0; i<n; i++) {
+    flt tn, td;
+
+    tn = -(pln->d + (pln->norm.x * pk->ox[i] + 
+                     pln->norm.y * pk->oy[i] + 
+                     pln->norm.z * pk->oz[i]));
+    td = pln->norm.x * pk->dx[i] + pln->norm.y * pk->dy[i] + 
+         pln->norm.z * pk->dz[i];
+    tn /= (td != 0.0) ? td : 1.0;
+    t[i] = (td != 0.0 && tn > 0.0) ? tn : 0.0;
+  }
+
+  packet_hits(pk, (object *) pln, t);
+}
+
 static void plane_normal(const plane * pln, const vector * pnt, const ray * incident, vector * N) {
   *N=pln->norm;
 
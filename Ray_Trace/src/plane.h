@@ -15,6 +15,7 @@ typedef struct {
 } plane; 
 
 static void plane_intersect(const plane *, ray *);
+static void plane_packet_intersect(const plane *, raypacket *);
 static int plane_bbox(void * obj, vector * min, vector * max);
 static void plane_normal(const plane *, const vector *, const ray * incident, vector *);
 #endif
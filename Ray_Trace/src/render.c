@@ -16,6 +16,7 @@
 #include "shade.h"
 #include "ui.h"
 #include "grid.h"
+#include "bvh.h"
 #include "camera.h"
 #include "intersect.h"
 
@@ -54,6 +55,47 @@ void * thread_slave(void * voidparms) {
 }
 
 
+/*
+ * Build the schedule of square tiles the threads render from.  The tiles
+ * are handed out in Morton order, so consecutive tiles, which are likely
+ * to be rendered at the same time by different threads, lie close
+ * together in the image and in the grid.  The codes of a square power of
+ * two larger than the image are walked and those outside the image are
+ * skipped.
+ */
+static tilesched * create_tiles(scenedef * scene) {
+  tilesched * tiles;
+  int i, n, code, tx, ty, side;
+
+  tiles = (tilesched *) malloc(sizeof(tilesched));
+  tiles->size = scene->tilesize;
+  tiles->xtiles = (scene->hres + tiles->size - 1) / tiles->size;
+  tiles->ytiles = (scene->vres + tiles->size - 1) / tiles->size;
+  tiles->numtiles = tiles->xtiles * tiles->ytiles;
+  tiles->order = (int *) malloc(tiles->numtiles * sizeof(int));
+
+  side = 1;
+  while (side < tiles->xtiles || side < tiles->ytiles)
+    side <<= 1;
+
+  n = 0;
+  for (code=0; code < side*side; code++) {
+    /* de-interleave the even bits into x and the odd bits into y */
+    tx = ty = 0;
+    for (i=0; (1 << i) < side; i++) {
+      tx |= ((code >> (2*i    )) & 1) << i;
+      ty |= ((code >> (2*i + 1)) & 1) << i;
+    }
+    if (tx < tiles->xtiles && ty < tiles->ytiles)
+      tiles->order[n++] = ty * tiles->xtiles + tx;
+  }
+
+  rt_shared_iterator_init(&tiles->iter);
+
+  return tiles;
+}
+
+
 /* 
  * Create the pool of rendering threads, initialize all of the
  * state variables they need, and start them waiting on the barrier.
@@ -62,6 +104,7 @@ void create_render_threads(scenedef * scene) {
   thr_parms * parms;
   rt_thread_t * threads;
   rt_barrier_t * bar;
+  tilesched * tiles;
   int thr;
 
   /* allocate and initialize thread parameter buffers */
@@ -70,28 +113,39 @@ void create_render_threads(scenedef * scene) {
 
   bar = rt_thread_barrier_init(scene->numthreads);
 
+  /* Threads-only builds (or MPI nodes == 1) normally render tiles, */
+  /* each thread taking the next one as soon as it has finished.    */
+  tiles = NULL;
+#if !defined(_OPENMP)
+  if (scene->nodes == 1 && scene->tilesize > 0)
+    tiles = create_tiles(scene);
+#endif
+
   for (thr=0; thr<scene->numthreads; thr++) {
     parms[thr].tid=thr;
     parms[thr].nthr=scene->numthreads;
     parms[thr].scene=scene;
 
-    /* the sizes of these arrays are padded to avoid cache aliasing */
-    /* and false sharing between threads.                           */
     parms[thr].local_mbox = 
 #if !defined(DISABLEMBOX)
-      (unsigned long *) calloc(sizeof(unsigned long)*scene->objgroup.numobjects + 32, 1);
+      new_mailbox(scene->objgroup.numobjects);
 #else
       NULL;
 #endif
 
     parms[thr].serialno = 1;
     parms[thr].runbar = bar;
-
-    /* For a threads-only build (or MPI nodes == 1), we distribute  */
-    /* work round-robin by scanlines.  For MPI-only builds, we also */
-    /* distribute by scanlines.  For mixed MPI+threads builds, we   */
-    /* distribute work to nodes by scanline, and to the threads     */
-    /* within a node on a pixel-by-pixel basis.                     */
+    parms[thr].tiles = tiles;
+    parms[thr].numtiles = 0;
+    parms[thr].numrays = 0;
+
+    /* Without tiles, a threads-only build (or MPI nodes == 1)      */
+    /* distributes work round-robin by scanlines; with tiles, these */
+    /* bounds are replaced by those of each tile the thread takes.  */
+    /* For MPI-only builds, we also distribute by scanlines.  For   */
+    /* mixed MPI+threads builds, we distribute work to nodes by     */
+    /* scanline, and to the threads within a node on a pixel-by-    */
+    /* pixel basis.                                                 */
     if (scene->nodes == 1) {
       parms[thr].startx = 1;
       parms[thr].stopx  = scene->hres;
@@ -147,8 +201,13 @@ void destroy_render_threads(scenedef * scene) {
      *       may have changed on us.
      */
     for (thr=0; thr < parms[0].nthr; thr++) {
-      if (parms[thr].local_mbox != NULL) 
-        free(parms[thr].local_mbox);
+      free_mailbox(parms[thr].local_mbox);
+    }
+
+    if (parms[0].tiles != NULL) {
+      rt_shared_iterator_destroy(&parms[0].tiles->iter);
+      free(parms[0].tiles->order);
+      free(parms[0].tiles);
     }
 
     free(scene->threadparms);
@@ -204,6 +263,10 @@ static void rendercheck(scenedef * scene) {
   if (scene->boundmode == RT_BOUNDING_ENABLED) 
     engrid_scene(scene, scene->boundthresh); 
 
+  /* or a bounding volume hierarchy */
+  if (scene->boundmode == RT_BOUNDING_BVH) 
+    bvh_scene(scene, scene->boundthresh); 
+
   /* if any clipping groups exist, we have to use appropriate */
   /* intersection testing logic                               */
   if (scene->cliplist != NULL) {
@@ -238,6 +301,22 @@ static void rendercheck(scenedef * scene) {
     } 
   }
 
+  /* progressive rendering keeps the sample sums of every pixel, */
+  /* and is only done by a single node                           */
+  if (scene->aabuf != NULL) {
+    free(scene->aabuf);
+    scene->aabuf = NULL;
+  }
+  if (scene->progressive) {
+    if (scene->nodes == 1) {
+      scene->aabuf = malloc(sizeof(aapixel) * scene->hres * scene->vres);
+      if (scene->aabuf == NULL)
+        rt_ui_message(MSG_0, "Warning: Failed To Allocate Progressive Buffer!");
+    } else if (scene->mynode == 0) {
+      rt_ui_message(MSG_0, "Progressive rendering needs a single node.");
+    }
+  }
+
   /* if any threads are leftover from a previous scene, and the  */
   /* scene has changed significantly, we have to collect, and    */
   /* respawn the worker threads, since lots of things may have   */
@@ -328,6 +407,71 @@ static void renderio(scenedef * scene) {
 }
 
 
+/*
+ * Rewind the tile schedule, if the threads are using one
+ */
+static void rewindtiles(scenedef * scene) {
+  tilesched * tiles = ((thr_parms *) scene->threadparms)[0].tiles;
+
+  if (tiles != NULL)
+    rt_shared_iterator_set(&tiles->iter, 0, tiles->numtiles);
+}
+
+
+/*
+ * Render the frame progressively, adding samples to the pixels that still
+ * need them in each pass, up to scene->antialiasing + 1 of them.  The 
+ * image buffer holds the mean of the samples after every pass, when the
+ * progress callback, if any, may end the frame early.
+ */
+static void renderpasses(scenedef * scene) {
+  thr_parms * parms = (thr_parms *) scene->threadparms;
+  aapixel * aa = (aapixel *) scene->aabuf;
+  int pass, numpixels, refine, i;
+  double samples, maxsamples;
+
+  numpixels = scene->hres * scene->vres;
+  maxsamples = (double) numpixels * (scene->antialiasing + 1);
+  memset(aa, 0, sizeof(aapixel) * numpixels);
+
+  samples = 0.0;
+  refine = numpixels;
+  for (pass=0; refine > 0; pass++) {
+    scene->aapass = pass;
+    rewindtiles(scene);
+
+#ifdef THR
+    /* if using threads, wake up the child threads...  */
+    rt_thread_barrier(parms[0].runbar, 1);
+#endif
+
+    thread_trace(&parms[0]);
+
+    samples = 0.0;
+    for (i=0; i<numpixels; i++)
+      samples += aa[i].n;
+
+    refine = trace_select_pixels(scene);
+    if (scene->mynode == 0)
+      rt_ui_progress((int) ((100 * samples) / maxsamples));
+
+    if (scene->progressfunc != NULL &&
+        scene->progressfunc(scene->progressdata, pass + 1, refine)) {
+      pass++;
+      break;
+    }
+  }
+  scene->aapass = 0;
+
+  if (scene->verbosemode && scene->mynode == 0) {
+    char msgtxt[256];
+    sprintf(msgtxt, "  Progressive: %d passes, %.2f samples per pixel",
+            pass, samples / numpixels);
+    rt_ui_message(MSG_0, msgtxt);
+  }
+}
+
+
 /*
  * Render the scene
  */
@@ -361,22 +505,30 @@ void renderscene(scenedef * scene) {
 
   camera_init(scene);      /* Initialize all aspects of camera system  */
 
+  if (scene->aabuf != NULL) {
+    /* Ray Trace The Image in refining passes */
+    renderpasses(scene);
+  } else {
+    /* rewind the tile schedule, if the threads are using one */
+    rewindtiles(scene);
+
 #ifdef THR
-  /* if using threads, wake up the child threads...  */
-  rt_thread_barrier(((thr_parms *) scene->threadparms)[0].runbar, 1);
+    /* if using threads, wake up the child threads...  */
+    rt_thread_barrier(((thr_parms *) scene->threadparms)[0].runbar, 1);
 #endif
 
 #ifdef MPI
-  /* if using message passing, start persistent receives */
-  rt_start_scanlinereceives(scene->parbuf); /* start scanline receives */
+    /* if using message passing, start persistent receives */
+    rt_start_scanlinereceives(scene->parbuf); /* start scanline receives */
 #endif
 
-  /* Actually Ray Trace The Image */
-  thread_trace(&((thr_parms *) scene->threadparms)[0]);
+    /* Actually Ray Trace The Image */
+    thread_trace(&((thr_parms *) scene->threadparms)[0]);
 
 #ifdef MPI
-  rt_waitscanlines(scene->parbuf);  /* wait for all scanlines to recv/send  */
+    rt_waitscanlines(scene->parbuf);  /* wait for all scanlines to recv/send */
 #endif
+  }
 
   rt_timer_stop(rtth);              /* stop timer for ray tracing runtime   */
   runtime=rt_timer_time(rtth);
@@ -396,6 +548,21 @@ void renderscene(scenedef * scene) {
 
     sprintf(msgtxt, "\n  Ray Tracing Time: %10.4f seconds", runtime);
     rt_ui_message(MSG_0, msgtxt);
+
+    /* show how evenly the work was spread over the threads */
+    if (scene->verbosemode) {
+      thr_parms * parms = (thr_parms *) scene->threadparms;
+      int thr;
+
+      for (thr=0; thr<parms[0].nthr; thr++) {
+        if (parms[thr].tiles != NULL)
+          sprintf(msgtxt, "  Thread %3d: %8lu rays, %6d tiles", 
+                  thr, parms[thr].numrays, parms[thr].numtiles);
+        else 
+          sprintf(msgtxt, "  Thread %3d: %8lu rays", thr, parms[thr].numrays);
+        rt_ui_message(MSG_0, msgtxt);
+      }
+    }
  
     if (scene->writeimagefile) 
       renderio(scene);
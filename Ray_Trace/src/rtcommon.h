@@ -35,6 +35,7 @@ typedef flt apiflt;  /* generic floating point number, using double */
  */
 #define RT_BOUNDING_DISABLED 0  /* spatial subdivision/bounding disabled */
 #define RT_BOUNDING_ENABLED  1  /* spatial subdivision/bounding enabled  */
+#define RT_BOUNDING_BVH      2  /* bounding volume hierarchy (binned SAH) */
 
 
 /*
@@ -208,7 +208,9 @@ color full_shader(ray * incident) {
   color col, diffuse, ambocccol, phongcol;
   shadedata shadevars;
   ray shadowray;
-  flt inten;
+  const flt * shadows;
+  flt inten, shadowfilter;
+  int lightnum;
   flt t = FHUGE;
   object const * obj;
   int numints;
@@ -260,6 +262,8 @@ color full_shader(ray * incident) {
     shadowray.serial = incident->serial + 1; /* track ray serial number */
     shadowray.mbox = incident->mbox;
     shadowray.scene = incident->scene;
+    shadows = incident->intstruct.shadows; /* shadow packet results */
+    lightnum = 0;
 
     while (cur != NULL) {              /* loop for light contributions */
       light * li=(light *) cur->item;  /* set li=to the current light  */
@@ -267,19 +271,30 @@ color full_shader(ray * incident) {
 
       /* add in diffuse lighting for this light if we're facing it */ 
       if (inten > MINCONTRIB) {            
-        /* test for a shadow */
-        shadowray.o   = shadevars.hit;
-        shadowray.d   = shadevars.L;      
-        shadowray.maxdist = shadevars.Llen;
-        shadowray.flags = RT_RAY_SHADOW;
-        shadowray.serial++;
-        intersect_objects(&shadowray); /* trace the shadow ray */
-
-        if (!shadow_intersection(&shadowray)) {
+        if (shadows != NULL) {
+          /* the shadow ray was already traced in a ray packet */
+          shadowfilter = shadows[lightnum];
+        } else {
+          /* test for a shadow */
+          shadowray.o   = shadevars.hit;
+          shadowray.d   = shadevars.L;      
+          shadowray.o   = Rayoffset(&shadowray, 0.0);
+          shadowray.maxdist = shadevars.Llen;
+          shadowray.flags = RT_RAY_SHADOW;
+          shadowray.serial++;
+          intersect_objects(&shadowray); /* trace the shadow ray */
+
+          if (shadow_intersection(&shadowray))
+            shadowfilter = -1.0;         /* the light is occluded */
+          else
+            shadowfilter = shadowray.intstruct.shadowfilter;
+        }
+
+        if (shadowfilter >= 0.0) {
           /* If the light isn't occluded, then we modulate it by any */
           /* transparent surfaces the shadow ray encountered, and    */
           /* proceed with illumination calculations                  */
-          inten *= shadowray.intstruct.shadowfilter;
+          inten *= shadowfilter;
 
           /* calculate diffuse lighting component */
           ColorAddS(&diffuse, &((standard_texture *)li->tex)->col, inten);
@@ -296,6 +311,7 @@ color full_shader(ray * incident) {
       }  
 
       cur = cur->next;
+      lightnum++;
     } 
     incident->serial = shadowray.serial; /* track ray serial number */
 
@@ -385,7 +401,7 @@ color shade_ambient_occlusion(ray * incident, const shadedata * shadevars) {
 
   ambray.o=shadevars->hit;
   ambray.d=shadevars->N;
-  ambray.o=Raypnt(&ambray, EPSILON);    /* avoid numerical precision bugs */
+  ambray.o=Rayoffset(&ambray, EPSILON); /* avoid numerical precision bugs */
   ambray.serial = incident->serial + 1; /* next serial number */
   ambray.randval=incident->randval;     /* random number seed */
   ambray.frng=incident->frng;           /* 32-bit FP RNG handle */
@@ -459,7 +475,7 @@ color shade_reflection(ray * incident, const shadedata * shadevars, flt specular
 
   specray.o=shadevars->hit; 
   specray.d=R;			         /* reflect incident ray about normal */
-  specray.o=Raypnt(&specray, EPSILON);   /* avoid numerical precision bugs */
+  specray.o=Rayoffset(&specray, EPSILON); /* avoid numerical precision bugs */
   specray.maxdist = FHUGE;               /* take any intersection */
   specray.opticdist = incident->opticdist;
   specray.add_intersection=incident->add_intersection; /* inherit ray type  */
@@ -496,7 +512,7 @@ color shade_transmission(ray * incident, const shadedata * shadevars, flt trans)
 
   transray.o=shadevars->hit; 
   transray.d=incident->d;                /* ray continues on incident path */
-  transray.o=Raypnt(&transray, EPSILON); /* avoid numerical precision bugs */
+  transray.o=Rayoffset(&transray, EPSILON); /* avoid numerical precision bugs */
   transray.maxdist = FHUGE;              /* take any intersection */
   transray.opticdist = incident->opticdist;
   transray.add_intersection=incident->add_intersection; /* inherit ray type  */
@@ -546,7 +562,7 @@ flt shade_blinn(const ray * incident, const shadedata * shadevars, flt specpower
   inten = shadevars->N.x * H.x + shadevars->N.y * H.y + shadevars->N.z * H.z;
   if (inten > MINCONTRIB) {
     /* normalize the previous dot product */
-    inten /= sqrt(H.x * H.x + H.y * H.y + H.z * H.z);
+    inten /= SQRT(H.x * H.x + H.y * H.y + H.z * H.z);
 
     /* calculate specular exponent */
     inten = pow(inten, specpower);
@@ -579,7 +595,7 @@ flt shade_blinn_fast(const ray * incident, const shadedata * shadevars, flt spec
   inten = shadevars->N.x * H.x + shadevars->N.y * H.y + shadevars->N.z * H.z;
   if (inten > 0.0) {
     /* normalize the previous dot product */
-    inten /= sqrt(H.x * H.x + H.y * H.y + H.z * H.z);
+    inten /= SQRT(H.x * H.x + H.y * H.y + H.z * H.z);
 
     /* replace specular exponent with a simple approximation */
     inten = inten / (specpower - (specpower * inten) + inten);
@@ -10,6 +10,7 @@
 #include "vector.h"
 #include "intersect.h"
 #include "util.h"
+#include "packet.h"
 
 #define SPHERE_PRIVATE
 #include "sphere.h"
@@ -18,7 +19,8 @@ static object_methods sphere_methods = {
   (void (*)(const void *, void *))(sphere_intersect),
   (void (*)(const void *, const void *, const void *, void *))(sphere_normal),
   sphere_bbox, 
-  free 
+  free,
+  (void (*)(const void *, void *))(sphere_packet_intersect)
 };
 
 object * newsphere(void * tex, vector ctr, flt rad) {
@@ -49,17 +51,25 @@ static int sphere_bbox(void * obj, vector * min, vector * max) {
 }
 
 static void sphere_intersect(const sphere * spr, ray * ry) {
-  flt b, disc, t1, t2, temp;
-  vector V;
+  flt a, b, disc, t1, t2, temp;
+  vector V, F;
 
   VSUB(spr->ctr, ry->o, V);
+  VDOT(a, ry->d, ry->d);
   VDOT(b, V, ry->d); 
-  VDOT(temp, V, V);  
+  b /= a;                  /* t of the point on the ray nearest the center */
 
-  disc=b*b + spr->rad*spr->rad - temp;
+  /* squared distance from the center to the ray, rather than V.V - b*b */
+  /* which cancels badly for small spheres far from the ray origin      */
+  F.x = V.x - b * ry->d.x;
+  F.y = V.y - b * ry->d.y;
+  F.z = V.z - b * ry->d.z;
+  VDOT(temp, F, F);  
+
+  disc=(spr->rad*spr->rad - temp) / a;
 
   if (disc<=0.0) return;
-  disc=sqrt(disc);
+  disc=SQRT(disc);
 
   t2=b+disc;
   if (t2 <= SPEPSILON) 
@@ -71,6 +81,39 @@ static void sphere_intersect(const sphere * spr, ray * ry) {
     ry->add_intersection(t1, (object *) spr, ry);  
 }
 
+/*
+ * The same arithmetic as sphere_intersect() on every lane of a packet,
+ * lanes that miss get t = 0.0, which packet_hits() ignores.
+ */
+static void sphere_packet_intersect(const sphere * spr, raypacket * pk) {
+  flt t1[RT_PACKET_MAX], t2[RT_PACKET_MAX];
+  flt rad2 = spr->rad * spr->rad;
+  int i, n = pk->num;
+
+  for (i=0; i<n; i++) {
+    flt vx, vy, vz, fx, fy, fz, a, b, disc, root, tfar, tnear;
+
+    vx = spr->ctr.x - pk->ox[i];
+    vy = spr->ctr.y - pk->oy[i];
+    vz = spr->ctr.z - pk->oz[i];
+    a = pk->dx[i] * pk->dx[i] + pk->dy[i] * pk->dy[i] + pk->dz[i] * pk->dz[i];
+    b = (vx * pk->dx[i] + vy * pk->dy[i] + vz * pk->dz[i]) / a;
+    fx = vx - b * pk->dx[i];
+    fy = vy - b * pk->dy[i];
+    fz = vz - b * pk->dz[i];
+    disc = (rad2 - (fx*fx + fy*fy + fz*fz)) / a;
+    root = SQRT(disc > 0.0f ? disc : 0.0f);
+
+    tfar  = (disc > 0.0f) ? b + root : 0.0f;
+    tnear = (disc > 0.0f) ? b - root : 0.0f;
+    t2[i] = (tfar > SPEPSILON) ? tfar : 0.0f;
+    t1[i] = (tnear > SPEPSILON) ? tnear : 0.0f;
+  }
+
+  packet_hits(pk, (object *) spr, t2);
+  packet_hits(pk, (object *) spr, t1);
+}
+
 static void sphere_normal(const sphere * spr, const vector * pnt, const ray * incident, vector * N) {
   flt invlen;
 
@@ -78,7 +121,7 @@ static void sphere_normal(const sphere * spr, const vector * pnt, const ray * in
   N->y = pnt->y - spr->ctr.y;
   N->z = pnt->z - spr->ctr.z;
 
-  invlen = 1.0 / sqrt(N->x*N->x + N->y*N->y + N->z*N->z);
+  invlen = 1.0f / SQRT(N->x*N->x + N->y*N->y + N->z*N->z);
   N->x *= invlen;
   N->y *= invlen;
   N->z *= invlen;
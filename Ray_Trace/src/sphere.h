@@ -16,6 +16,7 @@ typedef struct {
 
 static int sphere_bbox(void * obj, vector * min, vector * max);
 static void sphere_intersect(const sphere *, ray *);
+static void sphere_packet_intersect(const sphere *, raypacket *);
 static void sphere_normal(const sphere *, const vector *, const ray *, vector *);
 
 #endif /* SPHERE_PRIVATE */
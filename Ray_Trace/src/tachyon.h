@@ -145,6 +145,42 @@ void rt_crop_disable(SceneHandle);
  */
 void rt_aa_maxsamples(SceneHandle, int maxsamples);
 
+/*
+ * rt_aa_threshold(SceneHandle, thresh)
+ * 
+ * Makes antialiasing adaptive: a pixel stops taking supersamples as soon
+ * as the standard error of its mean color falls below thresh in each 
+ * channel (colors range from 0 to 1, so 0.01 is about 2.5 of 255 levels).
+ * Samples are taken in groups of 4 between tests.  When rendering
+ * progressively, a pixel is also refined while it differs from the
+ * average of its four neighbours by more than thresh.  0 (the default)
+ * always takes the maximum number of samples.
+ */
+void rt_aa_threshold(SceneHandle, apiflt thresh);
+
+/*
+ * rt_progressive(SceneHandle, onoff)
+ * 
+ * Renders the image in passes, the first tracing one ray through the
+ * center of each pixel and each following one adding up to 4 jittered
+ * samples to the pixels still being refined, up to maxsamples + 1 
+ * samples in all.  The image buffer holds the average of the samples 
+ * taken so far after every pass.  Ray packets are not used, and 
+ * rendering on more than one node is not supported.
+ */
+void rt_progressive(SceneHandle, int onoff);
+
+/*
+ * rt_set_progressive_callback(SceneHandle, func, data)
+ * 
+ * Calls func(data, passes, pixels) after each pass of progressive 
+ * rendering, with the number of passes done and the number of pixels 
+ * the next pass would refine, 0 when the image is finished.  Returning
+ * nonzero ends the frame early with the image as it stands.
+ */
+void rt_set_progressive_callback(SceneHandle, 
+                                 int (* func)(void *, int, int), void * data);
+
 /*
  * rt_verbose(SceneHandle, onoff);
  *
@@ -257,11 +293,35 @@ void rt_trans_mode(SceneHandle, int);
  * rt_boundmode(SceneHandle, int)
  * 
  * Enables/Disables automatic generation and use of ray tracing acceleration
- * data structures. 
+ * data structures.  RT_BOUNDING_ENABLED builds hierarchical uniform grids,
+ * RT_BOUNDING_BVH builds a bounding volume hierarchy instead.
  */
 void rt_boundmode(SceneHandle, int);
 
 
+/*
+ * rt_packetsize(SceneHandle, int)
+ *
+ * Traces primary rays in packets of 4, 8 or 16 neighbouring pixels (2x2,
+ * 4x2 or 4x4), along with their shadow rays, instead of one at a time.
+ * Only used with the perspective, orthographic and fisheye cameras and no
+ * antialiasing; 0 (the default) traces every ray on its own.
+ */
+void rt_packetsize(SceneHandle, int);
+
+
+/*
+ * rt_tilesize(SceneHandle, int)
+ *
+ * Renders the image in square tiles of the given width in pixels, which
+ * the threads take from a shared queue, nearby tiles one after the other,
+ * as soon as they finish the previous one.  The default is 16; 0 gives
+ * each thread every numthreads'th scanline instead.  Tiles are not used
+ * when rendering on more than one node.
+ */
+void rt_tilesize(SceneHandle, int);
+
+
 /* 
  * rt_boundthresh(SceneHandle, int)
  * 
@@ -273,6 +333,31 @@ void rt_boundmode(SceneHandle, int);
  */
 void rt_boundthresh(SceneHandle, int);
 
+
+/*
+ * rt_bvh_export(SceneHandle, int * numnodes, void ** nodes,
+ *               int * numobj, int ** order)
+ *
+ * Builds the bounding volume hierarchy RT_BOUNDING_BVH would build for
+ * the objects defined so far, without rendering, so an application can
+ * store it with its copy of the scene.  Returns numnodes nodes of 32 bytes
+ * and the leaf order of numobj objects, both to be freed by the caller,
+ * or 0 if the scene is too small for a hierarchy.
+ */
+int rt_bvh_export(SceneHandle, int *, void **, int *, int **);
+
+
+/*
+ * rt_bvh_import(SceneHandle, int numnodes, const void * nodes,
+ *               int numobj, const int * order)
+ *
+ * Supplies a hierarchy from rt_bvh_export() for the next rendering with
+ * RT_BOUNDING_BVH to use instead of building one.  The scene must define
+ * the same objects in the same order; a hierarchy that doesn't fit them
+ * is ignored.  The data is copied.
+ */
+void rt_bvh_import(SceneHandle, int, const void *, int, const int *);
+
 /* 
  * rt_shadermode()
  *
@@ -410,6 +495,16 @@ void rt_tristripscnv3fv(SceneHandle scene, void * tex,
                         int numverts, const float * cnv,
                         int numstrips, int *vertsperstrip, int *facets);
 
+void rt_trimesh(SceneHandle, void *, int, const float *, const float *,
+                const float *, int, const int *);
+ /* trimesh parms: texture, vertex count, vertices, normals, colors,   */
+ /*                triangle count, vertex indices (3 per triangle).     */
+ /* Vertices, normals and colors are 3 floats per vertex; normals and  */
+ /* colors may be NULL for flat shading and the texture color.  The    */
+ /* arrays are copied, and the mesh is a single object with its own    */
+ /* BVH, much smaller and faster than the same triangles added one by  */
+ /* one with rt_tri, rt_stri or rt_vcstri.                             */
+
 void rt_heightfield(SceneHandle, void *, apivector, int, int, apiflt *, apiflt, apiflt);
   /* field parms: texture, center, m, n, field, wx, wy */
 
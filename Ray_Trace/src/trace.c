@@ -16,6 +16,7 @@
 #include "parallel.h"
 #include "intersect.h"
 #include "ui.h"
+#include "packet.h"
 #include "trace.h"
 
 color trace(ray * primary) {
@@ -28,18 +29,264 @@ color trace(ray * primary) {
   return primary->scene->bgtexfunc(primary);
 }
 
-void * thread_trace(thr_parms * t) {
-  unsigned long * local_mbox = NULL;
-  scenedef * scene;
+/*
+ * Trace the pixels of a thread in tiles of scene->packetsize primary rays,
+ * 2x2 pixels for 4, 4x2 for 8 and 4x4 for 16.  The rays of a tile are
+ * intersected as one packet and, with the full shader, their shadow rays
+ * as one packet per light.  Each ray is then shaded on its own, so
+ * reflected, refracted and ambient occlusion rays are traced one by one.
+ */
+static void trace_packets(thr_parms * t, ray * primary, int do_ui) {
+  scenedef * scene = t->scene;
+  ray rays[RT_PACKET_MAX];
+  int px[RT_PACKET_MAX], py[RT_PACKET_MAX];
+  raypacket pk;
+  flt * filters = NULL;
+  unsigned long serial;
   color col;
-  ray primary;
-  int x, y, do_ui, hskip;
-  int startx, stopx, xinc, starty, stopy, yinc, hsize, vres;
+  int tw, th, bx, by, x, y, i, j, n, addr;
+
+  /* each pixel uses the same AO RNG seed, as in trace_region() */
+  rng_frand_handle cachefrng = primary->frng;
+
+  tw = (scene->packetsize >= 8) ? 4 : 2;
+  th = scene->packetsize / tw;
+
+  if (scene->shader == (color (*)(void *)) full_shader && scene->numlights > 0)
+    filters = (flt *) malloc(sizeof(flt) * RT_PACKET_MAX * scene->numlights);
+
+  for (i=0; i<RT_PACKET_MAX; i++) {
+    rays[i] = *primary;
+    pk.rays[i] = &rays[i];
+  }
+  pk.mbox = primary->mbox;
+  serial = primary->serial;
 
 #if defined(_OPENMP)
-#pragma omp parallel
-{
+#pragma omp for schedule(runtime)
+#endif
+  for (by=t->starty; by<=t->stopy; by+=th*t->yinc) {
+    for (bx=t->startx; bx<=t->stopx; bx+=tw*t->xinc) {
+      /* generate the rays of the tile */
+      n = 0;
+      for (j=0; j<th && (y = by + j*t->yinc) <= t->stopy; j++) {
+        for (i=0; i<tw && (x = bx + i*t->xinc) <= t->stopx; i++) {
+          scene->camera.cam_setup(&rays[n], x, y);
+          px[n] = x;
+          py[n] = y;
+          n++;
+        }
+      }
+
+      serial += n;               /* one serial number for each ray */
+      pk.serial = serial;
+      packet_setup(&pk, n);
+      packet_intersect_objects(&pk);
+      if (filters != NULL)
+        packet_shadows(&pk, filters);
+      serial = pk.serial;
+
+      for (i=0; i<n; i++) {
+        rays[i].serial = serial;
+        rays[i].frng = cachefrng;
+        col = scene->shader(&rays[i]);               /* shade the hit point */
+        serial = rays[i].serial;
+
+        addr = scene->hres*3 * (py[i] - 1) + (3 * (px[i] - 1));
+        if (scene->imgbufformat == RT_IMAGE_BUFFER_RGB24) {
+          unsigned char *img = (unsigned char *) scene->img;
+          int R = (int) (col.r * 255.0f); /* quantize float to integer */
+          int G = (int) (col.g * 255.0f); /* quantize float to integer */
+          int B = (int) (col.b * 255.0f); /* quantize float to integer */
+
+          img[addr    ] = (byte) ((R > 255) ? 255 : ((R < 0) ? 0 : R));
+          img[addr + 1] = (byte) ((G > 255) ? 255 : ((G < 0) ? 0 : G));
+          img[addr + 2] = (byte) ((B > 255) ? 255 : ((B < 0) ? 0 : B));
+        } else {
+          float *img = (float *) scene->img;
+          img[addr    ] = col.r;
+          img[addr + 1] = col.g;
+          img[addr + 2] = col.b;
+        }
+      }
+    }
+
+    if (do_ui) {
+      for (j=0; j<th && (y = by + j*t->yinc) <= t->stopy; j++) {
+        if (!((y-1) % 16))
+          rt_ui_progress((100 * y) / scene->vres); /* progress meter */
+      }
+    }
+  }
+
+  if (filters != NULL)
+    free(filters);
+
+  primary->serial = serial;
+}
+
+
+/*
+ * Add samples to each pixel of the region that is still being refined by
+ * progressive rendering, and store the new mean of its samples in the 
+ * image.  The first pass traces the pixel centers, later passes up to
+ * RT_AA_GROUP jittered rays per pixel, so that they keep some of the 
+ * locality of the rays of one pixel.  The pass number changes the AO 
+ * sample directions as well.
+ */
+static void trace_progressive(thr_parms * t, ray * primary) {
+  scenedef * scene = t->scene;
+  aapixel * aa = (aapixel *) scene->aabuf;
+  aapixel * p;
+  color col;
+  float rn;
+  int x, y, addr, last;
+
+  /* every pixel of a pass uses the same AO RNG seed, as in trace_region() */
+  rng_frand_handle cachefrng = primary->frng;
+  if (scene->aapass > 0)
+    rng_frand_seed(&cachefrng, scene->aapass * 2654435761U);
+
+#if defined(_OPENMP)
+#pragma omp for schedule(runtime)
 #endif
+  for (y=t->starty; y<=t->stopy; y+=t->yinc) {
+    for (x=t->startx; x<=t->stopx; x+=t->xinc) {
+      p = &aa[scene->hres * (y - 1) + (x - 1)];
+      if (p->done)
+        continue;
+
+      primary->frng = cachefrng;
+      last = MYMIN(p->n + RT_AA_GROUP, scene->antialiasing + 1);
+      if (p->n == 0)
+        last = 1;
+      for (; p->n < last; p->n++) {
+        if (p->n == 0)
+          col=scene->camera.cam_ray(primary, x, y);    /* pixel center */
+        else 
+          col=scene->camera.cam_sample(primary, x, y); /* jittered ray */
+
+        p->sum.r += col.r;            /* accumulate samples */
+        p->sum.g += col.g;
+        p->sum.b += col.b;
+        p->sumsq.r += col.r * col.r;  /* accumulate squared samples */
+        p->sumsq.g += col.g * col.g;
+        p->sumsq.b += col.b * col.b;
+      }
+
+      rn = 1.0f / p->n;
+      col.r = p->sum.r * rn;
+      col.g = p->sum.g * rn;
+      col.b = p->sum.b * rn;
+
+      addr = scene->hres*3 * (y - 1) + (3 * (x - 1));
+      if (scene->imgbufformat == RT_IMAGE_BUFFER_RGB24) {
+        unsigned char *img = (unsigned char *) scene->img;
+        int R = (int) (col.r * 255.0f); /* quantize float to integer */
+        int G = (int) (col.g * 255.0f); /* quantize float to integer */
+        int B = (int) (col.b * 255.0f); /* quantize float to integer */
+
+        img[addr    ] = (byte) ((R > 255) ? 255 : ((R < 0) ? 0 : R));
+        img[addr + 1] = (byte) ((G > 255) ? 255 : ((G < 0) ? 0 : G));
+        img[addr + 2] = (byte) ((B > 255) ? 255 : ((B < 0) ? 0 : B));
+      } else {
+        float *img = (float *) scene->img;
+        img[addr    ] = col.r;
+        img[addr + 1] = col.g;
+        img[addr + 2] = col.b;
+      }
+    }
+  }
+}
+
+
+/* add the mean of the samples of a pixel to a color */
+static void addmean(const aapixel * p, color * c) {
+  float rn = 1.0f / p->n;
+
+  c->r += p->sum.r * rn;
+  c->g += p->sum.g * rn;
+  c->b += p->sum.b * rn;
+}
+
+/*
+ * Choose the pixels progressive rendering refines in the next pass, and
+ * return how many there are.  Pixels stop at scene->antialiasing + 1
+ * samples.  Without an error threshold every pixel is refined until then.
+ * With one, a pixel is refined while the mean of its samples differs 
+ * from the average of its four neighbours by more than the threshold in
+ * some channel, or while the standard error of its mean exceeds it.  So
+ * edges, fine texture and noisy soft shadows or AO keep being sampled,
+ * while background and flat or smoothly shaded surfaces stop after the
+ * first pass.  Called by the master thread between passes.
+ */
+int trace_select_pixels(scenedef * scene) {
+  aapixel * aa = (aapixel *) scene->aabuf;
+  aapixel * p;
+  int x, y, k, hres, vres, maxn, num, count;
+  flt thresh, rn, wn;
+  color avg;
+
+  hres = scene->hres;
+  vres = scene->vres;
+  thresh = scene->aathresh;
+  maxn = scene->antialiasing + 1;
+
+  count = 0;
+  if (thresh <= 0.0) {
+    for (k=0; k<hres*vres; k++) {
+      aa[k].done = (aa[k].n >= maxn);
+      if (!aa[k].done)
+        count++;
+    }
+    return count;
+  }
+
+  for (y=0; y<vres; y++) {
+    for (x=0; x<hres; x++) {
+      p = &aa[y*hres + x];
+      if (p->n >= maxn) {
+        p->done = 1;
+        continue;
+      }
+
+      /* average of the neighbours inside the image */
+      avg.r = avg.g = avg.b = 0.0f;
+      num = 0;
+      if (x > 0)      { addmean(p - 1, &avg);    num++; }
+      if (x < hres-1) { addmean(p + 1, &avg);    num++; }
+      if (y > 0)      { addmean(p - hres, &avg); num++; }
+      if (y < vres-1) { addmean(p + hres, &avg); num++; }
+      if (num == 0) {
+        addmean(p, &avg);           /* a single pixel image */
+        num = 1;
+      }
+
+      rn = 1.0 / p->n;
+      wn = 1.0 / num;
+      p->done = (p->n < 2 || 
+                 cam_aa_converged(&p->sum, &p->sumsq, p->n, thresh)) &&
+                FABS(p->sum.r * rn - avg.r * wn) <= thresh &&
+                FABS(p->sum.g * rn - avg.g * wn) <= thresh &&
+                FABS(p->sum.b * rn - avg.b * wn) <= thresh;
+      if (!p->done)
+        count++;
+    }
+  }
+
+  return count;
+}
+
+
+/*
+ * Render the pixels between t->startx..stopx and t->starty..stopy, 
+ * stepping by t->xinc and t->yinc, in either RGB24 or RGB96F format.
+ */
+static void trace_region(thr_parms * t, ray * primary, int do_ui) {
+  scenedef * scene;
+  color col;
+  int x, y, hskip;
+  int startx, stopx, xinc, starty, stopy, yinc, hsize, vres;
 
   /*
    * Copy all of the frequently used parameters into local variables.
@@ -57,62 +304,25 @@ void * thread_trace(thr_parms * t) {
   hsize  = scene->hres*3;
   vres   = scene->vres;
   hskip  = xinc * 3;
-  do_ui = (scene->mynode == 0 && t->tid == 0);
-
-#if !defined(DISABLEMBOX)
-   /* allocate mailbox array per thread... */
-#if defined(_OPENMP)
-  local_mbox = (unsigned long *)calloc(sizeof(unsigned long)*scene->numobjects, 1);
-#else
-  if (t->local_mbox == NULL)  
-    local_mbox = (unsigned long *)calloc(sizeof(unsigned long)*scene->objgroup.numobjects, 1);
-  else 
-    local_mbox = t->local_mbox;
-#endif
-#else
-  local_mbox = NULL; /* mailboxes are disabled */
-#endif
-
-#if defined(_OPENMP)
-#pragma omp single
-#endif
-  /* 
-   * If we are getting close to integer wraparound on the    
-   * ray serial numbers, we need to re-clear the mailbox     
-   * array(s).  Each thread maintains its own serial numbers 
-   * so only those threads that are getting hit hard will    
-   * need to re-clear their mailbox arrays.  In all likelihood,
-   * the threads will tend to hit their counter limits at about
-   * the same time though.
-   * When compiled on platforms with a 64-bit long, this counter won't 
-   * wraparound in _anyone's_ lifetime, so no need to even check....
-   * On lesser-bit platforms, we're not quite so lucky, so we have to check.
-   */
-#if !defined(LP64)
-  if (local_mbox != NULL) {
-    if (t->serialno > (((unsigned long) 1) << ((sizeof(unsigned long) * 8) - 3))) {
-      memset(local_mbox, 0, sizeof(unsigned long) * scene->objgroup.numobjects);
-      t->serialno = 1;
-    }
-  }
-#endif
-
-  /* setup the thread-specific properties of the primary ray(s) */
-  camray_init(scene, &primary, t->serialno, local_mbox, 
-              rng_seed_from_tid_nodeid(t->tid, scene->mynode));
-
 
   /* 
    * Render the image in either RGB24 or RGB96F format
    */
-  if (scene->imgbufformat == RT_IMAGE_BUFFER_RGB24) {
+  if (scene->aabuf != NULL) {
+    /* one more sample for the pixels being refined progressively */
+    trace_progressive(t, primary);
+  } else if (scene->packetsize > 1 && scene->camera.cam_setup != NULL &&
+      scene->nodes == 1) {
+    /* coherent primary rays traced as packets */
+    trace_packets(t, primary, do_ui);
+  } else if (scene->imgbufformat == RT_IMAGE_BUFFER_RGB24) {
     /* 24-bit unsigned char RGB, RT_IMAGE_BUFFER_RGB24 */
     int addr, R,G,B;
     unsigned char *img = (unsigned char *) scene->img;
 
     /* copy the RNG state to cause increased coherence among */
     /* AO sample rays, significantly reducing granulation    */
-    rng_frand_handle cachefrng = primary.frng;
+    rng_frand_handle cachefrng = primary->frng;
 
 #if defined(_OPENMP)
 #pragma omp for schedule(runtime)
@@ -120,8 +330,8 @@ void * thread_trace(thr_parms * t) {
     for (y=starty; y<=stopy; y+=yinc) {
       addr = hsize * (y - 1) + (3 * (startx - 1));    /* scanline address */
       for (x=startx; x<=stopx; x+=xinc) {
-        primary.frng = cachefrng; /* each pixel uses the same AO RNG seed */
-        col=scene->camera.cam_ray(&primary, x, y);    /* generate ray */ 
+        primary->frng = cachefrng; /* each pixel uses the same AO RNG seed */
+        col=scene->camera.cam_ray(primary, x, y);    /* generate ray */ 
 
         R = (int) (col.r * 255.0f); /* quantize float to integer */
         G = (int) (col.g * 255.0f); /* quantize float to integer */
@@ -163,7 +373,7 @@ void * thread_trace(thr_parms * t) {
 
     /* copy the RNG state to cause increased coherence among */
     /* AO sample rays, significantly reducing granulation    */
-    rng_frand_handle cachefrng = primary.frng;
+    rng_frand_handle cachefrng = primary->frng;
 
 #if defined(_OPENMP)
 #pragma omp for schedule(runtime)
@@ -171,8 +381,8 @@ void * thread_trace(thr_parms * t) {
     for (y=starty; y<=stopy; y+=yinc) {
       addr = hsize * (y - 1) + (3 * (startx - 1));    /* scanline address */
       for (x=startx; x<=stopx; x+=xinc) {
-        primary.frng = cachefrng; /* each pixel uses the same AO RNG seed */
-        col=scene->camera.cam_ray(&primary, x, y);    /* generate ray */ 
+        primary->frng = cachefrng; /* each pixel uses the same AO RNG seed */
+        col=scene->camera.cam_ray(primary, x, y);    /* generate ray */ 
         img[addr    ] = col.r;   /* Store final pixel to the image buffer */
         img[addr + 1] = col.g;   /* Store final pixel to the image buffer */
         img[addr + 2] = col.b;   /* Store final pixel to the image buffer */
@@ -194,6 +404,122 @@ void * thread_trace(thr_parms * t) {
 
     }        /* end y-loop */
   }          /* end of RGB96F loop */
+}
+
+
+/*
+ * Render tiles taken from the shared schedule until none are left.  The
+ * jitter seed and the eye position of the camera ray, which the depth of
+ * field cameras leave moved, are reset for each tile, so that antialiased
+ * and depth of field images do not depend on which thread rendered which
+ * tile.
+ */
+static void trace_tiles(thr_parms * t, ray * primary, int do_ui) {
+  scenedef * scene = t->scene;
+  tilesched * tiles = t->tiles;
+  thr_parms tile = *t;
+  int k, tileno, tx, ty, percent, lastpercent;
+
+  /* every pixel starts from the same AO RNG state, as in trace_region() */
+  rng_frand_handle cachefrng = primary->frng;
+
+  t->numtiles = 0;
+  lastpercent = -1;
+  while (rt_shared_iterator_next(&tiles->iter, &k) != ITERATOR_DONE) {
+    tileno = tiles->order[k];
+    tx = tileno % tiles->xtiles;
+    ty = tileno / tiles->xtiles;
+
+    tile.startx = tx * tiles->size + 1;
+    tile.stopx  = MYMIN(tile.startx + tiles->size - 1, scene->hres);
+    tile.xinc   = 1;
+    tile.starty = ty * tiles->size + 1;
+    tile.stopy  = MYMIN(tile.starty + tiles->size - 1, scene->vres);
+    tile.yinc   = 1;
+
+    primary->frng = cachefrng;
+    primary->o = scene->camera.center;
+    primary->randval = rng_seed_from_tid_nodeid(tileno, scene->mynode) + tileno
+                       + scene->aapass * tiles->numtiles;
+    trace_region(&tile, primary, 0);
+    t->numtiles++;
+
+    if (do_ui) {
+      percent = (100 * k) / tiles->numtiles;
+      if (percent != lastpercent) {
+        rt_ui_progress(percent);  /* call progress meter callback */
+        lastpercent = percent;
+      }
+    }
+  }
+}
+
+
+void * thread_trace(thr_parms * t) {
+  mailbox * local_mbox = NULL;
+  unsigned long startserial;
+  scenedef * scene;
+  ray primary;
+  int do_ui;
+
+#if defined(_OPENMP)
+#pragma omp parallel
+{
+#endif
+
+  scene  = t->scene;
+  do_ui = (scene->mynode == 0 && t->tid == 0 && scene->aabuf == NULL);
+
+#if !defined(DISABLEMBOX)
+   /* allocate mailbox per thread... */
+#if defined(_OPENMP)
+  local_mbox = new_mailbox(scene->objgroup.numobjects);
+#else
+  if (t->local_mbox == NULL)  
+    local_mbox = new_mailbox(scene->objgroup.numobjects);
+  else 
+    local_mbox = t->local_mbox;
+#endif
+#else
+  local_mbox = NULL; /* mailboxes are disabled */
+#endif
+
+#if defined(_OPENMP)
+#pragma omp single
+#endif
+  /* 
+   * If we are getting close to integer wraparound on the    
+   * ray serial numbers, we need to re-clear the thread     
+   * mailboxes.  Each thread maintains its own serial numbers 
+   * so only those threads that are getting hit hard will    
+   * need to re-clear their mailboxes.  In all likelihood,
+   * the threads will tend to hit their counter limits at about
+   * the same time though.
+   * When compiled on platforms with a 64-bit long, this counter won't 
+   * wraparound in _anyone's_ lifetime, so no need to even check....
+   * On lesser-bit platforms, we're not quite so lucky, so we have to check.
+   */
+#if !defined(LP64)
+  if (local_mbox != NULL) {
+    if (t->serialno > (((unsigned long) 1) << ((sizeof(unsigned long) * 8) - 3))) {
+      reset_mailbox(local_mbox);
+      t->serialno = 1;
+    }
+  }
+#endif
+
+  /* setup the thread-specific properties of the primary ray(s) */
+  camray_init(scene, &primary, t->serialno, local_mbox, 
+              rng_seed_from_tid_nodeid(t->tid, scene->mynode) + scene->aapass);
+
+
+  /* render tiles as they are handed out, or the thread's scanlines */
+  startserial = primary.serial;
+  if (t->tiles != NULL)
+    trace_tiles(t, &primary, do_ui);
+  else 
+    trace_region(t, &primary, do_ui);
+  t->numrays = primary.serial - startserial;
 
   /* 
    * Image has been rendered into the buffer in the appropriate pixel format
@@ -202,13 +528,10 @@ void * thread_trace(thr_parms * t) {
   t->serialno = primary.serial + 1;
 
 #if defined(_OPENMP)
-  if (local_mbox != NULL)
-    free(local_mbox);
+  free_mailbox(local_mbox);
 #else
-  if (t->local_mbox == NULL) {
-    if (local_mbox != NULL)
-      free(local_mbox);
-  }
+  if (t->local_mbox == NULL)
+    free_mailbox(local_mbox);
 #endif
 
   if (scene->nodes == 1)
@@ -4,11 +4,29 @@
  *   $Id: trace.h,v 1.32 2001/01/19 08:31:39 johns Exp $
  */
 
+/* tiles of the image, handed out to the threads as they ask for work */
+typedef struct {
+  rt_shared_iterator_t iter; /* next entry of order[] to be rendered      */
+  int size;                  /* tile width and height in pixels           */
+  int xtiles;                /* tiles across the image                    */
+  int ytiles;                /* tiles down the image                      */
+  int numtiles;              /* xtiles * ytiles                           */
+  int * order;               /* tile numbers, in Morton order             */
+} tilesched;
+
+/* sample sums of one pixel, for progressive rendering */
+typedef struct {
+  color sum;                 /* sum of the samples taken so far           */
+  color sumsq;               /* sum of their squares                      */
+  int n;                     /* number of samples                         */
+  int done;                  /* skip the pixel in the next pass           */
+} aapixel;
+
 typedef struct {
   int tid;
   int nthr;
   scenedef * scene;
-  unsigned long * local_mbox;
+  mailbox * local_mbox;
   unsigned long serialno; 
   int startx;
   int stopx;
@@ -17,8 +35,12 @@ typedef struct {
   int stopy;
   int yinc;
   rt_barrier_t * runbar; /* Thread barrier */
+  tilesched * tiles;     /* shared tile schedule, NULL for scanlines */
+  int numtiles;          /* tiles rendered in the last frame */
+  unsigned long numrays; /* rays traced in the last frame */
 } thr_parms;
 
 color trace(ray *);
-void * thread_trace(thr_parms *); 
+void * thread_trace(thr_parms *);
+int trace_select_pixels(scenedef *); 
 
@@ -10,6 +10,7 @@
 #include "macros.h"
 #include "intersect.h"
 #include "util.h"
+#include "packet.h"
 
 #define TRIANGLE_PRIVATE
 #include "triangle.h"
@@ -18,28 +19,32 @@ static object_methods tri_methods = {
   (void (*)(const void *, void *))(tri_intersect),
   (void (*)(const void *, const void *, const void *, void *))(tri_normal),
   tri_bbox, 
-  free 
+  free,
+  (void (*)(const void *, void *))(tri_packet_intersect)
 };
 
 static object_methods stri_methods = {
   (void (*)(const void *, void *))(tri_intersect),
   (void (*)(const void *, const void *, const void *, void *))(stri_normal),
   tri_bbox, 
-  free 
+  free,
+  (void (*)(const void *, void *))(tri_packet_intersect)
 };
 
 static object_methods stri_methods_reverse = {
   (void (*)(const void *, void *))(tri_intersect),
   (void (*)(const void *, const void *, const void *, void *))(stri_normal_reverse),
   tri_bbox, 
-  free 
+  free,
+  (void (*)(const void *, void *))(tri_packet_intersect)
 };
 
 static object_methods stri_methods_guess = {
   (void (*)(const void *, void *))(tri_intersect),
   (void (*)(const void *, const void *, const void *, void *))(stri_normal_guess),
   tri_bbox, 
-  free 
+  free,
+  (void (*)(const void *, void *))(tri_packet_intersect)
 };
 
 object * newtri(void * tex, vector v0, vector v1, vector v2) {
@@ -51,9 +56,9 @@ object * newtri(void * tex, vector v0, vector v1, vector v2) {
   VSub(&v2, &v1, &edge3);
 
   /* check to see if this will be a degenerate triangle before creation */
-  if ((VLength(&edge1) >= EPSILON) && 
-      (VLength(&edge2) >= EPSILON) && 
-      (VLength(&edge3) >= EPSILON)) {
+  if ((VLength(&edge1) >= ZEROEPSILON) && 
+      (VLength(&edge2) >= ZEROEPSILON) && 
+      (VLength(&edge3) >= ZEROEPSILON)) {
 
     t=(tri *) malloc(sizeof(tri));
 
@@ -82,9 +87,9 @@ object * newstri(void * tex, vector v0, vector v1, vector v2,
   VSub(&v2, &v1, &edge3);
 
   /* check to see if this will be a degenerate triangle before creation */
-  if ((VLength(&edge1) >= EPSILON) && 
-      (VLength(&edge2) >= EPSILON) &&
-      (VLength(&edge3) >= EPSILON)) {
+  if ((VLength(&edge1) >= ZEROEPSILON) && 
+      (VLength(&edge2) >= ZEROEPSILON) &&
+      (VLength(&edge3) >= ZEROEPSILON)) {
 
     t=(stri *) malloc(sizeof(stri));
 
@@ -141,9 +146,9 @@ object * newvcstri(void * voidtex, vector v0, vector v1, vector v2,
   VSub(&v2, &v1, &edge3);
 
   /* check to see if this will be a degenerate triangle before creation */
-  if ((VLength(&edge1) >= EPSILON) && 
-      (VLength(&edge2) >= EPSILON) &&
-      (VLength(&edge3) >= EPSILON)) {
+  if ((VLength(&edge1) >= ZEROEPSILON) && 
+      (VLength(&edge2) >= ZEROEPSILON) &&
+      (VLength(&edge3) >= ZEROEPSILON)) {
 
     t=(vcstri *) malloc(sizeof(vcstri));
 
@@ -235,7 +240,7 @@ static void tri_intersect(const tri * trn, ray * ry) {
   det = DOT(trn->edge1, pvec);
 
 #if 0           /* define TEST_CULL if culling is desired */
-   if (det < EPSILON)
+   if (det < ZEROEPSILON)
       return;
 
    /* calculate distance from vert0 to ray origin */
@@ -256,15 +261,15 @@ static void tri_intersect(const tri * trn, ray * ry) {
 
    /* calculate t, scale parameters, ray intersects triangle */
    t = DOT(trn->edge2, qvec);
-   inv_det = 1.0 / det;
+   inv_det = 1.0f / det;
    t *= inv_det;
    u *= inv_det;
    v *= inv_det;
 #else                    /* the non-culling branch */
-   if (det > -EPSILON && det < EPSILON)
+   if (det > -ZEROEPSILON && det < ZEROEPSILON)
      return;
 
-   inv_det = 1.0 / det;
+   inv_det = 1.0f / det;
 
    /* calculate distance from vert0 to ray origin */
    SUB(tvec, ry->o, trn->v0);
@@ -290,12 +295,55 @@ static void tri_intersect(const tri * trn, ray * ry) {
 }
 
 
+/*
+ * The non-culling test of tri_intersect() on every lane of a packet.
+ * Lanes whose determinant is near zero divide by 1.0 instead; lanes that
+ * miss get t = 0.0, which packet_hits() ignores.
+ */
+static void tri_packet_intersect(const tri * trn, raypacket * pk) {
+  flt t[RT_PACKET_MAX];
+  int i, n = pk->num;
+
+  for (i=0; i<n; i++) {
+    flt px, py, pz, qx, qy, qz, tx, ty, tz;
+    flt det, inv_det, u, v, tt;
+    int ok;
+
+    /* pvec = d x edge2, det = edge1 . pvec */
+    px = pk->dy[i] * trn->edge2.z - pk->dz[i] * trn->edge2.y;
+    py = pk->dz[i] * trn->edge2.x - pk->dx[i] * trn->edge2.z;
+    pz = pk->dx[i] * trn->edge2.y - pk->dy[i] * trn->edge2.x;
+    det = trn->edge1.x * px + trn->edge1.y * py + trn->edge1.z * pz;
+    ok = !(det > -ZEROEPSILON && det < ZEROEPSILON);
+    inv_det = 1.0f / (ok ? det : 1.0f);
+
+    /* tvec = o - v0, u = (tvec . pvec) / det */
+    tx = pk->ox[i] - trn->v0.x;
+    ty = pk->oy[i] - trn->v0.y;
+    tz = pk->oz[i] - trn->v0.z;
+    u = (tx * px + ty * py + tz * pz) * inv_det;
+
+    /* qvec = tvec x edge1, v = (d . qvec) / det, t = (edge2 . qvec) / det */
+    qx = ty * trn->edge1.z - tz * trn->edge1.y;
+    qy = tz * trn->edge1.x - tx * trn->edge1.z;
+    qz = tx * trn->edge1.y - ty * trn->edge1.x;
+    v = (pk->dx[i] * qx + pk->dy[i] * qy + pk->dz[i] * qz) * inv_det;
+    tt = (trn->edge2.x * qx + trn->edge2.y * qy + trn->edge2.z * qz) * inv_det;
+
+    ok = ok && !(u < 0.0 || u > 1.0) && !(v < 0.0 || u + v > 1.0);
+    t[i] = ok ? tt : 0.0f;
+  }
+
+  packet_hits(pk, (object *) trn, t);
+}
+
+
 static void tri_normal(const tri * trn, const vector * hit, const ray * incident, vector * N) {
   flt invlen;
 
   CROSS((*N), trn->edge1, trn->edge2);
 
-  invlen = 1.0 / sqrt(N->x*N->x + N->y*N->y + N->z*N->z);
+  invlen = 1.0f / SQRT(N->x*N->x + N->y*N->y + N->z*N->z);
   N->x *= invlen;
   N->y *= invlen;
   N->z *= invlen;
@@ -324,13 +372,13 @@ static void stri_normal(const stri * trn, const vector * hit, const ray * incide
   CROSS(tmp, trn->edge1, P);
   V = DOT(tmp, norm) / lensqr;   
 
-  W = 1.0 - (U + V);
+  W = 1.0f - (U + V);
 
   N->x = W*trn->n0.x + U*trn->n1.x + V*trn->n2.x;
   N->y = W*trn->n0.y + U*trn->n1.y + V*trn->n2.y;
   N->z = W*trn->n0.z + U*trn->n1.z + V*trn->n2.z;
 
-  invlen = 1.0 / sqrt(N->x*N->x + N->y*N->y + N->z*N->z);
+  invlen = 1.0f / SQRT(N->x*N->x + N->y*N->y + N->z*N->z);
   N->x *= invlen;
   N->y *= invlen;
   N->z *= invlen;
@@ -366,7 +414,7 @@ color vcstri_color(const vector * hit, const texture * tx, const ray * incident)
   CROSS(tmp, trn->edge1, P);
   V = DOT(tmp, norm) / lensqr;   
 
-  W = 1.0 - (U + V);
+  W = 1.0f - (U + V);
 
   col.r = W*tex->c0.r + U*tex->c1.r + V*tex->c2.r;
   col.g = W*tex->c0.g + U*tex->c1.g + V*tex->c2.g;
@@ -391,13 +439,13 @@ static void stri_normal_reverse(const stri * trn, const vector * hit, const ray
   CROSS(tmp, trn->edge1, P);
   V = DOT(tmp, norm) / lensqr;   
 
-  W = 1.0 - (U + V);
+  W = 1.0f - (U + V);
 
   N->x = W*trn->n0.x + U*trn->n1.x + V*trn->n2.x;
   N->y = W*trn->n0.y + U*trn->n1.y + V*trn->n2.y;
   N->z = W*trn->n0.z + U*trn->n1.z + V*trn->n2.z;
 
-  invlen = 1.0 / sqrt(N->x*N->x + N->y*N->y + N->z*N->z);
+  invlen = 1.0f / SQRT(N->x*N->x + N->y*N->y + N->z*N->z);
   N->x *= invlen;
   N->y *= invlen;
   N->z *= invlen;
@@ -431,13 +479,13 @@ static void stri_normal_guess(const stri * trn, const vector * hit, const ray *
   CROSS(tmp, trn->edge1, P);
   V = DOT(tmp, norm) / lensqr;   
 
-  W = 1.0 - (U + V);
+  W = 1.0f - (U + V);
 
   N->x = W*trn->n0.x + U*trn->n1.x + V*trn->n2.x;
   N->y = W*trn->n0.y + U*trn->n1.y + V*trn->n2.y;
   N->z = W*trn->n0.z + U*trn->n1.z + V*trn->n2.z;
 
-  invlen = 1.0 / sqrt(N->x*N->x + N->y*N->y + N->z*N->z);
+  invlen = 1.0f / SQRT(N->x*N->x + N->y*N->y + N->z*N->z);
   N->x *= invlen;
   N->y *= invlen;
   N->z *= invlen;
@@ -51,6 +51,7 @@ typedef struct {
 static int tri_bbox(void * obj, vector * min, vector * max);
 
 static void tri_intersect(const tri *, ray *);
+static void tri_packet_intersect(const tri *, raypacket *);
 
 static void tri_normal(const tri *, const vector *, const ray *, vector *);
 static void stri_normal(const stri *, const vector *, const ray *, vector *);
@@ -0,0 +1,417 @@
+/*
+ * trimesh.c - indexed triangle meshes with shared vertex data
+ *
+ * A mesh is a single object however many triangles it has.  Instead of a
+ * tri or stri object per triangle, with its own object header and copies
+ * of its vertices and normals, a mesh keeps the precomputed intersection
+ * data of its triangles in single precision arrays, shares normals and
+ * colors between them by index, and has its own BVH over them, so the
+ * scene's grid or BVH only sees the mesh as a whole.
+ *
+ * $Id$
+ *
+ */
+
+#include "machine.h"
+#include "types.h"
+#include "macros.h"
+#include "vector.h"
+#include "intersect.h"
+#include "util.h"
+#include "ui.h"
+#include "bvh.h"
+
+#define TRIMESH_PRIVATE
+#include "trimesh.h"
+
+static object_methods trimesh_methods = {
+  (void (*)(const void *, void *))(trimesh_intersect),
+  (void (*)(const void *, const void *, const void *, void *))(trimesh_normal),
+  trimesh_bbox,
+  trimesh_free,
+  (void (*)(const void *, void *))(NULL)
+};
+
+
+/*
+ * Build a mesh from numverts vertices, with optional vertex normals and
+ * colors (3 floats each per vertex, or NULL), and numtris triangles given
+ * as 3 vertex indices each.  Triangles with an index out of range or
+ * without area are left out.  Returns NULL if none are left.
+ */
+object * newtrimesh(scenedef * scene, void * tex, int numverts,
+                    const float * v, const float * n, const float * c,
+                    int numtris, const int * facets) {
+  trimesh * m;
+  vector * bmin, * bmax, v0, v1, v2, edge1, edge2, edge3;
+  int * tris, * order;
+  int i, j, k, num, maxdepth;
+
+  /* keep the triangles that can be hit */
+  tris = (int *) malloc(numtris * sizeof(int));
+  num = 0;
+  for (i=0; i<numtris; i++) {
+    const int * f = &facets[i * 3];
+
+    if (f[0] < 0 || f[0] >= numverts ||
+        f[1] < 0 || f[1] >= numverts ||
+        f[2] < 0 || f[2] >= numverts)
+      continue;
+
+    v0.x = v[f[0]*3];  v0.y = v[f[0]*3 + 1];  v0.z = v[f[0]*3 + 2];
+    v1.x = v[f[1]*3];  v1.y = v[f[1]*3 + 1];  v1.z = v[f[1]*3 + 2];
+    v2.x = v[f[2]*3];  v2.y = v[f[2]*3 + 1];  v2.z = v[f[2]*3 + 2];
+    VSub(&v1, &v0, &edge1);
+    VSub(&v2, &v0, &edge2);
+    VSub(&v2, &v1, &edge3);
+
+    /* same test for degenerate triangles as newtri() */
+    if ((VLength(&edge1) >= ZEROEPSILON) &&
+        (VLength(&edge2) >= ZEROEPSILON) &&
+        (VLength(&edge3) >= ZEROEPSILON))
+      tris[num++] = i;
+  }
+
+  if (num == 0) {
+    free(tris);
+    return NULL;
+  }
+
+  m = (trimesh *) malloc(sizeof(trimesh));
+  memset(m, 0, sizeof(trimesh));
+  m->methods = &trimesh_methods;
+  m->tex = tex;
+  m->numtris = num;
+  m->fixup = scene->normalfixupmode;
+
+  /* triangle bounds, for the mesh's BVH */
+  bmin = (vector *) malloc(num * sizeof(vector));
+  bmax = (vector *) malloc(num * sizeof(vector));
+  for (i=0; i<num; i++) {
+    const int * f = &facets[tris[i] * 3];
+
+    bmin[i].x = bmax[i].x = v[f[0]*3    ];
+    bmin[i].y = bmax[i].y = v[f[0]*3 + 1];
+    bmin[i].z = bmax[i].z = v[f[0]*3 + 2];
+    for (j=1; j<3; j++) {
+      bmin[i].x = MYMIN(bmin[i].x, v[f[j]*3    ]);
+      bmin[i].y = MYMIN(bmin[i].y, v[f[j]*3 + 1]);
+      bmin[i].z = MYMIN(bmin[i].z, v[f[j]*3 + 2]);
+      bmax[i].x = MYMAX(bmax[i].x, v[f[j]*3    ]);
+      bmax[i].y = MYMAX(bmax[i].y, v[f[j]*3 + 1]);
+      bmax[i].z = MYMAX(bmax[i].z, v[f[j]*3 + 2]);
+    }
+    if (i == 0) {
+      m->min = bmin[0];
+      m->max = bmax[0];
+    }
+    m->min.x = MYMIN(m->min.x, bmin[i].x);
+    m->min.y = MYMIN(m->min.y, bmin[i].y);
+    m->min.z = MYMIN(m->min.z, bmin[i].z);
+    m->max.x = MYMAX(m->max.x, bmax[i].x);
+    m->max.y = MYMAX(m->max.y, bmax[i].y);
+    m->max.z = MYMAX(m->max.z, bmax[i].z);
+  }
+
+  order = (int *) malloc(num * sizeof(int));
+  m->nodes = bvh_build_nodes(num, bmin, bmax, scene->numthreads, order,
+                             &m->numnodes, &maxdepth);
+  free(bmin);
+  free(bmax);
+
+  /* store the triangles in leaf order */
+  m->tridata = (float *) malloc(9 * num * sizeof(float));
+  for (k=0; k<3; k++) {
+    m->v0[k] = m->tridata + (k    ) * num;
+    m->e1[k] = m->tridata + (k + 3) * num;
+    m->e2[k] = m->tridata + (k + 6) * num;
+  }
+  if (n != NULL || c != NULL)
+    m->facets = (int *) malloc(3 * num * sizeof(int));
+
+  for (i=0; i<num; i++) {
+    const int * f = &facets[tris[order[i]] * 3];
+
+    for (k=0; k<3; k++) {
+      m->v0[k][i] = v[f[0]*3 + k];
+      m->e1[k][i] = v[f[1]*3 + k] - v[f[0]*3 + k];
+      m->e2[k][i] = v[f[2]*3 + k] - v[f[0]*3 + k];
+    }
+    if (m->facets != NULL) {
+      m->facets[i*3    ] = f[0];
+      m->facets[i*3 + 1] = f[1];
+      m->facets[i*3 + 2] = f[2];
+    }
+  }
+  free(order);
+  free(tris);
+
+  if (n != NULL) {
+    m->n = (float *) malloc(3 * numverts * sizeof(float));
+    memcpy(m->n, n, 3 * numverts * sizeof(float));
+  }
+  if (c != NULL) {
+    m->c = (float *) malloc(3 * numverts * sizeof(float));
+    memcpy(m->c, c, 3 * numverts * sizeof(float));
+  }
+
+  if (scene->verbosemode && scene->mynode == 0) {
+    char msgtxt[256];
+    sprintf(msgtxt, "Triangle mesh: %d triangles, %d vertices, %d BVH nodes",
+            num, numverts, m->numnodes);
+    rt_ui_message(MSG_0, msgtxt);
+  }
+
+  return (object *) m;
+}
+
+
+static int trimesh_bbox(void * obj, vector * min, vector * max) {
+  trimesh * m = (trimesh *) obj;
+
+  *min = m->min;
+  *max = m->max;
+
+  return 1;
+}
+
+
+static void trimesh_free(void * v) {
+  trimesh * m = (trimesh *) v;
+
+  free(m->nodes);
+  free(m->tridata);
+  if (m->facets != NULL)
+    free(m->facets);
+  if (m->n != NULL)
+    free(m->n);
+  if (m->c != NULL)
+    free(m->c);
+  free(m);
+}
+
+
+/* walk the mesh's BVH near child first, like bvh_intersect() */
+static void trimesh_intersect(const trimesh * m, ray * ry) {
+  const bvhnode * n;
+  int stack[BVH_MAXDEPTH + 1];
+  int sp, i, k, neg[3];
+  flt inv[3], org[3], dir[3], t0, t1, tnear, tfar;
+
+  if (ry->flags & RT_RAY_FINISHED)
+    return;
+
+  org[0] = ry->o.x;  org[1] = ry->o.y;  org[2] = ry->o.z;
+  dir[0] = ry->d.x;  dir[1] = ry->d.y;  dir[2] = ry->d.z;
+  for (k=0; k<3; k++) {
+    if (dir[k] > 1e-20 || dir[k] < -1e-20)
+      inv[k] = 1.0f / dir[k];
+    else
+      inv[k] = (dir[k] < 0.0) ? -FHUGE : FHUGE;
+    neg[k] = inv[k] < 0.0;
+  }
+
+  sp = 0;
+  i = 0;
+  for (;;) {
+    n = &m->nodes[i];
+
+    tnear = 0.0;
+    tfar = ry->maxdist;
+    for (k=0; k<3; k++) {
+      t0 = ((neg[k] ? n->max[k] : n->min[k]) - org[k]) * inv[k];
+      t1 = ((neg[k] ? n->min[k] : n->max[k]) - org[k]) * inv[k];
+      if (t0 > tnear) tnear = t0;
+      if (t1 < tfar)  tfar = t1;
+    }
+
+    if (tnear <= tfar) {
+      if (n->num == 0) {
+        if (neg[n->axis]) {
+          stack[sp++] = i + 1;
+          i = n->offset;
+        } else {
+          stack[sp++] = n->offset;
+          i = i + 1;
+        }
+        continue;
+      }
+
+      trimesh_leaf(m, n->offset, n->num, ry);
+
+      if (ry->flags & RT_RAY_FINISHED)
+        return;
+    }
+
+    if (sp == 0)
+      return;
+    i = stack[--sp];
+  }
+}
+
+
+/*
+ * Test one ray against the triangles start .. start+num-1, with the same
+ * non-culling test as tri_intersect().  The triangles are tested
+ * TRIMESH_CHUNK at a time in a loop over the SoA arrays that the compiler
+ * can vectorize; misses get t = 0.0.  The hits are then passed on one by
+ * one, and the triangle of the one that became the closest is recorded
+ * for trimesh_normal() and trimesh_color().
+ */
+static void trimesh_leaf(const trimesh * m, int start, int num, ray * ry) {
+  flt t[TRIMESH_CHUNK];
+  flt ox, oy, oz, dx, dy, dz, olddist;
+  int i, j, cnt;
+
+  ox = ry->o.x;  oy = ry->o.y;  oz = ry->o.z;
+  dx = ry->d.x;  dy = ry->d.y;  dz = ry->d.z;
+
+  for (; num > 0; start += cnt, num -= cnt) {
+    cnt = (num > TRIMESH_CHUNK) ? TRIMESH_CHUNK : num;
+
+    for (j=0; j<cnt; j++) {
+      flt e1x, e1y, e1z, e2x, e2y, e2z;
+      flt px, py, pz, qx, qy, qz, tx, ty, tz;
+      flt det, inv_det, u, v, tt;
+      int ok;
+
+      i = start + j;
+      e1x = m->e1[0][i];  e1y = m->e1[1][i];  e1z = m->e1[2][i];
+      e2x = m->e2[0][i];  e2y = m->e2[1][i];  e2z = m->e2[2][i];
+
+      /* pvec = d x edge2, det = edge1 . pvec */
+      px = dy * e2z - dz * e2y;
+      py = dz * e2x - dx * e2z;
+      pz = dx * e2y - dy * e2x;
+      det = e1x * px + e1y * py + e1z * pz;
+      ok = !(det > -ZEROEPSILON && det < ZEROEPSILON);
+      inv_det = 1.0f / (ok ? det : 1.0f);
+
+      /* tvec = o - v0, u = (tvec . pvec) / det */
+      tx = ox - m->v0[0][i];
+      ty = oy - m->v0[1][i];
+      tz = oz - m->v0[2][i];
+      u = (tx * px + ty * py + tz * pz) * inv_det;
+
+      /* qvec = tvec x edge1, v = (d . qvec) / det, t = (edge2 . qvec) / det */
+      qx = ty * e1z - tz * e1y;
+      qy = tz * e1x - tx * e1z;
+      qz = tx * e1y - ty * e1x;
+      v = (dx * qx + dy * qy + dz * qz) * inv_det;
+      tt = (e2x * qx + e2y * qy + e2z * qz) * inv_det;
+
+      ok = ok && !(u < 0.0 || u > 1.0) && !(v < 0.0 || u + v > 1.0);
+      t[j] = ok ? tt : 0.0f;
+    }
+
+    for (j=0; j<cnt; j++) {
+      if (t[j] > 0.0) {
+        olddist = ry->maxdist;
+        ry->add_intersection(t[j], (object *) m, ry);
+        if (ry->maxdist != olddist)
+          ry->intstruct.closest.prim = start + j;
+        if (ry->flags & RT_RAY_FINISHED)
+          return;
+      }
+    }
+  }
+}
+
+
+/* barycentric coordinates of the hit point within triangle i */
+static void trimesh_uv(const trimesh * m, int i, const vector * hit,
+                       vector * norm, flt * U, flt * V) {
+  vector e1, e2, P, tmp;
+  flt lensqr;
+
+  e1.x = m->e1[0][i];  e1.y = m->e1[1][i];  e1.z = m->e1[2][i];
+  e2.x = m->e2[0][i];  e2.y = m->e2[1][i];  e2.z = m->e2[2][i];
+  VCross(&e1, &e2, norm);
+  lensqr = VDot(norm, norm);
+
+  P.x = hit->x - m->v0[0][i];
+  P.y = hit->y - m->v0[1][i];
+  P.z = hit->z - m->v0[2][i];
+
+  VCross(&P, &e2, &tmp);
+  *U = VDot(&tmp, norm) / lensqr;
+
+  VCross(&e1, &P, &tmp);
+  *V = VDot(&tmp, norm) / lensqr;
+}
+
+
+/*
+ * Flat or interpolated normal of the triangle that was hit, flipped
+ * towards the viewer the way tri_normal() and the stri_normal() variants
+ * for each normal fixup mode do it.
+ */
+static void trimesh_normal(const trimesh * m, const vector * hit, const ray * incident, vector * N) {
+  int i = incident->intstruct.closest.prim;
+  const int * f;
+  vector norm;
+  flt U, V, W, invlen;
+  int flip;
+
+  trimesh_uv(m, i, hit, &norm, &U, &V);
+
+  if (m->n == NULL) {
+    invlen = 1.0f / SQRT(norm.x*norm.x + norm.y*norm.y + norm.z*norm.z);
+    N->x = norm.x * invlen;
+    N->y = norm.y * invlen;
+    N->z = norm.z * invlen;
+    flip = (VDot(N, &(incident->d)) > 0.0);
+  } else {
+    f = &m->facets[i * 3];
+    W = 1.0f - (U + V);
+    N->x = W*m->n[f[0]*3    ] + U*m->n[f[1]*3    ] + V*m->n[f[2]*3    ];
+    N->y = W*m->n[f[0]*3 + 1] + U*m->n[f[1]*3 + 1] + V*m->n[f[2]*3 + 1];
+    N->z = W*m->n[f[0]*3 + 2] + U*m->n[f[1]*3 + 2] + V*m->n[f[2]*3 + 2];
+
+    invlen = 1.0f / SQRT(N->x*N->x + N->y*N->y + N->z*N->z);
+    N->x *= invlen;
+    N->y *= invlen;
+    N->z *= invlen;
+
+    switch (m->fixup) {
+      case 2:  /* guess from the interpolated normal */
+        flip = (VDot(N, &(incident->d)) > 0.0);
+        break;
+      case 1:  /* reverse winding order */
+        flip = (VDot(&norm, &(incident->d)) < 0.0);
+        break;
+      case 0:  /* winding order */
+      default:
+        flip = (VDot(&norm, &(incident->d)) > 0.0);
+        break;
+    }
+  }
+
+  if (flip) {
+    N->x=-N->x;
+    N->y=-N->y;
+    N->z=-N->z;
+  }
+}
+
+
+/* vertex colors interpolated over the triangle that was hit */
+color trimesh_color(const vector * hit, const texture * tx, const ray * incident) {
+  const vcstri_texture * tex = (const vcstri_texture *) tx;
+  const trimesh * m = (const trimesh *) tex->obj;
+  int i = incident->intstruct.closest.prim;
+  const int * f = &m->facets[i * 3];
+  vector norm;
+  flt U, V, W;
+  color col;
+
+  trimesh_uv(m, i, hit, &norm, &U, &V);
+  W = 1.0f - (U + V);
+
+  col.r = W*m->c[f[0]*3    ] + U*m->c[f[1]*3    ] + V*m->c[f[2]*3    ];
+  col.g = W*m->c[f[0]*3 + 1] + U*m->c[f[1]*3 + 1] + V*m->c[f[2]*3 + 1];
+  col.b = W*m->c[f[0]*3 + 2] + U*m->c[f[1]*3 + 2] + V*m->c[f[2]*3 + 2];
+
+  return col;
+}
+
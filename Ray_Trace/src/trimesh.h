@@ -0,0 +1,50 @@
+/*
+ * trimesh.h - indexed triangle meshes with shared vertex data
+ *
+ * $Id$
+ *
+ */
+
+object * newtrimesh(scenedef * scene, void * tex, int numverts,
+                    const float * v, const float * n, const float * c,
+                    int numtris, const int * facets);
+color trimesh_color(const vector * hit, const texture * tex, const ray * incident);
+
+#ifdef TRIMESH_PRIVATE
+
+#define TRIMESH_CHUNK 16   /* triangles tested per pass through a leaf  */
+
+/*
+ * The triangles are stored in the leaf order of the mesh's own BVH, so a
+ * leaf is a contiguous run of them.  The intersection data of triangle i
+ * is v0[k][i], e1[k][i] and e2[k][i] for k = 0, 1, 2 (x, y, z), all held
+ * in one block.  Vertex normals and colors are shared between the
+ * triangles through facets[], which is only kept when one of them is.
+ */
+typedef struct {
+  RT_OBJECT_HEAD
+  vector min;             /* bounds of the mesh                           */
+  vector max;
+  int numtris;            /* triangles, degenerate ones removed           */
+  float * v0[3];          /* first vertex of each triangle                */
+  float * e1[3];          /* v1 - v0                                      */
+  float * e2[3];          /* v2 - v0                                      */
+  float * tridata;        /* the block holding v0, e1 and e2              */
+  int * facets;           /* vertex indices, 3 per triangle, or NULL      */
+  float * n;              /* vertex normals, 3 per vertex, or NULL        */
+  float * c;              /* vertex colors, 3 per vertex, or NULL         */
+  int fixup;              /* normal fixup mode of the scene               */
+  int numnodes;           /* nodes in the mesh's BVH                      */
+  bvhnode * nodes;
+} trimesh;
+
+static int trimesh_bbox(void * obj, vector * min, vector * max);
+static void trimesh_free(void * v);
+static void trimesh_intersect(const trimesh *, ray *);
+static void trimesh_leaf(const trimesh *, int start, int num, ray *);
+static void trimesh_uv(const trimesh *, int i, const vector *, vector *,
+                       flt *, flt *);
+static void trimesh_normal(const trimesh *, const vector *, const ray *, vector *);
+
+#endif
+
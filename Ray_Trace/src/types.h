@@ -15,23 +15,35 @@ struct ray_t;
 /* All floating point types will be based on "float" */
 #define SPEPSILON   0.0001f     /* amount to crawl down a ray           */
 #define EPSILON     0.0001f     /* amount to crawl down a ray           */
+#define RELEPSILON  0.00006f    /* extra crawl per unit of hit position */
+#define ZEROEPSILON 0.00000005f /* smallest determinant, edge length or */
+                                /* direction component taken as nonzero */
 #define FHUGE       1e18f       /* biggest fp number we care about      */
 #define TWOPI       6.28318531f /* guess... :-)                         */
 #define MINCONTRIB  0.001959f   /* 1.0 / 512.0, smallest contribution   */
                                 /* to overall pixel color we care about */
                                 /* XXX this must change for HDR images  */
+#define SQRT(x)     sqrtf(x)    /* math library calls that stay in the  */
+#define FABS(x)     fabsf(x)    /* precision of flt                     */
 #else
 /* All floating point types will be based on "double" */
 #define SPEPSILON   0.00000005  /* amount to crawl down a ray           */
 #define EPSILON     0.00000005  /* amount to crawl down a ray           */
+#define RELEPSILON  0.0         /* extra crawl per unit of hit position */
+#define ZEROEPSILON 0.00000005  /* smallest determinant, edge length or */
+                                /* direction component taken as nonzero */
 #define FHUGE       1e18        /* biggest fp number we care about      */
 #define TWOPI       6.28318531  /* guess... :-)                         */
 #define MINCONTRIB  0.001959    /* 1.0 / 512.0, smallest contribution   */
                                 /* to overall pixel color we care about */
                                 /* XXX this must change for HDR images  */
+#define SQRT(x)     sqrt(x)     /* math library calls that stay in the  */
+#define FABS(x)     fabs(x)     /* precision of flt                     */
 #endif
 
 #define BOUNDTHRESH 16         /* subdivide cells /w > # of children   */
+#define RT_TILESIZE 16         /* edge of the image tiles, in pixels   */
+#define RT_AA_GROUP 4          /* adaptive AA samples between checks   */
 
 /* 
  * Maximum internal table sizes 
@@ -187,6 +199,7 @@ typedef struct {
   void (* normal)(const void *, const void *, const void *, void *); /* normal function ptr    */
   int (* bbox)(void *, vector *, vector *);        /* return the object bbox */
   void (* freeobj)(void *);                        /* free the object        */
+  void (* packet_intersect)(const void *, void *); /* ray packet func ptr    */
 } object_methods;
 
 
@@ -215,6 +228,7 @@ typedef struct {
 typedef struct {
   const object * obj;        /* to object we hit                        */ 
   flt t;                     /* distance along the ray to the hit point */
+  int prim;                  /* triangle hit within a mesh object       */
 } intersection;
 
 
@@ -222,9 +236,32 @@ typedef struct {
   int num;                   /* number of intersections    */
   intersection closest;      /* closest intersection > 0.0 */
   flt shadowfilter;          /* modulation by transparent surfaces */
+  const flt * shadows;       /* per light filters from a shadow packet */
 } intersectstruct;
 
 
+/* 
+ * Mailbox of the objects a thread's current ray has been tested against.
+ * For small scenes it is an array of the last ray serial number that 
+ * tested each object, for larger ones a small open addressing hash table
+ * keyed by object id, where entries left by earlier rays have another 
+ * serial number and count as free.
+ */
+typedef struct {
+  unsigned long serial;      /* ray that tested the object */
+  unsigned int id;           /* id of the object           */
+} mboxentry;
+
+typedef struct {
+  unsigned long * direct;    /* serial numbers by object id, or NULL */
+  unsigned int numdirect;    /* objects in the direct array          */
+  mboxentry * entries;       /* the table, a power of two in size */
+  unsigned int mask;         /* number of entries - 1             */
+  unsigned int live;         /* entries used by the current ray   */
+  unsigned long serial;      /* serial number of the current ray  */
+} mailbox;
+
+
 
 typedef struct {
   int projection;            /* camera projection mode                  */
@@ -245,6 +282,8 @@ typedef struct {
   flt aperture;              /* depth of field aperture                 */
   vector projcent;           /* center of image plane in world coords   */
   color (* cam_ray)(void *, flt, flt);   /* camera ray generator fctn   */
+  void (* cam_setup)(void *, flt, flt);  /* untraced ray, for packets   */
+  color (* cam_sample)(void *, flt, flt); /* one jittered AA sample     */
   vector lowleft;            /* lower left corner of image plane        */
   vector iplaneright;        /* image plane right vector                */
   vector iplaneup;           /* image plane up    vector                */
@@ -316,9 +355,18 @@ typedef struct {
   flt aspectratio;           /* aspect ratio of output image            */
   int raydepth;              /* maximum recursion depth                 */
   int antialiasing;          /* number of antialiasing rays to fire     */
+  flt aathresh;              /* adaptive AA error threshold, 0 = fixed  */
+  int progressive;           /* render in refining passes               */
+  int (* progressfunc)(void *, int, int); /* called after each pass     */
+  void * progressdata;       /* user data passed to progressfunc        */
+  void * aabuf;              /* per pixel sample sums, progressive mode */
+  int aapass;                /* progressive pass being rendered         */
   int verbosemode;           /* verbose reporting flag                  */
   int boundmode;             /* automatic spatial subdivision flag      */
   int boundthresh;           /* threshold number of subobjects          */
+  void * bvhimport;          /* imported BVH for bvh_scene(), or NULL   */
+  int packetsize;            /* primary rays traced together, 0 = off   */
+  int tilesize;              /* edge of scheduled tiles, 0 = scanlines  */
   list * texlist;            /* linked list of texture objects          */
   list * cliplist;           /* linked list of clipping plane groups    */
   unsigned int flags;        /* scene feature requirement flags         */
@@ -353,7 +401,7 @@ typedef struct ray_t {
    unsigned int depth;    /* levels left to recurse.. (maxdepth - curdepth) */
    unsigned int flags;    /* ray flags, any special treatment needed etc    */
    unsigned long serial;  /* serial number of the ray                       */
-   unsigned long * mbox;  /* mailbox array for optimizing intersections     */
+   mailbox * mbox;        /* mailbox for optimizing intersections           */
    scenedef * scene;      /* pointer to the scene, for global parms such as */
                           /* background colors etc                          */
    unsigned int randval;  /* random number seed                             */
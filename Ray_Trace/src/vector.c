@@ -19,13 +19,13 @@ void VCross(const vector * a, const vector * b, vector * c) {
 }
 
 flt VLength(const vector * a) {
-  return (flt) sqrt((a->x * a->x) + (a->y * a->y) + (a->z * a->z));
+  return (flt) SQRT((a->x * a->x) + (a->y * a->y) + (a->z * a->z));
 }
 
 void VNorm(vector * a) {
   flt len;
 
-  len=sqrt((a->x * a->x) + (a->y * a->y) + (a->z * a->z));
+  len=SQRT((a->x * a->x) + (a->y * a->y) + (a->z * a->z));
   if (len != 0.0) {
     a->x /= len;
     a->y /= len;
@@ -61,6 +61,20 @@ vector Raypnt(const ray * a, flt t) {
   return temp;
 }
 
+/*
+ * Rayoffset()
+ *   origin for a secondary ray a leaving a surface from the hit point in
+ *   a->o: the point distance t down the ray, plus RELEPSILON times the
+ *   largest coordinate of the hit point.  A hit point is only accurate
+ *   to a few ulps of its coordinates, which in single precision can be
+ *   far more than a fixed crawl; RELEPSILON is zero in double precision.
+ */
+vector Rayoffset(const ray * a, flt t) {
+  flt m = MYMAX(MYMAX(FABS(a->o.x), FABS(a->o.y)), FABS(a->o.z));
+
+  return Raypnt(a, t + RELEPSILON * m);
+}
+
 void VScale(vector * a, flt s) {
   a->x *= s;
   a->y *= s;
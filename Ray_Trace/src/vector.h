@@ -12,6 +12,7 @@ void VAdd(const vector *, const vector *, vector *);
 void VSub(const vector *, const vector *, vector *);
 void VAddS(flt, const vector *, const vector *, vector *);
 vector Raypnt(const ray *, flt);
+vector Rayoffset(const ray *, flt);
 void VScale(vector * a, flt s); 
 
 void ColorAddS(color * a, const color * b, flt s); 
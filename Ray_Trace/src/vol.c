@@ -13,6 +13,7 @@
 #include "util.h"
 #include "parallel.h"
 #include "threads.h"
+#define VOL_PRIVATE
 #include "vol.h"
 #include "box.h"
 #include "trace.h"
@@ -43,6 +44,8 @@ void * newscalarvol(void * voidtex, vector min, vector max,
                     scalarvol * invol) {
   standard_texture * tx, * tex;
   scalarvol * vol;
+  volcells * vc;
+  int loaded;
 
   tex=(standard_texture *) voidtex;
   tex->flags = RT_TEXTURE_NOFLAGS; /* doesn't cast a shadow */
@@ -84,13 +87,13 @@ void * newscalarvol(void * voidtex, vector min, vector max,
   tx->opacity   = 1.0;
   tx->outline   = 0.0;
   tx->outlinewidth = 0.0;
-  tx->img = vol;
   tx->texfunc = (color(*)(const void *, const void *, void *))(scalar_volume_texture);
 
   tx->obj = (void *) newbox(tx, min, max); /* XXX hack!! */
 
   /* Force load of volume data so that we don't have to do mutex locks */
   /* inside the rendering threads                                      */
+  loaded=vol->loaded;
   if (!vol->loaded) {
     LoadVol(vol);
   }
@@ -100,6 +103,17 @@ void * newscalarvol(void * voidtex, vector min, vector max,
     tx->texfunc = (color(*)(const void *, const void *, void *))(constant_texture);
     tx->img = NULL;
     free(vol);
+  } else {
+    vc=malloc(sizeof(volcells));
+    vc->vol=vol;
+    vc->cells=NULL;
+
+    /* data loaded by the caller may change from frame to frame, */
+    /* so only the volumes we load ourselves get macrocells      */
+    if (!loaded) 
+      vol_cells(vc);
+
+    tx->img = vc;
   }
 
   return (void *) tx->obj;
@@ -136,13 +150,37 @@ color VoxelColor(flt scalar) {
   return col;
 } 
 
+/*
+ * The ray parameter at which a ray sampling voxel v along one axis first
+ * reaches a voxel of another macrocell, or FHUGE if it leaves the volume
+ * first.  Samples map to voxels as in scalar_volume_texture() below.
+ */
+static flt vol_cellexit(flt o, flt d, flt min, flt len, int res, int v) {
+  int b;
+
+  if (d > 0.0) {
+    b = ((v >> VOL_CELLSHIFT) + 1) << VOL_CELLSHIFT;
+    if (b > res - 1) 
+      return FHUGE;
+  } else if (d < 0.0) {
+    b = (v >> VOL_CELLSHIFT) << VOL_CELLSHIFT;
+    if (b == 0)
+      return FHUGE;
+  } else {
+    return FHUGE;
+  }
+
+  return ((min + len * (b - 0.5) / (res - 1.5)) - o) / d;
+}
+
 color scalar_volume_texture(const vector * hit, const texture * tx, ray * ry) {
   color col, col2;
   box * bx;
   flt a, tx1, tx2, ty1, ty2, tz1, tz2;
   flt tnear, tfar;
-  flt t, tdist, dt, sum, tt; 
+  flt t, tdist, dt, sum, tt, texit, tc; 
   vector pnt, bln;
+  volcells * vc;
   scalarvol * vol;
   flt scalar, transval; 
   int x, y, z;
@@ -150,7 +188,8 @@ color scalar_volume_texture(const vector * hit, const texture * tx, ray * ry) {
   standard_texture * tex = (standard_texture *) tx;
 
   bx=(box *) tex->obj;
-  vol=(scalarvol *) ((standard_texture *) bx->tex)->img;
+  vc=(volcells *) ((standard_texture *) bx->tex)->img;
+  vol=vc->vol;
    
   col.r=0.0;
   col.g=0.0;
@@ -220,7 +259,8 @@ color scalar_volume_texture(const vector * hit, const texture * tx, ray * ry) {
   dt=sqrt(bln.x*bln.x + bln.y*bln.y + bln.z*bln.z) / tdist; 
   sum=0.0;
 
-  for (t=tnear; t<=tfar; t+=dt) {
+  t=tnear;
+  while (t<=tfar) {
     pnt.x=((ry->o.x + (ry->d.x * t)) - bx->min.x) / bln.x;
     pnt.y=((ry->o.y + (ry->d.y * t)) - bx->min.y) / bln.y;
     pnt.z=((ry->o.z + (ry->d.z * t)) - bx->min.z) / bln.z;
@@ -228,6 +268,26 @@ color scalar_volume_texture(const vector * hit, const texture * tx, ray * ry) {
     x=(int) ((vol->xres - 1.5) * pnt.x + 0.5);
     y=(int) ((vol->yres - 1.5) * pnt.y + 0.5);
     z=(int) ((vol->zres - 1.5) * pnt.z + 0.5);
+
+    /* Voxels of value zero add nothing, so when the whole macrocell */
+    /* is zero, step over every sample that is sure to stay in it.   */
+    /* The margin covers rounding in the sample to voxel mapping.   */
+    if (vc->cells != NULL && 
+        vc->cells[(((z >> VOL_CELLSHIFT) * vc->ycells) + 
+                    (y >> VOL_CELLSHIFT)) * vc->xcells + 
+                    (x >> VOL_CELLSHIFT)] == 0) {
+      texit=vol_cellexit(ry->o.x, ry->d.x, bx->min.x, bln.x, vol->xres, x);
+      tc=vol_cellexit(ry->o.y, ry->d.y, bx->min.y, bln.y, vol->yres, y);
+      if (tc < texit) texit=tc;
+      tc=vol_cellexit(ry->o.z, ry->d.z, bx->min.z, bln.z, vol->zres, z);
+      if (tc < texit) texit=tc;
+      texit -= 0.01 * dt;
+
+      do {
+        t+=dt;
+      } while (t < texit && t <= tfar);
+      continue;
+    }
    
     ptr = vol->data + ((vol->xres * vol->yres * z) + (vol->xres * y) + x);
    
@@ -247,7 +307,10 @@ color scalar_volume_texture(const vector * hit, const texture * tx, ray * ry) {
     }  
     else { 
       sum=1.0;
+      break; /* opaque, nothing further along the ray shows through */
     }
+
+    t+=dt;
   }
 
 
@@ -293,3 +356,36 @@ void LoadVol(scalarvol * vol) {
 }
 
 
+/*
+ * Find the largest voxel value of each macrocell of the volume.  Volumes
+ * too thin to map samples onto voxels the usual way don't get any.
+ */
+static void vol_cells(volcells * vc) {
+  scalarvol * vol = vc->vol;
+  int x, y, z, idx;
+  unsigned char * ptr, * cell;
+
+  if (vol->xres < 2 || vol->yres < 2 || vol->zres < 2)
+    return;
+
+  vc->xcells = ((vol->xres - 1) >> VOL_CELLSHIFT) + 1;
+  vc->ycells = ((vol->yres - 1) >> VOL_CELLSHIFT) + 1;
+  vc->zcells = ((vol->zres - 1) >> VOL_CELLSHIFT) + 1;
+  vc->cells = calloc(vc->xcells * vc->ycells * vc->zcells, 1);
+  if (vc->cells == NULL)
+    return;
+
+  ptr = vol->data;
+  for (z=0; z<vol->zres; z++) {
+    for (y=0; y<vol->yres; y++) {
+      idx = ((z >> VOL_CELLSHIFT) * vc->ycells + (y >> VOL_CELLSHIFT)) * 
+            vc->xcells;
+      for (x=0; x<vol->xres; x++) {
+        cell = &vc->cells[idx + (x >> VOL_CELLSHIFT)];
+        if (ptr[x] > *cell) 
+          *cell = ptr[x];
+      }
+      ptr += vol->xres;
+    }
+  }
+}
@@ -13,3 +13,25 @@ void * newscalarvol(void * intex, vector min, vector max,
 void  LoadVol(scalarvol *);
 color scalar_volume_texture(const vector *, const texture *, ray *);
 
+
+#ifdef VOL_PRIVATE
+
+#define VOL_CELLSHIFT 3  /* macrocells are 8x8x8 voxels */
+
+/*
+ * A scalar volume texture refers to its volume through this, along with
+ * the largest voxel value of each macrocell, so rays can step over the
+ * empty parts of the volume without sampling them.
+ */
+typedef struct {
+  scalarvol * vol;       /* the volume data                         */
+  unsigned char * cells; /* largest voxel of each macrocell, or NULL */
+  int xcells;            /* macrocells along the X axis             */
+  int ycells;            /* macrocells along the Y axis             */
+  int zcells;            /* macrocells along the Z axis             */
+} volcells;
+
+static void vol_cells(volcells * vc);
+static flt vol_cellexit(flt o, flt d, flt min, flt len, int res, int v);
+
+#endif